@@ -7,6 +7,10 @@ GPU Computing / GPGPU Praktikum source code.
 
 #include "CSimpleArraysTask.h"
 #include "CMatrixRotateTask.h"
+#include "CFusedExpressionTask.h"
+#include "CLayoutTransformTask.h"
+#include "CBatchedRotateTask.h"
+#include "CMatrixMultiplyTask.h"
 
 #include <iostream>
 
@@ -38,6 +42,76 @@ bool CAssignment1::DoCompute()
 		RunComputeTask(task, LocalWorkSize);
 	}
 
+	// Task 2 (in-place): rotation of square matrices within a single buffer.
+	std::cout << "Running in-place matrix rotation example..." << std::endl << std::endl;
+	{
+		size_t LocalWorkSize[3] = {16, 16, 1};
+		CMatrixRotateTask task(2048, 2048, true);
+		RunComputeTask(task, LocalWorkSize);
+
+		CMatrixRotateTask oddTask(1999, 1999, true);
+		RunComputeTask(oddTask, LocalWorkSize);
+	}
+
+	// Task 2b: matrix rotation benchmark over tile shapes and sizes that are not multiples of the tile.
+	std::cout << "Running matrix rotation benchmark..." << std::endl << std::endl;
+	{
+		const size_t tileShapes[][2] = { {16, 16}, {32, 8}, {8, 32}, {32, 16}, {64, 4} };
+		const size_t matrixSizes[][2] = { {2048, 1024}, {1920, 1080}, {1000, 777}, {4099, 513} };
+
+		for(size_t s = 0; s < ARRAYLEN(matrixSizes); s++)
+		{
+			for(size_t t = 0; t < ARRAYLEN(tileShapes); t++)
+			{
+				size_t LocalWorkSize[3] = {tileShapes[t][0], tileShapes[t][1], 1};
+				std::cout << "Matrix " << matrixSizes[s][0] << " x " << matrixSizes[s][1] << ", tile "
+					<< LocalWorkSize[0] << " x " << LocalWorkSize[1] << ":" << std::endl;
+				CMatrixRotateTask task(matrixSizes[s][0], matrixSizes[s][1]);
+				RunComputeTask(task, LocalWorkSize);
+			}
+		}
+	}
+
+	// Task 3: fused element-wise expression.
+	std::cout << "Running fused expression example..." << std::endl << std::endl;
+	{
+		size_t LocalWorkSize[3] = {256, 1, 1};
+		CFusedExpressionTask task(1 << 22);
+		RunComputeTask(task, LocalWorkSize);
+	}
+
+	// Task 4: layout transforms.
+	std::cout << "Running layout transform example..." << std::endl << std::endl;
+	{
+		//the local work size is chosen per transform
+		size_t LocalWorkSize[3] = {16, 16, 1};
+		CLayoutTransformTask task;
+		RunComputeTask(task, LocalWorkSize);
+	}
+
+	// Task 5: batched rotation of small matrices.
+	std::cout << "Running batched matrix rotation example..." << std::endl << std::endl;
+	{
+		size_t LocalWorkSize[3] = {16, 16, 1};
+		CBatchedRotateTask uniformTask(16384, 32, 32);
+		RunComputeTask(uniformTask, LocalWorkSize);
+
+		CBatchedRotateTask mixedTask(4096, 32, 128);
+		RunComputeTask(mixedTask, LocalWorkSize);
+	}
+
+	// Task 6: dense matrix multiplication.
+	std::cout << "Running matrix multiplication example..." << std::endl << std::endl;
+	{
+		//the work-group sizes are fixed by the kernel variants
+		size_t LocalWorkSize[3] = {16, 16, 1};
+		CMatrixMultiplyTask task(1024, 1024, 1024);
+		RunComputeTask(task, LocalWorkSize);
+
+		CMatrixMultiplyTask oddTask(1000, 777, 513);
+		RunComputeTask(oddTask, LocalWorkSize);
+	}
+
 	return true;
 }
 
@@ -0,0 +1,193 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CBatchedRotateTask.h"
+
+#include "../Common/CLUtil.h"
+#include "../Common/CTimer.h"
+#include "../Common/CValidator.h"
+
+#include <string.h>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CBatchedRotateTask
+
+CBatchedRotateTask::CBatchedRotateTask(size_t MatrixCount, size_t MinSize, size_t MaxSize)
+	: m_MatrixCount(MatrixCount), m_MinSize(MinSize), m_MaxSize(max(MinSize, MaxSize)), m_TotalSize(0),
+	m_dM(NULL), m_dMR(NULL), m_dMatrices(NULL), m_dTileStarts(NULL), m_Program(NULL), m_BatchedKernel(NULL)
+{
+}
+
+CBatchedRotateTask::~CBatchedRotateTask()
+{
+	ReleaseResources();
+}
+
+bool CBatchedRotateTask::InitResources(cl_device_id Device, cl_context Context)
+{
+	//pack the matrices back to back
+	m_Matrices.resize(m_MatrixCount);
+	m_TotalSize = 0;
+	for(size_t m = 0; m < m_MatrixCount; m++)
+	{
+		cl_uint sizeX = static_cast<cl_uint>(m_MinSize + rand() % (m_MaxSize - m_MinSize + 1));
+		cl_uint sizeY = static_cast<cl_uint>(m_MinSize + rand() % (m_MaxSize - m_MinSize + 1));
+		m_Matrices[m].s[0] = static_cast<cl_uint>(m_TotalSize);
+		m_Matrices[m].s[1] = static_cast<cl_uint>(m_TotalSize);
+		m_Matrices[m].s[2] = sizeX;
+		m_Matrices[m].s[3] = sizeY;
+		m_TotalSize += sizeX * sizeY;
+	}
+
+	//CPU resources
+	m_hM.resize(m_TotalSize);
+	m_hMR.resize(m_TotalSize);
+	m_hGPUResultBatched.resize(m_TotalSize);
+	m_hGPUResultLoop.resize(m_TotalSize);
+
+	for(size_t i = 0; i < m_TotalSize; i++)
+		m_hM[i] = float(rand()) / float(RAND_MAX);
+
+	//device resources
+	cl_int clError, clError2;
+	m_dM = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_float) * m_TotalSize, &m_hM[0], &clError2);
+	clError = clError2;
+	m_dMR = clCreateBuffer(Context, CL_MEM_WRITE_ONLY, sizeof(cl_float) * m_TotalSize, NULL, &clError2);
+	clError |= clError2;
+	m_dMatrices = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint4) * m_MatrixCount, &m_Matrices[0], &clError2);
+	clError |= clError2;
+	//the tile table depends on the work-group size, it is filled in ComputeGPU()
+	m_dTileStarts = clCreateBuffer(Context, CL_MEM_READ_ONLY, sizeof(cl_uint) * (m_MatrixCount + 1), NULL, &clError2);
+	clError |= clError2;
+	V_RETURN_FALSE_CL(clError, "Failed to allocate arrays!");
+
+	string programCode;
+	if(!CLUtil::LoadProgramSourceToMemory("MatrixRot.cl", programCode))
+		return false;
+	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode);
+	if(m_Program == nullptr)
+		return false;
+
+	m_BatchedKernel = clCreateKernel(m_Program, "MatrixRotBatched", &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create kernel: MatrixRotBatched");
+
+	clError = clSetKernelArg(m_BatchedKernel, 0, sizeof(cl_mem), (void*)&m_dM);
+	clError |= clSetKernelArg(m_BatchedKernel, 1, sizeof(cl_mem), (void*)&m_dMR);
+	clError |= clSetKernelArg(m_BatchedKernel, 2, sizeof(cl_mem), (void*)&m_dMatrices);
+	clError |= clSetKernelArg(m_BatchedKernel, 3, sizeof(cl_mem), (void*)&m_dTileStarts);
+	V_RETURN_FALSE_CL(clError, "Failed to set kernel args: MatrixRotBatched");
+
+	return true;
+}
+
+void CBatchedRotateTask::ReleaseResources()
+{
+	SAFE_RELEASE_MEMOBJECT(m_dM);
+	SAFE_RELEASE_MEMOBJECT(m_dMR);
+	SAFE_RELEASE_MEMOBJECT(m_dMatrices);
+	SAFE_RELEASE_MEMOBJECT(m_dTileStarts);
+
+	SAFE_RELEASE_KERNEL(m_BatchedKernel);
+	SAFE_RELEASE_PROGRAM(m_Program);
+}
+
+void CBatchedRotateTask::ComputeCPU()
+{
+	for(size_t m = 0; m < m_MatrixCount; m++)
+	{
+		const float* M = &m_hM[m_Matrices[m].s[0]];
+		float* MR = &m_hMR[m_Matrices[m].s[1]];
+		unsigned int sizeX = m_Matrices[m].s[2];
+		unsigned int sizeY = m_Matrices[m].s[3];
+
+		for(unsigned int y = 0; y < sizeY; y++)
+			for(unsigned int x = 0; x < sizeX; x++)
+				MR[x * sizeY + (sizeY - y - 1)] = M[y * sizeX + x];
+	}
+}
+
+void CBatchedRotateTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
+{
+	//tile table for the current work-group size
+	vector<cl_uint> tileStarts(m_MatrixCount + 1);
+	tileStarts[0] = 0;
+	for(size_t m = 0; m < m_MatrixCount; m++)
+	{
+		size_t tilesX = CLUtil::GetGlobalWorkSize(m_Matrices[m].s[2], LocalWorkSize[0]) / LocalWorkSize[0];
+		size_t tilesY = CLUtil::GetGlobalWorkSize(m_Matrices[m].s[3], LocalWorkSize[1]) / LocalWorkSize[1];
+		tileStarts[m + 1] = tileStarts[m] + static_cast<cl_uint>(tilesX * tilesY);
+	}
+	V_RETURN_CL(clEnqueueWriteBuffer(CommandQueue, m_dTileStarts, CL_TRUE, 0, sizeof(cl_uint) * (m_MatrixCount + 1), &tileStarts[0], 0, NULL, NULL),
+		"Error copying data from host to device!");
+
+	cl_int clErr = clSetKernelArg(m_BatchedKernel, 6, (LocalWorkSize[0] + 1) * LocalWorkSize[1] * sizeof(float), NULL);
+	V_RETURN_CL(clErr, "Failed to set kernel args: MatrixRotBatched");
+
+	cout<<endl<<"Rotating "<<m_MatrixCount<<" matrices ("<<m_MinSize<<" to "<<m_MaxSize<<" elements per side, "
+		<<tileStarts[m_MatrixCount]<<" tiles of "<<LocalWorkSize[0]<<" x "<<LocalWorkSize[1]<<")."<<endl;
+
+	//one launch for all matrices
+	cl_uint firstMatrix = 0;
+	cl_uint matrixCount = static_cast<cl_uint>(m_MatrixCount);
+	clErr = clSetKernelArg(m_BatchedKernel, 4, sizeof(cl_uint), (void*)&firstMatrix);
+	clErr |= clSetKernelArg(m_BatchedKernel, 5, sizeof(cl_uint), (void*)&matrixCount);
+	V_RETURN_CL(clErr, "Failed to set kernel args: MatrixRotBatched");
+
+	size_t globalWorkSize[2] = {tileStarts[m_MatrixCount] * LocalWorkSize[0], LocalWorkSize[1]};
+	double time = CLUtil::ProfileKernel(CommandQueue, m_BatchedKernel, 2, globalWorkSize, LocalWorkSize, 8);
+	cout<<"Batched kernel:   "<<time<<" ms, "<<m_MatrixCount / (time * 1.0e-3)<<" matrices/s."<<endl;
+
+	V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dMR, CL_TRUE, 0, m_TotalSize * sizeof(float), &m_hGPUResultBatched[0], 0, NULL, NULL),
+		"Error reading data from device to host!");
+
+	//one launch per matrix
+	//(clear the output first, so that the batched results cannot hide missing writes)
+	memset(&m_hGPUResultLoop[0], 0, m_TotalSize * sizeof(float));
+	V_RETURN_CL(clEnqueueWriteBuffer(CommandQueue, m_dMR, CL_TRUE, 0, m_TotalSize * sizeof(float), &m_hGPUResultLoop[0], 0, NULL, NULL),
+		"Error copying data from host to device!");
+
+	matrixCount = 1;
+	clErr = clSetKernelArg(m_BatchedKernel, 5, sizeof(cl_uint), (void*)&matrixCount);
+	V_RETURN_CL(clErr, "Failed to set kernel args: MatrixRotBatched");
+
+	CTimer timer;
+	timer.Start();
+	for(size_t m = 0; m < m_MatrixCount; m++)
+	{
+		firstMatrix = static_cast<cl_uint>(m);
+		clErr = clSetKernelArg(m_BatchedKernel, 4, sizeof(cl_uint), (void*)&firstMatrix);
+		globalWorkSize[0] = (tileStarts[m + 1] - tileStarts[m]) * LocalWorkSize[0];
+		clErr |= clEnqueueNDRangeKernel(CommandQueue, m_BatchedKernel, 2, NULL, globalWorkSize, LocalWorkSize, 0, NULL, NULL);
+		V_RETURN_CL(clErr, "Error executing kernel!");
+	}
+	V_RETURN_CL(clFinish(CommandQueue), "Error finishing the queue!");
+	timer.Stop();
+
+	time = timer.GetElapsedMilliseconds();
+	cout<<"Per-matrix loop:  "<<time<<" ms, "<<m_MatrixCount / (time * 1.0e-3)<<" matrices/s."<<endl;
+
+	V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dMR, CL_TRUE, 0, m_TotalSize * sizeof(float), &m_hGPUResultLoop[0], 0, NULL, NULL),
+		"Error reading data from device to host!");
+}
+
+bool CBatchedRotateTask::ValidateResults()
+{
+	CValidator validator;
+	if(!validator.Compare(&m_hMR[0], &m_hGPUResultBatched[0], m_TotalSize))
+	{
+		validator.PrintMismatches("Results of the batched kernel are incorrect");
+		return false;
+	}
+	if(!validator.Compare(&m_hMR[0], &m_hGPUResultLoop[0], m_TotalSize))
+	{
+		validator.PrintMismatches("Results of the per-matrix launches are incorrect");
+		return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
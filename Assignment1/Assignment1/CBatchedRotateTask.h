@@ -0,0 +1,76 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CBATCHED_ROTATE_TASK_H
+#define _CBATCHED_ROTATE_TASK_H
+
+#include "../Common/IComputeTask.h"
+
+#include <vector>
+
+//! A1/T5: Batched rotation of many small matrices
+/*!
+	All matrices are stored back to back in one buffer and rotated clockwise
+	by a single launch of MatrixRotBatched. The matrices may have different
+	sizes, an offsets table describes where each of them starts. For
+	comparison, the same kernel is also launched once per matrix.
+*/
+class CBatchedRotateTask : public IComputeTask
+{
+public:
+	//! MatrixCount matrices with random side lengths between MinSize and MaxSize (all equal if MinSize == MaxSize)
+	CBatchedRotateTask(size_t MatrixCount, size_t MinSize, size_t MaxSize);
+	virtual ~CBatchedRotateTask();
+
+	// IComputeTask
+
+	virtual bool InitResources(cl_device_id Device, cl_context Context);
+
+	virtual void ReleaseResources();
+
+	virtual void ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
+
+	virtual void ComputeCPU();
+
+	virtual bool ValidateResults();
+
+protected:
+	size_t					m_MatrixCount;
+	size_t					m_MinSize;
+	size_t					m_MaxSize;
+
+	//(input offset, output offset, SizeX, SizeY) for each matrix
+	std::vector<cl_uint4>	m_Matrices;
+	size_t					m_TotalSize;
+
+	//float data on the CPU
+	std::vector<float>		m_hM, m_hMR;
+	std::vector<float>		m_hGPUResultBatched, m_hGPUResultLoop;
+
+	//pointers on the GPU
+	cl_mem					m_dM, m_dMR;
+	cl_mem					m_dMatrices, m_dTileStarts;
+
+	//OpenCL program and kernels
+	cl_program				m_Program;
+	cl_kernel				m_BatchedKernel;
+};
+
+#endif // _CBATCHED_ROTATE_TASK_H
@@ -0,0 +1,325 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CFUSED_EXPRESSION_H
+#define _CFUSED_EXPRESSION_H
+
+#include "../Common/CLUtil.h"
+#include "../Common/CProgramCache.h"
+
+#include <string>
+#include <sstream>
+#include <vector>
+
+//! Element-wise expressions over device arrays that are evaluated by a single, generated kernel
+/*!
+	Writing (a + b) * c - d with one kernel per operation allocates temporary
+	arrays and reads / writes the full data once per operation. Here the C++
+	operators only build an expression tree (expression templates). When the tree
+	is evaluated, one OpenCL kernel is generated for the whole expression, compiled
+	through a CProgramCache and executed. Each input is read once and the result
+	is written once.
+
+	Usage:
+		CDeviceArray<float> a, b, c, d, out;
+		...
+		CFusedEvaluator evaluator(Device, Context, programCache);
+		evaluator.Evaluate(CommandQueue, out, (a + b) * c - d, 256);
+
+	Scalars are passed as kernel arguments, so changing a constant does not
+	trigger a recompilation.
+*/
+
+//! OpenCL type names of the supported element types
+template <typename T> struct CLTypeName;
+template <> struct CLTypeName<float>		{ static const char* Get() { return "float"; } };
+template <> struct CLTypeName<int>			{ static const char* Get() { return "int"; } };
+template <> struct CLTypeName<unsigned int>	{ static const char* Get() { return "uint"; } };
+
+//! Simple typed wrapper around a cl_mem buffer
+template <typename T>
+class CDeviceArray
+{
+public:
+	typedef T ValueType;
+
+	CDeviceArray() : m_Buffer(nullptr), m_Size(0) {}
+	~CDeviceArray() { Release(); }
+
+	bool Create(cl_context Context, size_t Size, cl_mem_flags Flags = CL_MEM_READ_WRITE)
+	{
+		Release();
+		cl_int clError;
+		m_Buffer = clCreateBuffer(Context, Flags, Size * sizeof(T), NULL, &clError);
+		V_RETURN_FALSE_CL(clError, "Error allocating device array");
+		m_Size = Size;
+		return true;
+	}
+
+	void Release()
+	{
+		SAFE_RELEASE_MEMOBJECT(m_Buffer);
+		m_Size = 0;
+	}
+
+	cl_mem GetBuffer() const { return m_Buffer; }
+	size_t GetSize() const { return m_Size; }
+
+protected:
+	// copying would release the buffer twice
+	CDeviceArray(const CDeviceArray&);
+	CDeviceArray& operator=(const CDeviceArray&);
+
+	cl_mem		m_Buffer;
+	size_t		m_Size;
+};
+
+//! Collects the kernel arguments while the source of an expression is generated
+template <typename T>
+class CFusedKernelBuilder
+{
+public:
+	//! Returns the parameter name of an array, each buffer becomes exactly one parameter
+	std::string AddArray(const CDeviceArray<T>& Array)
+	{
+		size_t i = 0;
+		for(; i < m_Arrays.size(); i++)
+			if(m_Arrays[i] == Array.GetBuffer())
+				break;
+		if(i == m_Arrays.size())
+		{
+			m_Arrays.push_back(Array.GetBuffer());
+			m_ArraySizes.push_back(Array.GetSize());
+		}
+
+		std::stringstream name;
+		name<<"A"<<i;
+		return name.str();
+	}
+
+	std::string AddScalar(T Value)
+	{
+		std::stringstream name;
+		name<<"S"<<m_Scalars.size();
+		m_Scalars.push_back(Value);
+		return name.str();
+	}
+
+	std::vector<cl_mem>		m_Arrays;
+	std::vector<size_t>		m_ArraySizes;
+	std::vector<T>			m_Scalars;
+};
+
+// Expression nodes. Each node generates the OpenCL expression for the element with index 'i'.
+
+template <typename T>
+class CArrayExpr
+{
+public:
+	typedef T ValueType;
+
+	CArrayExpr(const CDeviceArray<T>& Array) : m_Array(Array) {}
+
+	std::string Generate(CFusedKernelBuilder<T>& Builder) const
+	{
+		return Builder.AddArray(m_Array) + "[i]";
+	}
+
+protected:
+	const CDeviceArray<T>&	m_Array;
+};
+
+template <typename T>
+class CScalarExpr
+{
+public:
+	typedef T ValueType;
+
+	CScalarExpr(T Value) : m_Value(Value) {}
+
+	std::string Generate(CFusedKernelBuilder<T>& Builder) const
+	{
+		return Builder.AddScalar(m_Value);
+	}
+
+protected:
+	T		m_Value;
+};
+
+struct FusedAdd { static std::string Apply(const std::string& L, const std::string& R) { return "(" + L + " + " + R + ")"; } };
+struct FusedSub { static std::string Apply(const std::string& L, const std::string& R) { return "(" + L + " - " + R + ")"; } };
+struct FusedMul { static std::string Apply(const std::string& L, const std::string& R) { return "(" + L + " * " + R + ")"; } };
+struct FusedDiv { static std::string Apply(const std::string& L, const std::string& R) { return "(" + L + " / " + R + ")"; } };
+struct FusedMin { static std::string Apply(const std::string& L, const std::string& R) { return "min(" + L + ", " + R + ")"; } };
+struct FusedMax { static std::string Apply(const std::string& L, const std::string& R) { return "max(" + L + ", " + R + ")"; } };
+
+template <class TOp, class TLeft, class TRight>
+class CBinaryExpr
+{
+public:
+	typedef typename TLeft::ValueType ValueType;
+
+	CBinaryExpr(const TLeft& Left, const TRight& Right) : m_Left(Left), m_Right(Right) {}
+
+	std::string Generate(CFusedKernelBuilder<ValueType>& Builder) const
+	{
+		// the order of the calls defines the order of the kernel parameters
+		std::string left = m_Left.Generate(Builder);
+		std::string right = m_Right.Generate(Builder);
+		return TOp::Apply(left, right);
+	}
+
+protected:
+	// the nodes are small, so we store them by value: temporaries of an
+	// expression like (a + b) * c are gone when the full expression is evaluated
+	TLeft	m_Left;
+	TRight	m_Right;
+};
+
+// Maps the operands of the overloaded operators to expression nodes
+
+template <class E> struct FusedOperand {};
+template <typename T> struct FusedOperand< CDeviceArray<T> >
+{
+	typedef CArrayExpr<T> Type;
+	static Type Make(const CDeviceArray<T>& Array) { return Type(Array); }
+};
+template <typename T> struct FusedOperand< CArrayExpr<T> >
+{
+	typedef CArrayExpr<T> Type;
+	static const Type& Make(const Type& E) { return E; }
+};
+template <typename T> struct FusedOperand< CScalarExpr<T> >
+{
+	typedef CScalarExpr<T> Type;
+	static const Type& Make(const Type& E) { return E; }
+};
+template <class TOp, class L, class R> struct FusedOperand< CBinaryExpr<TOp, L, R> >
+{
+	typedef CBinaryExpr<TOp, L, R> Type;
+	static const Type& Make(const Type& E) { return E; }
+};
+
+#define FUSED_BINARY_OPERATOR(OPERATOR, OP)																	\
+	template <class L, class R>																				\
+	CBinaryExpr<OP, typename FusedOperand<L>::Type, typename FusedOperand<R>::Type>							\
+	OPERATOR(const L& Left, const R& Right)																	\
+	{																										\
+		return CBinaryExpr<OP, typename FusedOperand<L>::Type, typename FusedOperand<R>::Type>(				\
+			FusedOperand<L>::Make(Left), FusedOperand<R>::Make(Right));										\
+	}																										\
+	template <class L>																						\
+	CBinaryExpr<OP, typename FusedOperand<L>::Type, CScalarExpr<typename FusedOperand<L>::Type::ValueType> >	\
+	OPERATOR(const L& Left, typename FusedOperand<L>::Type::ValueType Right)								\
+	{																										\
+		typedef CScalarExpr<typename FusedOperand<L>::Type::ValueType> TScalar;								\
+		return CBinaryExpr<OP, typename FusedOperand<L>::Type, TScalar>(FusedOperand<L>::Make(Left), TScalar(Right));	\
+	}																										\
+	template <class R>																						\
+	CBinaryExpr<OP, CScalarExpr<typename FusedOperand<R>::Type::ValueType>, typename FusedOperand<R>::Type>	\
+	OPERATOR(typename FusedOperand<R>::Type::ValueType Left, const R& Right)								\
+	{																										\
+		typedef CScalarExpr<typename FusedOperand<R>::Type::ValueType> TScalar;								\
+		return CBinaryExpr<OP, TScalar, typename FusedOperand<R>::Type>(TScalar(Left), FusedOperand<R>::Make(Right));	\
+	}
+
+FUSED_BINARY_OPERATOR(operator+, FusedAdd)
+FUSED_BINARY_OPERATOR(operator-, FusedSub)
+FUSED_BINARY_OPERATOR(operator*, FusedMul)
+FUSED_BINARY_OPERATOR(operator/, FusedDiv)
+FUSED_BINARY_OPERATOR(FusedMinimum, FusedMin)
+FUSED_BINARY_OPERATOR(FusedMaximum, FusedMax)
+
+#undef FUSED_BINARY_OPERATOR
+
+//! Generates, compiles (through the cache) and runs the fused kernel of an expression
+class CFusedEvaluator
+{
+public:
+	CFusedEvaluator(cl_device_id Device, cl_context Context, CProgramCache& Cache)
+		: m_Device(Device), m_Context(Context), m_Cache(Cache) {}
+
+	//! Returns the kernel source for the expression, this is also the key used for caching
+	template <typename T, class E>
+	static std::string GenerateSource(const E& Expr, CFusedKernelBuilder<T>& Builder)
+	{
+		std::string body = Expr.Generate(Builder);
+		const char* type = CLTypeName<T>::Get();
+
+		std::stringstream src;
+		// do not contract mul + add into fma, so the result is the same as on the CPU
+		src<<"#pragma OPENCL FP_CONTRACT OFF\n";
+		src<<"__kernel void FusedElementwise(__global "<<type<<"* Out";
+		for(size_t i = 0; i < Builder.m_Arrays.size(); i++)
+			src<<", __global const "<<type<<"* A"<<i;
+		for(size_t i = 0; i < Builder.m_Scalars.size(); i++)
+			src<<", const "<<type<<" S"<<i;
+		src<<", uint N)\n";
+		src<<"{\n";
+		src<<"\tuint i = get_global_id(0);\n";
+		src<<"\tif(i < N)\n";
+		src<<"\t\tOut[i] = "<<body<<";\n";
+		src<<"}\n";
+		return src.str();
+	}
+
+	//! Evaluates Out[i] = Expr(i) for all elements of Out
+	template <typename T, class E>
+	bool Evaluate(cl_command_queue CommandQueue, CDeviceArray<T>& Out, const E& Expr, size_t LocalWorkSize)
+	{
+		CFusedKernelBuilder<T> builder;
+		std::string source = GenerateSource(typename FusedOperand<E>::Type(FusedOperand<E>::Make(Expr)), builder);
+
+		for(size_t i = 0; i < builder.m_ArraySizes.size(); i++)
+			if(builder.m_ArraySizes[i] < Out.GetSize())
+			{
+				std::cerr<<"Error: operand "<<i<<" of the fused expression is smaller than the output array."<<std::endl;
+				return false;
+			}
+
+		cl_kernel kernel = m_Cache.GetKernel(m_Device, m_Context, source, "FusedElementwise");
+		if(kernel == nullptr)
+			return false;
+
+		cl_uint arg = 0;
+		cl_mem out = Out.GetBuffer();
+		cl_int clError = clSetKernelArg(kernel, arg++, sizeof(cl_mem), (void*)&out);
+		for(size_t i = 0; i < builder.m_Arrays.size(); i++)
+			clError |= clSetKernelArg(kernel, arg++, sizeof(cl_mem), (void*)&builder.m_Arrays[i]);
+		for(size_t i = 0; i < builder.m_Scalars.size(); i++)
+			clError |= clSetKernelArg(kernel, arg++, sizeof(T), (void*)&builder.m_Scalars[i]);
+		cl_uint n = static_cast<cl_uint>(Out.GetSize());
+		clError |= clSetKernelArg(kernel, arg++, sizeof(cl_uint), (void*)&n);
+		V_RETURN_FALSE_CL(clError, "Failed to set kernel args: FusedElementwise");
+
+		size_t globalWorkSize = CLUtil::GetGlobalWorkSize(Out.GetSize(), LocalWorkSize);
+		V_RETURN_FALSE_CL(clEnqueueNDRangeKernel(CommandQueue, kernel, 1, NULL, &globalWorkSize, &LocalWorkSize, 0, NULL, NULL),
+			"Error executing kernel: FusedElementwise");
+
+		return true;
+	}
+
+protected:
+	cl_device_id		m_Device;
+	cl_context			m_Context;
+	CProgramCache&		m_Cache;
+};
+
+#endif // _CFUSED_EXPRESSION_H
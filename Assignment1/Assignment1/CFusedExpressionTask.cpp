@@ -0,0 +1,164 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CFusedExpressionTask.h"
+
+#include "../Common/CLUtil.h"
+#include "../Common/CTimer.h"
+#include "../Common/CValidator.h"
+
+#include <string.h>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CFusedExpressionTask
+
+CFusedExpressionTask::CFusedExpressionTask(size_t ArraySize)
+	: m_ArraySize(ArraySize)
+{
+}
+
+CFusedExpressionTask::~CFusedExpressionTask()
+{
+	ReleaseResources();
+}
+
+bool CFusedExpressionTask::InitResources(cl_device_id Device, cl_context Context)
+{
+	m_Device = Device;
+	m_Context = Context;
+
+	//CPU resources
+	m_hA = new float[m_ArraySize];
+	m_hB = new float[m_ArraySize];
+	m_hC = new float[m_ArraySize];
+	m_hD = new float[m_ArraySize];
+	m_hResult = new float[m_ArraySize];
+	m_hGPUResultFused = new float[m_ArraySize];
+	m_hGPUResultUnfused = new float[m_ArraySize];
+
+	for(unsigned int i = 0; i < m_ArraySize; i++)
+	{
+		m_hA[i] = float(rand()) / float(RAND_MAX);
+		m_hB[i] = float(rand()) / float(RAND_MAX);
+		m_hC[i] = float(rand()) / float(RAND_MAX);
+		m_hD[i] = float(rand()) / float(RAND_MAX);
+	}
+
+	//device resources
+	if(!m_dA.Create(Context, m_ArraySize, CL_MEM_READ_ONLY) || !m_dB.Create(Context, m_ArraySize, CL_MEM_READ_ONLY) ||
+		!m_dC.Create(Context, m_ArraySize, CL_MEM_READ_ONLY) || !m_dD.Create(Context, m_ArraySize, CL_MEM_READ_ONLY))
+		return false;
+	if(!m_dOut.Create(Context, m_ArraySize) || !m_dTemp[0].Create(Context, m_ArraySize) || !m_dTemp[1].Create(Context, m_ArraySize))
+		return false;
+
+	return true;
+}
+
+void CFusedExpressionTask::ReleaseResources()
+{
+	//CPU resources
+	SAFE_DELETE_ARRAY(m_hA);
+	SAFE_DELETE_ARRAY(m_hB);
+	SAFE_DELETE_ARRAY(m_hC);
+	SAFE_DELETE_ARRAY(m_hD);
+	SAFE_DELETE_ARRAY(m_hResult);
+	SAFE_DELETE_ARRAY(m_hGPUResultFused);
+	SAFE_DELETE_ARRAY(m_hGPUResultUnfused);
+
+	//GPU resources
+	m_dA.Release();
+	m_dB.Release();
+	m_dC.Release();
+	m_dD.Release();
+	m_dOut.Release();
+	m_dTemp[0].Release();
+	m_dTemp[1].Release();
+
+	m_ProgramCache.Release();
+}
+
+void CFusedExpressionTask::ComputeCPU()
+{
+	for(unsigned int i = 0; i < m_ArraySize; i++)
+	{
+		m_hResult[i] = (m_hA[i] + m_hB[i]) * m_hC[i] - m_hD[i];
+	}
+}
+
+void CFusedExpressionTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
+{
+	size_t dataSize = m_ArraySize * sizeof(float);
+	V_RETURN_CL(clEnqueueWriteBuffer(CommandQueue, m_dA.GetBuffer(), CL_FALSE, 0, dataSize, m_hA, 0, NULL, NULL), "Error copying data from host to device!");
+	V_RETURN_CL(clEnqueueWriteBuffer(CommandQueue, m_dB.GetBuffer(), CL_FALSE, 0, dataSize, m_hB, 0, NULL, NULL), "Error copying data from host to device!");
+	V_RETURN_CL(clEnqueueWriteBuffer(CommandQueue, m_dC.GetBuffer(), CL_FALSE, 0, dataSize, m_hC, 0, NULL, NULL), "Error copying data from host to device!");
+	V_RETURN_CL(clEnqueueWriteBuffer(CommandQueue, m_dD.GetBuffer(), CL_FALSE, 0, dataSize, m_hD, 0, NULL, NULL), "Error copying data from host to device!");
+
+	CFusedEvaluator evaluator(m_Device, m_Context, m_ProgramCache);
+	const int nIterations = 10;
+	CTimer timer;
+
+	//fused: one kernel, 4 reads and 1 write per element
+	//(the first evaluation compiles the kernel, so it is not timed)
+	if(!evaluator.Evaluate(CommandQueue, m_dOut, (m_dA + m_dB) * m_dC - m_dD, LocalWorkSize[0]))
+		return;
+	V_RETURN_CL(clFinish(CommandQueue), "Error finishing the queue!");
+
+	timer.Start();
+	for(int i = 0; i < nIterations; i++)
+		evaluator.Evaluate(CommandQueue, m_dOut, (m_dA + m_dB) * m_dC - m_dD, LocalWorkSize[0]);
+	V_RETURN_CL(clFinish(CommandQueue), "Error finishing the queue!");
+	timer.Stop();
+
+	double msFused = timer.GetElapsedMilliseconds() / double(nIterations);
+	V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dOut.GetBuffer(), CL_TRUE, 0, dataSize, m_hGPUResultFused, 0, NULL, NULL),
+		"Error reading data from device to host!");
+
+	//unfused: one kernel per operation, 6 reads and 3 writes per element
+	if(!evaluator.Evaluate(CommandQueue, m_dTemp[0], m_dA + m_dB, LocalWorkSize[0]) ||
+		!evaluator.Evaluate(CommandQueue, m_dTemp[1], m_dTemp[0] * m_dC, LocalWorkSize[0]) ||
+		!evaluator.Evaluate(CommandQueue, m_dOut, m_dTemp[1] - m_dD, LocalWorkSize[0]))
+		return;
+	V_RETURN_CL(clFinish(CommandQueue), "Error finishing the queue!");
+
+	timer.Start();
+	for(int i = 0; i < nIterations; i++)
+	{
+		evaluator.Evaluate(CommandQueue, m_dTemp[0], m_dA + m_dB, LocalWorkSize[0]);
+		evaluator.Evaluate(CommandQueue, m_dTemp[1], m_dTemp[0] * m_dC, LocalWorkSize[0]);
+		evaluator.Evaluate(CommandQueue, m_dOut, m_dTemp[1] - m_dD, LocalWorkSize[0]);
+	}
+	V_RETURN_CL(clFinish(CommandQueue), "Error finishing the queue!");
+	timer.Stop();
+
+	double msUnfused = timer.GetElapsedMilliseconds() / double(nIterations);
+	V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dOut.GetBuffer(), CL_TRUE, 0, dataSize, m_hGPUResultUnfused, 0, NULL, NULL),
+		"Error reading data from device to host!");
+
+	cout<<endl<<"Compiled "<<m_ProgramCache.GetProgramCount()<<" programs for "<<(1 + nIterations) * 4<<" evaluations."<<endl;
+	cout<<"  fused:   "<<msFused<<" ms, "<<1.0e-6 * 5.0 * dataSize / msFused<<" GB/s effective"<<endl;
+	cout<<"  unfused: "<<msUnfused<<" ms, "<<1.0e-6 * 9.0 * dataSize / msUnfused<<" GB/s effective"<<endl;
+}
+
+bool CFusedExpressionTask::ValidateResults()
+{
+	// the generated kernels do not contract into fma (FP_CONTRACT OFF), but the host compiler
+	// may fuse (a + b) * c - d when it targets FMA, which changes the last bits
+	CValidator validator(CValidator::ULP, 4);
+	if(!validator.Compare(m_hResult, m_hGPUResultFused, m_ArraySize))
+	{
+		validator.PrintMismatches("Results of the fused kernel are incorrect");
+		return false;
+	}
+	if(!validator.Compare(m_hResult, m_hGPUResultUnfused, m_ArraySize))
+	{
+		validator.PrintMismatches("Results of the unfused kernels are incorrect");
+		return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
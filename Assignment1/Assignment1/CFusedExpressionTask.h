@@ -0,0 +1,72 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CFUSED_EXPRESSION_TASK_H
+#define _CFUSED_EXPRESSION_TASK_H
+
+#include "../Common/IComputeTask.h"
+#include "../Common/CProgramCache.h"
+
+#include "CFusedExpression.h"
+
+//! A1/T3: Fused element-wise expression (a + b) * c - d
+/*!
+	Evaluates the expression once with a single generated kernel and once
+	as a chain of single-operation kernels with temporary arrays, to compare
+	the cost of the intermediate memory round-trips.
+*/
+class CFusedExpressionTask : public IComputeTask
+{
+public:
+	CFusedExpressionTask(size_t ArraySize);
+	virtual ~CFusedExpressionTask();
+
+	// IComputeTask
+
+	virtual bool InitResources(cl_device_id Device, cl_context Context);
+
+	virtual void ReleaseResources();
+
+	virtual void ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
+
+	virtual void ComputeCPU();
+
+	virtual bool ValidateResults();
+
+protected:
+	size_t					m_ArraySize = 0;
+
+	//float arrays on the CPU
+	float					*m_hA = nullptr, *m_hB = nullptr, *m_hC = nullptr, *m_hD = nullptr;
+	float					*m_hResult = nullptr;
+	float					*m_hGPUResultFused = nullptr, *m_hGPUResultUnfused = nullptr;
+
+	//float arrays on the GPU
+	CDeviceArray<float>		m_dA, m_dB, m_dC, m_dD;
+	CDeviceArray<float>		m_dOut;
+	//intermediate results of the unfused evaluation
+	CDeviceArray<float>		m_dTemp[2];
+
+	cl_device_id			m_Device = nullptr;
+	cl_context				m_Context = nullptr;
+	CProgramCache			m_ProgramCache;
+};
+
+#endif // _CFUSED_EXPRESSION_TASK_H
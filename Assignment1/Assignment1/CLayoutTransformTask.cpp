@@ -0,0 +1,165 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CLayoutTransformTask.h"
+
+#include "../Common/CLUtil.h"
+#include "../Common/CTimer.h"
+
+#include <string.h>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CLayoutTransformTask
+
+CLayoutTransformTask::CLayoutTransformTask()
+{
+	// NCHW <-> NHWC of a float tensor
+	const size_t nchw[4] = {4, 32, 128, 128};
+	const size_t nhwc[4] = {4, 128, 128, 32};
+	const unsigned int toNHWC[4] = {0, 2, 3, 1};
+	const unsigned int toNCHW[4] = {0, 3, 1, 2};
+	AddCase("NCHW -> NHWC (float)", CLayoutTransform::Permute(4, nchw, toNHWC, sizeof(float)));
+	AddCase("NHWC -> NCHW (float)", CLayoutTransform::Permute(4, nhwc, toNCHW, sizeof(float)));
+
+	// RGB planes of an 8 bit image to interleaved pixels
+	const size_t chw[3] = {3, 1080, 1920};
+	const unsigned int toHWC[3] = {1, 2, 0};
+	AddCase("CHW -> HWC (uchar)", CLayoutTransform::Permute(3, chw, toHWC, 1));
+
+	// rotations and flips of RGBA8 and 8 bit images
+	AddCase("rotate 90 (uchar4)", CLayoutTransform::Rotate(1920, 1080, 90, 4));
+	AddCase("rotate 180 (uchar4)", CLayoutTransform::Rotate(1920, 1080, 180, 4));
+	AddCase("rotate 270 (uchar4)", CLayoutTransform::Rotate(1920, 1080, 270, 4));
+	AddCase("rotate 90 (uchar)", CLayoutTransform::Rotate(1920, 1080, 90, 1));
+	const size_t image[2] = {1080, 1920};
+	AddCase("vertical flip (uchar4)", CLayoutTransform::Flip(2, image, 1 << 0, 4));
+	AddCase("horizontal flip (uchar4)", CLayoutTransform::Flip(2, image, 1 << 1, 4));
+
+	// wide elements
+	const size_t matrix[2] = {1000, 777};
+	const unsigned int transpose[2] = {1, 0};
+	AddCase("transpose (half)", CLayoutTransform::Permute(2, matrix, transpose, 2));
+	AddCase("transpose (double)", CLayoutTransform::Permute(2, matrix, transpose, 8));
+	AddCase("transpose (float4)", CLayoutTransform::Permute(2, matrix, transpose, 16));
+}
+
+CLayoutTransformTask::~CLayoutTransformTask()
+{
+	ReleaseResources();
+}
+
+void CLayoutTransformTask::AddCase(const string& Name, const SLayoutDesc& Desc)
+{
+	STransformCase c;
+	c.Name = Name;
+	c.Desc = Desc;
+	m_Cases.push_back(c);
+}
+
+bool CLayoutTransformTask::InitResources(cl_device_id Device, cl_context Context)
+{
+	m_Device = Device;
+	m_Context = Context;
+
+	size_t maxBytes = 0;
+	for(size_t i = 0; i < m_Cases.size(); i++)
+	{
+		size_t bytes = CLayoutTransform::GetElementCount(m_Cases[i].Desc) * m_Cases[i].Desc.ElementSize;
+		maxBytes = max(maxBytes, bytes);
+		m_Cases[i].CPUResult.resize(bytes);
+		m_Cases[i].GPUResult.resize(bytes);
+	}
+
+	//CPU resources
+	m_hInput.resize(maxBytes);
+	for(size_t i = 0; i < maxBytes; i++)
+		m_hInput[i] = static_cast<unsigned char>(rand());
+
+	//device resources
+	cl_int clError, clError2;
+	m_dInput = clCreateBuffer(Context, CL_MEM_READ_ONLY, maxBytes, NULL, &clError2);
+	clError = clError2;
+	m_dOutput = clCreateBuffer(Context, CL_MEM_WRITE_ONLY, maxBytes, NULL, &clError2);
+	clError |= clError2;
+	V_RETURN_FALSE_CL(clError, "Error allocating device arrays");
+
+	return true;
+}
+
+void CLayoutTransformTask::ReleaseResources()
+{
+	SAFE_RELEASE_MEMOBJECT(m_dInput);
+	SAFE_RELEASE_MEMOBJECT(m_dOutput);
+
+	m_ProgramCache.Release();
+}
+
+void CLayoutTransformTask::ComputeCPU()
+{
+	CTimer timer;
+
+	cout<<endl;
+	for(size_t i = 0; i < m_Cases.size(); i++)
+	{
+		STransformCase& c = m_Cases[i];
+		timer.Start();
+		CLayoutTransform::TransformCPU(c.Desc, &m_hInput[0], &c.CPUResult[0]);
+		timer.Stop();
+
+		double ms = timer.GetElapsedMilliseconds();
+		cout<<"  "<<c.Name<<": "<<ms<<" ms, "<<2.0e-6 * c.CPUResult.size() / ms<<" GB/s"<<endl;
+	}
+}
+
+void CLayoutTransformTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
+{
+	V_RETURN_CL(clEnqueueWriteBuffer(CommandQueue, m_dInput, CL_TRUE, 0, m_hInput.size(), &m_hInput[0], 0, NULL, NULL),
+		"Error copying data from host to device!");
+
+	CLayoutTransform transform(m_Device, m_Context, m_ProgramCache);
+	const int nIterations = 10;
+	CTimer timer;
+
+	cout<<endl;
+	for(size_t i = 0; i < m_Cases.size(); i++)
+	{
+		STransformCase& c = m_Cases[i];
+
+		//the first call compiles the kernel
+		if(!transform.Enqueue(CommandQueue, c.Desc, m_dInput, m_dOutput))
+			return;
+		V_RETURN_CL(clFinish(CommandQueue), "Error finishing the queue!");
+
+		timer.Start();
+		for(int j = 0; j < nIterations; j++)
+			transform.Enqueue(CommandQueue, c.Desc, m_dInput, m_dOutput);
+		V_RETURN_CL(clFinish(CommandQueue), "Error finishing the queue!");
+		timer.Stop();
+
+		double ms = timer.GetElapsedMilliseconds() / double(nIterations);
+		cout<<"  "<<c.Name<<": "<<ms<<" ms, "<<2.0e-6 * c.GPUResult.size() / ms<<" GB/s"<<endl;
+
+		V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dOutput, CL_TRUE, 0, c.GPUResult.size(), &c.GPUResult[0], 0, NULL, NULL),
+			"Error reading data from device to host!");
+	}
+}
+
+bool CLayoutTransformTask::ValidateResults()
+{
+	bool valid = true;
+	for(size_t i = 0; i < m_Cases.size(); i++)
+	{
+		if(m_Cases[i].CPUResult != m_Cases[i].GPUResult)
+		{
+			cout<<"Results of \""<<m_Cases[i].Name<<"\" are incorrect!"<<endl;
+			valid = false;
+		}
+	}
+	return valid;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,78 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CLAYOUT_TRANSFORM_TASK_H
+#define _CLAYOUT_TRANSFORM_TASK_H
+
+#include "../Common/IComputeTask.h"
+#include "../Common/CLayoutTransform.h"
+
+#include <vector>
+#include <string>
+
+//! A1/T4: Layout transforms (transposes, rotations and flips of tensors and images)
+/*!
+	Runs a set of typical layout changes with the generated device kernels
+	and with the multithreaded host implementation, and compares both.
+*/
+class CLayoutTransformTask : public IComputeTask
+{
+public:
+	CLayoutTransformTask();
+	virtual ~CLayoutTransformTask();
+
+	// IComputeTask
+
+	virtual bool InitResources(cl_device_id Device, cl_context Context);
+
+	virtual void ReleaseResources();
+
+	virtual void ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
+
+	virtual void ComputeCPU();
+
+	virtual bool ValidateResults();
+
+protected:
+	void AddCase(const std::string& Name, const SLayoutDesc& Desc);
+
+	struct STransformCase
+	{
+		std::string					Name;
+		SLayoutDesc					Desc;
+		std::vector<unsigned char>	CPUResult;
+		std::vector<unsigned char>	GPUResult;
+	};
+
+	std::vector<STransformCase>	m_Cases;
+
+	//input data on the CPU (large enough for all cases)
+	std::vector<unsigned char>	m_hInput;
+
+	//input and output buffers on the GPU
+	cl_mem					m_dInput = nullptr;
+	cl_mem					m_dOutput = nullptr;
+
+	cl_device_id			m_Device = nullptr;
+	cl_context				m_Context = nullptr;
+	CProgramCache			m_ProgramCache;
+};
+
+#endif // _CLAYOUT_TRANSFORM_TASK_H
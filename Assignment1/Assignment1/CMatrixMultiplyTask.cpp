@@ -0,0 +1,263 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CMatrixMultiplyTask.h"
+
+#include "../Common/CLUtil.h"
+#include "../Common/CTimer.h"
+#include "../Common/CParallel.h"
+#include "../Common/CValidator.h"
+
+#include <string.h>
+#include <math.h>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CMatrixMultiplyTask
+
+CMatrixMultiplyTask::CMatrixMultiplyTask(size_t M, size_t N, size_t K, unsigned int FlopsPerCycle)
+	: m_M(static_cast<unsigned int>(M)), m_N(static_cast<unsigned int>(N)), m_K(static_cast<unsigned int>(K)),
+	m_ComputeUnits(0), m_ClockMHz(0), m_FlopsPerCycle(FlopsPerCycle), m_dA(NULL), m_dB(NULL), m_dC(NULL)
+{
+	AddVariant("naive", "MatMulNaive", "", 16, 16);
+	AddVariant("local memory tiles 16x16", "MatMulTiled", "-D TILE=16", 16, 16);
+	AddVariant("register blocking 4x4 (64x64 per group)", "MatMulRegisterBlocked", "-D TS=64 -D WPT=4 -D TK=16", 16, 64);
+	AddVariant("register blocking 8x8 (128x128 per group)", "MatMulRegisterBlocked", "-D TS=128 -D WPT=8 -D TK=16", 16, 128);
+}
+
+CMatrixMultiplyTask::~CMatrixMultiplyTask()
+{
+	ReleaseResources();
+}
+
+void CMatrixMultiplyTask::AddVariant(const string& Name, const string& KernelName, const string& CompileOptions,
+	size_t LocalSize, size_t BlockSize)
+{
+	SKernelVariant v;
+	v.Name = Name;
+	v.KernelName = KernelName;
+	v.CompileOptions = CompileOptions;
+	v.LocalSize = LocalSize;
+	v.BlockSize = BlockSize;
+	v.Program = NULL;
+	v.Kernel = NULL;
+	m_Variants.push_back(v);
+}
+
+bool CMatrixMultiplyTask::InitResources(cl_device_id Device, cl_context Context)
+{
+	//CPU resources
+	m_hA.resize(m_M * m_K);
+	m_hB.resize(m_K * m_N);
+	m_hC.resize(m_M * m_N);
+
+	for(size_t i = 0; i < m_hA.size(); i++)
+		m_hA[i] = 2.0f * float(rand()) / float(RAND_MAX) - 1.0f;
+	for(size_t i = 0; i < m_hB.size(); i++)
+		m_hB[i] = 2.0f * float(rand()) / float(RAND_MAX) - 1.0f;
+
+	//peak of the device for the compute roof
+	cl_device_type deviceType;
+	cl_uint vectorWidth;
+	cl_int clError, clError2;
+	clError = clGetDeviceInfo(Device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &m_ComputeUnits, NULL);
+	clError |= clGetDeviceInfo(Device, CL_DEVICE_MAX_CLOCK_FREQUENCY, sizeof(cl_uint), &m_ClockMHz, NULL);
+	clError |= clGetDeviceInfo(Device, CL_DEVICE_TYPE, sizeof(cl_device_type), &deviceType, NULL);
+	clError |= clGetDeviceInfo(Device, CL_DEVICE_NATIVE_VECTOR_WIDTH_FLOAT, sizeof(cl_uint), &vectorWidth, NULL);
+	V_RETURN_FALSE_CL(clError, "Failed to query the device properties!");
+
+	//one fused multiply-add (2 FLOPs) per lane and cycle: 64 lanes per GPU compute unit
+	//(AMD CU, NVIDIA SM of most generations), two vector FMA units per CPU core
+	if(m_FlopsPerCycle == 0)
+		m_FlopsPerCycle = (deviceType & CL_DEVICE_TYPE_GPU) ? 2 * 64 : 2 * 2 * max(vectorWidth, 1u);
+
+	//device resources
+	m_dA = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_float) * m_hA.size(), &m_hA[0], &clError2);
+	clError = clError2;
+	m_dB = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_float) * m_hB.size(), &m_hB[0], &clError2);
+	clError |= clError2;
+	m_dC = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_float) * m_hC.size(), NULL, &clError2);
+	clError |= clError2;
+	V_RETURN_FALSE_CL(clError, "Failed to allocate arrays!");
+
+	string programCode;
+	if(!CLUtil::LoadProgramSourceToMemory("MatrixMul.cl", programCode))
+		return false;
+
+	//one program per variant, the tile sizes are compile-time constants
+	for(size_t i = 0; i < m_Variants.size(); i++)
+	{
+		SKernelVariant& v = m_Variants[i];
+		v.Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode, v.CompileOptions);
+		if(v.Program == nullptr)
+			return false;
+
+		v.Kernel = clCreateKernel(v.Program, v.KernelName.c_str(), &clError);
+		V_RETURN_FALSE_CL(clError, "Failed to create kernel: " << v.KernelName);
+
+		clError = clSetKernelArg(v.Kernel, 0, sizeof(cl_mem), (void*)&m_dA);
+		clError |= clSetKernelArg(v.Kernel, 1, sizeof(cl_mem), (void*)&m_dB);
+		clError |= clSetKernelArg(v.Kernel, 2, sizeof(cl_mem), (void*)&m_dC);
+		clError |= clSetKernelArg(v.Kernel, 3, sizeof(cl_uint), (void*)&m_M);
+		clError |= clSetKernelArg(v.Kernel, 4, sizeof(cl_uint), (void*)&m_N);
+		clError |= clSetKernelArg(v.Kernel, 5, sizeof(cl_uint), (void*)&m_K);
+		V_RETURN_FALSE_CL(clError, "Failed to set kernel args: " << v.KernelName);
+	}
+
+	return true;
+}
+
+void CMatrixMultiplyTask::ReleaseResources()
+{
+	SAFE_RELEASE_MEMOBJECT(m_dA);
+	SAFE_RELEASE_MEMOBJECT(m_dB);
+	SAFE_RELEASE_MEMOBJECT(m_dC);
+
+	for(size_t i = 0; i < m_Variants.size(); i++)
+	{
+		SAFE_RELEASE_KERNEL(m_Variants[i].Kernel);
+		SAFE_RELEASE_PROGRAM(m_Variants[i].Program);
+	}
+}
+
+void CMatrixMultiplyTask::MultiplyCPU(const float* A, const float* B, float* C, unsigned int M, unsigned int N, unsigned int K)
+{
+	//blocks of rows of C are distributed over the threads, within a block the
+	//K x N panel of B is walked in pieces that stay in the cache
+	const unsigned int BLOCK_M = 32;
+	const unsigned int BLOCK_K = 128;
+	const unsigned int BLOCK_N = 512;
+
+	unsigned int nBlocks = (M + BLOCK_M - 1) / BLOCK_M;
+	CParallel::For(0, nBlocks, [=](size_t Begin, size_t End)
+	{
+		for(size_t b = Begin; b < End; b++)
+		{
+			unsigned int i0 = static_cast<unsigned int>(b) * BLOCK_M;
+			unsigned int i1 = min(i0 + BLOCK_M, M);
+			memset(C + i0 * N, 0, (i1 - i0) * N * sizeof(float));
+
+			for(unsigned int j0 = 0; j0 < N; j0 += BLOCK_N)
+			{
+				unsigned int j1 = min(j0 + BLOCK_N, N);
+				for(unsigned int k0 = 0; k0 < K; k0 += BLOCK_K)
+				{
+					unsigned int k1 = min(k0 + BLOCK_K, K);
+					for(unsigned int i = i0; i < i1; i++)
+					{
+						float* c = C + i * N;
+						for(unsigned int k = k0; k < k1; k++)
+						{
+							float a = A[i * K + k];
+							const float* bRow = B + k * N;
+							for(unsigned int j = j0; j < j1; j++)
+								c[j] += a * bRow[j];
+						}
+					}
+				}
+			}
+		}
+	});
+}
+
+void CMatrixMultiplyTask::ComputeCPU()
+{
+	CTimer timer;
+	timer.Start();
+	MultiplyCPU(&m_hA[0], &m_hB[0], &m_hC[0], m_M, m_N, m_K);
+	timer.Stop();
+
+	double ms = timer.GetElapsedMilliseconds();
+	cout<<endl<<"CPU blocked ("<<CParallel::GetThreadCount()<<" threads): "<<ms<<" ms, "
+		<<2.0e-6 * m_M * m_N * m_K / ms<<" GFLOP/s"<<endl;
+}
+
+void CMatrixMultiplyTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
+{
+	double flops = 2.0 * m_M * m_N * m_K;
+
+	//the memory roofline: achievable device bandwidth (measured with a buffer copy)
+	//times the arithmetic intensity of the multiplication, if every matrix is moved only once
+	size_t copyBytes = min(m_hA.size(), m_hC.size()) * sizeof(float);
+	const int nCopies = 10;
+	CTimer timer;
+	V_RETURN_CL(clFinish(CommandQueue), "Error finishing the queue!");
+	timer.Start();
+	for(int i = 0; i < nCopies; i++)
+		V_RETURN_CL(clEnqueueCopyBuffer(CommandQueue, m_dA, m_dC, 0, 0, copyBytes, 0, NULL, NULL), "Error copying buffers!");
+	V_RETURN_CL(clFinish(CommandQueue), "Error finishing the queue!");
+	timer.Stop();
+
+	double bandwidth = 2.0e-6 * copyBytes * nCopies / timer.GetElapsedMilliseconds();
+	double intensity = flops / (sizeof(float) * (double(m_M) * m_K + double(m_K) * m_N + double(m_M) * m_N));
+	double memoryRoof = bandwidth * intensity;
+
+	//the compute roofline: peak FLOP rate of the device
+	double computeRoof = 1.0e-3 * m_ComputeUnits * m_ClockMHz * m_FlopsPerCycle;
+	double roof = min(memoryRoof, computeRoof);
+
+	cout<<endl<<"Multiplying "<<m_M<<" x "<<m_K<<" by "<<m_K<<" x "<<m_N<<"."<<endl;
+	cout<<"Copy bandwidth "<<bandwidth<<" GB/s, arithmetic intensity "<<intensity<<" FLOP/byte, memory roof "
+		<<memoryRoof<<" GFLOP/s"<<endl;
+	cout<<"Compute roof "<<computeRoof<<" GFLOP/s ("<<m_ComputeUnits<<" compute units x "<<m_ClockMHz<<" MHz x "
+		<<m_FlopsPerCycle<<" FLOP/cycle), roofline "<<roof<<" GFLOP/s ("<<(memoryRoof < computeRoof ? "memory" : "compute")
+		<<" bound)"<<endl;
+
+	//C is cleared before each kernel, so that a kernel cannot pass with the results of the previous one
+	vector<float> zeros(m_hC.size(), 0.0f);
+
+	for(size_t i = 0; i < m_Variants.size(); i++)
+	{
+		SKernelVariant& v = m_Variants[i];
+
+		V_RETURN_CL(clEnqueueWriteBuffer(CommandQueue, m_dC, CL_TRUE, 0, zeros.size() * sizeof(float), &zeros[0], 0, NULL, NULL),
+			"Error copying data from host to device!");
+
+		size_t localWorkSize[2] = {v.LocalSize, v.LocalSize};
+		size_t globalWorkSize[2];
+		globalWorkSize[0] = CLUtil::GetGlobalWorkSize(m_N, v.BlockSize) / v.BlockSize * v.LocalSize;
+		globalWorkSize[1] = CLUtil::GetGlobalWorkSize(m_M, v.BlockSize) / v.BlockSize * v.LocalSize;
+
+		double ms = CLUtil::ProfileKernel(CommandQueue, v.Kernel, 2, globalWorkSize, localWorkSize, 5);
+		if(ms < 0)
+			return;
+		double gflops = 1.0e-6 * flops / ms;
+		cout<<"  "<<v.Name<<": "<<ms<<" ms, "<<gflops<<" GFLOP/s, "<<100.0 * gflops / roof<<"% of the roofline"<<endl;
+
+		v.Result.resize(m_hC.size());
+		V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dC, CL_TRUE, 0, m_hC.size() * sizeof(float), &v.Result[0], 0, NULL, NULL),
+			"Error reading data from device to host!");
+	}
+}
+
+bool CMatrixMultiplyTask::ValidateResults()
+{
+	//the summation order differs between the implementations
+	CValidator validator(CValidator::ABSOLUTE, 1.0e-4 * sqrt(double(m_K)));
+
+	bool valid = true;
+	for(size_t i = 0; i < m_Variants.size(); i++)
+	{
+		const vector<float>& result = m_Variants[i].Result;
+		if(result.size() != m_hC.size())
+		{
+			cout<<"Results of the "<<m_Variants[i].Name<<" kernel are missing!"<<endl;
+			valid = false;
+			continue;
+		}
+
+		if(!validator.Compare(&m_hC[0], &result[0], m_hC.size()))
+		{
+			const CValidator::SMismatch& first = validator.GetMismatches()[0];
+			cout<<"Results of the "<<m_Variants[i].Name<<" kernel are incorrect (C["<<first.Index / m_N<<"]["<<first.Index % m_N<<"]):"<<endl;
+			validator.PrintMismatches(m_Variants[i].Name);
+			valid = false;
+		}
+	}
+	return valid;
+}
+
+///////////////////////////////////////////////////////////////////////////////
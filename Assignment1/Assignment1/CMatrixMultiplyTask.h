@@ -0,0 +1,97 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CMATRIX_MULTIPLY_TASK_H
+#define _CMATRIX_MULTIPLY_TASK_H
+
+#include "../Common/IComputeTask.h"
+
+#include <vector>
+#include <string>
+
+//! A1/T6: Dense matrix multiplication C = A * B
+/*!
+	Compares a naive kernel, a local memory tiled kernel and register-blocked
+	kernels (4x4 and 8x8 outputs per work-item). The tile sizes are compile-time
+	constants of MatrixMul.cl, set with -D options when the programs are built.
+	Performance is reported in GFLOP/s and as a share of the roofline, the lower
+	of the memory roof (bandwidth x arithmetic intensity) and the compute roof
+	(compute units x clock x FLOPs per cycle and compute unit).
+*/
+class CMatrixMultiplyTask : public IComputeTask
+{
+public:
+	//! A is M x K, B is K x N
+	/*!
+		FlopsPerCycle is the peak number of FLOPs per clock cycle of one compute unit,
+		it cannot be queried from OpenCL. 0 estimates it from the device type.
+	*/
+	CMatrixMultiplyTask(size_t M, size_t N, size_t K, unsigned int FlopsPerCycle = 0);
+	virtual ~CMatrixMultiplyTask();
+
+	// IComputeTask
+
+	virtual bool InitResources(cl_device_id Device, cl_context Context);
+
+	virtual void ReleaseResources();
+
+	virtual void ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
+
+	virtual void ComputeCPU();
+
+	virtual bool ValidateResults();
+
+	//! Cache-blocked, multithreaded C = A * B on the host
+	static void MultiplyCPU(const float* A, const float* B, float* C, unsigned int M, unsigned int N, unsigned int K);
+
+protected:
+	struct SKernelVariant
+	{
+		std::string			Name;
+		std::string			KernelName;
+		std::string			CompileOptions;
+		//work-group size (per dimension) and size of the block of C computed by one work-group
+		size_t				LocalSize;
+		size_t				BlockSize;
+
+		cl_program			Program;
+		cl_kernel			Kernel;
+		std::vector<float>	Result;
+	};
+
+	void AddVariant(const std::string& Name, const std::string& KernelName, const std::string& CompileOptions,
+		size_t LocalSize, size_t BlockSize);
+
+	unsigned int				m_M, m_N, m_K;
+
+	//compute roof: m_ComputeUnits x m_ClockMHz x m_FlopsPerCycle
+	cl_uint						m_ComputeUnits, m_ClockMHz;
+	unsigned int				m_FlopsPerCycle;
+
+	//float data on the CPU
+	std::vector<float>			m_hA, m_hB, m_hC;
+
+	//pointers on the GPU
+	cl_mem						m_dA, m_dB, m_dC;
+
+	std::vector<SKernelVariant>	m_Variants;
+};
+
+#endif // _CMATRIX_MULTIPLY_TASK_H
@@ -6,18 +6,45 @@ GPU Computing / GPGPU Praktikum source code.
 #include "CMatrixRotateTask.h"
 
 #include "../Common/CLUtil.h"
+#include "../Common/CTimer.h"
+#include "../Common/CParallel.h"
+#include "../Common/CValidator.h"
 
 #include <string.h>
 
+// the AVX block transpose is compiled for its own target, the CPU is checked before it is used
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#include <immintrin.h>
+	#define ROTATE_HAS_AVX		1
+	#define ROTATE_TARGET_AVX	__attribute__((target("avx")))
+	#define ROTATE_FLATTEN		__attribute__((flatten))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#include <immintrin.h>
+	#include <intrin.h>
+	#define ROTATE_HAS_AVX		1
+	#define ROTATE_TARGET_AVX
+	#define ROTATE_FLATTEN
+#else
+	#define ROTATE_HAS_AVX		0
+#endif
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <xmmintrin.h>
+	#define ROTATE_HAS_SSE		1
+#else
+	#define ROTATE_HAS_SSE		0
+#endif
+
 using namespace std;
 
 ///////////////////////////////////////////////////////////////////////////////
 // CMatrixRotateTask
 
-CMatrixRotateTask::CMatrixRotateTask(size_t SizeX, size_t SizeY)
-	:m_SizeX(static_cast<unsigned>(SizeX)), m_SizeY(static_cast<unsigned>(SizeY)), m_hM(NULL), m_hMR(NULL), m_dM(NULL),
-	m_dMR(NULL), m_hGPUResultNaive(NULL), m_hGPUResultOpt(NULL), m_Program(NULL),
-	m_NaiveKernel(NULL), m_OptimizedKernel(NULL)
+CMatrixRotateTask::CMatrixRotateTask(size_t SizeX, size_t SizeY, bool InPlace)
+	:m_SizeX(static_cast<unsigned>(SizeX)), m_SizeY(static_cast<unsigned>(SizeY)), m_InPlace(InPlace), m_hM(NULL), m_hMR(NULL), m_dM(NULL),
+	m_dMR(NULL), m_hGPUResultNaive(NULL), m_hGPUResultOpt(NULL), m_hGPUResultPadded(NULL),
+	m_OptimizedValid(false), m_CPUValid(true), m_Program(NULL), m_NaiveKernel(NULL), m_OptimizedKernel(NULL), m_PaddedKernel(NULL),
+	m_InPlaceKernel(NULL)
 {
 }
 
@@ -28,11 +55,22 @@ CMatrixRotateTask::~CMatrixRotateTask()
 
 bool CMatrixRotateTask::InitResources(cl_device_id Device, cl_context Context)
 {
+	if(m_InPlace && m_SizeX != m_SizeY)
+	{
+		cerr<<"Error: in-place rotation requires a square matrix."<<endl;
+		return false;
+	}
+
 	//CPU resources
+	//(the in-place mode only keeps the input, the reference and one GPU result)
 	m_hM = new float[m_SizeX * m_SizeY];
 	m_hMR = new float[m_SizeX * m_SizeY];
-	m_hGPUResultNaive = new float[m_SizeX * m_SizeY];
 	m_hGPUResultOpt = new float[m_SizeX * m_SizeY];
+	if(!m_InPlace)
+	{
+		m_hGPUResultNaive = new float[m_SizeX * m_SizeY];
+		m_hGPUResultPadded = new float[m_SizeX * m_SizeY];
+	}
 
 	//fill the matrix with random floats
 	for(unsigned int i = 0; i < m_SizeX * m_SizeY; i++)
@@ -46,6 +84,29 @@ bool CMatrixRotateTask::InitResources(cl_device_id Device, cl_context Context)
 	
 	cl_int clError;
 	unsigned int m_ArraySize = ( m_SizeX * m_SizeY ) ;
+
+	if(m_InPlace)
+	{
+		//a single buffer holds the matrix before and after the rotation
+		m_dM = clCreateBuffer(Context,CL_MEM_READ_WRITE,sizeof(cl_float)*m_ArraySize,NULL,&clError);
+		V_RETURN_FALSE_CL(clError,"Failed to allocate arrays!");
+
+		string programCode;
+		if(!CLUtil::LoadProgramSourceToMemory("MatrixRot.cl",programCode))
+			return false;
+		m_Program = CLUtil::BuildCLProgramFromMemory(Device,Context,programCode);
+		if(m_Program == nullptr) return false;
+
+		m_InPlaceKernel = clCreateKernel(m_Program,"MatrixRotInPlace",&clError);
+		V_RETURN_FALSE_CL(clError,"Failed to create kernel:MatrixRotInPlace");
+
+		clError = clSetKernelArg(m_InPlaceKernel,0,sizeof(cl_mem),(void*)&m_dM);
+		clError |= clSetKernelArg(m_InPlaceKernel,1,sizeof(cl_uint),(void*)&m_SizeX);
+		V_RETURN_FALSE_CL(clError,"Failed to set kernel args:MatrixRotInPlace");
+
+		return true;
+	}
+
 	m_dM = clCreateBuffer(Context,CL_MEM_READ_ONLY,sizeof(cl_float)*m_ArraySize,NULL,&clError);
 	m_dMR = clCreateBuffer(Context,CL_MEM_WRITE_ONLY,sizeof(cl_float)*m_ArraySize,NULL,&clError);
 
@@ -68,6 +129,9 @@ bool CMatrixRotateTask::InitResources(cl_device_id Device, cl_context Context)
 	m_OptimizedKernel = clCreateKernel(m_Program,"MatrixRotOptimized",&clError);
 	V_RETURN_FALSE_CL(clError,"Failed to create kernel:MatrixRotOptimized");
 
+	m_PaddedKernel = clCreateKernel(m_Program,"MatrixRotOptimizedPadded",&clError);
+	V_RETURN_FALSE_CL(clError,"Failed to create kernel:MatrixRotOptimizedPadded");
+
 
 	//TO DO: bind kernel arguments
 	clError = clSetKernelArg(m_NaiveKernel,0,sizeof(cl_mem),(void*)&m_dM);
@@ -81,6 +145,12 @@ bool CMatrixRotateTask::InitResources(cl_device_id Device, cl_context Context)
 	clError = clSetKernelArg(m_OptimizedKernel,2,sizeof(cl_uint),(void*)&m_SizeX);
 	clError = clSetKernelArg(m_OptimizedKernel,3,sizeof(cl_uint),(void*)&m_SizeY);
 	V_RETURN_FALSE_CL(clError,"Failed to set kernel args:MatrixRotOptimized");
+
+	clError = clSetKernelArg(m_PaddedKernel,0,sizeof(cl_mem),(void*)&m_dM);
+	clError |= clSetKernelArg(m_PaddedKernel,1,sizeof(cl_mem),(void*)&m_dMR);
+	clError |= clSetKernelArg(m_PaddedKernel,2,sizeof(cl_uint),(void*)&m_SizeX);
+	clError |= clSetKernelArg(m_PaddedKernel,3,sizeof(cl_uint),(void*)&m_SizeY);
+	V_RETURN_FALSE_CL(clError,"Failed to set kernel args:MatrixRotOptimizedPadded");
 	
 	
 
@@ -94,11 +164,18 @@ void CMatrixRotateTask::ReleaseResources()
 	SAFE_DELETE_ARRAY(m_hMR);
 	SAFE_DELETE_ARRAY(m_hGPUResultNaive);
 	SAFE_DELETE_ARRAY(m_hGPUResultOpt);
+	SAFE_DELETE_ARRAY(m_hGPUResultPadded);
 
 	// TO DO: release device resources
 	
-	clReleaseMemObject(m_dM);
-	clReleaseMemObject(m_dMR);
+	SAFE_RELEASE_MEMOBJECT(m_dM);
+	SAFE_RELEASE_MEMOBJECT(m_dMR);
+
+	SAFE_RELEASE_KERNEL(m_NaiveKernel);
+	SAFE_RELEASE_KERNEL(m_OptimizedKernel);
+	SAFE_RELEASE_KERNEL(m_PaddedKernel);
+	SAFE_RELEASE_KERNEL(m_InPlaceKernel);
+	SAFE_RELEASE_PROGRAM(m_Program);
 	
 	
 
@@ -106,6 +183,12 @@ void CMatrixRotateTask::ReleaseResources()
 
 void CMatrixRotateTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
 {
+	if(m_InPlace)
+	{
+		ComputeGPUInPlace(CommandQueue, LocalWorkSize);
+		return;
+	}
+
 	// TO DO: write input data to the GPU
 	
 	cl_int clErr;
@@ -140,6 +223,7 @@ void CMatrixRotateTask::ComputeGPU(cl_context Context, cl_command_queue CommandQ
 	
 
 	double time = 0;
+	double timeNaive = 0;
 	
 	//naive kernel
 	// TO DO: time = CLUtil::ProfileKernel...
@@ -151,6 +235,7 @@ void CMatrixRotateTask::ComputeGPU(cl_context Context, cl_command_queue CommandQ
 	
 	
 	cout<<"Executed naive kernel in "<<time<<" ms."<<endl;
+	timeNaive = time;
 	
 	
 	
@@ -162,51 +247,339 @@ void CMatrixRotateTask::ComputeGPU(cl_context Context, cl_command_queue CommandQ
 	
 
 	//optimized kernel
-	
-	// TO DO: allocate shared (local) memory for the kernel
-	
-	clErr = clSetKernelArg(m_OptimizedKernel,4,LocalWorkSize[0]*LocalWorkSize[1]*sizeof(float),NULL);
-	V_RETURN_CL(clErr,"Failed to set kernel args:MatrixRotOptimized");
-	
-	// run kernel
-	// TO DO: time = GLUtil::ProfileKernel...
-	
-	//clErr = clEnqueueNDRangeKernel(CommandQueue,m_OptimizedKernel,2,NULL,globalWorkSize,LocalWorkSize,0,NULL,NULL);
-	V_RETURN_CL(clErr,"Error executing kernel!");	
-	time=CLUtil::ProfileKernel(CommandQueue,m_OptimizedKernel,2,globalWorkSize, LocalWorkSize, 8);
-	
-	cout<<"Executed optimized kernel in "<<time<<" ms."<<endl;
+	//(its output indexing assumes whole square tiles, so it is skipped for other sizes and tile shapes)
+	m_OptimizedValid = (LocalWorkSize[0] == LocalWorkSize[1]) &&
+		(m_SizeX % LocalWorkSize[0] == 0) && (m_SizeY % LocalWorkSize[1] == 0);
+	if(m_OptimizedValid)
+	{
+		// TO DO: allocate shared (local) memory for the kernel
+		
+		clErr = clSetKernelArg(m_OptimizedKernel,4,LocalWorkSize[0]*LocalWorkSize[1]*sizeof(float),NULL);
+		V_RETURN_CL(clErr,"Failed to set kernel args:MatrixRotOptimized");
+		
+		// run kernel
+		// TO DO: time = GLUtil::ProfileKernel...
+		
+		//clErr = clEnqueueNDRangeKernel(CommandQueue,m_OptimizedKernel,2,NULL,globalWorkSize,LocalWorkSize,0,NULL,NULL);
+		V_RETURN_CL(clErr,"Error executing kernel!");	
+		time=CLUtil::ProfileKernel(CommandQueue,m_OptimizedKernel,2,globalWorkSize, LocalWorkSize, 8);
+		
+		cout<<"Executed optimized kernel in "<<time<<" ms (speedup "<<timeNaive / time<<"x)."<<endl;
 
-	// TO DO: read back the data to the host
-	
-	clErr = clEnqueueReadBuffer(CommandQueue,m_dMR,CL_TRUE,0,m_ArraySize*sizeof(float),m_hGPUResultOpt,0,NULL,NULL);
+		// TO DO: read back the data to the host
+		
+		clErr = clEnqueueReadBuffer(CommandQueue,m_dMR,CL_TRUE,0,m_ArraySize*sizeof(float),m_hGPUResultOpt,0,NULL,NULL);
+		V_RETURN_CL(clErr,"Error reading data from device to host!");
+	}
+	else
+	{
+		cout<<"Skipped optimized kernel (work-group is not square or matrix size is not a multiple of it)."<<endl;
+	}
+
+	//optimized kernel with padded tile and edge handling
+
+	//clear the output first, so that the previous results cannot hide missing writes
+	memset(m_hGPUResultPadded, 0, m_ArraySize*sizeof(float));
+	clErr = clEnqueueWriteBuffer(CommandQueue,m_dMR,CL_FALSE,0,m_ArraySize*sizeof(float),m_hGPUResultPadded,0,NULL,NULL);
+	V_RETURN_CL(clErr,"Error copying data from host to device!");
+
+	clErr = clSetKernelArg(m_PaddedKernel,4,(LocalWorkSize[0] + 1)*LocalWorkSize[1]*sizeof(float),NULL);
+	V_RETURN_CL(clErr,"Failed to set kernel args:MatrixRotOptimizedPadded");
+
+	time=CLUtil::ProfileKernel(CommandQueue,m_PaddedKernel,2,globalWorkSize, LocalWorkSize, 8);
+
+	cout<<"Executed padded optimized kernel in "<<time<<" ms (speedup "<<timeNaive / time<<"x)."<<endl;
+
+	clErr = clEnqueueReadBuffer(CommandQueue,m_dMR,CL_TRUE,0,m_ArraySize*sizeof(float),m_hGPUResultPadded,0,NULL,NULL);
 	V_RETURN_CL(clErr,"Error reading data from device to host!");
 	
 	
 	
 }
 
-void CMatrixRotateTask::ComputeCPU()
+void CMatrixRotateTask::ComputeGPUInPlace(cl_command_queue CommandQueue, size_t LocalWorkSize[3])
 {
-	for(unsigned int x = 0; x < m_SizeX; x++)
+	size_t dataSize = m_SizeX * m_SizeY * sizeof(float);
+
+	//one work-item per 4-cycle: SizeX/2 x (SizeX+1)/2 representatives
+	size_t globalWorkSize[2];
+	globalWorkSize[0] = CLUtil::GetGlobalWorkSize((m_SizeX + 1) / 2, LocalWorkSize[0]);
+	globalWorkSize[1] = CLUtil::GetGlobalWorkSize(m_SizeX / 2, LocalWorkSize[1]);
+	if(globalWorkSize[1] == 0)
 	{
-		for(unsigned int y = 0; y < m_SizeY; y++)
+		//a 1 x 1 matrix does not change
+		memcpy(m_hGPUResultOpt, m_hM, dataSize);
+		return;
+	}
+
+	cl_int clErr = clSetKernelArg(m_InPlaceKernel,2,4*(LocalWorkSize[0] + 1)*LocalWorkSize[1]*sizeof(float),NULL);
+	V_RETURN_CL(clErr,"Failed to set kernel args:MatrixRotInPlace");
+
+	clErr = clEnqueueWriteBuffer(CommandQueue,m_dM,CL_FALSE,0,dataSize,m_hM,0,NULL,NULL);
+	V_RETURN_CL(clErr,"Error copying data from host to device!");
+
+	double time = CLUtil::ProfileKernel(CommandQueue,m_InPlaceKernel,2,globalWorkSize, LocalWorkSize, 8);
+	cout<<"Executed in-place kernel in "<<time<<" ms."<<endl;
+
+	//the profiling runs rotated the matrix several times, start again from the original
+	clErr = clEnqueueWriteBuffer(CommandQueue,m_dM,CL_FALSE,0,dataSize,m_hM,0,NULL,NULL);
+	V_RETURN_CL(clErr,"Error copying data from host to device!");
+	clErr = clEnqueueNDRangeKernel(CommandQueue,m_InPlaceKernel,2,NULL,globalWorkSize,LocalWorkSize,0,NULL,NULL);
+	V_RETURN_CL(clErr,"Error executing kernel!");
+
+	clErr = clEnqueueReadBuffer(CommandQueue,m_dM,CL_TRUE,0,dataSize,m_hGPUResultOpt,0,NULL,NULL);
+	V_RETURN_CL(clErr,"Error reading data from device to host!");
+}
+
+void CMatrixRotateTask::RotateInPlaceCPU(float* M, unsigned int N)
+{
+	for(unsigned int y = 0; y < N / 2; y++)
+	{
+		for(unsigned int x = 0; x < (N + 1) / 2; x++)
 		{
-			m_hMR[ x * m_SizeY + (m_SizeY - y - 1) ] = m_hM[ y * m_SizeX + x ];
+			// (y, x) -> (x, N-1-y) -> (N-1-y, N-1-x) -> (N-1-x, y) -> (y, x)
+			float tmp = M[(N - 1 - x) * N + y];
+			M[(N - 1 - x) * N + y] = M[(N - 1 - y) * N + (N - 1 - x)];
+			M[(N - 1 - y) * N + (N - 1 - x)] = M[x * N + (N - 1 - y)];
+			M[x * N + (N - 1 - y)] = M[y * N + x];
+			M[y * N + x] = tmp;
 		}
 	}
 }
 
+// rotates the columns [X0, X1) of the rows [Y0, Y1) element by element
+static inline void RotateRange(const float* M, float* MR, unsigned int SizeX, unsigned int SizeY,
+	unsigned int X0, unsigned int X1, unsigned int Y0, unsigned int Y1)
+{
+	for(unsigned int y = Y0; y < Y1; y++)
+		for(unsigned int x = X0; x < X1; x++)
+			MR[x * SizeY + (SizeY - y - 1)] = M[y * SizeX + x];
+}
+
+// rotates one tile in W x W blocks, the remaining columns and rows element by element
+template <unsigned int W, void (*RotateBlock)(const float*, float*, unsigned int, unsigned int, unsigned int, unsigned int)>
+static inline void RotateTile(const float* M, float* MR, unsigned int SizeX, unsigned int SizeY,
+	unsigned int X0, unsigned int X1, unsigned int Y0, unsigned int Y1)
+{
+	unsigned int y = Y0;
+	for(; y + W <= Y1; y += W)
+	{
+		unsigned int x = X0;
+		for(; x + W <= X1; x += W)
+			RotateBlock(M, MR, SizeX, SizeY, x, y);
+		//remaining columns of the tile
+		RotateRange(M, MR, SizeX, SizeY, x, X1, y, y + W);
+	}
+	//remaining rows of the tile
+	RotateRange(M, MR, SizeX, SizeY, X0, X1, y, Y1);
+}
+
+#if ROTATE_HAS_AVX
+
+// rotates the 8x8 block at (X0, Y0): loading the rows bottom-up, the transposed rows are the rotated rows
+ROTATE_TARGET_AVX static inline void RotateBlockAVX(const float* M, float* MR, unsigned int SizeX, unsigned int SizeY, unsigned int X0, unsigned int Y0)
+{
+	const float* in = M + (Y0 + 7) * SizeX + X0;
+	__m256 r0 = _mm256_loadu_ps(in);
+	__m256 r1 = _mm256_loadu_ps(in - SizeX);
+	__m256 r2 = _mm256_loadu_ps(in - 2 * SizeX);
+	__m256 r3 = _mm256_loadu_ps(in - 3 * SizeX);
+	__m256 r4 = _mm256_loadu_ps(in - 4 * SizeX);
+	__m256 r5 = _mm256_loadu_ps(in - 5 * SizeX);
+	__m256 r6 = _mm256_loadu_ps(in - 6 * SizeX);
+	__m256 r7 = _mm256_loadu_ps(in - 7 * SizeX);
+
+	__m256 t0 = _mm256_unpacklo_ps(r0, r1);
+	__m256 t1 = _mm256_unpackhi_ps(r0, r1);
+	__m256 t2 = _mm256_unpacklo_ps(r2, r3);
+	__m256 t3 = _mm256_unpackhi_ps(r2, r3);
+	__m256 t4 = _mm256_unpacklo_ps(r4, r5);
+	__m256 t5 = _mm256_unpackhi_ps(r4, r5);
+	__m256 t6 = _mm256_unpacklo_ps(r6, r7);
+	__m256 t7 = _mm256_unpackhi_ps(r6, r7);
+
+	__m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+	float* out = MR + X0 * SizeY + (SizeY - 8 - Y0);
+	_mm256_storeu_ps(out, _mm256_permute2f128_ps(s0, s4, 0x20));
+	_mm256_storeu_ps(out + SizeY, _mm256_permute2f128_ps(s1, s5, 0x20));
+	_mm256_storeu_ps(out + 2 * SizeY, _mm256_permute2f128_ps(s2, s6, 0x20));
+	_mm256_storeu_ps(out + 3 * SizeY, _mm256_permute2f128_ps(s3, s7, 0x20));
+	_mm256_storeu_ps(out + 4 * SizeY, _mm256_permute2f128_ps(s0, s4, 0x31));
+	_mm256_storeu_ps(out + 5 * SizeY, _mm256_permute2f128_ps(s1, s5, 0x31));
+	_mm256_storeu_ps(out + 6 * SizeY, _mm256_permute2f128_ps(s2, s6, 0x31));
+	_mm256_storeu_ps(out + 7 * SizeY, _mm256_permute2f128_ps(s3, s7, 0x31));
+}
+
+// flattened, so that the AVX blocks are inlined into the tile loop
+ROTATE_FLATTEN ROTATE_TARGET_AVX static void RotateTileAVX(const float* M, float* MR, unsigned int SizeX, unsigned int SizeY,
+	unsigned int X0, unsigned int X1, unsigned int Y0, unsigned int Y1)
+{
+	RotateTile<8, RotateBlockAVX>(M, MR, SizeX, SizeY, X0, X1, Y0, Y1);
+}
+
+#endif // ROTATE_HAS_AVX
+
+#if ROTATE_HAS_SSE
+
+// rotates the 4x4 block at (X0, Y0): loading the rows bottom-up, the transposed rows are the rotated rows
+static inline void RotateBlockSSE(const float* M, float* MR, unsigned int SizeX, unsigned int SizeY, unsigned int X0, unsigned int Y0)
+{
+	const float* in = M + (Y0 + 3) * SizeX + X0;
+	__m128 r0 = _mm_loadu_ps(in);
+	__m128 r1 = _mm_loadu_ps(in - SizeX);
+	__m128 r2 = _mm_loadu_ps(in - 2 * SizeX);
+	__m128 r3 = _mm_loadu_ps(in - 3 * SizeX);
+
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+	float* out = MR + X0 * SizeY + (SizeY - 4 - Y0);
+	_mm_storeu_ps(out, r0);
+	_mm_storeu_ps(out + SizeY, r1);
+	_mm_storeu_ps(out + 2 * SizeY, r2);
+	_mm_storeu_ps(out + 3 * SizeY, r3);
+}
+
+#endif // ROTATE_HAS_SSE
+
+unsigned int CMatrixRotateTask::GetCPUBlockSize()
+{
+#if ROTATE_HAS_AVX && defined(_MSC_VER)
+	// AVX in the CPU and enabled (XSAVE) by the OS
+	static const bool avx = []()
+	{
+		int info[4];
+		__cpuid(info, 1);
+		return (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+	}();
+	if(avx)
+		return 8;
+#elif ROTATE_HAS_AVX
+	if(__builtin_cpu_supports("avx"))
+		return 8;
+#endif
+	return ROTATE_HAS_SSE ? 4 : 1;
+}
+
+void CMatrixRotateTask::RotateCPU(const float* M, float* MR, unsigned int SizeX, unsigned int SizeY)
+{
+	//64 x 64 floats: the input and output tile together fit into a typical L1 + L2
+	const unsigned int TILE = 64;
+	const unsigned int W = GetCPUBlockSize();
+
+	unsigned int tilesX = (SizeX + TILE - 1) / TILE;
+	unsigned int tilesY = (SizeY + TILE - 1) / TILE;
+
+	CParallel::For(0, tilesX * tilesY, [=](size_t Begin, size_t End)
+	{
+		for(size_t t = Begin; t < End; t++)
+		{
+			unsigned int x0 = static_cast<unsigned int>(t % tilesX) * TILE;
+			unsigned int y0 = static_cast<unsigned int>(t / tilesX) * TILE;
+			unsigned int x1 = min(x0 + TILE, SizeX);
+			unsigned int y1 = min(y0 + TILE, SizeY);
+
+#if ROTATE_HAS_AVX
+			if(W == 8)
+			{
+				RotateTileAVX(M, MR, SizeX, SizeY, x0, x1, y0, y1);
+				continue;
+			}
+#endif
+#if ROTATE_HAS_SSE
+			if(W == 4)
+			{
+				RotateTile<4, RotateBlockSSE>(M, MR, SizeX, SizeY, x0, x1, y0, y1);
+				continue;
+			}
+#endif
+			RotateRange(M, MR, SizeX, SizeY, x0, x1, y0, y1);
+		}
+	}, 0, 4);
+}
+
+void CMatrixRotateTask::RotateCPUNaive(const float* M, float* MR, unsigned int SizeX, unsigned int SizeY)
+{
+	for(unsigned int x = 0; x < SizeX; x++)
+	{
+		for(unsigned int y = 0; y < SizeY; y++)
+		{
+			MR[ x * SizeY + (SizeY - y - 1) ] = M[ y * SizeX + x ];
+		}
+	}
+}
+
+void CMatrixRotateTask::ComputeCPU()
+{
+	if(m_InPlace)
+	{
+		memcpy(m_hMR, m_hM, m_SizeX * m_SizeY * sizeof(float));
+		RotateInPlaceCPU(m_hMR, m_SizeX);
+		return;
+	}
+
+	double bytes = 2.0 * m_SizeX * m_SizeY * sizeof(float);
+	CTimer timer;
+
+	//the naive loop writes to the (not yet used) GPU result array, so both results can be compared
+	timer.Start();
+	RotateCPUNaive(m_hM, m_hGPUResultNaive, m_SizeX, m_SizeY);
+	timer.Stop();
+	double msNaive = timer.GetElapsedMilliseconds();
+
+	timer.Start();
+	RotateCPU(m_hM, m_hMR, m_SizeX, m_SizeY);
+	timer.Stop();
+	double msBlocked = timer.GetElapsedMilliseconds();
+
+	m_CPUValid = CValidator().Compare(m_hMR, m_hGPUResultNaive, m_SizeX * m_SizeY);
+
+	cout<<endl<<"CPU naive loop:   "<<msNaive<<" ms, "<<1.0e-6 * bytes / msNaive<<" GB/s"<<endl;
+	cout<<"CPU blocked SIMD: "<<msBlocked<<" ms, "<<1.0e-6 * bytes / msBlocked<<" GB/s ("
+		<<GetCPUBlockSize()<<" x "<<GetCPUBlockSize()<<" blocks, "<<CParallel::GetThreadCount()<<" threads)"<<endl;
+}
+
 bool CMatrixRotateTask::ValidateResults()
 {
-	if(!(memcmp(m_hMR, m_hGPUResultNaive, m_SizeX * m_SizeY * sizeof(float)) == 0))
+	// rotation only moves data, so the results have to be bitwise identical
+	CValidator validator;
+	size_t count = m_SizeX * m_SizeY;
+
+	if(m_InPlace)
+	{
+		if(!validator.Compare(m_hMR, m_hGPUResultOpt, count))
+		{
+			validator.PrintMismatches("Results of the in-place kernel are incorrect");
+			return false;
+		}
+		return true;
+	}
+
+	if(!m_CPUValid)
+	{
+		cout<<"Results of the blocked CPU rotation are incorrect!"<<endl;
+		return false;
+	}
+	if(!validator.Compare(m_hMR, m_hGPUResultNaive, count))
+	{
+		validator.PrintMismatches("Results of the naive kernel are incorrect");
+		return false;
+	}
+	if(m_OptimizedValid && !validator.Compare(m_hMR, m_hGPUResultOpt, count))
 	{
-		cout<<"Results of the naive kernel are incorrect!"<<endl;
+		validator.PrintMismatches("Results of the optimized kernel are incorrect");
 		return false;
 	}
-	if(!(memcmp(m_hMR, m_hGPUResultOpt, m_SizeX * m_SizeY * sizeof(float)) == 0))
+	if(!validator.Compare(m_hMR, m_hGPUResultPadded, count))
 	{
-		cout<<"Results of the optimized kernel are incorrect!"<<endl;
+		validator.PrintMismatches("Results of the padded optimized kernel are incorrect");
 		return false;
 	}
 	return true;
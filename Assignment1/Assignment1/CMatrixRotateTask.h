@@ -23,10 +23,14 @@
 #include "../Common/IComputeTask.h"
 
 //! A1/T2: Matrix rotation
+/*!
+	With InPlace set, a square matrix is rotated within a single device
+	buffer (MatrixRotInPlace) instead of running the out-of-place kernels.
+*/
 class CMatrixRotateTask : public IComputeTask
 {
 public:
-	CMatrixRotateTask(size_t SizeX, size_t SizeY);
+	CMatrixRotateTask(size_t SizeX, size_t SizeY, bool InPlace = false);
 	virtual ~CMatrixRotateTask();
 
 	// IComputeTask
@@ -40,12 +44,32 @@ public:
 
 	virtual bool ValidateResults();
 
+	//! Cache-blocked, vectorized and multithreaded clockwise rotation on the host
+	/*!
+		The matrix is processed in tiles that fit into the L1 cache, each tile in
+		SIMD-wide square blocks (8x8 with AVX, 4x4 with SSE) that are transposed
+		in registers. The tiles are distributed over all hardware threads.
+	*/
+	static void RotateCPU(const float* M, float* MR, unsigned int SizeX, unsigned int SizeY);
+
+	//! Edge length of the blocks used by RotateCPU: 8 if the CPU supports AVX, 4 with SSE, 1 otherwise
+	static unsigned int GetCPUBlockSize();
+
+	//! The straightforward loop, kept as a baseline
+	static void RotateCPUNaive(const float* M, float* MR, unsigned int SizeX, unsigned int SizeY);
+
 protected:
+	void ComputeGPUInPlace(cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
+
+	//! Rotates a square matrix clockwise by swapping the elements of each 4-cycle
+	static void RotateInPlaceCPU(float* M, unsigned int N);
+
 	//NOTE: we have two memory address spaces, so we mark pointers with a prefix
 	//to avoid confusions: 'h' - host, 'd' - device
 
 	unsigned int		m_SizeX;
 	unsigned int		m_SizeY;
+	bool				m_InPlace;
 
 	//float data on the CPU
 	//M: original matrix, MR: rotated matrix
@@ -55,12 +79,20 @@ protected:
 	//(result buffers for both kernels)
 	cl_mem				m_dM, m_dMR;
 	//(..and a pointer to read back the result)
-	float				*m_hGPUResultNaive, *m_hGPUResultOpt;
+	float				*m_hGPUResultNaive, *m_hGPUResultOpt, *m_hGPUResultPadded;
+
+	//the unpadded optimized kernel only supports matrices made of whole tiles
+	bool				m_OptimizedValid;
+
+	//does the blocked CPU rotation match the naive loop?
+	bool				m_CPUValid;
 
 	//OpenCL program and kernels
 	cl_program			m_Program;
 	cl_kernel			m_NaiveKernel;
 	cl_kernel			m_OptimizedKernel;
+	cl_kernel			m_PaddedKernel;
+	cl_kernel			m_InPlaceKernel;
 };
 
 #endif // _CMATRIX_ROTATE_TASK_H
@@ -6,6 +6,7 @@ GPU Computing / GPGPU Praktikum source code.
 #include "CSimpleArraysTask.h"
 
 #include "../Common/CLUtil.h"
+#include "../Common/CValidator.h"
 
 #include <string.h>
 
@@ -170,7 +171,10 @@ void CSimpleArraysTask::ComputeGPU(cl_context Context, cl_command_queue CommandQ
 
 bool CSimpleArraysTask::ValidateResults()
 {
-	return (memcmp(m_hC, m_hGPUResult, m_ArraySize * sizeof(float)) == 0);
+	CValidator validator;
+	bool valid = validator.Compare(m_hC, m_hGPUResult, m_ArraySize);
+	validator.PrintMismatches("Vector addition");
+	return valid;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,138 @@
+// Dense matrix multiplication C = A * B
+// A is M x K, B is K x N and C is M x N, all stored row by row.
+
+// The tile sizes are set by the host at compile time (-D TILE=16 ...)
+
+#ifndef TILE
+#define TILE 16
+#endif
+
+// register blocking: a work-group computes a TS x TS block of C, each work-item a WPT x WPT micro-tile,
+// stepping through K in slices of TK columns of A / rows of B
+#ifndef TS
+#define TS 64
+#endif
+#ifndef WPT
+#define WPT 4
+#endif
+#ifndef TK
+#define TK 16
+#endif
+
+#define RTS (TS / WPT)
+
+//naive implementation: every work-item reads a full row of A and a full column of B from global memory
+
+__kernel void MatMulNaive(__global const float* A, __global const float* B, __global float* C, uint M, uint N, uint K)
+{
+	uint col = get_global_id(0);
+	uint row = get_global_id(1);
+
+	if(row < M && col < N)
+	{
+		float acc = 0.0f;
+		for(uint k = 0; k < K; k++)
+			acc += A[row * K + k] * B[k * N + col];
+		C[row * N + col] = acc;
+	}
+}
+
+//local memory tiling: the work-group (TILE x TILE) loads square tiles of A and B once
+//and every work-item reads them TILE times from local memory
+
+__kernel __attribute__((reqd_work_group_size(TILE, TILE, 1)))
+void MatMulTiled(__global const float* A, __global const float* B, __global float* C, uint M, uint N, uint K)
+{
+	__local float As[TILE][TILE];
+	__local float Bs[TILE][TILE];
+
+	uint lx = get_local_id(0);
+	uint ly = get_local_id(1);
+	uint col = get_global_id(0);
+	uint row = get_global_id(1);
+
+	float acc = 0.0f;
+	for(uint k0 = 0; k0 < K; k0 += TILE)
+	{
+		//zero padding at the matrix edges
+		As[ly][lx] = (row < M && k0 + lx < K) ? A[row * K + k0 + lx] : 0.0f;
+		Bs[ly][lx] = (k0 + ly < K && col < N) ? B[(k0 + ly) * N + col] : 0.0f;
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		for(uint k = 0; k < TILE; k++)
+			acc += As[ly][k] * Bs[k][lx];
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	if(row < M && col < N)
+		C[row * N + col] = acc;
+}
+
+//register blocking: the work-group (RTS x RTS) computes a TS x TS block of C, every work-item
+//a WPT x WPT micro-tile held in registers. The rows and columns of a micro-tile are RTS apart,
+//so neighboring work-items read neighboring local memory words and write neighboring elements of C.
+//Each value loaded from local memory is used WPT times.
+
+__kernel __attribute__((reqd_work_group_size(RTS, RTS, 1)))
+void MatMulRegisterBlocked(__global const float* A, __global const float* B, __global float* C, uint M, uint N, uint K)
+{
+	//A is stored transposed (As[k][m]), so both tiles are read along their rows.
+	//The padding avoids bank conflicts when the transposed tile is written.
+	__local float As[TK][TS + 1];
+	__local float Bs[TK][TS + 1];
+
+	uint tx = get_local_id(0);
+	uint ty = get_local_id(1);
+	uint tid = ty * RTS + tx;
+	uint row0 = get_group_id(1) * TS;
+	uint col0 = get_group_id(0) * TS;
+
+	float acc[WPT][WPT];
+	for(uint wm = 0; wm < WPT; wm++)
+		for(uint wn = 0; wn < WPT; wn++)
+			acc[wm][wn] = 0.0f;
+
+	for(uint k0 = 0; k0 < K; k0 += TK)
+	{
+		//TS x TK slice of A, consecutive work-items read consecutive elements of a row
+		for(uint i = tid; i < TS * TK; i += RTS * RTS)
+		{
+			uint r = i / TK;
+			uint c = i % TK;
+			As[c][r] = (row0 + r < M && k0 + c < K) ? A[(row0 + r) * K + k0 + c] : 0.0f;
+		}
+		//TK x TS slice of B
+		for(uint i = tid; i < TK * TS; i += RTS * RTS)
+		{
+			uint r = i / TS;
+			uint c = i % TS;
+			Bs[r][c] = (k0 + r < K && col0 + c < N) ? B[(k0 + r) * N + col0 + c] : 0.0f;
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		for(uint k = 0; k < TK; k++)
+		{
+			float a[WPT], b[WPT];
+			for(uint w = 0; w < WPT; w++)
+			{
+				a[w] = As[k][ty + w * RTS];
+				b[w] = Bs[k][tx + w * RTS];
+			}
+			for(uint wm = 0; wm < WPT; wm++)
+				for(uint wn = 0; wn < WPT; wn++)
+					acc[wm][wn] = mad(a[wm], b[wn], acc[wm][wn]);
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	for(uint wm = 0; wm < WPT; wm++)
+	{
+		uint row = row0 + ty + wm * RTS;
+		for(uint wn = 0; wn < WPT; wn++)
+		{
+			uint col = col0 + tx + wn * RTS;
+			if(row < M && col < N)
+				C[row * N + col] = acc[wm][wn];
+		}
+	}
+}
@@ -66,4 +66,186 @@ __kernel void MatrixRotOptimized(__global const float* M, __global float* MR, ui
 	
 	
 }
- 
\ No newline at end of file
+ 
+//same as above, but the local tile is padded by one column and the matrix edges are handled explicitly
+//the tile has (get_local_size(1) x (get_local_size(0) + 1)) elements, so reading a tile column
+//hits a different local memory bank in every work-item.
+//SizeX and SizeY do not have to be multiples of the work-group size.
+
+__kernel void MatrixRotOptimizedPadded(__global const float* M, __global float* MR, uint SizeX, uint SizeY,
+							__local float* block)
+{
+	uint LX = get_local_size(0);
+	uint LY = get_local_size(1);
+	uint pitch = LX + 1;
+
+	uint lx = get_local_id(0);
+	uint ly = get_local_id(1);
+
+	//first element of the tile in the input matrix
+	uint x0 = get_group_id(0) * LX;
+	uint y0 = get_group_id(1) * LY;
+
+	//coalesced load of one tile row per work-item row
+	uint x = x0 + lx;
+	uint y = y0 + ly;
+	if(x < SizeX && y < SizeY)
+	{
+		block[ly * pitch + lx] = M[y * SizeX + x];
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	//the rotated tile has LX rows of LY elements: renumber the work-items
+	//so that consecutive work-items write consecutive elements of one output row
+	uint t = ly * LX + lx;
+	uint r = t / LY;
+	uint c = t % LY;
+
+	//output element (r, c) of the tile is input element (LY - 1 - c, r)
+	x = x0 + r;
+	y = y0 + LY - 1 - c;
+	if(x < SizeX && y < SizeY)
+	{
+		MR[x * SizeY + (SizeY - y - 1)] = block[(LY - 1 - c) * pitch + r];
+	}
+}
+
+//batched version of MatrixRotOptimizedPadded: rotates many (small) matrices in one launch
+//Matrices[m] = (input offset, output offset, SizeX, SizeY) of matrix m, offsets in elements.
+//TileStarts[m] is the index of the first tile of matrix m (TileStarts[m + 1] - TileStarts[m] tiles,
+//TileStarts has one more entry than Matrices). Each work-group rotates one tile and the launch
+//covers the tiles of the matrices FirstMatrix ... FirstMatrix + MatrixCount - 1, so the same kernel
+//can also be launched once per matrix.
+
+__kernel void MatrixRotBatched(__global const float* M, __global float* MR,
+							__global const uint4* Matrices, __global const uint* TileStarts,
+							uint FirstMatrix, uint MatrixCount, __local float* block)
+{
+	uint LX = get_local_size(0);
+	uint LY = get_local_size(1);
+	uint pitch = LX + 1;
+
+	uint lx = get_local_id(0);
+	uint ly = get_local_id(1);
+
+	//find the matrix of this tile: the last m with TileStarts[m] <= tile
+	uint tile = TileStarts[FirstMatrix] + get_group_id(0);
+	uint lo = FirstMatrix;
+	uint hi = FirstMatrix + MatrixCount - 1;
+	while(lo < hi)
+	{
+		uint mid = (lo + hi + 1) / 2;
+		if(TileStarts[mid] <= tile)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	uint4 matrix = Matrices[lo];
+	__global const float* in = M + matrix.s0;
+	__global float* out = MR + matrix.s1;
+	uint SizeX = matrix.s2;
+	uint SizeY = matrix.s3;
+
+	uint tilesX = (SizeX + LX - 1) / LX;
+	uint t = tile - TileStarts[lo];
+	uint x0 = (t % tilesX) * LX;
+	uint y0 = (t / tilesX) * LY;
+
+	//from here on identical to MatrixRotOptimizedPadded
+	uint x = x0 + lx;
+	uint y = y0 + ly;
+	if(x < SizeX && y < SizeY)
+	{
+		block[ly * pitch + lx] = in[y * SizeX + x];
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	uint i = ly * LX + lx;
+	uint r = i / LY;
+	uint c = i % LY;
+
+	x = x0 + r;
+	y = y0 + LY - 1 - c;
+	if(x < SizeX && y < SizeY)
+	{
+		out[x * SizeY + (SizeY - y - 1)] = block[(LY - 1 - c) * pitch + r];
+	}
+}
+
+//in-place rotation of a square N x N matrix
+//Every element is part of a cycle of four: (y, x) -> (x, N-1-y) -> (N-1-y, N-1-x) -> (N-1-x, y) -> (y, x).
+//The work-items are mapped to the representatives y < N/2, x < (N+1)/2 (the center of an odd matrix
+//stays in place). A work-group loads the four corresponding rectangles of its tile into local memory
+//and writes each of them back to the next position of the cycle, so every element is read and written
+//by exactly one work-group.
+//block has to hold 4 * get_local_size(1) * (get_local_size(0) + 1) floats.
+
+__kernel void MatrixRotInPlace(__global float* M, uint N, __local float* block)
+{
+	uint LX = get_local_size(0);
+	uint LY = get_local_size(1);
+	uint pitch = LX + 1;
+	uint tileSize = LY * pitch;
+
+	uint lx = get_local_id(0);
+	uint ly = get_local_id(1);
+
+	uint x0 = get_group_id(0) * LX;
+	uint y0 = get_group_id(1) * LY;
+	uint halfY = N / 2;
+	uint halfX = (N + 1) / 2;
+
+	//the rectangles 1 and 3 are transposed, so they are accessed with renumbered work-items
+	//to keep the global memory accesses along the matrix rows
+	uint t = ly * LX + lx;
+	uint r = t / LY;
+	uint c = t % LY;
+
+	//representatives (y0 + i, x0 + j) of the elements accessed by this work-item in the four rectangles
+	uint i0 = ly, j0 = lx;			// (y, x)
+	uint i1 = LY - 1 - c, j1 = r;	// (x, N-1-y)
+	uint i2 = ly, j2 = lx;			// (N-1-y, N-1-x)
+	uint i3 = c, j3 = r;			// (N-1-x, y)
+
+	bool valid0 = (y0 + i0 < halfY) && (x0 + j0 < halfX);
+	bool valid1 = (y0 + i1 < halfY) && (x0 + j1 < halfX);
+	bool valid3 = (y0 + i3 < halfY) && (x0 + j3 < halfX);
+
+	uint y, x;
+	if(valid0)
+	{
+		y = y0 + i0; x = x0 + j0;
+		block[i0 * pitch + j0] = M[y * N + x];
+		block[2 * tileSize + i2 * pitch + j2] = M[(N - 1 - y) * N + (N - 1 - x)];
+	}
+	if(valid1)
+	{
+		y = y0 + i1; x = x0 + j1;
+		block[tileSize + i1 * pitch + j1] = M[x * N + (N - 1 - y)];
+	}
+	if(valid3)
+	{
+		y = y0 + i3; x = x0 + j3;
+		block[3 * tileSize + i3 * pitch + j3] = M[(N - 1 - x) * N + y];
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	//each position receives the element of the previous position in the cycle
+	if(valid0)
+	{
+		y = y0 + i0; x = x0 + j0;
+		M[y * N + x] = block[3 * tileSize + i0 * pitch + j0];
+		M[(N - 1 - y) * N + (N - 1 - x)] = block[tileSize + i2 * pitch + j2];
+	}
+	if(valid1)
+	{
+		y = y0 + i1; x = x0 + j1;
+		M[x * N + (N - 1 - y)] = block[i1 * pitch + j1];
+	}
+	if(valid3)
+	{
+		y = y0 + i3; x = x0 + j3;
+		M[(N - 1 - x) * N + y] = block[2 * tileSize + i3 * pitch + j3];
+	}
+}
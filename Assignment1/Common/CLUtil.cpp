@@ -55,8 +55,7 @@ bool CLUtil::LoadProgramSourceToMemory(const std::string& Path, std::string& Sou
 cl_program CLUtil::BuildCLProgramFromMemory(cl_device_id Device, cl_context Context, const std::string& SourceCode, const std::string& CompileOptions)
 {
 	
-	// Ignore the last parameter CompileOptions in assignment 1
-	// This may be used later to pass flags and macro definitions to the OpenCL compiler
+	// CompileOptions may be used to pass flags and macro definitions to the OpenCL compiler
 
 //	cl_program prog = nullptr;
 
@@ -71,7 +70,8 @@ cl_program CLUtil::BuildCLProgramFromMemory(cl_device_id Device, cl_context Cont
 		return nullptr;
 	}	
 
-	clError = clBuildProgram(prog,1,&Device,NULL,NULL,NULL);
+	const char* pCompileOptions = CompileOptions.size() > 0 ? CompileOptions.c_str() : nullptr;
+	clError = clBuildProgram(prog,1,&Device,pCompileOptions,NULL,NULL);
 	PrintBuildLog(prog,Device);
 	if(CL_SUCCESS != clError)
 	{
@@ -0,0 +1,403 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CLayoutTransform.h"
+
+#include "CLUtil.h"
+#include "CParallel.h"
+
+#include <sstream>
+#include <string.h>
+#include <stdint.h>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// Kernel source
+
+// Parameterized by the macros emitted in GenerateSource():
+// T (element type), P0..P3 (permutation), F0..F3 (flips), TILE, Q, R0, R1
+static const char* g_LayoutKernels =
+"// input offset of the output element o\n"
+"inline uint InOffset(const uint* o, const uint* od, const uint* is)\n"
+"{\n"
+"	return (F0 ? od[0] - 1 - o[0] : o[0]) * is[P0]\n"
+"		+ (F1 ? od[1] - 1 - o[1] : o[1]) * is[P1]\n"
+"		+ (F2 ? od[2] - 1 - o[2] : o[2]) * is[P2]\n"
+"		+ (F3 ? od[3] - 1 - o[3] : o[3]) * is[P3];\n"
+"}\n"
+"\n"
+"inline uint OutOffset(const uint* o, const uint* od)\n"
+"{\n"
+"	return ((o[0] * od[1] + o[1]) * od[2] + o[2]) * od[3] + o[3];\n"
+"}\n"
+"\n"
+"// one element per work-item, used when the innermost axis stays in place\n"
+"__kernel void LayoutCopy(__global const T* In, __global T* Out, uint4 OutDims, uint4 InStrides)\n"
+"{\n"
+"	uint od[4] = {OutDims.s0, OutDims.s1, OutDims.s2, OutDims.s3};\n"
+"	uint is[4] = {InStrides.s0, InStrides.s1, InStrides.s2, InStrides.s3};\n"
+"\n"
+"	uint o[4];\n"
+"	o[3] = get_global_id(0);\n"
+"	o[2] = get_global_id(1);\n"
+"	o[1] = get_global_id(2) % od[1];\n"
+"	o[0] = get_global_id(2) / od[1];\n"
+"	if(o[3] >= od[3] || o[2] >= od[2] || o[0] >= od[0])\n"
+"		return;\n"
+"\n"
+"	Out[OutOffset(o, od)] = In[InOffset(o, od, is)];\n"
+"}\n"
+"\n"
+"#ifdef Q\n"
+"// TILE x TILE block of the output axes Q (along the input rows) and 3 (along the output rows).\n"
+"// The tile is padded by one element, so the transposed reads do not cause bank conflicts.\n"
+"__kernel void LayoutTiled(__global const T* In, __global T* Out, uint4 OutDims, uint4 InStrides)\n"
+"{\n"
+"	__local T tile[TILE][TILE + 1];\n"
+"\n"
+"	uint od[4] = {OutDims.s0, OutDims.s1, OutDims.s2, OutDims.s3};\n"
+"	uint is[4] = {InStrides.s0, InStrides.s1, InStrides.s2, InStrides.s3};\n"
+"\n"
+"	uint lx = get_local_id(0);\n"
+"	uint ly = get_local_id(1);\n"
+"\n"
+"	uint o[4];\n"
+"	o[R1] = get_global_id(2) % od[R1];\n"
+"	o[R0] = get_global_id(2) / od[R1];\n"
+"\n"
+"	// consecutive work-items read consecutive input elements\n"
+"	o[Q] = get_group_id(1) * TILE + lx;\n"
+"	o[3] = get_group_id(0) * TILE + ly;\n"
+"	if(o[Q] < od[Q] && o[3] < od[3])\n"
+"		tile[ly][lx] = In[InOffset(o, od, is)];\n"
+"\n"
+"	barrier(CLK_LOCAL_MEM_FENCE);\n"
+"\n"
+"	// ..and write consecutive output elements\n"
+"	o[Q] = get_group_id(1) * TILE + ly;\n"
+"	o[3] = get_group_id(0) * TILE + lx;\n"
+"	if(o[Q] < od[Q] && o[3] < od[3])\n"
+"		Out[OutOffset(o, od)] = tile[lx][ly];\n"
+"}\n"
+"#endif\n";
+
+static const char* GetCLElementType(size_t ElementSize)
+{
+	switch(ElementSize)
+	{
+	case 1: return "uchar";
+	case 2: return "ushort";
+	case 4: return "uint";
+	case 8: return "ulong";
+	case 16: return "uint4";
+	default: return nullptr;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CLayoutTransform
+
+CLayoutTransform::CLayoutTransform(cl_device_id Device, cl_context Context, CProgramCache& Cache)
+	: m_Device(Device), m_Context(Context), m_Cache(Cache)
+{
+}
+
+SLayoutDesc CLayoutTransform::Permute(unsigned int Rank, const size_t* Dims, const unsigned int* Perm, size_t ElementSize)
+{
+	SLayoutDesc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.Rank = Rank;
+	desc.ElementSize = ElementSize;
+	for(unsigned int a = 0; a < Rank && a < 4; a++)
+	{
+		desc.Dims[a] = Dims[a];
+		desc.Perm[a] = Perm[a];
+	}
+	return desc;
+}
+
+SLayoutDesc CLayoutTransform::Rotate(size_t SizeX, size_t SizeY, int Degrees, size_t ElementSize)
+{
+	const size_t dims[2] = {SizeY, SizeX};
+	const unsigned int identity[2] = {0, 1};
+	const unsigned int transpose[2] = {1, 0};
+
+	int quarterTurns = ((Degrees / 90) % 4 + 4) % 4;
+	SLayoutDesc desc = Permute(2, dims, (quarterTurns % 2) ? transpose : identity, ElementSize);
+	switch(quarterTurns)
+	{
+	// clockwise: Out[x][SizeY - 1 - y] = In[y][x]
+	case 1: desc.Flip[1] = true; break;
+	case 2: desc.Flip[0] = desc.Flip[1] = true; break;
+	// counter-clockwise: Out[SizeX - 1 - x][y] = In[y][x]
+	case 3: desc.Flip[0] = true; break;
+	default: break;
+	}
+	return desc;
+}
+
+SLayoutDesc CLayoutTransform::Flip(unsigned int Rank, const size_t* Dims, unsigned int AxisMask, size_t ElementSize)
+{
+	const unsigned int identity[4] = {0, 1, 2, 3};
+	SLayoutDesc desc = Permute(Rank, Dims, identity, ElementSize);
+	for(unsigned int a = 0; a < Rank && a < 4; a++)
+		desc.Flip[a] = (AxisMask & (1u << a)) != 0;
+	return desc;
+}
+
+bool CLayoutTransform::IsValid(const SLayoutDesc& Desc)
+{
+	if(Desc.Rank < 1 || Desc.Rank > 4 || GetCLElementType(Desc.ElementSize) == nullptr)
+		return false;
+
+	bool used[4] = {false, false, false, false};
+	for(unsigned int a = 0; a < Desc.Rank; a++)
+	{
+		if(Desc.Perm[a] >= Desc.Rank || used[Desc.Perm[a]] || Desc.Dims[a] == 0)
+			return false;
+		used[Desc.Perm[a]] = true;
+	}
+	return true;
+}
+
+void CLayoutTransform::GetOutputDims(const SLayoutDesc& Desc, size_t OutDims[4])
+{
+	for(unsigned int a = 0; a < 4; a++)
+		OutDims[a] = (a < Desc.Rank) ? Desc.Dims[Desc.Perm[a]] : 1;
+}
+
+size_t CLayoutTransform::GetElementCount(const SLayoutDesc& Desc)
+{
+	size_t count = 1;
+	for(unsigned int a = 0; a < Desc.Rank; a++)
+		count *= Desc.Dims[a];
+	return count;
+}
+
+void CLayoutTransform::Normalize(const SLayoutDesc& Desc, SNormalizedLayout& Layout)
+{
+	unsigned int k = 4 - Desc.Rank;
+
+	size_t inDims[4];
+	for(unsigned int a = 0; a < 4; a++)
+	{
+		inDims[a] = (a < k) ? 1 : Desc.Dims[a - k];
+		Layout.Perm[a] = (a < k) ? a : Desc.Perm[a - k] + k;
+		Layout.Flip[a] = (a < k) ? false : Desc.Flip[a - k];
+	}
+
+	Layout.InStrides[3] = 1;
+	for(int a = 2; a >= 0; a--)
+		Layout.InStrides[a] = Layout.InStrides[a + 1] * inDims[a + 1];
+
+	for(unsigned int a = 0; a < 4; a++)
+		Layout.OutDims[a] = inDims[Layout.Perm[a]];
+
+	// the tiled kernel only pays off if the innermost axis changes and the tile is reasonably filled
+	Layout.Q = 3;
+	for(unsigned int a = 0; a < 3; a++)
+		if(Layout.Perm[a] == 3)
+			Layout.Q = a;
+	Layout.Tiled = Layout.Q != 3 && Layout.OutDims[3] >= TILE_SIZE && Layout.OutDims[Layout.Q] >= TILE_SIZE;
+
+	Layout.R0 = (Layout.Q == 0) ? 1 : 0;
+	Layout.R1 = (Layout.Q == 2) ? 1 : 2;
+}
+
+string CLayoutTransform::GenerateSource(const SLayoutDesc& Desc)
+{
+	SNormalizedLayout layout;
+	Normalize(Desc, layout);
+
+	stringstream source;
+	source<<"#define T "<<GetCLElementType(Desc.ElementSize)<<"\n";
+	for(unsigned int a = 0; a < 4; a++)
+		source<<"#define P"<<a<<" "<<layout.Perm[a]<<"\n";
+	for(unsigned int a = 0; a < 4; a++)
+		source<<"#define F"<<a<<" "<<(layout.Flip[a] ? 1 : 0)<<"\n";
+	if(layout.Tiled)
+	{
+		source<<"#define TILE "<<TILE_SIZE<<"\n";
+		source<<"#define Q "<<layout.Q<<"\n";
+		source<<"#define R0 "<<layout.R0<<"\n";
+		source<<"#define R1 "<<layout.R1<<"\n";
+	}
+	source<<"\n"<<g_LayoutKernels;
+	return source.str();
+}
+
+bool CLayoutTransform::Enqueue(cl_command_queue CommandQueue, const SLayoutDesc& Desc, cl_mem In, cl_mem Out)
+{
+	if(!IsValid(Desc))
+	{
+		cerr<<"Error: invalid layout descriptor."<<endl;
+		return false;
+	}
+	// the kernels use 32 bit offsets
+	if(GetElementCount(Desc) > 0xFFFFFFFFull)
+	{
+		cerr<<"Error: the tensor is too large for the layout transform kernels."<<endl;
+		return false;
+	}
+
+	SNormalizedLayout layout;
+	Normalize(Desc, layout);
+
+	cl_kernel kernel = m_Cache.GetKernel(m_Device, m_Context, GenerateSource(Desc), layout.Tiled ? "LayoutTiled" : "LayoutCopy");
+	if(kernel == nullptr)
+		return false;
+
+	cl_uint4 outDims, inStrides;
+	for(unsigned int a = 0; a < 4; a++)
+	{
+		outDims.s[a] = static_cast<cl_uint>(layout.OutDims[a]);
+		inStrides.s[a] = static_cast<cl_uint>(layout.InStrides[a]);
+	}
+
+	cl_int clError = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&In);
+	clError |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&Out);
+	clError |= clSetKernelArg(kernel, 2, sizeof(cl_uint4), (void*)&outDims);
+	clError |= clSetKernelArg(kernel, 3, sizeof(cl_uint4), (void*)&inStrides);
+	V_RETURN_FALSE_CL(clError, "Failed to set kernel args: layout transform");
+
+	size_t localWorkSize[3], globalWorkSize[3];
+	if(layout.Tiled)
+	{
+		localWorkSize[0] = localWorkSize[1] = TILE_SIZE;
+		globalWorkSize[0] = CLUtil::GetGlobalWorkSize(layout.OutDims[3], TILE_SIZE);
+		globalWorkSize[1] = CLUtil::GetGlobalWorkSize(layout.OutDims[layout.Q], TILE_SIZE);
+		globalWorkSize[2] = layout.OutDims[layout.R0] * layout.OutDims[layout.R1];
+	}
+	else
+	{
+		// do not waste most of the work-group on short rows
+		localWorkSize[0] = 1;
+		while(localWorkSize[0] < 64 && localWorkSize[0] < layout.OutDims[3])
+			localWorkSize[0] *= 2;
+		localWorkSize[1] = 1;
+		while(localWorkSize[0] * localWorkSize[1] < 256 && localWorkSize[1] < layout.OutDims[2])
+			localWorkSize[1] *= 2;
+		globalWorkSize[0] = CLUtil::GetGlobalWorkSize(layout.OutDims[3], localWorkSize[0]);
+		globalWorkSize[1] = CLUtil::GetGlobalWorkSize(layout.OutDims[2], localWorkSize[1]);
+		globalWorkSize[2] = layout.OutDims[0] * layout.OutDims[1];
+	}
+	localWorkSize[2] = 1;
+
+	clError = clEnqueueNDRangeKernel(CommandQueue, kernel, 3, NULL, globalWorkSize, localWorkSize, 0, NULL, NULL);
+	V_RETURN_FALSE_CL(clError, "Error executing the layout transform kernel!");
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Host implementation
+
+// 16 byte elements are copied as a pair of 64 bit words
+struct SElement16
+{
+	uint64_t v[2];
+};
+
+template <typename T>
+void CLayoutTransform::TransformCPU(const SNormalizedLayout& Layout, const T* In, T* Out, unsigned int ThreadCount)
+{
+	const size_t* od = Layout.OutDims;
+
+	// input offset of an output element: base + sum(o[a] * step[a])
+	ptrdiff_t step[4];
+	ptrdiff_t base = 0;
+	for(unsigned int a = 0; a < 4; a++)
+	{
+		ptrdiff_t stride = static_cast<ptrdiff_t>(Layout.InStrides[Layout.Perm[a]]);
+		step[a] = Layout.Flip[a] ? -stride : stride;
+		if(Layout.Flip[a])
+			base += static_cast<ptrdiff_t>(od[a] - 1) * stride;
+	}
+
+	ptrdiff_t os[4];
+	os[3] = 1;
+	for(int a = 2; a >= 0; a--)
+		os[a] = os[a + 1] * static_cast<ptrdiff_t>(od[a + 1]);
+
+	if(Layout.Perm[3] == 3)
+	{
+		// rows stay rows: copy (or reverse) them one by one
+		CParallel::For(0, od[0] * od[1] * od[2], [&](size_t Begin, size_t End)
+		{
+			for(size_t r = Begin; r < End; r++)
+			{
+				ptrdiff_t o2 = r % od[2];
+				ptrdiff_t o1 = (r / od[2]) % od[1];
+				ptrdiff_t o0 = r / (od[2] * od[1]);
+
+				const T* src = In + base + o0 * step[0] + o1 * step[1] + o2 * step[2];
+				T* dst = Out + r * od[3];
+				if(step[3] == 1)
+					memcpy(dst, src, od[3] * sizeof(T));
+				else
+					for(size_t x = 0; x < od[3]; x++)
+						dst[x] = src[-static_cast<ptrdiff_t>(x)];
+			}
+		}, ThreadCount, 16);
+		return;
+	}
+
+	// the innermost axis changes: transpose BLOCK x BLOCK blocks of the output axes Q and 3,
+	// so the strided reads of one block stay in the cache
+	const size_t BLOCK = 32;
+	unsigned int q = Layout.Q;
+	unsigned int r0 = (q == 0) ? 1 : 0;
+	unsigned int r1 = (q == 2) ? 1 : 2;
+
+	size_t nBlocksQ = (od[q] + BLOCK - 1) / BLOCK;
+	size_t nBlocks3 = (od[3] + BLOCK - 1) / BLOCK;
+
+	CParallel::For(0, od[r0] * od[r1] * nBlocksQ * nBlocks3, [&](size_t Begin, size_t End)
+	{
+		for(size_t u = Begin; u < End; u++)
+		{
+			size_t b3 = (u % nBlocks3) * BLOCK;
+			size_t bq = ((u / nBlocks3) % nBlocksQ) * BLOCK;
+			size_t outer = u / (nBlocks3 * nBlocksQ);
+
+			ptrdiff_t o[4];
+			o[r1] = outer % od[r1];
+			o[r0] = outer / od[r1];
+
+			ptrdiff_t endQ = min(od[q], bq + BLOCK);
+			ptrdiff_t end3 = min(od[3], b3 + BLOCK);
+			for(o[q] = bq; o[q] < endQ; o[q]++)
+			{
+				const T* src = In + base + o[0] * step[0] + o[1] * step[1] + o[2] * step[2];
+				T* dst = Out + o[0] * os[0] + o[1] * os[1] + o[2] * os[2];
+				for(ptrdiff_t x = b3; x < end3; x++)
+					dst[x] = src[x * step[3]];
+			}
+		}
+	}, ThreadCount, 4);
+}
+
+void CLayoutTransform::TransformCPU(const SLayoutDesc& Desc, const void* In, void* Out, unsigned int ThreadCount)
+{
+	if(!IsValid(Desc))
+	{
+		cerr<<"Error: invalid layout descriptor."<<endl;
+		return;
+	}
+
+	SNormalizedLayout layout;
+	Normalize(Desc, layout);
+
+	switch(Desc.ElementSize)
+	{
+	case 1: TransformCPU(layout, static_cast<const uint8_t*>(In), static_cast<uint8_t*>(Out), ThreadCount); break;
+	case 2: TransformCPU(layout, static_cast<const uint16_t*>(In), static_cast<uint16_t*>(Out), ThreadCount); break;
+	case 4: TransformCPU(layout, static_cast<const uint32_t*>(In), static_cast<uint32_t*>(Out), ThreadCount); break;
+	case 8: TransformCPU(layout, static_cast<const uint64_t*>(In), static_cast<uint64_t*>(Out), ThreadCount); break;
+	case 16: TransformCPU(layout, static_cast<const SElement16*>(In), static_cast<SElement16*>(Out), ThreadCount); break;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
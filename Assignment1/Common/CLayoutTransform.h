@@ -0,0 +1,136 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+
+#ifndef _CLAYOUT_TRANSFORM_H
+#define _CLAYOUT_TRANSFORM_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif 
+
+#include "CommonDefs.h"
+#include "CProgramCache.h"
+
+#include <string>
+
+//! Describes a layout change of a dense, row-major tensor with 1 to 4 axes
+/*!
+	Axis 0 is the outermost (slowest changing) axis. The output axis a
+	runs along the input axis Perm[a] and is reversed if Flip[a] is set:
+
+		Out[o_0, ..., o_R-1] = In[i_0, ..., i_R-1] with i_Perm[a] = Flip[a] ? D_a - 1 - o_a : o_a
+
+	where D_a is the extent of the output axis a. This covers transposes
+	(NCHW <-> NHWC), flips and rotations by multiples of 90 degrees.
+	Elements are copied bit-wise, only their size matters.
+*/
+struct SLayoutDesc
+{
+	unsigned int	Rank;			// number of axes, 1 to 4
+	size_t			Dims[4];		// extents of the INPUT axes
+	unsigned int	Perm[4];		// output axis a is input axis Perm[a]
+	bool			Flip[4];		// reverse the output axis a
+	size_t			ElementSize;	// 1, 2, 4, 8 or 16 bytes
+};
+
+//! Transposes, flips and rotates tensors on the device and on the host
+/*!
+	The device kernels are generated from the layout descriptor and kept
+	in a CProgramCache, so each layout is compiled once. When the innermost
+	axis changes, a tiled kernel reads and writes through a padded local
+	memory tile, so both global memory accesses are coalesced. Otherwise
+	every work-item copies one element.
+
+	TransformCPU() is the cache-blocked, multithreaded host equivalent.
+
+	Usage:
+
+		CLayoutTransform transform(Device, Context, cache);
+		size_t nchw[4] = {N, C, H, W};
+		unsigned int toNHWC[4] = {0, 2, 3, 1};
+		transform.Enqueue(queue, CLayoutTransform::Permute(4, nchw, toNHWC, sizeof(float)), dIn, dOut);
+
+	Transforms are out-of-place: In and Out must not overlap.
+*/
+class CLayoutTransform
+{
+public:
+	CLayoutTransform(cl_device_id Device, cl_context Context, CProgramCache& Cache);
+
+	//! Axis permutation: output axis a is input axis Perm[a]
+	static SLayoutDesc Permute(unsigned int Rank, const size_t* Dims, const unsigned int* Perm, size_t ElementSize);
+
+	//! Clockwise rotation of a SizeX x SizeY matrix (SizeX is the row length) by 0, 90, 180 or 270 degrees
+	static SLayoutDesc Rotate(size_t SizeX, size_t SizeY, int Degrees, size_t ElementSize);
+
+	//! Reverses all axes whose bit is set in AxisMask
+	static SLayoutDesc Flip(unsigned int Rank, const size_t* Dims, unsigned int AxisMask, size_t ElementSize);
+
+	//! Checks the rank, the permutation and the element size
+	static bool IsValid(const SLayoutDesc& Desc);
+
+	//! Extents of the output axes
+	static void GetOutputDims(const SLayoutDesc& Desc, size_t OutDims[4]);
+
+	static size_t GetElementCount(const SLayoutDesc& Desc);
+
+	//! Enqueues the transform of In into Out (both at least GetElementCount() * ElementSize bytes)
+	bool Enqueue(cl_command_queue CommandQueue, const SLayoutDesc& Desc, cl_mem In, cl_mem Out);
+
+	//! Host implementation. ThreadCount == 0 uses all hardware threads.
+	static void TransformCPU(const SLayoutDesc& Desc, const void* In, void* Out, unsigned int ThreadCount = 0);
+
+	//! Returns the OpenCL source of the kernels for the given layout
+	static std::string GenerateSource(const SLayoutDesc& Desc);
+
+	//! Edge length of the local memory tile of the tiled kernel
+	static const unsigned int TILE_SIZE = 16;
+
+protected:
+	//! The layout with leading unit axes added, so that it always has 4 axes
+	struct SNormalizedLayout
+	{
+		unsigned int	Perm[4];
+		bool			Flip[4];
+		size_t			OutDims[4];
+		size_t			InStrides[4];
+
+		// tiled kernel only: output axis along the input rows, and the two remaining axes
+		bool			Tiled;
+		unsigned int	Q, R0, R1;
+	};
+
+	static void Normalize(const SLayoutDesc& Desc, SNormalizedLayout& Layout);
+
+	template <typename T>
+	static void TransformCPU(const SNormalizedLayout& Layout, const T* In, T* Out, unsigned int ThreadCount);
+
+	cl_device_id		m_Device;
+	cl_context			m_Context;
+	CProgramCache&		m_Cache;
+};
+
+#endif // _CLAYOUT_TRANSFORM_H
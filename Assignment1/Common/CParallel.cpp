@@ -0,0 +1,57 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CParallel.h"
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CParallel
+
+unsigned int CParallel::GetThreadCount()
+{
+	unsigned int n = thread::hardware_concurrency();
+	return n > 0 ? n : 1;
+}
+
+void CParallel::For(size_t Begin, size_t End, const function<void(size_t, size_t)>& Body,
+	unsigned int ThreadCount, size_t MinChunkSize)
+{
+	if(End <= Begin)
+		return;
+
+	size_t count = End - Begin;
+	size_t nThreads = ThreadCount > 0 ? ThreadCount : GetThreadCount();
+	nThreads = min(nThreads, max<size_t>(1, count / max<size_t>(1, MinChunkSize)));
+
+	if(nThreads <= 1)
+	{
+		Body(Begin, End);
+		return;
+	}
+
+	size_t chunk = (count + nThreads - 1) / nThreads;
+	vector<thread> workers;
+	workers.reserve(nThreads - 1);
+	for(size_t i = 1; i < nThreads; i++)
+	{
+		size_t b = Begin + i * chunk;
+		size_t e = min(End, b + chunk);
+		if(b >= e)
+			break;
+		workers.push_back(thread(Body, b, e));
+	}
+
+	Body(Begin, min(End, Begin + chunk));
+
+	for(size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,77 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CProgramCache.h"
+
+#include "CLUtil.h"
+
+#include <sstream>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CProgramCache
+
+CProgramCache::~CProgramCache()
+{
+	Release();
+}
+
+string CProgramCache::GetKey(cl_device_id Device, cl_context Context, const std::string& SourceCode, const std::string& CompileOptions) const
+{
+	stringstream key;
+	key<<Device<<" "<<Context<<" "<<CompileOptions<<"\n"<<SourceCode;
+	return key.str();
+}
+
+cl_program CProgramCache::GetProgram(cl_device_id Device, cl_context Context, const std::string& SourceCode, const std::string& CompileOptions)
+{
+	string key = GetKey(Device, Context, SourceCode, CompileOptions);
+
+	map<string, cl_program>::iterator it = m_Programs.find(key);
+	if(it != m_Programs.end())
+		return it->second;
+
+	cl_program program = CLUtil::BuildCLProgramFromMemory(Device, Context, SourceCode, CompileOptions);
+	if(program == nullptr)
+		return nullptr;
+
+	m_Programs[key] = program;
+	return program;
+}
+
+cl_kernel CProgramCache::GetKernel(cl_device_id Device, cl_context Context, const std::string& SourceCode, const std::string& KernelName,
+	const std::string& CompileOptions)
+{
+	string key = KernelName + " " + GetKey(Device, Context, SourceCode, CompileOptions);
+
+	map<string, cl_kernel>::iterator it = m_Kernels.find(key);
+	if(it != m_Kernels.end())
+		return it->second;
+
+	cl_program program = GetProgram(Device, Context, SourceCode, CompileOptions);
+	if(program == nullptr)
+		return nullptr;
+
+	cl_int clError;
+	cl_kernel kernel = clCreateKernel(program, KernelName.c_str(), &clError);
+	V_RETURN_0_CL(clError, "Failed to create kernel: " << KernelName);
+
+	m_Kernels[key] = kernel;
+	return kernel;
+}
+
+void CProgramCache::Release()
+{
+	for(map<string, cl_kernel>::iterator it = m_Kernels.begin(); it != m_Kernels.end(); ++it)
+		clReleaseKernel(it->second);
+	m_Kernels.clear();
+
+	for(map<string, cl_program>::iterator it = m_Programs.begin(); it != m_Programs.end(); ++it)
+		clReleaseProgram(it->second);
+	m_Programs.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,72 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CPROGRAM_CACHE_H
+#define _CPROGRAM_CACHE_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif 
+
+#include "CommonDefs.h"
+
+#include <string>
+#include <map>
+
+//! Keeps built OpenCL programs around, so the same source is compiled only once
+/*!
+	Programs are identified by the device, the context, the compile options
+	and the complete source code. This is mainly useful for kernels that are
+	generated at runtime (the same generated source can show up many times).
+
+	The cache owns the programs and kernels: do not release them yourself.
+*/
+class CProgramCache
+{
+public:
+	CProgramCache() {};
+
+	virtual ~CProgramCache();
+
+	//! Returns a built program, compiling it on the first request. Returns nullptr on failure.
+	cl_program GetProgram(cl_device_id Device, cl_context Context, const std::string& SourceCode, const std::string& CompileOptions = "");
+
+	//! Same as GetProgram(), but returns a kernel of the cached program. Returns nullptr on failure.
+	cl_kernel GetKernel(cl_device_id Device, cl_context Context, const std::string& SourceCode, const std::string& KernelName,
+		const std::string& CompileOptions = "");
+
+	//! Releases all cached programs and kernels
+	void Release();
+
+	size_t GetProgramCount() const { return m_Programs.size(); }
+
+protected:
+	std::string GetKey(cl_device_id Device, cl_context Context, const std::string& SourceCode, const std::string& CompileOptions) const;
+
+	std::map<std::string, cl_program>	m_Programs;
+	std::map<std::string, cl_kernel>	m_Kernels;
+};
+
+#endif // _CPROGRAM_CACHE_H
@@ -0,0 +1,302 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CValidator.h"
+#include "CParallel.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <climits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define VALIDATOR_SSE 1
+#else
+	#define VALIDATOR_SSE 0
+#endif
+
+using namespace std;
+
+// elements tested together before falling back to element-wise checks
+#define VALIDATOR_BLOCK 16
+// minimum number of elements per parallel chunk
+#define VALIDATOR_MIN_CHUNK (1 << 16)
+
+///////////////////////////////////////////////////////////////////////////////
+// CValidator
+
+CValidator::CValidator(EMode Mode, double Tolerance, size_t MaxReported)
+	: m_Mode(Mode), m_Tolerance(Tolerance), m_MaxReported(MaxReported)
+{
+}
+
+bool CValidator::Compare(const float* Expected, const float* Actual, size_t Count)
+{
+	return CompareImpl(Expected, Actual, Count);
+}
+
+bool CValidator::Compare(const int* Expected, const int* Actual, size_t Count)
+{
+	return CompareImpl(Expected, Actual, Count);
+}
+
+bool CValidator::Compare(const unsigned int* Expected, const unsigned int* Actual, size_t Count)
+{
+	return CompareImpl(Expected, Actual, Count);
+}
+
+bool CValidator::Compare(const uint64_t* Expected, const uint64_t* Actual, size_t Count)
+{
+	return CompareImpl(Expected, Actual, Count);
+}
+
+void CValidator::PrintMismatches(const string& Name) const
+{
+	if(m_MismatchCount == 0)
+		return;
+
+	// enough digits to tell neighbouring floats apart
+	streamsize precision = cout.precision(9);
+
+	cout<<Name<<": "<<m_MismatchCount<<" mismatching elements"<<endl;
+	for(size_t i = 0; i < m_Mismatches.size(); i++)
+	{
+		const SMismatch& m = m_Mismatches[i];
+		cout<<"  ["<<m.Index<<"] expected "<<m.Expected<<", got "<<m.Actual<<endl;
+	}
+	if(m_MismatchCount > m_Mismatches.size())
+		cout<<"  ..."<<endl;
+
+	cout.precision(precision);
+}
+
+unsigned int CValidator::UlpDistance(float A, float B)
+{
+	if(std::isnan(A) || std::isnan(B))
+		return UINT_MAX;
+
+	int ia, ib;
+	memcpy(&ia, &A, sizeof(int));
+	memcpy(&ib, &B, sizeof(int));
+
+	// map the sign-magnitude representation to a monotonic integer line (-0 == +0)
+	long long oa = ia < 0 ? -(long long)(ia & 0x7FFFFFFF) : (long long)ia;
+	long long ob = ib < 0 ? -(long long)(ib & 0x7FFFFFFF) : (long long)ib;
+	long long d = oa > ob ? oa - ob : ob - oa;
+
+	return d > (long long)UINT_MAX ? UINT_MAX : (unsigned int)d;
+}
+
+template<class T>
+bool CValidator::CompareImpl(const T* Expected, const T* Actual, size_t Count)
+{
+	size_t nChunks = max<size_t>(1, min<size_t>(CParallel::GetThreadCount() * 4, Count / VALIDATOR_MIN_CHUNK));
+	size_t chunkSize = (Count + nChunks - 1) / nChunks;
+
+	vector<size_t> counts(nChunks, 0);
+	vector< vector<SMismatch> > mismatches(nChunks);
+
+	CParallel::For(0, nChunks, [&](size_t First, size_t Last)
+	{
+		for(size_t c = First; c < Last; c++)
+		{
+			size_t b = min(Count, c * chunkSize);
+			size_t e = min(Count, b + chunkSize);
+			counts[c] = CompareChunk(Expected, Actual, b, e, mismatches[c]);
+		}
+	});
+
+	// chunks are ordered by index, so the first reported ones are the first mismatches overall
+	m_MismatchCount = 0;
+	m_Mismatches.clear();
+	for(size_t c = 0; c < nChunks; c++)
+	{
+		m_MismatchCount += counts[c];
+		for(size_t i = 0; i < mismatches[c].size() && m_Mismatches.size() < m_MaxReported; i++)
+			m_Mismatches.push_back(mismatches[c][i]);
+	}
+
+	return m_MismatchCount == 0;
+}
+
+template<class T>
+size_t CValidator::CompareChunk(const T* Expected, const T* Actual, size_t Begin, size_t End, vector<SMismatch>& Mismatches) const
+{
+	size_t count = 0;
+	size_t i = Begin;
+
+	for(; i + VALIDATOR_BLOCK <= End; i += VALIDATOR_BLOCK)
+	{
+		if(BlockMatches(Expected + i, Actual + i, VALIDATOR_BLOCK))
+			continue;
+
+		for(size_t j = i; j < i + VALIDATOR_BLOCK; j++)
+		{
+			if(!Matches(Expected[j], Actual[j]))
+			{
+				if(Mismatches.size() < m_MaxReported)
+					Mismatches.push_back({j, (double)Expected[j], (double)Actual[j]});
+				count++;
+			}
+		}
+	}
+
+	for(; i < End; i++)
+	{
+		if(!Matches(Expected[i], Actual[i]))
+		{
+			if(Mismatches.size() < m_MaxReported)
+				Mismatches.push_back({i, (double)Expected[i], (double)Actual[i]});
+			count++;
+		}
+	}
+
+	return count;
+}
+
+bool CValidator::Matches(float Expected, float Actual) const
+{
+	if(m_Mode == EXACT)
+		return memcmp(&Expected, &Actual, sizeof(float)) == 0;
+
+	if(std::isnan(Expected) || std::isnan(Actual))
+		return std::isnan(Expected) && std::isnan(Actual);
+	if(Expected == Actual)
+		return true;
+
+	double diff = fabs((double)Expected - (double)Actual);
+	switch(m_Mode)
+	{
+	case ABSOLUTE:
+		return diff <= m_Tolerance;
+	case RELATIVE:
+		return diff <= m_Tolerance * max(fabs((double)Expected), fabs((double)Actual));
+	case ULP:
+		return UlpDistance(Expected, Actual) <= m_Tolerance;
+	default:
+		return false;
+	}
+}
+
+bool CValidator::Matches(int Expected, int Actual) const
+{
+	long long diff = (long long)Expected - (long long)Actual;
+	return (double)(diff < 0 ? -diff : diff) <= (m_Mode == EXACT ? 0.0 : m_Tolerance);
+}
+
+bool CValidator::Matches(unsigned int Expected, unsigned int Actual) const
+{
+	unsigned int diff = Expected > Actual ? Expected - Actual : Actual - Expected;
+	return (double)diff <= (m_Mode == EXACT ? 0.0 : m_Tolerance);
+}
+
+bool CValidator::Matches(uint64_t Expected, uint64_t Actual) const
+{
+	uint64_t diff = Expected > Actual ? Expected - Actual : Actual - Expected;
+	return (double)diff <= (m_Mode == EXACT ? 0.0 : m_Tolerance);
+}
+
+bool CValidator::BlockMatches(const float* Expected, const float* Actual, size_t Count) const
+{
+	if(m_Mode == EXACT)
+		return BlockMatches((const unsigned int*)Expected, (const unsigned int*)Actual, Count);
+
+#if VALIDATOR_SSE
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	const __m128 tol = _mm_set1_ps((float)m_Tolerance);
+	const int ulps = (int)min(m_Tolerance, (double)INT_MAX);
+	const __m128i ulpsHi = _mm_set1_epi32(ulps);
+	const __m128i ulpsLo = _mm_set1_epi32(-ulps);
+
+	__m128i ok = _mm_set1_epi32(-1);
+	for(size_t i = 0; i < Count; i += 4)
+	{
+		__m128 e = _mm_loadu_ps(Expected + i);
+		__m128 a = _mm_loadu_ps(Actual + i);
+		__m128 diff = _mm_and_ps(_mm_sub_ps(e, a), absMask);
+
+		// NaNs fail all comparisons below and end up in the element-wise check
+		__m128i pass;
+		switch(m_Mode)
+		{
+		case ABSOLUTE:
+			pass = _mm_castps_si128(_mm_cmple_ps(diff, tol));
+			break;
+		case RELATIVE:
+			pass = _mm_castps_si128(_mm_cmple_ps(diff,
+				_mm_mul_ps(tol, _mm_max_ps(_mm_and_ps(e, absMask), _mm_and_ps(a, absMask)))));
+			break;
+		default:
+			{
+				// same sign: the bit patterns are ulps apart; other sign or NaN: element-wise
+				__m128i ie = _mm_castps_si128(e);
+				__m128i ia = _mm_castps_si128(a);
+				__m128i d = _mm_sub_epi32(ie, ia);
+				__m128i sameSign = _mm_cmpgt_epi32(_mm_xor_si128(ie, ia), _mm_set1_epi32(-1));
+				__m128i inRange = _mm_andnot_si128(_mm_or_si128(_mm_cmpgt_epi32(d, ulpsHi), _mm_cmplt_epi32(d, ulpsLo)), sameSign);
+				pass = _mm_and_si128(inRange, _mm_castps_si128(_mm_cmpord_ps(e, a)));
+			}
+			break;
+		}
+		ok = _mm_and_si128(ok, pass);
+	}
+	return _mm_movemask_epi8(ok) == 0xFFFF;
+#else
+	for(size_t i = 0; i < Count; i++)
+		if(!Matches(Expected[i], Actual[i]))
+			return false;
+	return true;
+#endif
+}
+
+bool CValidator::BlockMatches(const int* Expected, const int* Actual, size_t Count) const
+{
+	if(m_Mode == EXACT)
+		return BlockMatches((const unsigned int*)Expected, (const unsigned int*)Actual, Count);
+
+	for(size_t i = 0; i < Count; i++)
+		if(!Matches(Expected[i], Actual[i]))
+			return false;
+	return true;
+}
+
+bool CValidator::BlockMatches(const unsigned int* Expected, const unsigned int* Actual, size_t Count) const
+{
+	if(m_Mode != EXACT)
+	{
+		for(size_t i = 0; i < Count; i++)
+			if(!Matches(Expected[i], Actual[i]))
+				return false;
+		return true;
+	}
+
+#if VALIDATOR_SSE
+	__m128i ok = _mm_set1_epi32(-1);
+	for(size_t i = 0; i < Count; i += 4)
+	{
+		__m128i e = _mm_loadu_si128((const __m128i*)(Expected + i));
+		__m128i a = _mm_loadu_si128((const __m128i*)(Actual + i));
+		ok = _mm_and_si128(ok, _mm_cmpeq_epi32(e, a));
+	}
+	return _mm_movemask_epi8(ok) == 0xFFFF;
+#else
+	return memcmp(Expected, Actual, Count * sizeof(unsigned int)) == 0;
+#endif
+}
+
+bool CValidator::BlockMatches(const uint64_t* Expected, const uint64_t* Actual, size_t Count) const
+{
+	if(m_Mode == EXACT)
+		return BlockMatches((const unsigned int*)Expected, (const unsigned int*)Actual, 2 * Count);
+
+	for(size_t i = 0; i < Count; i++)
+		if(!Matches(Expected[i], Actual[i]))
+			return false;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -7,6 +7,14 @@ GPU Computing / GPGPU Praktikum source code.
 
 #include "CReductionTask.h"
 #include "CScanTask.h"
+#include "CScanPrimitiveTask.h"
+#include "CTypedReductionTask.h"
+#include "CSegmentedReductionTask.h"
+#include "CRadixSortTask.h"
+#include "CCompactPrimitiveTask.h"
+#include "CTopKTask.h"
+
+#include "../Common/CLUtil.h"
 
 #include <iostream>
 
@@ -22,8 +30,52 @@ bool CAssignment2::DoCompute()
 	cout<<"Running parallel reduction task..."<<endl<<endl;
 	{
 		size_t LocalWorkSize[3] = {128, 1, 1};
-		CReductionTask reduction( 512 * 64 );
-		RunComputeTask(reduction, LocalWorkSize);
+
+		// the last size is not a power of two, only the unrolled and single-pass variants handle it
+		size_t sizes[] = {512 * 64, 1 << 20, 1 << 24, 1000003};
+		for(size_t i = 0; i < ARRAYLEN(sizes); i++)
+		{
+			cout<<"Array size: "<<sizes[i]<<endl;
+			CReductionTask reduction(sizes[i], LocalWorkSize[0]);
+			RunComputeTask(reduction, LocalWorkSize);
+		}
+	}
+
+	// Task 1b: reductions over other element types and operators
+	cout<<"########################################"<<endl;
+	cout<<"Running typed reduction tasks..."<<endl<<endl;
+	{
+		size_t LocalWorkSize[3] = {128, 1, 1};
+		size_t size = 1 << 22;
+
+		RunTypedReduction<int, SSumOp>(size, LocalWorkSize);
+		RunTypedReduction<int, SMinOp>(size, LocalWorkSize);
+		RunTypedReduction<unsigned int, SMaxOp>(size, LocalWorkSize);
+		RunTypedReduction<float, SSumOp>(size, LocalWorkSize);
+		RunTypedReduction<float, SKahanSumOp>(size, LocalWorkSize);
+		RunTypedReduction<float, SArgMinOp>(size, LocalWorkSize);
+		RunTypedReduction<float, SArgMaxOp>(size, LocalWorkSize);
+		RunTypedReduction<double, SSumOp>(size, LocalWorkSize);
+		RunTypedReduction<double, SArgMaxOp>(size, LocalWorkSize);
+
+		// count, sum, min, max, mean and variance in one pass, compare with the separate sum / min / max above
+		RunTypedReduction<int, SStatsOp>(size, LocalWorkSize);
+		RunTypedReduction<float, SStatsOp>(size, LocalWorkSize);
+		RunTypedReduction<double, SStatsOp>(size, LocalWorkSize);
+	}
+
+	// Task 1c: segmented reduction / reduce-by-key
+	cout<<"########################################"<<endl;
+	cout<<"Running segmented reduction tasks..."<<endl<<endl;
+	{
+		size_t LocalWorkSize[3] = {128, 1, 1};
+		size_t size = 1 << 22;
+
+		CSegmentedReductionTask<float, SSumOp> segmentedSum(size, LocalWorkSize[0]);
+		RunPrimitiveTask(segmentedSum, segmentedSum.GetName(), size, LocalWorkSize);
+
+		CSegmentedReductionTask<int, SArgMaxOp> segmentedArgMax(size, LocalWorkSize[0]);
+		RunPrimitiveTask(segmentedArgMax, segmentedArgMax.GetName(), size, LocalWorkSize);
 	}
 
 	// Task 2: parallel prefix sum
@@ -31,12 +83,126 @@ bool CAssignment2::DoCompute()
 	cout<<"Running parallel prefix sum task..."<<endl<<endl;
 	{
 		size_t LocalWorkSize[3] = {128, 1, 1};
-		CScanTask scan(512*64, LocalWorkSize[0]);
-		RunComputeTask(scan, LocalWorkSize);
+
+		// 2^10 .. 2^28 needs one to four levels, the last size is not a multiple of the block size
+		size_t sizes[] = {1 << 10, 1 << 13, 1 << 16, 1 << 19, 1 << 22, 1 << 25, 1 << 28, 1000003};
+		for(size_t i = 0; i < ARRAYLEN(sizes); i++)
+		{
+			cout<<"Array size: "<<sizes[i]<<endl;
+			CScanTask scan(sizes[i], LocalWorkSize[0]);
+			RunComputeTask(scan, LocalWorkSize);
+		}
+
+		// the same size without the padding, the two runs give the before / after timings of the
+		// padded local memory
+		cout<<"Array size: "<<sizes[4]<<endl;
+		CScanTask scanConflicts(sizes[4], LocalWorkSize[0], false);
+		RunComputeTask(scanConflicts, LocalWorkSize);
+	}
+
+	// Task 2b: generic scan primitive (../Common/CScanPrimitive.h)
+	cout<<"########################################"<<endl;
+	cout<<"Running scan primitive tasks..."<<endl<<endl;
+	{
+		size_t LocalWorkSize[3] = {128, 1, 1};
+		size_t size = 1 << 22;
+
+		RunScanPrimitive<cl_uint, SScanSumOp>(size, false, false, LocalWorkSize);
+		RunScanPrimitive<cl_uint, SScanSumOp>(size, true, false, LocalWorkSize);
+		RunScanPrimitive<cl_int, SScanMaxOp>(size, false, false, LocalWorkSize);
+		RunScanPrimitive<cl_int, SScanMinOp>(size, false, true, LocalWorkSize);
+		RunScanPrimitive<cl_float, SScanSumOp>(size, true, true, LocalWorkSize);
+		RunScanPrimitive<cl_ulong, SScanSumOp>(size, false, false, LocalWorkSize);
+		RunScanPrimitive<cl_ulong, SScanMaxOp>(size, true, true, LocalWorkSize);
+	}
+
+	// Task 3: radix sort (../Common/CRadixSort.h)
+	cout<<"########################################"<<endl;
+	cout<<"Running radix sort tasks..."<<endl<<endl;
+	{
+		size_t LocalWorkSize[3] = {128, 1, 1};
+		size_t size = 1 << 22;
+
+		// 4 and 8 bit digits: twice the passes against larger histograms and less coherent scatters
+		unsigned int digitBits[] = {4, 8};
+		for(size_t i = 0; i < ARRAYLEN(digitBits); i++)
+		{
+			CRadixSortTask<cl_uint> keys(size, false, digitBits[i], LocalWorkSize[0]);
+			RunPrimitiveTask(keys, keys.GetName(), size, LocalWorkSize, "keys");
+
+			CRadixSortTask<cl_uint> pairs(size, true, digitBits[i], LocalWorkSize[0]);
+			RunPrimitiveTask(pairs, pairs.GetName(), size, LocalWorkSize, "keys");
+		}
+
+		CRadixSortTask<cl_ulong> keys64(size, true, 8, LocalWorkSize[0]);
+		RunPrimitiveTask(keys64, keys64.GetName(), size, LocalWorkSize, "keys");
+	}
+
+	// Task 4: stream compaction / stable partition (../Common/CCompactPrimitive.h)
+	cout<<"########################################"<<endl;
+	cout<<"Running stream compaction tasks..."<<endl<<endl;
+	{
+		size_t LocalWorkSize[3] = {128, 1, 1};
+		size_t size = 1 << 22;
+
+		CCompactPrimitiveTask<cl_uint> compactFlags(size, false, "", CCompactPrimitiveTask<cl_uint>::HostPredicate(), LocalWorkSize[0]);
+		RunPrimitiveTask(compactFlags, compactFlags.GetName(), size, LocalWorkSize);
+
+		CCompactPrimitiveTask<cl_uint> partitionFlags(size, true, "", CCompactPrimitiveTask<cl_uint>::HostPredicate(), LocalWorkSize[0]);
+		RunPrimitiveTask(partitionFlags, partitionFlags.GetName(), size, LocalWorkSize);
+
+		// the predicate is evaluated in the kernel, no flags are read
+		CCompactPrimitiveTask<cl_int> compactPositive(size, false, "x > 0",
+			[](cl_int x, cl_uint) { return x > 0; }, LocalWorkSize[0]);
+		RunPrimitiveTask(compactPositive, compactPositive.GetName(), size, LocalWorkSize);
+
+		CCompactPrimitiveTask<cl_float> partitionSmall(size, true, "x < 0.25f",
+			[](cl_float x, cl_uint) { return x < 0.25f; }, LocalWorkSize[0]);
+		RunPrimitiveTask(partitionSmall, partitionSmall.GetName(), size, LocalWorkSize);
+	}
+
+	// Task 5: top-k selection (../Common/CTopKPrimitive.h)
+	cout<<"########################################"<<endl;
+	cout<<"Running top-k tasks..."<<endl<<endl;
+	{
+		size_t LocalWorkSize[3] = {128, 1, 1};
+		size_t size = 1 << 22;
+
+		CTopKTask<cl_uint> keys(size, 1000, false, 0, LocalWorkSize[0]);
+		RunPrimitiveTask(keys, keys.GetName(), size, LocalWorkSize, "keys");
+
+		// about 64 keys per value, many of them equal the threshold
+		CTopKTask<cl_uint> pairs(size, 4096, true, 1 << 16, LocalWorkSize[0]);
+		RunPrimitiveTask(pairs, pairs.GetName(), size, LocalWorkSize, "keys");
+
+		CTopKTask<cl_ulong> pairs64(size, 2000, true, 0, LocalWorkSize[0]);
+		RunPrimitiveTask(pairs64, pairs64.GetName(), size, LocalWorkSize, "keys");
 	}
 
 
 	return true;
 }
 
+void CAssignment2::RunPrimitiveTask(IComputeTask& Task, const string& Name, size_t ArraySize, size_t LocalWorkSize[3],
+	const char* Items)
+{
+	cout<<Name<<", "<<ArraySize<<" "<<Items<<endl;
+	RunComputeTask(Task, LocalWorkSize);
+	cout<<endl;
+}
+
+template <typename T, template <typename> class Op>
+void CAssignment2::RunTypedReduction(size_t ArraySize, size_t LocalWorkSize[3])
+{
+	CTypedReductionTask<T, Op> task(ArraySize, LocalWorkSize[0]);
+	RunPrimitiveTask(task, task.GetName(), ArraySize, LocalWorkSize);
+}
+
+template <typename T, template <typename> class Op>
+void CAssignment2::RunScanPrimitive(size_t ArraySize, bool Exclusive, bool Segmented, size_t LocalWorkSize[3])
+{
+	CScanPrimitiveTask<T, Op> task(ArraySize, Exclusive, Segmented, LocalWorkSize[0]);
+	RunPrimitiveTask(task, task.GetName(), ArraySize, LocalWorkSize);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
@@ -22,6 +22,8 @@
 
 #include "../Common/CAssignmentBase.h"
 
+#include <string>
+
 //! Assignment2 solution
 class CAssignment2 : public CAssignmentBase
 {
@@ -30,6 +32,19 @@ public:
 
 	//! This overloaded method contains the specific solution of A2
 	virtual bool DoCompute();
+
+protected:
+	//! Prints the name and size of a primitive benchmark and runs it
+	void RunPrimitiveTask(IComputeTask& Task, const std::string& Name, size_t ArraySize, size_t LocalWorkSize[3],
+		const char* Items = "elements");
+
+	//! Runs one instance of the typed reduction (A2/T1b)
+	template <typename T, template <typename> class Op>
+	void RunTypedReduction(size_t ArraySize, size_t LocalWorkSize[3]);
+
+	//! Runs one instance of the scan primitive (A2/T2b)
+	template <typename T, template <typename> class Op>
+	void RunScanPrimitive(size_t ArraySize, bool Exclusive, bool Segmented, size_t LocalWorkSize[3]);
 };
 
 #endif // _CASSIGNMENT2_H
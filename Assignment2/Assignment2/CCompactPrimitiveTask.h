@@ -0,0 +1,192 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CCOMPACT_PRIMITIVE_TASK_H
+#define _CCOMPACT_PRIMITIVE_TASK_H
+
+#include "../Common/IComputeTask.h"
+#include "../Common/CLUtil.h"
+#include "../Common/CBenchmark.h"
+#include "../Common/CValidator.h"
+#include "../Common/CCompactPrimitive.h"
+
+#include <iostream>
+#include <vector>
+#include <functional>
+
+//! A2/T4: Validation and benchmark of stream compaction / stable partition (../Common/CCompactPrimitive.h)
+/*!
+	T is cl_uint, cl_int or cl_float. Without a predicate every element is kept
+	with probability 1/2 (random flags). A predicate is given twice, as OpenCL
+	expression of x and i for the kernel and as the same test on the host.
+*/
+template <typename T>
+class CCompactPrimitiveTask : public IComputeTask
+{
+public:
+	typedef std::function<bool(T, cl_uint)> HostPredicate;
+
+	CCompactPrimitiveTask(size_t ArraySize, bool Partition, const std::string& Predicate = "", HostPredicate Host = HostPredicate(),
+		size_t LocalWorkSize = 128)
+		: m_N(ArraySize), m_Partition(Partition), m_HostPredicate(Host),
+		m_Compact(CLScanType<T>::Name(), Predicate, LocalWorkSize),
+		m_CountCPU(0), m_CountGPU(0), m_dInput(NULL), m_dOutput(NULL), m_dFlags(NULL), m_dCount(NULL)
+	{
+		m_Name = std::string(m_Partition ? "partition " : "compaction ") + CLScanType<T>::Name() + ", "
+			+ (Predicate.empty() ? std::string("flags") : "predicate " + Predicate);
+	}
+
+	virtual ~CCompactPrimitiveTask()
+	{
+		ReleaseResources();
+	}
+
+	const std::string& GetName() const { return m_Name; }
+
+	// IComputeTask
+
+	virtual bool InitResources(cl_device_id Device, cl_context Context)
+	{
+		//CPU resources
+		CBenchmark::Fill(m_hInput, m_N, CBenchmark::RandomValue<T>);
+		if(m_HostPredicate)
+		{
+			m_hFlags.resize(m_N);
+			for(size_t i = 0; i < m_N; i++)
+				m_hFlags[i] = m_HostPredicate(m_hInput[i], cl_uint(i)) ? 1 : 0;
+		}
+		else
+			CBenchmark::Fill(m_hFlags, m_N, []() { return CBenchmark::RandomFlag(2); });
+		m_hResultCPU.resize(m_N);
+		m_hResultGPU.resize(m_N);
+
+		//device resources
+		cl_int clError, clError2;
+		m_dInput = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(T) * m_N, &m_hInput[0], &clError2);
+		clError = clError2;
+		m_dOutput = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(T) * m_N, NULL, &clError2);
+		clError |= clError2;
+		m_dFlags = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint) * m_N, &m_hFlags[0], &clError2);
+		clError |= clError2;
+		m_dCount = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint), NULL, &clError2);
+		clError |= clError2;
+		V_RETURN_FALSE_CL(clError, "Error allocating device arrays");
+
+		return m_Compact.Init(Device, Context);
+	}
+
+	virtual void ReleaseResources()
+	{
+		// host resources
+		m_hInput.clear();
+		m_hFlags.clear();
+		m_hResultCPU.clear();
+		m_hResultGPU.clear();
+
+		// device resources
+		m_Compact.Release();
+
+		SAFE_RELEASE_MEMOBJECT(m_dInput);
+		SAFE_RELEASE_MEMOBJECT(m_dOutput);
+		SAFE_RELEASE_MEMOBJECT(m_dFlags);
+		SAFE_RELEASE_MEMOBJECT(m_dCount);
+	}
+
+	virtual void ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
+	{
+		if(!Run(CommandQueue))
+			return;
+		V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dOutput, CL_TRUE, 0, sizeof(T) * m_N, &m_hResultGPU[0], 0, NULL, NULL),
+			"Error reading data from device!");
+		V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dCount, CL_TRUE, 0, sizeof(cl_uint), &m_CountGPU, 0, NULL, NULL),
+			"Error reading data from device!");
+
+		//measure the performance
+		double ms;
+		if(!CBenchmark::TimeGPU(CommandQueue, [this, CommandQueue]() { Run(CommandQueue); }, ms))
+			return;
+		CBenchmark::PrintGPU(GetName() + (m_Compact.UsesLookBack() ? " (single pass" : " (count, scan, scatter")
+			+ (m_Compact.UsesSubGroups() ? ", sub-groups)" : ")"), ms, double(m_N));
+	}
+
+	virtual void ComputeCPU()
+	{
+		double ms = CBenchmark::TimeCPU([this]()
+			{
+				// kept elements in order, then (for partitions) the rejected ones
+				size_t out = 0;
+				for(size_t i = 0; i < m_N; i++)
+					if(m_hFlags[i])
+						m_hResultCPU[out++] = m_hInput[i];
+				m_CountCPU = cl_uint(out);
+				if(m_Partition)
+					for(size_t i = 0; i < m_N; i++)
+						if(!m_hFlags[i])
+							m_hResultCPU[out++] = m_hInput[i];
+			});
+
+		CBenchmark::PrintCPU(GetName() + " reference (" + std::to_string(m_CountCPU) + " kept)", ms);
+	}
+
+	virtual bool ValidateResults()
+	{
+		if(m_CountGPU != m_CountCPU)
+		{
+			std::cout<<"  "<<GetName()<<": "<<m_CountGPU<<" elements kept, expected "<<m_CountCPU<<std::endl;
+			return false;
+		}
+
+		// only the kept elements are defined after a compaction
+		CValidator validator;
+		bool success = validator.Compare(&m_hResultCPU[0], &m_hResultGPU[0], m_Partition ? m_N : m_CountCPU);
+		validator.PrintMismatches(GetName());
+		return success;
+	}
+
+protected:
+	bool Run(cl_command_queue CommandQueue)
+	{
+		// with a predicate the flags are not needed
+		cl_mem flags = m_Compact.HasPredicate() ? NULL : m_dFlags;
+		if(m_Partition)
+			return m_Compact.Partition(CommandQueue, m_dInput, m_dOutput, m_N, flags, m_dCount);
+		return m_Compact.Compact(CommandQueue, m_dInput, m_dOutput, m_N, flags, m_dCount);
+	}
+
+	size_t					m_N;
+	bool					m_Partition;
+	HostPredicate			m_HostPredicate;
+	std::string				m_Name;
+	CCompactPrimitive		m_Compact;
+
+	std::vector<T>			m_hInput;
+	std::vector<cl_uint>	m_hFlags;
+	std::vector<T>			m_hResultCPU;
+	std::vector<T>			m_hResultGPU;
+	cl_uint					m_CountCPU;
+	cl_uint					m_CountGPU;
+
+	cl_mem					m_dInput;
+	cl_mem					m_dOutput;
+	cl_mem					m_dFlags;
+	cl_mem					m_dCount;
+};
+
+#endif // _CCOMPACT_PRIMITIVE_TASK_H
@@ -0,0 +1,284 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CRADIX_SORT_TASK_H
+#define _CRADIX_SORT_TASK_H
+
+#include "../Common/IComputeTask.h"
+#include "../Common/CLUtil.h"
+#include "../Common/CBenchmark.h"
+#include "../Common/CValidator.h"
+#include "../Common/CParallel.h"
+#include "../Common/CRadixSort.h"
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+//! Multithreaded LSD radix sort on the HOST with 8 bit digits (stable, Values may be NULL)
+/*!
+	Every thread counts the digits of its own chunk, the counts are scanned
+	digit-major (digit, then chunk), so every chunk scatters its keys stably
+	into its own ranges.
+*/
+template <typename K>
+void RadixSortReference(std::vector<K>& Keys, std::vector<cl_uint>* Values)
+{
+	const unsigned int radix = 256;
+	size_t N = Keys.size();
+	size_t nChunks = std::max(size_t(1), std::min(size_t(CParallel::GetThreadCount()), N / 65536));
+
+	std::vector<K> tempKeys(N);
+	std::vector<cl_uint> tempValues(Values ? N : 0);
+	std::vector<size_t> offsets(nChunks * radix);
+
+	for(unsigned int shift = 0; shift < 8 * sizeof(K); shift += 8)
+	{
+		K* keysIn = &Keys[0];
+		K* keysOut = &tempKeys[0];
+		cl_uint* valuesIn = Values ? &(*Values)[0] : NULL;
+		cl_uint* valuesOut = Values ? &tempValues[0] : NULL;
+
+		CParallel::For(0, nChunks, [&](size_t Begin, size_t End) {
+			for(size_t c = Begin; c < End; c++)
+			{
+				size_t* count = &offsets[c * radix];
+				std::fill(count, count + radix, 0);
+				for(size_t i = c * N / nChunks; i < (c + 1) * N / nChunks; i++)
+					count[(keysIn[i] >> shift) & (radix - 1)]++;
+			}
+		});
+
+		size_t sum = 0;
+		for(unsigned int d = 0; d < radix; d++)
+			for(size_t c = 0; c < nChunks; c++)
+			{
+				size_t count = offsets[c * radix + d];
+				offsets[c * radix + d] = sum;
+				sum += count;
+			}
+
+		CParallel::For(0, nChunks, [&](size_t Begin, size_t End) {
+			for(size_t c = Begin; c < End; c++)
+			{
+				size_t* offset = &offsets[c * radix];
+				for(size_t i = c * N / nChunks; i < (c + 1) * N / nChunks; i++)
+				{
+					size_t dst = offset[(keysIn[i] >> shift) & (radix - 1)]++;
+					keysOut[dst] = keysIn[i];
+					if(valuesOut)
+						valuesOut[dst] = valuesIn[i];
+				}
+			}
+		});
+
+		// the number of passes is even for 32 and 64 bit keys, the result ends up in Keys
+		Keys.swap(tempKeys);
+		if(Values)
+			Values->swap(tempValues);
+	}
+}
+
+//! A2/T3: LSD radix sort (../Common/CRadixSort.h) of cl_uint or cl_ulong keys, optionally with values
+/*!
+	The keys are random over the full key width, the values are the original
+	indices, so a correct stable sort reproduces the CPU radix sort exactly.
+	The CPU radix sort and std::sort (std::stable_sort for key / value pairs)
+	are timed for comparison.
+*/
+template <typename K>
+class CRadixSortTask : public IComputeTask
+{
+public:
+	CRadixSortTask(size_t ArraySize, bool HasValues, unsigned int DigitBits, size_t LocalWorkSize = 128)
+		: m_N(ArraySize), m_Sort(sizeof(K) == sizeof(cl_ulong), HasValues, DigitBits, LocalWorkSize),
+		m_ReferenceValid(false), m_dInputKeys(NULL), m_dInputValues(NULL), m_dKeys(NULL), m_dValues(NULL)
+	{
+		std::stringstream name;
+		name<<"radix sort, "<<8 * sizeof(K)<<" bit keys"<<(HasValues ? " + values" : "")<<", "<<DigitBits<<" bit digits";
+		m_Name = name.str();
+	}
+
+	virtual ~CRadixSortTask()
+	{
+		ReleaseResources();
+	}
+
+	const std::string& GetName() const { return m_Name; }
+
+	// IComputeTask
+
+	virtual bool InitResources(cl_device_id Device, cl_context Context)
+	{
+		//CPU resources
+		CBenchmark::Fill(m_hInputKeys, m_N, CBenchmark::RandomBits<K>);
+		m_hInputValues.resize(m_N);
+		for(size_t i = 0; i < m_N; i++)
+			m_hInputValues[i] = cl_uint(i);
+
+		//device resources
+		cl_int clError, clError2;
+		m_dInputKeys = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(K) * m_N, &m_hInputKeys[0], &clError2);
+		clError = clError2;
+		m_dInputValues = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint) * m_N, &m_hInputValues[0], &clError2);
+		clError |= clError2;
+		m_dKeys = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(K) * m_N, NULL, &clError2);
+		clError |= clError2;
+		m_dValues = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * m_N, NULL, &clError2);
+		clError |= clError2;
+		V_RETURN_FALSE_CL(clError, "Error allocating device arrays");
+
+		return m_Sort.Init(Device, Context);
+	}
+
+	virtual void ReleaseResources()
+	{
+		// host resources
+		m_hInputKeys.clear();
+		m_hInputValues.clear();
+		m_hKeysCPU.clear();
+		m_hValuesCPU.clear();
+		m_hKeysGPU.clear();
+		m_hValuesGPU.clear();
+
+		// device resources
+		m_Sort.Release();
+
+		SAFE_RELEASE_MEMOBJECT(m_dInputKeys);
+		SAFE_RELEASE_MEMOBJECT(m_dInputValues);
+		SAFE_RELEASE_MEMOBJECT(m_dKeys);
+		SAFE_RELEASE_MEMOBJECT(m_dValues);
+	}
+
+	virtual void ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
+	{
+		if(!SortGPU(CommandQueue))
+			return;
+
+		m_hKeysGPU.resize(m_N);
+		m_hValuesGPU.resize(m_N);
+		V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dKeys, CL_TRUE, 0, sizeof(K) * m_N, &m_hKeysGPU[0], 0, NULL, NULL),
+			"Error reading data from device!");
+		if(m_Sort.HasValues())
+			V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dValues, CL_TRUE, 0, sizeof(cl_uint) * m_N, &m_hValuesGPU[0], 0, NULL, NULL),
+				"Error reading data from device!");
+
+		//measure the performance, every iteration starts from the unsorted input again
+		double ms;
+		if(!CBenchmark::TimeGPU(CommandQueue, [this, CommandQueue]() { SortGPU(CommandQueue); }, ms, 20))
+			return;
+		CBenchmark::PrintKeys(GetName() + " (including the copy of the input)", ms, double(m_N));
+	}
+
+	virtual void ComputeCPU()
+	{
+		m_hKeysCPU = m_hInputKeys;
+		if(m_Sort.HasValues())
+			m_hValuesCPU = m_hInputValues;
+
+		double msRadix = CBenchmark::TimeCPU([this]() { RadixSortReference(m_hKeysCPU, m_Sort.HasValues() ? &m_hValuesCPU : NULL); });
+
+		// std::sort as the baseline, pairs need the stable variant to give the same values
+		std::vector<K> keys;
+		std::vector<std::pair<K, cl_uint> > pairs;
+		if(m_Sort.HasValues())
+		{
+			pairs.resize(m_N);
+			for(size_t i = 0; i < m_N; i++)
+				pairs[i] = std::make_pair(m_hInputKeys[i], m_hInputValues[i]);
+		}
+		else
+			keys = m_hInputKeys;
+
+		double msStd = CBenchmark::TimeCPU([this, &keys, &pairs]()
+			{
+				if(m_Sort.HasValues())
+					std::stable_sort(pairs.begin(), pairs.end(),
+						[](const std::pair<K, cl_uint>& A, const std::pair<K, cl_uint>& B) { return A.first < B.first; });
+				else
+					std::sort(keys.begin(), keys.end());
+			});
+
+		std::stringstream radixLabel;
+		radixLabel<<"CPU radix sort ("<<CParallel::GetThreadCount()<<" threads)";
+		CBenchmark::PrintKeys(radixLabel.str(), msRadix, double(m_N), true);
+		CBenchmark::PrintKeys(m_Sort.HasValues() ? "std::stable_sort" : "std::sort", msStd, double(m_N), true);
+
+		// the reference itself is checked against the standard library
+		m_ReferenceValid = true;
+		for(size_t i = 0; i < m_N && m_ReferenceValid; i++)
+		{
+			if(m_Sort.HasValues())
+				m_ReferenceValid = pairs[i].first == m_hKeysCPU[i] && pairs[i].second == m_hValuesCPU[i];
+			else
+				m_ReferenceValid = keys[i] == m_hKeysCPU[i];
+		}
+		if(!m_ReferenceValid)
+			std::cout<<"  CPU radix sort does not match the standard library!"<<std::endl;
+	}
+
+	virtual bool ValidateResults()
+	{
+		if(m_hKeysGPU.size() != m_N)
+			return false;
+
+		CValidator validator;
+		bool success = m_ReferenceValid && validator.Compare(&m_hKeysCPU[0], &m_hKeysGPU[0], m_N);
+		validator.PrintMismatches(GetName() + " keys");
+		if(m_Sort.HasValues())
+		{
+			success = validator.Compare(&m_hValuesCPU[0], &m_hValuesGPU[0], m_N) && success;
+			validator.PrintMismatches(GetName() + " values");
+		}
+		return success;
+	}
+
+protected:
+	bool SortGPU(cl_command_queue CommandQueue)
+	{
+		V_RETURN_FALSE_CL(clEnqueueCopyBuffer(CommandQueue, m_dInputKeys, m_dKeys, 0, 0, sizeof(K) * m_N, 0, NULL, NULL),
+			"Error copying the input keys");
+		if(m_Sort.HasValues())
+			V_RETURN_FALSE_CL(clEnqueueCopyBuffer(CommandQueue, m_dInputValues, m_dValues, 0, 0, sizeof(cl_uint) * m_N, 0, NULL, NULL),
+				"Error copying the input values");
+
+		return m_Sort.Sort(CommandQueue, m_dKeys, m_dValues, m_N);
+	}
+
+	size_t					m_N;
+	std::string				m_Name;
+	CRadixSort				m_Sort;
+	bool					m_ReferenceValid;
+
+	std::vector<K>			m_hInputKeys;
+	std::vector<cl_uint>	m_hInputValues;
+	std::vector<K>			m_hKeysCPU;
+	std::vector<cl_uint>	m_hValuesCPU;
+	std::vector<K>			m_hKeysGPU;
+	std::vector<cl_uint>	m_hValuesGPU;
+
+	cl_mem					m_dInputKeys;
+	cl_mem					m_dInputValues;
+	cl_mem					m_dKeys;
+	cl_mem					m_dValues;
+};
+
+#endif // _CRADIX_SORT_TASK_H
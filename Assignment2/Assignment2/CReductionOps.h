@@ -0,0 +1,400 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CREDUCTION_OPS_H
+#define _CREDUCTION_OPS_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif 
+
+#include "../Common/CLUtil.h"
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <sstream>
+
+//! Element types of the typed reduction
+/*!
+	Name() is the OpenCL type, Lowest() / Highest() the OpenCL expressions of
+	its range (identities of max / min), Real is the floating point type of
+	the statistics (SStatsOp).
+*/
+template <typename T> struct CLReductionType;
+
+template <> struct CLReductionType<int>
+{
+	typedef float Real;
+
+	static const char* Name() { return "int"; }
+	static const char* Lowest() { return "INT_MIN"; }
+	static const char* Highest() { return "INT_MAX"; }
+};
+
+template <> struct CLReductionType<unsigned int>
+{
+	typedef float Real;
+
+	static const char* Name() { return "uint"; }
+	static const char* Lowest() { return "0"; }
+	static const char* Highest() { return "UINT_MAX"; }
+};
+
+template <> struct CLReductionType<float>
+{
+	typedef float Real;
+
+	static const char* Name() { return "float"; }
+	static const char* Lowest() { return "-FLT_MAX"; }
+	static const char* Highest() { return "FLT_MAX"; }
+};
+
+template <> struct CLReductionType<double>
+{
+	typedef double Real;
+
+	static const char* Name() { return "double"; }
+	static const char* Lowest() { return "-DBL_MAX"; }
+	static const char* Highest() { return "DBL_MAX"; }
+};
+
+//! Accumulator of the compensated sum (same layout as in ReductionOps.cl)
+template <typename T>
+struct SKahanSum
+{
+	T		Sum;
+	T		Compensation;
+};
+
+//! Accumulator of argmin / argmax (same layout as in ReductionOps.cl)
+template <typename T>
+struct SArgResult
+{
+	T		Value;
+	cl_uint	Index;
+};
+
+//! Accumulator of the statistics (same layout as in ReductionOps.cl)
+template <typename T>
+struct SStats
+{
+	typedef typename CLReductionType<T>::Real Real;
+
+	T		Sum;
+	T		Min;
+	T		Max;
+	Real	Mean;
+	//! sum of the squared deviations from the mean
+	Real	M2;
+	cl_uint	Count;
+
+	double Variance() const { return Count > 0 ? double(M2) / double(Count) : 0.0; }
+};
+
+//! Reduction operators
+/*!
+	Each operator mirrors the device implementation selected by Define():
+	Identity(), Load() and the associative Combine(). Reference() computes
+	the CPU result (FirstIndex is the index of Data[0] in the whole array)
+	and Matches() compares a device result with it. AbsSum is
+	the sum of the absolute input values, the scale of the rounding errors
+	of the sums.
+*/
+template <typename T>
+struct SSumOp
+{
+	typedef T Acc;
+
+	static const char* Name() { return "sum"; }
+	static const char* Define() { return "OP_SUM"; }
+
+	static Acc Identity() { return T(0); }
+	static Acc Load(T Value, cl_uint) { return Value; }
+	static Acc Combine(const Acc& A, const Acc& B) { return A + B; }
+
+	static double Value(const Acc& A) { return double(A); }
+
+	//! Integers are summed exactly (modulo 2^32), floats with a compensated double sum
+	static Acc Reference(const T* Data, size_t Count, cl_uint FirstIndex = 0)
+	{
+		if(std::numeric_limits<T>::is_integer)
+		{
+			Acc acc = Identity();
+			for(size_t i = 0; i < Count; i++)
+				acc = T((unsigned int)acc + (unsigned int)Data[i]);
+			return acc;
+		}
+		return T(KahanReference(Data, Count));
+	}
+
+	//! Plain float sums accumulate about one rounding error per sequential addition
+	static bool Matches(const Acc& Result, const Acc& Reference, double AbsSum)
+	{
+		if(std::numeric_limits<T>::is_integer)
+			return Result == Reference;
+		return std::fabs(Value(Result) - Value(Reference)) <= 1024.0 * std::numeric_limits<T>::epsilon() * AbsSum;
+	}
+
+	static double KahanReference(const T* Data, size_t Count)
+	{
+		double sum = 0.0, compensation = 0.0;
+		for(size_t i = 0; i < Count; i++)
+		{
+			double y = double(Data[i]) - compensation;
+			double t = sum + y;
+			compensation = (t - sum) - y;
+			sum = t;
+		}
+		return sum;
+	}
+};
+
+template <typename T>
+struct SKahanSumOp
+{
+	typedef SKahanSum<T> Acc;
+
+	static const char* Name() { return "kahan sum"; }
+	static const char* Define() { return "OP_KAHAN_SUM"; }
+
+	static Acc Identity() { Acc r = { T(0), T(0) }; return r; }
+	static Acc Load(T Value, cl_uint) { Acc r = { Value, T(0) }; return r; }
+	static Acc Combine(const Acc& A, const Acc& B)
+	{
+		T s = A.Sum + B.Sum;
+		T bv = s - A.Sum;
+		T err = (A.Sum - (s - bv)) + (B.Sum - bv);
+		Acc r = { s, A.Compensation + B.Compensation + err };
+		return r;
+	}
+
+	static double Value(const Acc& A) { return double(A.Sum) + double(A.Compensation); }
+
+	static Acc Reference(const T* Data, size_t Count, cl_uint FirstIndex = 0)
+	{
+		Acc r = { T(SSumOp<T>::KahanReference(Data, Count)), T(0) };
+		return r;
+	}
+
+	//! The error stays at a few rounding errors, independent of the size
+	static bool Matches(const Acc& Result, const Acc& Reference, double AbsSum)
+	{
+		return std::fabs(Value(Result) - Value(Reference)) <= 8.0 * std::numeric_limits<T>::epsilon() * AbsSum;
+	}
+};
+
+template <typename T>
+struct SMinOp
+{
+	typedef T Acc;
+
+	static const char* Name() { return "min"; }
+	static const char* Define() { return "OP_MIN"; }
+
+	static Acc Identity() { return std::numeric_limits<T>::max(); }
+	static Acc Load(T Value, cl_uint) { return Value; }
+	static Acc Combine(const Acc& A, const Acc& B) { return B < A ? B : A; }
+
+	static double Value(const Acc& A) { return double(A); }
+
+	static Acc Reference(const T* Data, size_t Count, cl_uint FirstIndex = 0)
+	{
+		Acc acc = Identity();
+		for(size_t i = 0; i < Count; i++)
+			acc = Combine(acc, Load(Data[i], FirstIndex + cl_uint(i)));
+		return acc;
+	}
+
+	static bool Matches(const Acc& Result, const Acc& Reference, double) { return Result == Reference; }
+};
+
+template <typename T>
+struct SMaxOp
+{
+	typedef T Acc;
+
+	static const char* Name() { return "max"; }
+	static const char* Define() { return "OP_MAX"; }
+
+	static Acc Identity() { return std::numeric_limits<T>::lowest(); }
+	static Acc Load(T Value, cl_uint) { return Value; }
+	static Acc Combine(const Acc& A, const Acc& B) { return B > A ? B : A; }
+
+	static double Value(const Acc& A) { return double(A); }
+
+	static Acc Reference(const T* Data, size_t Count, cl_uint FirstIndex = 0)
+	{
+		Acc acc = Identity();
+		for(size_t i = 0; i < Count; i++)
+			acc = Combine(acc, Load(Data[i], FirstIndex + cl_uint(i)));
+		return acc;
+	}
+
+	static bool Matches(const Acc& Result, const Acc& Reference, double) { return Result == Reference; }
+};
+
+//! argmin / argmax: ties go to the smaller index, so the result is deterministic
+template <typename T, bool IsMax>
+struct SArgOp
+{
+	typedef SArgResult<T> Acc;
+
+	static const char* Name() { return IsMax ? "argmax" : "argmin"; }
+	static const char* Define() { return IsMax ? "OP_ARGMAX" : "OP_ARGMIN"; }
+
+	static Acc Identity()
+	{
+		Acc r = { IsMax ? std::numeric_limits<T>::lowest() : std::numeric_limits<T>::max(), 0xFFFFFFFF };
+		return r;
+	}
+	static Acc Load(T Value, cl_uint Index) { Acc r = { Value, Index }; return r; }
+	static Acc Combine(const Acc& A, const Acc& B)
+	{
+		bool better = IsMax ? (B.Value > A.Value) : (B.Value < A.Value);
+		if(better || (B.Value == A.Value && B.Index < A.Index))
+			return B;
+		return A;
+	}
+
+	static double Value(const Acc& A) { return double(A.Value); }
+
+	static Acc Reference(const T* Data, size_t Count, cl_uint FirstIndex = 0)
+	{
+		Acc acc = Identity();
+		for(size_t i = 0; i < Count; i++)
+			acc = Combine(acc, Load(Data[i], FirstIndex + cl_uint(i)));
+		return acc;
+	}
+
+	static bool Matches(const Acc& Result, const Acc& Reference, double)
+	{
+		return Result.Value == Reference.Value && Result.Index == Reference.Index;
+	}
+};
+
+template <typename T> struct SArgMinOp : public SArgOp<T, false> {};
+template <typename T> struct SArgMaxOp : public SArgOp<T, true> {};
+
+//! count, sum, min, max, mean and variance in a single pass over the data
+/*!
+	Combine() is the merge of Chan et al. (Load() followed by Combine() is
+	Welford's update), so the partial results of the work-items and groups can
+	be merged in any order without the cancellation of the textbook formula.
+*/
+template <typename T>
+struct SStatsOp
+{
+	typedef SStats<T> Acc;
+	typedef typename Acc::Real Real;
+
+	static const char* Name() { return "stats"; }
+	static const char* Define() { return "OP_STATS"; }
+
+	static Acc Identity()
+	{
+		Acc r = { T(0), std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest(), Real(0), Real(0), 0 };
+		return r;
+	}
+	static Acc Load(T Value, cl_uint) { Acc r = { Value, Value, Value, Real(Value), Real(0), 1 }; return r; }
+	static Acc Combine(const Acc& A, const Acc& B)
+	{
+		cl_uint n = A.Count + B.Count;
+		if(n == 0)
+			return A;
+
+		Real delta = B.Mean - A.Mean;
+		Real weightB = Real(B.Count) / Real(n);
+		Acc r;
+		r.Sum = A.Sum + B.Sum;
+		r.Min = B.Min < A.Min ? B.Min : A.Min;
+		r.Max = B.Max > A.Max ? B.Max : A.Max;
+		r.Mean = A.Mean + delta * weightB;
+		r.M2 = A.M2 + B.M2 + delta * delta * Real(A.Count) * weightB;
+		r.Count = n;
+		return r;
+	}
+
+	static double Value(const Acc& A) { return double(A.Mean); }
+
+	//! Two passes in double: the mean from the compensated sum, then the squared deviations
+	static Acc Reference(const T* Data, size_t Count, cl_uint FirstIndex = 0)
+	{
+		Acc r = Identity();
+		r.Count = cl_uint(Count);
+		r.Sum = SSumOp<T>::Reference(Data, Count);
+
+		double mean = Count > 0 ? SSumOp<T>::KahanReference(Data, Count) / double(Count) : 0.0;
+		double m2 = 0.0;
+		for(size_t i = 0; i < Count; i++)
+		{
+			r.Min = Data[i] < r.Min ? Data[i] : r.Min;
+			r.Max = Data[i] > r.Max ? Data[i] : r.Max;
+			double d = double(Data[i]) - mean;
+			m2 += d * d;
+		}
+		r.Mean = Real(mean);
+		r.M2 = Real(m2);
+		return r;
+	}
+
+	//! The sum as for SSumOp, min and max exactly, mean and M2 relative to their scale
+	static bool Matches(const Acc& Result, const Acc& Reference, double AbsSum)
+	{
+		double eps = std::numeric_limits<Real>::epsilon();
+		double n = Reference.Count > 0 ? double(Reference.Count) : 1.0;
+		return Result.Count == Reference.Count && Result.Min == Reference.Min && Result.Max == Reference.Max
+			&& SSumOp<T>::Matches(Result.Sum, Reference.Sum, AbsSum)
+			&& std::fabs(double(Result.Mean) - double(Reference.Mean)) <= 1024.0 * eps * AbsSum / n
+			&& std::fabs(double(Result.M2) - double(Reference.M2)) <= 1024.0 * eps * double(Reference.M2);
+	}
+};
+
+//! Compile options selecting the element type and the operator in ReductionOps.cl
+template <typename T, template <typename> class Op>
+std::string GetTypedReductionOptions(size_t BlockSize)
+{
+	std::stringstream options;
+	options<<"-D VALUE_T="<<CLReductionType<T>::Name()
+		<<" -D VALUE_LOWEST="<<CLReductionType<T>::Lowest()
+		<<" -D VALUE_HIGHEST="<<CLReductionType<T>::Highest()
+		<<" -D "<<Op<T>::Define()
+		<<" -D BLOCK_SIZE="<<BlockSize;
+	if(sizeof(T) == sizeof(double) && !std::numeric_limits<T>::is_integer)
+		options<<" -D USE_FP64";
+	return options.str();
+}
+
+//! Loads ReductionOps.cl followed by KernelFile, the operator definitions are shared by all reduction kernels
+inline bool LoadReductionProgramSource(const std::string& KernelFile, std::string& SourceCode)
+{
+	std::string ops, kernels;
+	if(!CLUtil::LoadProgramSourceToMemory("ReductionOps.cl", ops) || !CLUtil::LoadProgramSourceToMemory(KernelFile, kernels))
+		return false;
+	SourceCode = ops + "\n" + kernels;
+	return true;
+}
+
+#endif // _CREDUCTION_OPS_H
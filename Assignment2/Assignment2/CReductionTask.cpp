@@ -7,25 +7,44 @@ GPU Computing / GPGPU Praktikum source code.
 
 #include "../Common/CLUtil.h"
 #include "../Common/CTimer.h"
+#include "../Common/CHostPrimitives.h"
+#include "../Common/CParallel.h"
+
+#include <sstream>
+#include <vector>
+#include <string.h>
 
 using namespace std;
 
+// number of input elements each work-item adds up before the tree phase (Reduction_DecompUnroll)
+#define REDUCTION_ELEMENTS_PER_THREAD 8
+// work-groups per compute unit of the single-pass reduction
+#define REDUCTION_GROUPS_PER_CU 8
+
+// from cl_ext.h (cl_amd_device_attribute_query)
+#ifndef CL_DEVICE_WAVEFRONT_WIDTH_AMD
+#define CL_DEVICE_WAVEFRONT_WIDTH_AMD 0x4043
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 // CReductionTask
 
-string g_kernelNames[4] = {
+string g_kernelNames[5] = {
 	"interleavedAddressing",
 	"sequentialAddressing",
 	"kernelDecomposition",
-	"kernelDecompositionUnroll"
+	"kernelDecompositionUnroll",
+	"singlePass"
 };
 
-CReductionTask::CReductionTask(size_t ArraySize)
-	: m_N(ArraySize), m_hInput(NULL), 
+CReductionTask::CReductionTask(size_t ArraySize, size_t LocalWorkSize)
+	: m_N(ArraySize), m_LocalWorkSize(LocalWorkSize), m_ComputeUnits(1), m_hInput(NULL), m_HostValid(true),
 	m_dPingArray(NULL),
 	m_dPongArray(NULL),
+	m_dCounter(NULL),
 	m_Program(NULL), 
-	m_InterleavedAddressingKernel(NULL), m_SequentialAddressingKernel(NULL), m_DecompKernel(NULL), m_DecompUnrollKernel(NULL)
+	m_InterleavedAddressingKernel(NULL), m_SequentialAddressingKernel(NULL), m_DecompKernel(NULL), m_DecompUnrollKernel(NULL),
+	m_SinglePassKernel(NULL)
 {
 }
 
@@ -50,13 +69,38 @@ bool CReductionTask::InitResources(cl_device_id Device, cl_context Context)
 	clError = clError2;
 	m_dPongArray = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * m_N, NULL, &clError2);
 	clError |= clError2;
+	cl_uint zero = 0;
+	m_dCounter = clCreateBuffer(Context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint), &zero, &clError2);
+	clError |= clError2;
 	V_RETURN_FALSE_CL(clError, "Error allocating device arrays");
 
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &m_ComputeUnits, NULL),
+		"Error querying the number of compute units");
+
 	//load and compile kernels
 	string programCode;
 
 	CLUtil::LoadProgramSourceToMemory("Reduction.cl", programCode);
-	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode);
+
+	// the unrolled kernel needs the block size at compile time
+	stringstream options;
+	options<<"-D BLOCK_SIZE="<<m_LocalWorkSize<<" -D ELEMENTS_PER_THREAD="<<REDUCTION_ELEMENTS_PER_THREAD;
+
+	// AMD wavefronts execute in lockstep, so the last stages can skip the barriers there.
+	// NVIDIA warps do not (independent thread scheduling since Volta), they keep the barriers.
+	size_t extSize = 0;
+	clGetDeviceInfo(Device, CL_DEVICE_EXTENSIONS, 0, NULL, &extSize);
+	vector<char> extensions(extSize + 1, 0);
+	clGetDeviceInfo(Device, CL_DEVICE_EXTENSIONS, extSize, &extensions[0], NULL);
+	cl_uint wavefrontWidth = 0;
+	if(strstr(&extensions[0], "cl_amd_device_attribute_query") &&
+		clGetDeviceInfo(Device, CL_DEVICE_WAVEFRONT_WIDTH_AMD, sizeof(cl_uint), &wavefrontWidth, NULL) == CL_SUCCESS &&
+		wavefrontWidth > 0)
+	{
+		options<<" -D WARP_SIZE="<<wavefrontWidth;
+	}
+
+	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode, options.str());
 	if(m_Program == nullptr) return false;
 
 	//create kernels
@@ -72,6 +116,9 @@ bool CReductionTask::InitResources(cl_device_id Device, cl_context Context)
 	m_DecompUnrollKernel = clCreateKernel(m_Program, "Reduction_DecompUnroll", &clError);
 	V_RETURN_FALSE_CL(clError, "Failed to create kernel: Reduction_DecompUnroll.");
 
+	m_SinglePassKernel = clCreateKernel(m_Program, "Reduction_SinglePass", &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create kernel: Reduction_SinglePass.");
+
 	return true;
 }
 
@@ -83,26 +130,30 @@ void CReductionTask::ReleaseResources()
 	// device resources
 	SAFE_RELEASE_MEMOBJECT(m_dPingArray);
 	SAFE_RELEASE_MEMOBJECT(m_dPongArray);
+	SAFE_RELEASE_MEMOBJECT(m_dCounter);
 
 	SAFE_RELEASE_KERNEL(m_InterleavedAddressingKernel);
 	SAFE_RELEASE_KERNEL(m_SequentialAddressingKernel);
 	SAFE_RELEASE_KERNEL(m_DecompKernel);
 	SAFE_RELEASE_KERNEL(m_DecompUnrollKernel);
+	SAFE_RELEASE_KERNEL(m_SinglePassKernel);
 
 	SAFE_RELEASE_PROGRAM(m_Program);
 }
 
 void CReductionTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
 {
-	ExecuteTask(Context, CommandQueue, LocalWorkSize, 0);
-	ExecuteTask(Context, CommandQueue, LocalWorkSize, 1);
-	ExecuteTask(Context, CommandQueue, LocalWorkSize, 2);
-//	ExecuteTask(Context, CommandQueue, LocalWorkSize, 3);
+	for(unsigned int task = 0; task < ARRAYLEN(m_resultGPU); task++)
+		if(IsTaskSupported(task))
+			ExecuteTask(Context, CommandQueue, LocalWorkSize, task);
 
-	TestPerformance(Context, CommandQueue, LocalWorkSize, 0);
-	TestPerformance(Context, CommandQueue, LocalWorkSize, 1);
-	TestPerformance(Context, CommandQueue, LocalWorkSize, 2);
-//	TestPerformance(Context, CommandQueue, LocalWorkSize, 3);
+	for(unsigned int task = 0; task < ARRAYLEN(m_resultGPU); task++)
+	{
+		if(IsTaskSupported(task))
+			TestPerformance(Context, CommandQueue, LocalWorkSize, task);
+		else
+			cout << "Skipping task " << g_kernelNames[task] << " (requires a power-of-two size)" << endl;
+	}
 
 }
 
@@ -123,14 +174,42 @@ void CReductionTask::ComputeCPU()
 
 	double ms = timer.GetElapsedMilliseconds() / double(nIterations);
 	cout << "  average time: " << ms << " ms, throughput: " << 1.0e-6 * (double)m_N / ms << " Gelem/s" <<endl;
+
+	// multithreaded host reductions for every supported instruction set
+	m_HostValid = true;
+	nIterations = 100;
+	for(int isa = CHostPrimitives::SCALAR; isa <= CHostPrimitives::AVX2; isa++)
+	{
+		CHostPrimitives::EISA ISA = (CHostPrimitives::EISA)isa;
+		if(!CHostPrimitives::IsSupported(ISA))
+			continue;
+
+		cout << "Testing performance of host reduction (" << CHostPrimitives::GetName(ISA) << ", " << CParallel::GetThreadCount() << " threads)" << endl;
+		unsigned int result = 0;
+		timer.Start();
+		for(unsigned int j = 0; j < nIterations; j++)
+			result = CHostPrimitives::Reduce(m_hInput, m_N, ISA);
+		timer.Stop();
+
+		ms = timer.GetElapsedMilliseconds() / double(nIterations);
+		cout << "  average time: " << ms << " ms, throughput: " << 1.0e-6 * (double)m_N / ms << " Gelem/s" <<endl;
+
+		if(result != m_resultCPU)
+		{
+			cout<<"result: "<<result<<"   anwser:" <<m_resultCPU<<endl;
+			m_HostValid = false;
+		}
+	}
 }
 
 bool CReductionTask::ValidateResults()
 {
-	bool success = true;
+	bool success = m_HostValid;
+	if(!m_HostValid)
+		cout<<"Validation of the host reduction failed."<<endl;
 
-	for(int i = 0; i < 4; i++)
-		if(m_resultGPU[i] != m_resultCPU)
+	for(unsigned int i = 0; i < ARRAYLEN(m_resultGPU); i++)
+		if(IsTaskSupported(i) && m_resultGPU[i] != m_resultCPU)
 		{
 			cout<<"result: "<<m_resultGPU[i]<<"   anwser:" <<m_resultCPU<<endl;
 			cout<<"Validation of reduction kernel "<<g_kernelNames[i]<<" failed." << endl;
@@ -245,13 +324,15 @@ void CReductionTask::Reduction_Decomp(cl_context Context, cl_command_queue Comma
 		clErr = clSetKernelArg(m_DecompKernel,0,sizeof(cl_mem),(void*)&m_dPingArray);
 		clErr = clSetKernelArg(m_DecompKernel,1,sizeof(cl_mem),(void*)&m_dPongArray);
 		clErr = clSetKernelArg(m_DecompKernel,2,sizeof(cl_uint),(void*)&m_N);
-		clErr = clSetKernelArg(m_DecompKernel,3,globalWorkSize*sizeof(int),NULL);
-		V_RETURN_CL(clErr,"Failed to set kernel args: Reduction_Decomp");
 		
 		if( globalWorkSize <= localWorkSize )
 		{
 			localWorkSize = globalWorkSize ;
 		}
+
+		// one element per work-item of the group (not of the whole grid)
+		clErr |= clSetKernelArg(m_DecompKernel,3,localWorkSize*sizeof(int),NULL);
+		V_RETURN_CL(clErr,"Failed to set kernel args: Reduction_Decomp");
 		
 		clErr = clEnqueueNDRangeKernel(CommandQueue,m_DecompKernel,1,NULL,&globalWorkSize,&localWorkSize,0,NULL,NULL);
 		V_RETURN_CL(clErr,"Error executing Reduction_Decomp!");
@@ -271,15 +352,72 @@ void CReductionTask::Reduction_Decomp(cl_context Context, cl_command_queue Comma
 
 void CReductionTask::Reduction_DecompUnroll(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
 {
+	// the block size is compiled into the kernel, LocalWorkSize has to match it
+	if(LocalWorkSize[0] != m_LocalWorkSize)
+	{
+		cout << "Reduction_DecompUnroll was built for a work-group size of " << m_LocalWorkSize << endl;
+		return;
+	}
 
-	// TO DO: Implement reduction with loop unrolling
+	cl_int clErr;
+	size_t localWorkSize = m_LocalWorkSize;
+	size_t elementsPerGroup = m_LocalWorkSize * REDUCTION_ELEMENTS_PER_THREAD;
 
-	// NOTE: make sure that the final result is always in the variable m_dPingArray
-	// as this is read back for the correctness check
-	// (CReductionTask::ExecuteTask)
-	//
-	// hint: for example, you can use swap(m_dPingArray, m_dPongArray) at the end of your for loop...
+	// every pass shrinks the array by elementsPerGroup, the final result ends up in m_dPingArray
+	for(cl_uint n = m_N; n > 1; )
+	{
+		cl_uint nGroups = cl_uint((n + elementsPerGroup - 1) / elementsPerGroup);
+		size_t globalWorkSize = nGroups * localWorkSize;
+
+		clErr = clSetKernelArg(m_DecompUnrollKernel, 0, sizeof(cl_mem), (void*)&m_dPingArray);
+		clErr |= clSetKernelArg(m_DecompUnrollKernel, 1, sizeof(cl_mem), (void*)&m_dPongArray);
+		clErr |= clSetKernelArg(m_DecompUnrollKernel, 2, sizeof(cl_uint), (void*)&n);
+		clErr |= clSetKernelArg(m_DecompUnrollKernel, 3, localWorkSize * sizeof(cl_uint), NULL);
+		V_RETURN_CL(clErr, "Failed to set kernel args: Reduction_DecompUnroll");
+
+		clErr = clEnqueueNDRangeKernel(CommandQueue, m_DecompUnrollKernel, 1, NULL, &globalWorkSize, &localWorkSize, 0, NULL, NULL);
+		V_RETURN_CL(clErr, "Error executing Reduction_DecompUnroll!");
 
+		swap(m_dPingArray, m_dPongArray);
+		n = nGroups;
+	}
+}
+
+void CReductionTask::Reduction_SinglePass(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
+{
+	// the block size is compiled into the kernel, LocalWorkSize has to match it
+	if(LocalWorkSize[0] != m_LocalWorkSize)
+	{
+		cout << "Reduction_SinglePass was built for a work-group size of " << m_LocalWorkSize << endl;
+		return;
+	}
+
+	// enough groups to fill the device, each work-item accumulates a grid-stride share of the input
+	size_t localWorkSize = m_LocalWorkSize;
+	size_t nGroups = min<size_t>((m_N + localWorkSize - 1) / localWorkSize, m_ComputeUnits * REDUCTION_GROUPS_PER_CU);
+	nGroups = max<size_t>(nGroups, 1);
+	size_t globalWorkSize = nGroups * localWorkSize;
+
+	// the partial sums (and the final result) go to m_dPongArray, the input stays intact
+	cl_int clErr;
+	clErr = clSetKernelArg(m_SinglePassKernel, 0, sizeof(cl_mem), (void*)&m_dPingArray);
+	clErr |= clSetKernelArg(m_SinglePassKernel, 1, sizeof(cl_mem), (void*)&m_dPongArray);
+	clErr |= clSetKernelArg(m_SinglePassKernel, 2, sizeof(cl_mem), (void*)&m_dCounter);
+	clErr |= clSetKernelArg(m_SinglePassKernel, 3, sizeof(cl_uint), (void*)&m_N);
+	clErr |= clSetKernelArg(m_SinglePassKernel, 4, localWorkSize * sizeof(cl_uint), NULL);
+	V_RETURN_CL(clErr, "Failed to set kernel args: Reduction_SinglePass");
+
+	clErr = clEnqueueNDRangeKernel(CommandQueue, m_SinglePassKernel, 1, NULL, &globalWorkSize, &localWorkSize, 0, NULL, NULL);
+	V_RETURN_CL(clErr, "Error executing Reduction_SinglePass!");
+
+	swap(m_dPingArray, m_dPongArray);
+}
+
+bool CReductionTask::IsTaskSupported(unsigned int Task) const
+{
+	if(Task >= 3)
+		return true;
+	return m_N >= 2 && (m_N & (m_N - 1)) == 0;
 }
 
 void CReductionTask::ExecuteTask(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3], unsigned int Task)
@@ -301,7 +439,9 @@ void CReductionTask::ExecuteTask(cl_context Context, cl_command_queue CommandQue
 		case 3:
 			Reduction_DecompUnroll(Context, CommandQueue, LocalWorkSize);
 			break;
-
+		case 4:
+			Reduction_SinglePass(Context, CommandQueue, LocalWorkSize);
+			break;
 	}
 
 	//read back the results synchronously.
@@ -340,6 +480,9 @@ void CReductionTask::TestPerformance(cl_context Context, cl_command_queue Comman
 			case 3:
 				Reduction_DecompUnroll(Context, CommandQueue, LocalWorkSize);
 				break;
+			case 4:
+				Reduction_SinglePass(Context, CommandQueue, LocalWorkSize);
+				break;
 		}
 	}
 
@@ -26,7 +26,8 @@
 class CReductionTask : public IComputeTask
 {
 public:
-	CReductionTask(size_t ArraySize);
+	//! LocalWorkSize is compiled into the unrolled kernel (BLOCK_SIZE)
+	CReductionTask(size_t ArraySize, size_t LocalWorkSize = 128);
 
 	virtual ~CReductionTask();
 
@@ -48,6 +49,10 @@ protected:
 	void Reduction_SequentialAddressing(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
 	void Reduction_Decomp(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
 	void Reduction_DecompUnroll(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
+	void Reduction_SinglePass(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
+
+	//! The first three variants only handle power-of-two sizes
+	bool IsTaskSupported(unsigned int Task) const;
 
 	void ExecuteTask(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3], unsigned int task);
 	void TestPerformance(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3], unsigned int task);
@@ -56,15 +61,21 @@ protected:
 	//to avoid confusions: 'h' - host, 'd' - device
 
 	unsigned int		m_N;
+	size_t				m_LocalWorkSize;
+	cl_uint				m_ComputeUnits;
 
 	// input data
 	unsigned int		*m_hInput;
 	// results
 	unsigned int		m_resultCPU;
-	unsigned int		m_resultGPU[4];
+	unsigned int		m_resultGPU[5];
+	// result of the multithreaded host reductions (CHostPrimitives)
+	bool				m_HostValid;
 
 	cl_mem				m_dPingArray;
 	cl_mem				m_dPongArray;
+	// work-group counter of the single-pass reduction
+	cl_mem				m_dCounter;
 
 	//OpenCL program and kernels
 	cl_program			m_Program;
@@ -72,6 +83,7 @@ protected:
 	cl_kernel			m_SequentialAddressingKernel;
 	cl_kernel			m_DecompKernel;
 	cl_kernel			m_DecompUnrollKernel;
+	cl_kernel			m_SinglePassKernel;
 
 };
 
@@ -0,0 +1,147 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CSCAN_PRIMITIVE_TASK_H
+#define _CSCAN_PRIMITIVE_TASK_H
+
+#include "../Common/IComputeTask.h"
+#include "../Common/CLUtil.h"
+#include "../Common/CBenchmark.h"
+#include "../Common/CValidator.h"
+#include "../Common/CScanPrimitive.h"
+
+#include <iostream>
+#include <vector>
+
+//! A2/T2b: Validation and benchmark of the generic scan primitive (../Common/CScanPrimitive.h)
+/*!
+	T is cl_uint, cl_int, cl_float or cl_ulong, Op one of SScanSumOp, SScanMinOp
+	and SScanMaxOp. Segmented scans use random segments of 64 elements on average.
+*/
+template <typename T, template <typename> class Op>
+class CScanPrimitiveTask : public IComputeTask
+{
+public:
+	CScanPrimitiveTask(size_t ArraySize, bool Exclusive, bool Segmented, size_t LocalWorkSize = 128)
+		: m_N(ArraySize), m_Scan(MakeScanDesc<T, Op>(Exclusive, Segmented), LocalWorkSize),
+		m_dInput(NULL), m_dOutput(NULL), m_dHeadFlags(NULL)
+	{
+	}
+
+	virtual ~CScanPrimitiveTask()
+	{
+		ReleaseResources();
+	}
+
+	const std::string& GetName() const { return m_Scan.GetDesc().Name; }
+
+	// IComputeTask
+
+	virtual bool InitResources(cl_device_id Device, cl_context Context)
+	{
+		//CPU resources
+		// small values keep int and float sums exact, ulong values exceed 32 bit
+		if(sizeof(T) == sizeof(cl_ulong))
+			CBenchmark::Fill(m_hInput, m_N, []() { return T(CBenchmark::RandomBits<cl_ulong>() >> 16); });
+		else
+			CBenchmark::Fill(m_hInput, m_N, CBenchmark::RandomSmall<T>);
+		CBenchmark::Fill(m_hHeadFlags, m_N, []() { return CBenchmark::RandomFlag(64); });
+		if(m_N > 0)
+			m_hHeadFlags[0] = 1;
+		m_hResultCPU.resize(m_N);
+		m_hResultGPU.resize(m_N);
+
+		//device resources
+		cl_int clError, clError2;
+		m_dInput = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(T) * m_N, &m_hInput[0], &clError2);
+		clError = clError2;
+		m_dOutput = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(T) * m_N, NULL, &clError2);
+		clError |= clError2;
+		m_dHeadFlags = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint) * m_N, &m_hHeadFlags[0], &clError2);
+		clError |= clError2;
+		V_RETURN_FALSE_CL(clError, "Error allocating device arrays");
+
+		return m_Scan.Init(Device, Context);
+	}
+
+	virtual void ReleaseResources()
+	{
+		// host resources
+		m_hInput.clear();
+		m_hHeadFlags.clear();
+		m_hResultCPU.clear();
+		m_hResultGPU.clear();
+
+		// device resources
+		m_Scan.Release();
+
+		SAFE_RELEASE_MEMOBJECT(m_dInput);
+		SAFE_RELEASE_MEMOBJECT(m_dOutput);
+		SAFE_RELEASE_MEMOBJECT(m_dHeadFlags);
+	}
+
+	virtual void ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
+	{
+		if(!m_Scan.Scan(CommandQueue, m_dInput, m_dOutput, m_N, m_dHeadFlags))
+			return;
+		V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dOutput, CL_TRUE, 0, sizeof(T) * m_N, &m_hResultGPU[0], 0, NULL, NULL),
+			"Error reading data from device!");
+
+		//measure the performance
+		double ms;
+		if(!CBenchmark::TimeGPU(CommandQueue, [this, CommandQueue]() { m_Scan.Scan(CommandQueue, m_dInput, m_dOutput, m_N, m_dHeadFlags); }, ms))
+			return;
+		CBenchmark::PrintGPU(GetName(), ms, double(m_N), double(2 * m_N * sizeof(T)));
+	}
+
+	virtual void ComputeCPU()
+	{
+		double ms = CBenchmark::TimeCPU([this]()
+			{
+				ScanReference<T, Op>(&m_hInput[0], &m_hResultCPU[0], m_N, m_Scan.GetDesc().Exclusive,
+					m_Scan.GetDesc().Segmented ? &m_hHeadFlags[0] : NULL);
+			});
+		CBenchmark::PrintCPU(GetName() + " reference", ms);
+	}
+
+	virtual bool ValidateResults()
+	{
+		// the float sums are combined in a different order on the GPU
+		CValidator validator(std::numeric_limits<T>::is_integer ? CValidator::EXACT : CValidator::RELATIVE, 1e-5);
+		bool success = validator.Compare(&m_hResultCPU[0], &m_hResultGPU[0], m_N);
+		validator.PrintMismatches(GetName());
+		return success;
+	}
+
+protected:
+	size_t					m_N;
+	CScanPrimitive			m_Scan;
+
+	std::vector<T>			m_hInput;
+	std::vector<cl_uint>	m_hHeadFlags;
+	std::vector<T>			m_hResultCPU;
+	std::vector<T>			m_hResultGPU;
+
+	cl_mem					m_dInput;
+	cl_mem					m_dOutput;
+	cl_mem					m_dHeadFlags;
+};
+
+#endif // _CSCAN_PRIMITIVE_TASK_H
@@ -7,8 +7,13 @@ GPU Computing / GPGPU Praktikum source code.
 
 #include "../Common/CLUtil.h"
 #include "../Common/CTimer.h"
+#include "../Common/CValidator.h"
+#include "../Common/CHostPrimitives.h"
+#include "../Common/CParallel.h"
 
 #include <string.h>
+#include <algorithm>
+#include <sstream>
 
 using namespace std;
 
@@ -16,32 +21,45 @@ using namespace std;
 // but we also need to allocate more local memory for that.
 #define NUM_BANKS	32
 
+// the naive scan needs two additional arrays and log2(N) passes, it is skipped for larger arrays
+#define SCAN_NAIVE_MAX_SIZE	(1 << 24)
+
+// elements per work-item in the single-pass scan
+#define SCAN_ITEMS_PER_THREAD	8
+
 ///////////////////////////////////////////////////////////////////////////////
 // CScanTask
 
 // only useful for debug info
-const string g_kernelNames[2] = 
+const string g_kernelNames[3] = 
 {
 	"scanNaive",
-	"scanWorkEfficient"
+	"scanWorkEfficient",
+	"scanSinglePass"
 };
 
-CScanTask::CScanTask(size_t ArraySize, size_t MinLocalWorkSize)
-	: m_N(ArraySize), m_hArray(NULL), m_hResultCPU(NULL), m_hResultGPU(NULL),
-	m_dPingArray(NULL), m_dPongArray(NULL),
+CScanTask::CScanTask(size_t ArraySize, size_t MinLocalWorkSize, bool AvoidBankConflicts)
+	: m_N(ArraySize), m_AvoidBankConflicts(AvoidBankConflicts), m_hArray(NULL), m_hResultCPU(NULL), m_hResultGPU(NULL), m_HostValid(true),
+	m_RunNaive(ArraySize <= SCAN_NAIVE_MAX_SIZE), m_dPingArray(NULL), m_dPongArray(NULL),
+	m_dLevelArrays(NULL), m_UseLookBack(false), m_Epoch(0),
+	m_dTileCounter(NULL), m_dTileFlags(NULL), m_dTileAggregate(NULL), m_dTilePrefix(NULL),
 	m_Program(NULL), 
-	m_ScanNaiveKernel(NULL), m_ScanWorkEfficientKernel(NULL), m_ScanWorkEfficientAddKernel(NULL)
+	m_ScanNaiveKernel(NULL), m_ScanWorkEfficientKernel(NULL), m_ScanWorkEfficientAddKernel(NULL),
+	m_ScanDecoupledLookBackKernel(NULL)
 {
 	// compute the number of levels that we need for the work-efficient algorithm
 
 	m_MinLocalWorkSize = MinLocalWorkSize;
 
-	m_nLevels = 1;
-	size_t N = ArraySize;
-	while (N > 0){
-		N /= 2 * m_MinLocalWorkSize;
-		m_nLevels++;
-	}
+	// every level holds one element per block of the level below, until a single block remains
+	unsigned int blockSize = (unsigned int)(2 * m_MinLocalWorkSize);
+	unsigned int N = m_N;
+	m_LevelSizes.push_back(N);
+	do {
+		N = (N + blockSize - 1) / blockSize;
+		m_LevelSizes.push_back(N);
+	} while (N > 1);
+	m_nLevels = (unsigned int)m_LevelSizes.size();
 
 	// Reset validation results
 	for (int i = 0; i < (int)ARRAYLEN(m_bValidationResults); i++)
@@ -67,27 +85,51 @@ bool CScanTask::InitResources(cl_device_id Device, cl_context Context)
 
 	//device resources
 	// ping-pong buffers
-	cl_int clError, clError2;
-	m_dPingArray = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * m_N, NULL, &clError2);
-	clError = clError2;
-	m_dPongArray = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * m_N, NULL, &clError2);
-	clError |= clError2;
+	cl_int clError = CL_SUCCESS, clError2;
+	if(m_RunNaive)
+	{
+		m_dPingArray = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * m_N, NULL, &clError2);
+		clError |= clError2;
+		m_dPongArray = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * m_N, NULL, &clError2);
+		clError |= clError2;
+	}
 
-	// level buffer
+	// level buffers, the kernels handle partial blocks so no padding is needed
 	m_dLevelArrays = new cl_mem[m_nLevels];
-	unsigned int N = m_N;
 	for (unsigned int i = 0; i < m_nLevels; i++) {
-		m_dLevelArrays[i] = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * N, NULL, &clError2);
+		m_dLevelArrays[i] = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * m_LevelSizes[i], NULL, &clError2);
 		clError |= clError2;
-		N = max(N / (2 * m_MinLocalWorkSize), m_MinLocalWorkSize);
 	}
+
+	// tile states of the single-pass scan, the flags have to start below any epoch
+	size_t nTiles = CLUtil::GetGlobalWorkSize(m_N, m_MinLocalWorkSize * SCAN_ITEMS_PER_THREAD) / (m_MinLocalWorkSize * SCAN_ITEMS_PER_THREAD);
+	vector<cl_uint> zeros(nTiles, 0);
+	m_dTileCounter = clCreateBuffer(Context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint), &zeros[0], &clError2);
+	clError |= clError2;
+	m_dTileFlags = clCreateBuffer(Context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint) * nTiles, &zeros[0], &clError2);
+	clError |= clError2;
+	m_dTileAggregate = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * nTiles, NULL, &clError2);
+	clError |= clError2;
+	m_dTilePrefix = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * nTiles, NULL, &clError2);
+	clError |= clError2;
 	V_RETURN_FALSE_CL(clError, "Error allocating device arrays");
 
+	// OpenCL does not guarantee forward progress between work-groups. GPUs keep resident groups running,
+	// which is all the look-back needs. Other devices may run groups as cooperative fibers on fewer threads,
+	// there a spinning group could starve its predecessor, so they use the hierarchical scan instead.
+	cl_device_type deviceType;
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_TYPE, sizeof(deviceType), &deviceType, NULL), "Error querying the device type");
+	m_UseLookBack = (deviceType & CL_DEVICE_TYPE_GPU) != 0;
+
 	//load and compile kernels
 	string programCode;
 
 	CLUtil::LoadProgramSourceToMemory("Scan.cl", programCode);
-	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode);
+	stringstream options;
+	options<<"-D ITEMS_PER_THREAD="<<SCAN_ITEMS_PER_THREAD;
+	if(m_AvoidBankConflicts)
+		options<<" -D AVOID_BANK_CONFLICTS";
+	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode, options.str());
 	if(m_Program == nullptr) return false;
 
 	//create kernels
@@ -100,6 +142,9 @@ bool CScanTask::InitResources(cl_device_id Device, cl_context Context)
 	m_ScanWorkEfficientAddKernel = clCreateKernel(m_Program, "Scan_WorkEfficientAdd", &clError);
 	V_RETURN_FALSE_CL(clError, "Failed to create kernel.");
 
+	m_ScanDecoupledLookBackKernel = clCreateKernel(m_Program, "Scan_DecoupledLookBack", &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create kernel.");
+
 	return true;
 }
 
@@ -121,9 +166,15 @@ void CScanTask::ReleaseResources()
 		}
 	SAFE_DELETE_ARRAY(m_dLevelArrays);
 
+	SAFE_RELEASE_MEMOBJECT(m_dTileCounter);
+	SAFE_RELEASE_MEMOBJECT(m_dTileFlags);
+	SAFE_RELEASE_MEMOBJECT(m_dTileAggregate);
+	SAFE_RELEASE_MEMOBJECT(m_dTilePrefix);
+
 	SAFE_RELEASE_KERNEL(m_ScanNaiveKernel);
 	SAFE_RELEASE_KERNEL(m_ScanWorkEfficientKernel);
 	SAFE_RELEASE_KERNEL(m_ScanWorkEfficientAddKernel);
+	SAFE_RELEASE_KERNEL(m_ScanDecoupledLookBackKernel);
 
 	SAFE_RELEASE_PROGRAM(m_Program);
 }
@@ -131,14 +182,26 @@ void CScanTask::ReleaseResources()
 void CScanTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
 {
 	cout << endl;
+	cout << "Bank conflict avoidance " << (m_AvoidBankConflicts ? "on" : "off") << endl;
 
-	ValidateTask(Context, CommandQueue, LocalWorkSize, 0);
+	if(m_RunNaive)
+		ValidateTask(Context, CommandQueue, LocalWorkSize, 0);
+	else
+	{
+		cout << "Skipping " << g_kernelNames[0] << " for " << m_N << " elements" << endl;
+		m_bValidationResults[0] = true;
+	}
 	ValidateTask(Context, CommandQueue, LocalWorkSize, 1);
+	if(!m_UseLookBack)
+		cout << "No forward progress guarantee, " << g_kernelNames[2] << " falls back to " << g_kernelNames[1] << endl;
+	ValidateTask(Context, CommandQueue, LocalWorkSize, 2);
 
 	cout << endl;
 
-	TestPerformance(Context, CommandQueue, LocalWorkSize, 0);
+	if(m_RunNaive)
+		TestPerformance(Context, CommandQueue, LocalWorkSize, 0);
 	TestPerformance(Context, CommandQueue, LocalWorkSize, 1);
+	TestPerformance(Context, CommandQueue, LocalWorkSize, 2);
 
 	cout << endl;
 }
@@ -160,13 +223,38 @@ void CScanTask::ComputeCPU()
 	timer.Stop();
 	double ms = timer.GetElapsedMilliseconds() / double(nIterations);
 	cout << "  average time: " << ms << " ms, throughput: " << 1.0e-6 * (double)m_N / ms << " Gelem/s" <<endl;
+
+	// multithreaded host scans for every supported instruction set, m_hResultGPU is overwritten by the kernels later
+	m_HostValid = true;
+	nIterations = (unsigned int)min<size_t>(100, max<size_t>(1, (1 << 24) / m_N));
+	for(int isa = CHostPrimitives::SCALAR; isa <= CHostPrimitives::AVX2; isa++)
+	{
+		CHostPrimitives::EISA ISA = (CHostPrimitives::EISA)isa;
+		if(!CHostPrimitives::IsSupported(ISA))
+			continue;
+
+		cout << "Testing performance of host scan (" << CHostPrimitives::GetName(ISA) << ", " << CParallel::GetThreadCount() << " threads)" << endl;
+		timer.Start();
+		for(unsigned int j = 0; j < nIterations; j++)
+			CHostPrimitives::Scan(m_hArray, m_hResultGPU, m_N, false, ISA);
+		timer.Stop();
+
+		ms = timer.GetElapsedMilliseconds() / double(nIterations);
+		cout << "  average time: " << ms << " ms, throughput: " << 1.0e-6 * (double)m_N / ms << " Gelem/s" <<endl;
+
+		CValidator validator;
+		m_HostValid &= validator.Compare(m_hResultCPU, m_hResultGPU, m_N);
+		validator.PrintMismatches(string("host scan ") + CHostPrimitives::GetName(ISA));
+	}
 }
 
 bool CScanTask::ValidateResults()
 {
-	bool success = true;
+	bool success = m_HostValid;
+	if(!m_HostValid)
+		cout<<"Validation of the host scan failed."<<endl;
 
-	for(int i = 0; i < 2; i++)
+	for(int i = 0; i < (int)ARRAYLEN(m_bValidationResults); i++)
 		if(!m_bValidationResults[i])
 		{
 			cout<<"Validation of reduction kernel "<<g_kernelNames[i]<<" failed." << endl;
@@ -188,10 +276,10 @@ void CScanTask::Scan_Naive(cl_context Context, cl_command_queue CommandQueue, si
 	// hint: for example, you can use swap(m_dPingArray, m_dPongArray) at the end of your for loop...
 	
 	cl_int clErr;
-	size_t globalWorkSize = m_N  ;
 	size_t localWorkSize = LocalWorkSize[0];
+	size_t globalWorkSize = CLUtil::GetGlobalWorkSize(m_N, localWorkSize);
 	
-	for( unsigned int offset = 1 ; offset <= m_N/2; offset=offset*2   ) 
+	for( unsigned int offset = 1 ; offset < m_N; offset=offset*2   ) 
 	{
 		
 		clErr = clSetKernelArg(m_ScanNaiveKernel,0,sizeof(cl_mem),(void*)&m_dPingArray);
@@ -211,133 +299,80 @@ void CScanTask::Scan_Naive(cl_context Context, cl_command_queue CommandQueue, si
 
 void CScanTask::Scan_WorkEfficient(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
 {
+	// the level sizes were computed for m_MinLocalWorkSize, so the blocks always use it
+	Scan_WorkEfficientLevel(CommandQueue, 0);
+}
 
-	// TO DO: Implement efficient version of scan
-
-	// Make sure that the local prefix sum works before you start experimenting with large arrays
-	
-/*	cl_int clErr;
-	size_t globalWorkSize = m_N / 2 ;
-	size_t localWorkSize = globalWorkSize;
-	
-	unsigned int		*m_hInter;
-	m_hInter= new unsigned int[m_N];
-	
-	clErr = clSetKernelArg(m_ScanWorkEfficientKernel,0,sizeof(cl_mem),(void*)&m_dLevelArrays[0]);
-	clErr = clSetKernelArg(m_ScanWorkEfficientKernel,1,sizeof(cl_mem),(void*)&m_dLevelArrays[0]);
-	clErr = clSetKernelArg(m_ScanWorkEfficientKernel,2,localWorkSize*2*sizeof(int),NULL);
-	V_RETURN_CL(clErr,"Failed to set kernel args: Scan_WorkEfficient");
-		
-	clErr = clEnqueueNDRangeKernel(CommandQueue,m_ScanWorkEfficientKernel,1,NULL,&globalWorkSize,&localWorkSize,0,NULL,NULL);
-	V_RETURN_CL(clErr,"Error executing Scan_WorkEfficient!");
-		
-*/
-
+void CScanTask::Scan_WorkEfficientLevel(cl_command_queue CommandQueue, unsigned int Level)
+{
 	cl_int clErr;
-	size_t globalWorkSize = m_N / 2 ;
-	size_t localWorkSize = LocalWorkSize[0];
-	
-	unsigned int		*m_hInter;
-	m_hInter= new unsigned int[m_N];
-	
-	
-	//local pps
-		clErr = clSetKernelArg(m_ScanWorkEfficientKernel,0,sizeof(cl_mem),(void*)&m_dLevelArrays[ 0 ]);
-		clErr = clSetKernelArg(m_ScanWorkEfficientKernel,1,sizeof(cl_mem),(void*)&m_dLevelArrays[ 1 ]);
-		clErr = clSetKernelArg(m_ScanWorkEfficientKernel,2,localWorkSize*2*sizeof(int),NULL);
-		V_RETURN_CL(clErr,"Failed to set kernel args: Scan_WorkEfficient");
-		
-		clErr = clEnqueueNDRangeKernel(CommandQueue,m_ScanWorkEfficientKernel,1,NULL,&globalWorkSize,&localWorkSize,0,NULL,NULL);
-		V_RETURN_CL(clErr,"Error executing Scan_WorkEfficient!");
-		
-	
-
-	/*	clEnqueueReadBuffer(CommandQueue, m_dLevelArrays[0], CL_TRUE, 0, m_N * sizeof(cl_uint), m_hInter, 0, NULL, NULL) ;
-
-		cout<<"****inter block result:"<<endl;
-		for(int i = 0 ; i < 16 ; i++ )
-		{
-			cout<<m_hInter[i]<<" ";
-		}
-		cout<<endl;
-	*/	
-		
-	// block pps	
-		size_t globalWorkSize_S = m_N / ( localWorkSize * 2 * 2 ) ;
-		size_t localWorkSize_S = localWorkSize ;
-		if( globalWorkSize_S < localWorkSize_S )
-			localWorkSize_S = globalWorkSize_S ;
-		
-		clErr = clSetKernelArg(m_ScanWorkEfficientKernel,0,sizeof(cl_mem),(void*)&m_dLevelArrays[ 1 ]);
-		clErr = clSetKernelArg(m_ScanWorkEfficientKernel,1,sizeof(cl_mem),(void*)&m_dLevelArrays[ 2 ]);
-		clErr = clSetKernelArg(m_ScanWorkEfficientKernel,2,localWorkSize_S*2*sizeof(int),NULL);
-		V_RETURN_CL(clErr,"Failed to set kernel args: Scan_WorkEfficient");
-		
-		clErr = clEnqueueNDRangeKernel(CommandQueue,m_ScanWorkEfficientKernel,1,NULL,&globalWorkSize_S,&localWorkSize_S,0,NULL,NULL);
-		V_RETURN_CL(clErr,"Error executing Scan_WorkEfficient!");
-		
-	
-
-	/*	clEnqueueReadBuffer(CommandQueue, m_dLevelArrays[1], CL_TRUE, 0, globalWorkSize_S * 2 * sizeof(cl_uint), m_hInter, 0, NULL, NULL) ;
-
-		cout<<"****sum block result:"<<endl;
-		for(int i = 0 ; i < globalWorkSize_S * 2 ; i++ )
-		{
-			cout<<m_hInter[i]<<" ";
-		}
-		cout<<endl;	
-	*/
-		
-	//add back
-	
-	globalWorkSize = m_N ;
-	localWorkSize = LocalWorkSize[0] * 2 ;	
-	
-	clErr = clSetKernelArg(m_ScanWorkEfficientAddKernel,0,sizeof(cl_mem),(void*)&m_dLevelArrays[1]);
-	clErr = clSetKernelArg(m_ScanWorkEfficientAddKernel,1,sizeof(cl_mem),(void*)&m_dLevelArrays[0]);
-	clErr = clSetKernelArg(m_ScanWorkEfficientAddKernel,2,localWorkSize*sizeof(int),NULL);
-	V_RETURN_CL(clErr,"Failed to set kernel args: Scan_WorkEfficientAdd!");
-		
-	
-	clErr = clEnqueueNDRangeKernel(CommandQueue,m_ScanWorkEfficientAddKernel,1,NULL,&globalWorkSize,&localWorkSize,0,NULL,NULL);
-	V_RETURN_CL(clErr,"Error executing Scan_WorkEfficientAdd!");	
-	
-	/*
-	clEnqueueReadBuffer(CommandQueue, m_dLevelArrays[0], CL_TRUE, 0, m_N * sizeof(cl_uint), m_hInter, 0, NULL, NULL) ;
+	size_t localWorkSize = m_MinLocalWorkSize;
+	unsigned int N = m_LevelSizes[Level];
+	unsigned int nBlocks = m_LevelSizes[Level + 1];
+
+	// local pps, the block totals go to the next level
+	size_t globalWorkSize = nBlocks * localWorkSize;
+	clErr = clSetKernelArg(m_ScanWorkEfficientKernel, 0, sizeof(cl_mem), (void*)&m_dLevelArrays[Level]);
+	clErr |= clSetKernelArg(m_ScanWorkEfficientKernel, 1, sizeof(cl_mem), (void*)&m_dLevelArrays[Level + 1]);
+	clErr |= clSetKernelArg(m_ScanWorkEfficientKernel, 2, GetLocalBlockSize() * sizeof(cl_uint), NULL);
+	clErr |= clSetKernelArg(m_ScanWorkEfficientKernel, 3, sizeof(cl_uint), (void*)&N);
+	V_RETURN_CL(clErr, "Failed to set kernel args: Scan_WorkEfficient");
+
+	clErr = clEnqueueNDRangeKernel(CommandQueue, m_ScanWorkEfficientKernel, 1, NULL, &globalWorkSize, &localWorkSize, 0, NULL, NULL);
+	V_RETURN_CL(clErr, "Error executing Scan_WorkEfficient!");
+
+	// a single block is complete, otherwise scan the block totals and add them back
+	if(nBlocks == 1)
+		return;
+
+	Scan_WorkEfficientLevel(CommandQueue, Level + 1);
+
+	globalWorkSize = (nBlocks - 1) * localWorkSize;
+	clErr = clSetKernelArg(m_ScanWorkEfficientAddKernel, 0, sizeof(cl_mem), (void*)&m_dLevelArrays[Level + 1]);
+	clErr |= clSetKernelArg(m_ScanWorkEfficientAddKernel, 1, sizeof(cl_mem), (void*)&m_dLevelArrays[Level]);
+	clErr |= clSetKernelArg(m_ScanWorkEfficientAddKernel, 2, sizeof(cl_uint), (void*)&N);
+	V_RETURN_CL(clErr, "Failed to set kernel args: Scan_WorkEfficientAdd!");
+
+	clErr = clEnqueueNDRangeKernel(CommandQueue, m_ScanWorkEfficientAddKernel, 1, NULL, &globalWorkSize, &localWorkSize, 0, NULL, NULL);
+	V_RETURN_CL(clErr, "Error executing Scan_WorkEfficientAdd!");
+}
 
-		cout<<"****gpu result:"<<endl;
-		for(int i = 0 ; i < 16 ; i++ )
-		{
-			cout<<m_hInter[i]<<" ";
-		}
-		cout<<endl;
+void CScanTask::Scan_SinglePass(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
+{
+	if(!m_UseLookBack)
+	{
+		Scan_WorkEfficient(Context, CommandQueue, LocalWorkSize);
+		return;
+	}
 
-	
-		
-	
-	cout<<"****cpu result:"<<endl;
-	for(int i = 0 ; i < 16 ; i++ )
-		{
-			cout<<m_hResultCPU[i]<<" ";
-		}
-	cout<<endl;
-	cout<<"****original matrix:"<<endl;
-	for(int i = 0 ; i < 16 ; i++ )
-		{
-			cout<<m_hArray[i]<<" ";
-		}
-	cout<<endl;
-		
-	
-	*/
-	
-	
-	
-	
-	
-	
-	
+	// the tile buffers were sized for m_MinLocalWorkSize
+	cl_int clErr;
+	size_t localWorkSize = m_MinLocalWorkSize;
+	size_t tileSize = localWorkSize * SCAN_ITEMS_PER_THREAD;
+	size_t globalWorkSize = CLUtil::GetGlobalWorkSize(m_N, tileSize) / SCAN_ITEMS_PER_THREAD;
+
+	// a new epoch invalidates the tile states of the previous launch
+	m_Epoch++;
+
+	clErr = clSetKernelArg(m_ScanDecoupledLookBackKernel, 0, sizeof(cl_mem), (void*)&m_dLevelArrays[0]);
+	clErr |= clSetKernelArg(m_ScanDecoupledLookBackKernel, 1, sizeof(cl_uint), (void*)&m_N);
+	clErr |= clSetKernelArg(m_ScanDecoupledLookBackKernel, 2, sizeof(cl_mem), (void*)&m_dTileCounter);
+	clErr |= clSetKernelArg(m_ScanDecoupledLookBackKernel, 3, sizeof(cl_mem), (void*)&m_dTileFlags);
+	clErr |= clSetKernelArg(m_ScanDecoupledLookBackKernel, 4, sizeof(cl_mem), (void*)&m_dTileAggregate);
+	clErr |= clSetKernelArg(m_ScanDecoupledLookBackKernel, 5, sizeof(cl_mem), (void*)&m_dTilePrefix);
+	clErr |= clSetKernelArg(m_ScanDecoupledLookBackKernel, 6, sizeof(cl_uint), (void*)&m_Epoch);
+	clErr |= clSetKernelArg(m_ScanDecoupledLookBackKernel, 7, (tileSize + localWorkSize) * sizeof(cl_uint), NULL);
+	V_RETURN_CL(clErr, "Failed to set kernel args: Scan_DecoupledLookBack");
+
+	clErr = clEnqueueNDRangeKernel(CommandQueue, m_ScanDecoupledLookBackKernel, 1, NULL, &globalWorkSize, &localWorkSize, 0, NULL, NULL);
+	V_RETURN_CL(clErr, "Error executing Scan_DecoupledLookBack!");
+}
 
+size_t CScanTask::GetLocalBlockSize() const
+{
+	// OFFSET() in Scan.cl inserts one padding element after every NUM_BANKS elements
+	size_t blockSize = 2 * m_MinLocalWorkSize;
+	return m_AvoidBankConflicts ? blockSize + blockSize / NUM_BANKS : blockSize;
 }
 
 void CScanTask::ValidateTask(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3], unsigned int Task)
@@ -354,10 +389,17 @@ void CScanTask::ValidateTask(cl_context Context, cl_command_queue CommandQueue,
 			Scan_WorkEfficient(Context, CommandQueue, LocalWorkSize);
 			V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dLevelArrays[0], CL_TRUE, 0, m_N * sizeof(cl_uint), m_hResultGPU, 0, NULL, NULL), "Error reading data from device!");
 			break;
+		case 2:
+			V_RETURN_CL(clEnqueueWriteBuffer(CommandQueue, m_dLevelArrays[0], CL_FALSE, 0, m_N * sizeof(cl_uint), m_hArray, 0, NULL, NULL), "Error copying data from host to device!");
+			Scan_SinglePass(Context, CommandQueue, LocalWorkSize);
+			V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dLevelArrays[0], CL_TRUE, 0, m_N * sizeof(cl_uint), m_hResultGPU, 0, NULL, NULL), "Error reading data from device!");
+			break;
 	}
 
 	// validate results
-	m_bValidationResults[Task] =( memcmp(m_hResultCPU, m_hResultGPU, m_N * sizeof(unsigned int)) == 0);
+	CValidator validator;
+	m_bValidationResults[Task] = validator.Compare(m_hResultCPU, m_hResultGPU, m_N);
+	validator.PrintMismatches(g_kernelNames[Task]);
 }
 
 void CScanTask::TestPerformance(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3], unsigned int Task)
@@ -365,15 +407,16 @@ void CScanTask::TestPerformance(cl_context Context, cl_command_queue CommandQueu
 	cout << "Testing performance of task " << g_kernelNames[Task] << endl;
 
 	//write input data to the GPU
-	V_RETURN_CL(clEnqueueWriteBuffer(CommandQueue, m_dPingArray, CL_FALSE, 0, m_N * sizeof(cl_uint), m_hArray, 0, NULL, NULL), "Error copying data from host to device!");
+	cl_mem input = (Task == 0) ? m_dPingArray : m_dLevelArrays[0];
+	V_RETURN_CL(clEnqueueWriteBuffer(CommandQueue, input, CL_FALSE, 0, m_N * sizeof(cl_uint), m_hArray, 0, NULL, NULL), "Error copying data from host to device!");
 	//finish all before we start meassuring the time
 	V_RETURN_CL(clFinish(CommandQueue), "Error finishing the queue!");
 
 	CTimer timer;
 	timer.Start();
 
-	//run the kernel N times
-	unsigned int nIterations = 1;
+	//run the kernel N times, small arrays more often to get above the timer resolution
+	unsigned int nIterations = (unsigned int)min<size_t>(100, max<size_t>(1, (1 << 24) / m_N));
 	for(unsigned int i = 0; i < nIterations; i++) {
 		//run selected task
 		switch (Task){
@@ -383,6 +426,9 @@ void CScanTask::TestPerformance(cl_context Context, cl_command_queue CommandQueu
 			case 1:
 				Scan_WorkEfficient(Context, CommandQueue, LocalWorkSize);
 				break;
+			case 2:
+				Scan_SinglePass(Context, CommandQueue, LocalWorkSize);
+				break;
 		}
 	}
 
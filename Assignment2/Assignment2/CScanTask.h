@@ -22,12 +22,15 @@
 
 #include "../Common/IComputeTask.h"
 
+#include <vector>
+
 //! A2 / T2 Parallel prefix sum (scan)
 class CScanTask : public IComputeTask
 {
 public:
-	//! The second parameter is necessary to pre-allocate the multi-level arrays
-	CScanTask(size_t ArraySize, size_t MinLocalWorkSize);
+	//! The second parameter is necessary to pre-allocate the multi-level arrays,
+	//! the third one pads the local memory of the work-efficient scan (OFFSET in Scan.cl)
+	CScanTask(size_t ArraySize, size_t MinLocalWorkSize, bool AvoidBankConflicts = true);
 
 	virtual ~CScanTask();
 
@@ -47,32 +50,56 @@ protected:
 	void Scan_Naive(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
 	void Scan_WorkEfficient(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
 
+	//! Scans m_dLevelArrays[Level] block-wise, recurses on the block totals and adds them back
+	void Scan_WorkEfficientLevel(cl_command_queue CommandQueue, unsigned int Level);
+
+	//! Decoupled look-back scan, falls back to Scan_WorkEfficient if m_UseLookBack is not set
+	void Scan_SinglePass(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
+
+	//! Number of elements in the local memory of Scan_WorkEfficient, including the padding
+	size_t GetLocalBlockSize() const;
+
 	void ValidateTask(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3], unsigned int Task);
 	void TestPerformance(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3], unsigned int Task);
 
 	unsigned int		m_N;
+	bool				m_AvoidBankConflicts;
 
 	//float data on the CPU
 	unsigned int		*m_hArray;
 
 	unsigned int		*m_hResultCPU;
 	unsigned int		*m_hResultGPU;
-	bool				m_bValidationResults[2];
+	bool				m_bValidationResults[3];
+	// result of the multithreaded host scans (CHostPrimitives)
+	bool				m_HostValid;
 
-	// ping-pong arrays for the naive scan
+	// ping-pong arrays for the naive scan (only allocated for small arrays)
+	bool				m_RunNaive;
 	cl_mem				m_dPingArray;
 	cl_mem				m_dPongArray;
 
-	// arrays for each level of the work-efficient scan
+	// arrays for each level of the work-efficient scan, level i + 1 holds the block totals of level i.
+	// The last level has a single element (the total of the array).
 	size_t				m_MinLocalWorkSize;
 	unsigned int		m_nLevels;
+	std::vector<unsigned int> m_LevelSizes;
 	cl_mem				*m_dLevelArrays;
-	cl_mem              m_dSumArray ; 
+
+	// tile states of the single-pass scan (see Scan_DecoupledLookBack)
+	bool				m_UseLookBack;
+	cl_uint				m_Epoch;
+	cl_mem				m_dTileCounter;
+	cl_mem				m_dTileFlags;
+	cl_mem				m_dTileAggregate;
+	cl_mem				m_dTilePrefix;
+
 	//OpenCL program and kernels
 	cl_program			m_Program;
 	cl_kernel			m_ScanNaiveKernel;
 	cl_kernel			m_ScanWorkEfficientKernel;
 	cl_kernel			m_ScanWorkEfficientAddKernel;
+	cl_kernel			m_ScanDecoupledLookBackKernel;
 };
 
 #endif // _CSCAN_TASK_H
@@ -0,0 +1,462 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CSEGMENTED_REDUCTION_TASK_H
+#define _CSEGMENTED_REDUCTION_TASK_H
+
+#include "../Common/IComputeTask.h"
+#include "../Common/CLUtil.h"
+#include "../Common/CBenchmark.h"
+
+#include "CReductionOps.h"
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+// work units (elements or segment ends) per work-item
+#define SEGMENTED_REDUCTION_ITEMS_PER_THREAD 8
+
+//! A2/T1c: Segmented reduction and reduce-by-key
+/*!
+	The input is split into segments of very different lengths (many empty
+	and short segments, a few that span a large part of the array). It is
+	reduced twice, with the same element type and operator as
+	CTypedReductionTask:
+		- CSR style: segment s covers [offsets[s], offsets[s + 1]), one result
+		  per segment (Identity() for empty segments)
+		- reduce-by-key: runs of equal keys form the segments, the result are
+		  the keys and values of all runs
+
+	On GPUs both run in a single launch, see SegmentedReduction.cl for the
+	load balancing and the chaining of segments across work-groups. Other
+	devices do not guarantee that a waiting work-group lets its predecessor
+	run, they use two passes with CombineTiles in between.
+*/
+template <typename T, template <typename> class Op>
+class CSegmentedReductionTask : public IComputeTask
+{
+public:
+	typedef typename Op<T>::Acc Acc;
+
+	CSegmentedReductionTask(size_t ArraySize, size_t LocalWorkSize = 128)
+		: m_N(ArraySize), m_S(0), m_LocalWorkSize(LocalWorkSize), m_Epoch(0), m_UseLookBack(false), m_SegmentCountGPU(0),
+		m_dValues(NULL), m_dOffsets(NULL), m_dKeys(NULL), m_dResults(NULL), m_dResultKeys(NULL), m_dSegmentCount(NULL),
+		m_dTileCounter(NULL), m_dTileFlags(NULL), m_dTilePrefix(NULL), m_dTileCarry(NULL),
+		m_Program(NULL), m_CSRKernel(NULL), m_KeysKernel(NULL), m_CombineKernel(NULL)
+	{
+	}
+
+	virtual ~CSegmentedReductionTask()
+	{
+		ReleaseResources();
+	}
+
+	std::string GetName() const
+	{
+		return std::string("segmented ") + Op<T>::Name() + "<" + CLReductionType<T>::Name() + ">";
+	}
+
+	// IComputeTask
+
+	virtual bool InitResources(cl_device_id Device, cl_context Context)
+	{
+		if(m_N == 0 || (m_LocalWorkSize & (m_LocalWorkSize - 1)) != 0)
+		{
+			std::cerr<<"The segmented reduction requires a non-empty array and a power-of-two work-group size."<<std::endl;
+			return false;
+		}
+
+		//CPU resources
+		GenerateSegments();
+
+		CBenchmark::Fill(m_hValues, m_N, CBenchmark::RandomValue<T>);
+
+		//device resources
+		size_t nTiles = std::max(GetTileCount(m_N + m_S), GetTileCount(m_N));
+		std::vector<cl_uint> zeros(nTiles, 0);
+
+		cl_int clError, clError2;
+		m_dValues = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(T) * m_N, &m_hValues[0], &clError2);
+		clError = clError2;
+		m_dOffsets = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint) * (m_S + 1), &m_hOffsets[0], &clError2);
+		clError |= clError2;
+		m_dKeys = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint) * m_N, &m_hKeys[0], &clError2);
+		clError |= clError2;
+		m_dResults = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(Acc) * std::max<size_t>(m_S, 1), NULL, &clError2);
+		clError |= clError2;
+		m_dResultKeys = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * std::max<size_t>(m_S, 1), NULL, &clError2);
+		clError |= clError2;
+		m_dSegmentCount = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint), NULL, &clError2);
+		clError |= clError2;
+		m_dTileCounter = clCreateBuffer(Context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint), &zeros[0], &clError2);
+		clError |= clError2;
+		m_dTileFlags = clCreateBuffer(Context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint) * nTiles, &zeros[0], &clError2);
+		clError |= clError2;
+		m_dTilePrefix = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * nTiles, NULL, &clError2);
+		clError |= clError2;
+		m_dTileCarry = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(Acc) * nTiles, NULL, &clError2);
+		clError |= clError2;
+		V_RETURN_FALSE_CL(clError, "Error allocating device arrays");
+
+		// forward progress between work-groups, see the look-back in CScanTask
+		cl_device_type deviceType;
+		V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_TYPE, sizeof(deviceType), &deviceType, NULL), "Error querying the device type");
+		m_UseLookBack = (deviceType & CL_DEVICE_TYPE_GPU) != 0;
+
+		//load and compile kernels
+		std::string programCode;
+		if(!LoadReductionProgramSource("SegmentedReduction.cl", programCode)) return false;
+		std::stringstream options;
+		options<<GetTypedReductionOptions<T, Op>(m_LocalWorkSize)<<" -D ITEMS_PER_THREAD="<<SEGMENTED_REDUCTION_ITEMS_PER_THREAD;
+		if(m_UseLookBack)
+			options<<" -D LOOK_BACK";
+		m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode, options.str());
+		if(m_Program == nullptr) return false;
+
+		m_CSRKernel = clCreateKernel(m_Program, "SegmentedReduceCSR", &clError);
+		V_RETURN_FALSE_CL(clError, "Failed to create kernel: SegmentedReduceCSR.");
+
+		m_KeysKernel = clCreateKernel(m_Program, "ReduceByKey", &clError);
+		V_RETURN_FALSE_CL(clError, "Failed to create kernel: ReduceByKey.");
+
+		m_CombineKernel = clCreateKernel(m_Program, "CombineTiles", &clError);
+		V_RETURN_FALSE_CL(clError, "Failed to create kernel: CombineTiles.");
+
+		return true;
+	}
+
+	virtual void ReleaseResources()
+	{
+		// host resources
+		m_hValues.clear();
+		m_hOffsets.clear();
+		m_hKeys.clear();
+
+		// device resources
+		SAFE_RELEASE_MEMOBJECT(m_dValues);
+		SAFE_RELEASE_MEMOBJECT(m_dOffsets);
+		SAFE_RELEASE_MEMOBJECT(m_dKeys);
+		SAFE_RELEASE_MEMOBJECT(m_dResults);
+		SAFE_RELEASE_MEMOBJECT(m_dResultKeys);
+		SAFE_RELEASE_MEMOBJECT(m_dSegmentCount);
+		SAFE_RELEASE_MEMOBJECT(m_dTileCounter);
+		SAFE_RELEASE_MEMOBJECT(m_dTileFlags);
+		SAFE_RELEASE_MEMOBJECT(m_dTilePrefix);
+		SAFE_RELEASE_MEMOBJECT(m_dTileCarry);
+
+		SAFE_RELEASE_KERNEL(m_CSRKernel);
+		SAFE_RELEASE_KERNEL(m_KeysKernel);
+		SAFE_RELEASE_KERNEL(m_CombineKernel);
+		SAFE_RELEASE_PROGRAM(m_Program);
+	}
+
+	virtual void ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
+	{
+		// the block size is compiled into the kernels
+		if(LocalWorkSize[0] != m_LocalWorkSize)
+		{
+			std::cout<<"The segmented reduction was built for a work-group size of "<<m_LocalWorkSize<<std::endl;
+			return;
+		}
+
+		m_hResultsCSR.resize(m_S);
+		ReduceCSR(CommandQueue);
+		if(m_S > 0)
+			V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dResults, CL_TRUE, 0, sizeof(Acc) * m_S, &m_hResultsCSR[0], 0, NULL, NULL),
+				"Error reading data from device!");
+
+		ReduceByKey(CommandQueue);
+		V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dSegmentCount, CL_TRUE, 0, sizeof(cl_uint), &m_SegmentCountGPU, 0, NULL, NULL),
+			"Error reading data from device!");
+		size_t nRuns = std::min<size_t>(m_SegmentCountGPU, m_S);
+		m_hResultsKeys.resize(nRuns);
+		m_hResultKeys.resize(nRuns);
+		if(nRuns > 0)
+		{
+			V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dResults, CL_TRUE, 0, sizeof(Acc) * nRuns, &m_hResultsKeys[0], 0, NULL, NULL),
+				"Error reading data from device!");
+			V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dResultKeys, CL_TRUE, 0, sizeof(cl_uint) * nRuns, &m_hResultKeys[0], 0, NULL, NULL),
+				"Error reading data from device!");
+		}
+
+		//measure the performance
+		for(int mode = 0; mode < 2; mode++)
+		{
+			double ms;
+			if(!CBenchmark::TimeGPU(CommandQueue, [this, CommandQueue, mode]()
+				{
+					if(mode == 0)
+						ReduceCSR(CommandQueue);
+					else
+						ReduceByKey(CommandQueue);
+				}, ms))
+				return;
+
+			double bytes = double(m_N * sizeof(T)) + (mode == 0 ? double((m_S + 1) * sizeof(cl_uint)) : double(m_N * sizeof(cl_uint)));
+			std::cout<<std::endl;
+			CBenchmark::PrintGPU(GetName() + (mode == 0 ? ", offsets" : ", keys"), ms, double(m_N), bytes);
+		}
+	}
+
+	virtual void ComputeCPU()
+	{
+		double ms = CBenchmark::TimeCPU([this]() { Reference(); });
+		CBenchmark::PrintCPU(GetName() + " reference", ms);
+	}
+
+	virtual bool ValidateResults()
+	{
+		bool valid = true;
+
+		size_t mismatches = 0;
+		for(size_t s = 0; s < m_S && s < m_hResultsCSR.size(); s++)
+		{
+			if(!Op<T>::Matches(m_hResultsCSR[s], m_hReferenceCSR[s], m_hAbsSums[s]))
+			{
+				if(mismatches < 8)
+					std::cout<<"  segment "<<s<<" ["<<m_hOffsets[s]<<", "<<m_hOffsets[s + 1]<<"): "<<Op<T>::Value(m_hResultsCSR[s])
+						<<", expected "<<Op<T>::Value(m_hReferenceCSR[s])<<std::endl;
+				mismatches++;
+			}
+		}
+		if(mismatches > 0 || m_hResultsCSR.size() != m_S)
+		{
+			std::cout<<GetName()<<" with offsets: "<<mismatches<<" of "<<m_S<<" segments are incorrect."<<std::endl;
+			valid = false;
+		}
+
+		if(m_SegmentCountGPU != m_hReferenceKeys.size())
+		{
+			std::cout<<GetName()<<" by key: found "<<m_SegmentCountGPU<<" runs, expected "<<m_hReferenceKeys.size()<<"."<<std::endl;
+			return false;
+		}
+		mismatches = 0;
+		for(size_t r = 0; r < m_hReferenceKeys.size(); r++)
+		{
+			if(m_hResultKeys[r] != m_hReferenceKeys[r] || !Op<T>::Matches(m_hResultsKeys[r], m_hReferenceKeyValues[r], m_hReferenceKeyAbsSums[r]))
+			{
+				if(mismatches < 8)
+					std::cout<<"  run "<<r<<": key "<<m_hResultKeys[r]<<" value "<<Op<T>::Value(m_hResultsKeys[r])
+						<<", expected key "<<m_hReferenceKeys[r]<<" value "<<Op<T>::Value(m_hReferenceKeyValues[r])<<std::endl;
+				mismatches++;
+			}
+		}
+		if(mismatches > 0)
+		{
+			std::cout<<GetName()<<" by key: "<<mismatches<<" of "<<m_hReferenceKeys.size()<<" runs are incorrect."<<std::endl;
+			valid = false;
+		}
+
+		return valid;
+	}
+
+protected:
+	size_t GetTileCount(size_t WorkUnits) const
+	{
+		size_t tileSize = m_LocalWorkSize * SEGMENTED_REDUCTION_ITEMS_PER_THREAD;
+		return (WorkUnits + tileSize - 1) / tileSize;
+	}
+
+	//! CPU reference of both variants, the keys reduce over the non-empty segments
+	void Reference()
+	{
+		m_hReferenceCSR.resize(m_S);
+		m_hAbsSums.resize(m_S);
+		m_hReferenceKeys.clear();
+		m_hReferenceKeyValues.clear();
+		m_hReferenceKeyAbsSums.clear();
+		for(size_t s = 0; s < m_S; s++)
+		{
+			size_t begin = m_hOffsets[s], count = m_hOffsets[s + 1] - begin;
+			m_hReferenceCSR[s] = Op<T>::Reference(&m_hValues[0] + begin, count, cl_uint(begin));
+
+			double absSum = 0.0;
+			for(size_t i = begin; i < begin + count; i++)
+				absSum += std::fabs(double(m_hValues[i]));
+			m_hAbsSums[s] = absSum;
+
+			// the runs of the keys are the non-empty segments
+			if(count > 0)
+			{
+				m_hReferenceKeys.push_back(m_hKeys[begin]);
+				m_hReferenceKeyValues.push_back(m_hReferenceCSR[s]);
+				m_hReferenceKeyAbsSums.push_back(absSum);
+			}
+		}
+	}
+
+	//! Skewed segment lengths: 30% empty, most short, a few very long ones
+	void GenerateSegments()
+	{
+		m_hOffsets.clear();
+		m_hOffsets.push_back(0);
+		size_t pos = 0;
+		while(pos < m_N)
+		{
+			size_t length;
+			int r = rand() % 1000;
+			if(r < 300)
+				length = 0;
+			else if(r < 995)
+				length = 1 + rand() % 16;
+			else
+				length = 1 + size_t(rand()) * 7919 % std::max<size_t>(m_N / 8, 1);
+			pos = std::min(m_N, pos + length);
+			m_hOffsets.push_back(cl_uint(pos));
+		}
+		m_S = m_hOffsets.size() - 1;
+
+		// the keys of consecutive non-empty segments differ
+		m_hKeys.resize(m_N);
+		cl_uint key = 0;
+		for(size_t s = 0; s < m_S; s++)
+		{
+			if(m_hOffsets[s] == m_hOffsets[s + 1])
+				continue;
+			key += 1 + rand() % 100;
+			for(size_t i = m_hOffsets[s]; i < m_hOffsets[s + 1]; i++)
+				m_hKeys[i] = key;
+		}
+	}
+
+	void ReduceCSR(cl_command_queue CommandQueue)
+	{
+		size_t nTiles = GetTileCount(m_N + m_S);
+		cl_uint n = cl_uint(m_N), s = cl_uint(m_S);
+		m_Epoch++;
+
+		cl_int clErr;
+		clErr = clSetKernelArg(m_CSRKernel, 0, sizeof(cl_mem), (void*)&m_dValues);
+		clErr |= clSetKernelArg(m_CSRKernel, 1, sizeof(cl_mem), (void*)&m_dOffsets);
+		clErr |= clSetKernelArg(m_CSRKernel, 2, sizeof(cl_uint), (void*)&n);
+		clErr |= clSetKernelArg(m_CSRKernel, 3, sizeof(cl_uint), (void*)&s);
+		clErr |= clSetKernelArg(m_CSRKernel, 4, sizeof(cl_mem), (void*)&m_dResults);
+		clErr |= clSetKernelArg(m_CSRKernel, 5, sizeof(cl_mem), (void*)&m_dTileCounter);
+		clErr |= clSetKernelArg(m_CSRKernel, 6, sizeof(cl_mem), (void*)&m_dTileFlags);
+		clErr |= clSetKernelArg(m_CSRKernel, 7, sizeof(cl_mem), (void*)&m_dTilePrefix);
+		clErr |= clSetKernelArg(m_CSRKernel, 8, sizeof(cl_mem), (void*)&m_dTileCarry);
+		clErr |= clSetKernelArg(m_CSRKernel, 9, sizeof(cl_uint), (void*)&m_Epoch);
+		V_RETURN_CL(clErr, "Failed to set kernel args: SegmentedReduceCSR");
+
+		RunPasses(CommandQueue, m_CSRKernel, 10, nTiles, "SegmentedReduceCSR");
+	}
+
+	void ReduceByKey(cl_command_queue CommandQueue)
+	{
+		size_t nTiles = GetTileCount(m_N);
+		cl_uint n = cl_uint(m_N);
+		m_Epoch++;
+
+		cl_int clErr;
+		clErr = clSetKernelArg(m_KeysKernel, 0, sizeof(cl_mem), (void*)&m_dValues);
+		clErr |= clSetKernelArg(m_KeysKernel, 1, sizeof(cl_mem), (void*)&m_dKeys);
+		clErr |= clSetKernelArg(m_KeysKernel, 2, sizeof(cl_uint), (void*)&n);
+		clErr |= clSetKernelArg(m_KeysKernel, 3, sizeof(cl_mem), (void*)&m_dResultKeys);
+		clErr |= clSetKernelArg(m_KeysKernel, 4, sizeof(cl_mem), (void*)&m_dResults);
+		clErr |= clSetKernelArg(m_KeysKernel, 5, sizeof(cl_mem), (void*)&m_dSegmentCount);
+		clErr |= clSetKernelArg(m_KeysKernel, 6, sizeof(cl_mem), (void*)&m_dTileCounter);
+		clErr |= clSetKernelArg(m_KeysKernel, 7, sizeof(cl_mem), (void*)&m_dTileFlags);
+		clErr |= clSetKernelArg(m_KeysKernel, 8, sizeof(cl_mem), (void*)&m_dTilePrefix);
+		clErr |= clSetKernelArg(m_KeysKernel, 9, sizeof(cl_mem), (void*)&m_dTileCarry);
+		clErr |= clSetKernelArg(m_KeysKernel, 10, sizeof(cl_uint), (void*)&m_Epoch);
+		V_RETURN_CL(clErr, "Failed to set kernel args: ReduceByKey");
+
+		RunPasses(CommandQueue, m_KeysKernel, 11, nTiles, "ReduceByKey");
+	}
+
+	//! Enqueues Kernel over nTiles tiles. With look-back this is a single pass, otherwise a pass that
+	//! stores the tile states (StatesOnlyArg = 1), CombineTiles and the pass that writes the results.
+	void RunPasses(cl_command_queue CommandQueue, cl_kernel Kernel, cl_uint StatesOnlyArg, size_t nTiles, const char* Name)
+	{
+		size_t localWorkSize = m_LocalWorkSize;
+		size_t globalWorkSize = nTiles * localWorkSize;
+		cl_uint zero = 0, one = 1;
+		cl_int clErr;
+
+		if(!m_UseLookBack)
+		{
+			V_RETURN_CL(clSetKernelArg(Kernel, StatesOnlyArg, sizeof(cl_uint), (void*)&one), "Failed to set kernel args: " << Name);
+			clErr = clEnqueueNDRangeKernel(CommandQueue, Kernel, 1, NULL, &globalWorkSize, &localWorkSize, 0, NULL, NULL);
+			V_RETURN_CL(clErr, "Error executing " << Name << "!");
+
+			size_t combineWorkSize = 1;
+			cl_uint n = cl_uint(nTiles);
+			clErr = clSetKernelArg(m_CombineKernel, 0, sizeof(cl_mem), (void*)&m_dTilePrefix);
+			clErr |= clSetKernelArg(m_CombineKernel, 1, sizeof(cl_mem), (void*)&m_dTileCarry);
+			clErr |= clSetKernelArg(m_CombineKernel, 2, sizeof(cl_uint), (void*)&n);
+			V_RETURN_CL(clErr, "Failed to set kernel args: CombineTiles");
+
+			clErr = clEnqueueNDRangeKernel(CommandQueue, m_CombineKernel, 1, NULL, &combineWorkSize, &combineWorkSize, 0, NULL, NULL);
+			V_RETURN_CL(clErr, "Error executing CombineTiles!");
+		}
+
+		V_RETURN_CL(clSetKernelArg(Kernel, StatesOnlyArg, sizeof(cl_uint), (void*)&zero), "Failed to set kernel args: " << Name);
+		clErr = clEnqueueNDRangeKernel(CommandQueue, Kernel, 1, NULL, &globalWorkSize, &localWorkSize, 0, NULL, NULL);
+		V_RETURN_CL(clErr, "Error executing " << Name << "!");
+	}
+
+	size_t					m_N;
+	// number of segments (including the empty ones)
+	size_t					m_S;
+	size_t					m_LocalWorkSize;
+	// tile states of a launch are valid if their flag equals the epoch
+	cl_uint					m_Epoch;
+	// single pass with look-back (GPUs only)
+	bool					m_UseLookBack;
+
+	std::vector<T>			m_hValues;
+	std::vector<cl_uint>	m_hOffsets;
+	std::vector<cl_uint>	m_hKeys;
+
+	// CPU references
+	std::vector<Acc>		m_hReferenceCSR;
+	std::vector<double>		m_hAbsSums;
+	std::vector<cl_uint>	m_hReferenceKeys;
+	std::vector<Acc>		m_hReferenceKeyValues;
+	std::vector<double>		m_hReferenceKeyAbsSums;
+
+	// GPU results
+	std::vector<Acc>		m_hResultsCSR;
+	std::vector<Acc>		m_hResultsKeys;
+	std::vector<cl_uint>	m_hResultKeys;
+	cl_uint					m_SegmentCountGPU;
+
+	cl_mem					m_dValues;
+	cl_mem					m_dOffsets;
+	cl_mem					m_dKeys;
+	cl_mem					m_dResults;
+	cl_mem					m_dResultKeys;
+	cl_mem					m_dSegmentCount;
+
+	// chained scan state
+	cl_mem					m_dTileCounter;
+	cl_mem					m_dTileFlags;
+	cl_mem					m_dTilePrefix;
+	cl_mem					m_dTileCarry;
+
+	cl_program				m_Program;
+	cl_kernel				m_CSRKernel;
+	cl_kernel				m_KeysKernel;
+	cl_kernel				m_CombineKernel;
+};
+
+#endif // _CSEGMENTED_REDUCTION_TASK_H
@@ -0,0 +1,206 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CTOPK_TASK_H
+#define _CTOPK_TASK_H
+
+#include "../Common/IComputeTask.h"
+#include "../Common/CLUtil.h"
+#include "../Common/CBenchmark.h"
+#include "../Common/CValidator.h"
+#include "../Common/CTopKPrimitive.h"
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+//! A2/T5: selection of the K largest cl_uint or cl_ulong keys (../Common/CTopKPrimitive.h), optionally with values
+/*!
+	The values are the original indices. With KeyRange > 0 the keys are taken
+	modulo KeyRange, so there are many keys equal to the K-th largest one and
+	the selection of the ties is tested. The reference is std::nth_element
+	followed by sorting the K largest keys, std::sort of the whole array is
+	timed for comparison.
+
+	Ties may be resolved differently, so the values are checked for pointing
+	to distinct input elements with the selected keys.
+*/
+template <typename K>
+class CTopKTask : public IComputeTask
+{
+public:
+	CTopKTask(size_t ArraySize, size_t TopK, bool HasValues, K KeyRange = 0, size_t LocalWorkSize = 128)
+		: m_N(ArraySize), m_K(std::min(TopK, ArraySize)), m_KeyRange(KeyRange),
+		m_TopK(sizeof(K) == sizeof(cl_ulong), HasValues, LocalWorkSize),
+		m_dKeys(NULL), m_dValues(NULL), m_dOutKeys(NULL), m_dOutValues(NULL)
+	{
+		std::stringstream name;
+		name<<"top-"<<m_K<<", "<<8 * sizeof(K)<<" bit keys"<<(HasValues ? " + values" : "");
+		if(KeyRange > 0)
+			name<<" below "<<KeyRange;
+		m_Name = name.str();
+	}
+
+	virtual ~CTopKTask()
+	{
+		ReleaseResources();
+	}
+
+	const std::string& GetName() const { return m_Name; }
+
+	// IComputeTask
+
+	virtual bool InitResources(cl_device_id Device, cl_context Context)
+	{
+		//CPU resources
+		K range = m_KeyRange;
+		CBenchmark::Fill(m_hKeys, m_N, [range]() { return range > 0 ? CBenchmark::RandomBits<K>() % range : CBenchmark::RandomBits<K>(); });
+		m_hValues.resize(m_N);
+		for(size_t i = 0; i < m_N; i++)
+			m_hValues[i] = cl_uint(i);
+
+		//device resources
+		cl_int clError, clError2;
+		m_dKeys = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(K) * m_N, &m_hKeys[0], &clError2);
+		clError = clError2;
+		m_dValues = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint) * m_N, &m_hValues[0], &clError2);
+		clError |= clError2;
+		m_dOutKeys = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(K) * std::max<size_t>(m_K, 1), NULL, &clError2);
+		clError |= clError2;
+		m_dOutValues = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * std::max<size_t>(m_K, 1), NULL, &clError2);
+		clError |= clError2;
+		V_RETURN_FALSE_CL(clError, "Error allocating device arrays");
+
+		return m_TopK.Init(Device, Context);
+	}
+
+	virtual void ReleaseResources()
+	{
+		// host resources
+		m_hKeys.clear();
+		m_hValues.clear();
+		m_hKeysCPU.clear();
+		m_hKeysGPU.clear();
+		m_hValuesGPU.clear();
+
+		// device resources
+		m_TopK.Release();
+
+		SAFE_RELEASE_MEMOBJECT(m_dKeys);
+		SAFE_RELEASE_MEMOBJECT(m_dValues);
+		SAFE_RELEASE_MEMOBJECT(m_dOutKeys);
+		SAFE_RELEASE_MEMOBJECT(m_dOutValues);
+	}
+
+	virtual void ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
+	{
+		if(!m_TopK.Select(CommandQueue, m_dKeys, m_dValues, m_N, m_K, m_dOutKeys, m_dOutValues))
+			return;
+
+		m_hKeysGPU.resize(m_K);
+		m_hValuesGPU.resize(m_K);
+		if(m_K == 0)
+			return;
+		V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dOutKeys, CL_TRUE, 0, sizeof(K) * m_K, &m_hKeysGPU[0], 0, NULL, NULL),
+			"Error reading data from device!");
+		if(m_TopK.HasValues())
+			V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dOutValues, CL_TRUE, 0, sizeof(cl_uint) * m_K, &m_hValuesGPU[0], 0, NULL, NULL),
+				"Error reading data from device!");
+
+		//measure the performance, the input is not modified
+		double ms;
+		if(!CBenchmark::TimeGPU(CommandQueue,
+			[this, CommandQueue]() { m_TopK.Select(CommandQueue, m_dKeys, m_dValues, m_N, m_K, m_dOutKeys, m_dOutValues); }, ms, 20))
+			return;
+		CBenchmark::PrintKeys(GetName(), ms, double(m_N));
+	}
+
+	virtual void ComputeCPU()
+	{
+		double msSelect = CBenchmark::TimeCPU([this]()
+			{
+				m_hKeysCPU = m_hKeys;
+				if(m_K > 0)
+				{
+					std::nth_element(m_hKeysCPU.begin(), m_hKeysCPU.begin() + (m_K - 1), m_hKeysCPU.end(), std::greater<K>());
+					m_hKeysCPU.resize(m_K);
+					std::sort(m_hKeysCPU.begin(), m_hKeysCPU.end(), std::greater<K>());
+				}
+				else
+					m_hKeysCPU.clear();
+			});
+
+		std::vector<K> keys = m_hKeys;
+		double msSort = CBenchmark::TimeCPU([&keys]() { std::sort(keys.begin(), keys.end(), std::greater<K>()); });
+
+		std::stringstream selectLabel;
+		selectLabel<<"std::nth_element + sort of the top "<<m_K;
+		CBenchmark::PrintKeys(selectLabel.str(), msSelect, double(m_N), true);
+		CBenchmark::PrintKeys("std::sort", msSort, double(m_N), true);
+	}
+
+	virtual bool ValidateResults()
+	{
+		if(m_hKeysGPU.size() != m_K)
+			return false;
+		if(m_K == 0)
+			return true;
+
+		CValidator validator;
+		bool success = validator.Compare(&m_hKeysCPU[0], &m_hKeysGPU[0], m_K);
+		validator.PrintMismatches(GetName() + " keys");
+
+		if(m_TopK.HasValues())
+		{
+			// every value is the index of a distinct input element with the same key
+			std::vector<cl_uint> indices = m_hValuesGPU;
+			std::sort(indices.begin(), indices.end());
+			bool valid = std::adjacent_find(indices.begin(), indices.end()) == indices.end();
+			for(size_t i = 0; i < m_K && valid; i++)
+				valid = m_hValuesGPU[i] < m_N && m_hKeys[m_hValuesGPU[i]] == m_hKeysGPU[i];
+			if(!valid)
+				std::cout<<GetName()<<": the values do not belong to the keys."<<std::endl;
+			success = success && valid;
+		}
+		return success;
+	}
+
+protected:
+	size_t					m_N;
+	size_t					m_K;
+	K						m_KeyRange;
+	std::string				m_Name;
+	CTopKPrimitive			m_TopK;
+
+	std::vector<K>			m_hKeys;
+	std::vector<cl_uint>	m_hValues;
+	std::vector<K>			m_hKeysCPU;
+	std::vector<K>			m_hKeysGPU;
+	std::vector<cl_uint>	m_hValuesGPU;
+
+	cl_mem					m_dKeys;
+	cl_mem					m_dValues;
+	cl_mem					m_dOutKeys;
+	cl_mem					m_dOutValues;
+};
+
+#endif // _CTOPK_TASK_H
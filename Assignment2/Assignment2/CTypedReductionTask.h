@@ -0,0 +1,235 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CTYPED_REDUCTION_TASK_H
+#define _CTYPED_REDUCTION_TASK_H
+
+#include "../Common/IComputeTask.h"
+#include "../Common/CLUtil.h"
+#include "../Common/CBenchmark.h"
+
+#include "CReductionOps.h"
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+
+// work-groups per compute unit of the single-pass reduction
+#define TYPED_REDUCTION_GROUPS_PER_CU 8
+
+//! A2/T1b: Single-pass reduction over a generic element type and operator
+/*!
+	T is int, unsigned int, float or double, Op one of the operators in
+	CReductionOps.h (SSumOp, SKahanSumOp, SMinOp, SMaxOp, SArgMinOp, SArgMaxOp, SStatsOp).
+	TypedReduction.cl (with ReductionOps.cl) is compiled with -D macros selecting both, the host side
+	of the operator provides the CPU reference.
+*/
+template <typename T, template <typename> class Op>
+class CTypedReductionTask : public IComputeTask
+{
+public:
+	typedef typename Op<T>::Acc Acc;
+
+	CTypedReductionTask(size_t ArraySize, size_t LocalWorkSize = 128)
+		: m_N(ArraySize), m_LocalWorkSize(LocalWorkSize), m_ComputeUnits(1), m_Supported(true), m_AbsSum(0.0),
+		m_dInput(NULL), m_dPartials(NULL), m_dCounter(NULL), m_Program(NULL), m_Kernel(NULL)
+	{
+		m_ResultCPU = Op<T>::Identity();
+		m_ResultGPU = Op<T>::Identity();
+	}
+
+	virtual ~CTypedReductionTask()
+	{
+		ReleaseResources();
+	}
+
+	std::string GetName() const
+	{
+		return std::string(Op<T>::Name()) + "<" + CLReductionType<T>::Name() + ">";
+	}
+
+	// IComputeTask
+
+	virtual bool InitResources(cl_device_id Device, cl_context Context)
+	{
+		if((m_LocalWorkSize & (m_LocalWorkSize - 1)) != 0)
+		{
+			std::cerr<<"The typed reduction requires a power-of-two work-group size."<<std::endl;
+			return false;
+		}
+
+		// double needs cl_khr_fp64, the task is skipped without it
+		if(sizeof(T) == sizeof(double) && !std::numeric_limits<T>::is_integer)
+		{
+			size_t extSize = 0;
+			clGetDeviceInfo(Device, CL_DEVICE_EXTENSIONS, 0, NULL, &extSize);
+			std::vector<char> extensions(extSize + 1, 0);
+			clGetDeviceInfo(Device, CL_DEVICE_EXTENSIONS, extSize, &extensions[0], NULL);
+			if(strstr(&extensions[0], "cl_khr_fp64") == NULL)
+			{
+				std::cout<<"The device does not support double precision, skipping "<<GetName()<<"."<<std::endl;
+				m_Supported = false;
+				return true;
+			}
+		}
+
+		//CPU resources
+		m_hInput.resize(m_N);
+		m_AbsSum = 0.0;
+		for(size_t i = 0; i < m_N; i++)
+		{
+			m_hInput[i] = CBenchmark::RandomValue<T>();
+			m_AbsSum += std::fabs(double(m_hInput[i]));
+		}
+
+		V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &m_ComputeUnits, NULL),
+			"Error querying the number of compute units");
+
+		//device resources
+		cl_int clError, clError2;
+		m_dInput = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(T) * m_N, &m_hInput[0], &clError2);
+		clError = clError2;
+		m_dPartials = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(Acc) * GetGroupCount(), NULL, &clError2);
+		clError |= clError2;
+		cl_uint zero = 0;
+		m_dCounter = clCreateBuffer(Context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint), &zero, &clError2);
+		clError |= clError2;
+		V_RETURN_FALSE_CL(clError, "Error allocating device arrays");
+
+		//load and compile kernels
+		std::string programCode;
+		if(!LoadReductionProgramSource("TypedReduction.cl", programCode)) return false;
+		m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode, GetTypedReductionOptions<T, Op>(m_LocalWorkSize));
+		if(m_Program == nullptr) return false;
+
+		m_Kernel = clCreateKernel(m_Program, "TypedReduction", &clError);
+		V_RETURN_FALSE_CL(clError, "Failed to create kernel: TypedReduction.");
+
+		return true;
+	}
+
+	virtual void ReleaseResources()
+	{
+		// host resources
+		m_hInput.clear();
+
+		// device resources
+		SAFE_RELEASE_MEMOBJECT(m_dInput);
+		SAFE_RELEASE_MEMOBJECT(m_dPartials);
+		SAFE_RELEASE_MEMOBJECT(m_dCounter);
+
+		SAFE_RELEASE_KERNEL(m_Kernel);
+		SAFE_RELEASE_PROGRAM(m_Program);
+	}
+
+	virtual void ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
+	{
+		if(!m_Supported)
+			return;
+
+		// the block size is compiled into the kernel
+		if(LocalWorkSize[0] != m_LocalWorkSize)
+		{
+			std::cout<<"TypedReduction was built for a work-group size of "<<m_LocalWorkSize<<std::endl;
+			return;
+		}
+
+		Reduce(CommandQueue);
+		V_RETURN_CL(clEnqueueReadBuffer(CommandQueue, m_dPartials, CL_TRUE, 0, sizeof(Acc), &m_ResultGPU, 0, NULL, NULL),
+			"Error reading data from device!");
+
+		//measure the performance
+		double ms;
+		if(!CBenchmark::TimeGPU(CommandQueue, [this, CommandQueue]() { Reduce(CommandQueue); }, ms))
+			return;
+		std::cout<<std::endl;
+		CBenchmark::PrintGPU(GetName(), ms, double(m_N), double(m_N * sizeof(T)));
+	}
+
+	virtual void ComputeCPU()
+	{
+		if(!m_Supported)
+			return;
+
+		double ms = CBenchmark::TimeCPU([this]() { m_ResultCPU = Op<T>::Reference(&m_hInput[0], m_N); });
+		CBenchmark::PrintCPU(GetName() + " reference", ms);
+	}
+
+	virtual bool ValidateResults()
+	{
+		if(!m_Supported)
+			return true;
+
+		double error = std::fabs(Op<T>::Value(m_ResultGPU) - Op<T>::Value(m_ResultCPU));
+		std::cout<<GetName()<<": "<<Op<T>::Value(m_ResultGPU)<<" (reference "<<Op<T>::Value(m_ResultCPU)
+			<<", error relative to sum |x|: "<<(m_AbsSum > 0.0 ? error / m_AbsSum : 0.0)<<")"<<std::endl;
+
+		return Op<T>::Matches(m_ResultGPU, m_ResultCPU, m_AbsSum);
+	}
+
+protected:
+	size_t GetGroupCount() const
+	{
+		size_t nGroups = std::min<size_t>((m_N + m_LocalWorkSize - 1) / m_LocalWorkSize, m_ComputeUnits * TYPED_REDUCTION_GROUPS_PER_CU);
+		return std::max<size_t>(nGroups, 1);
+	}
+
+	//! Enqueues the single-pass reduction, the result ends up in m_dPartials[0]
+	void Reduce(cl_command_queue CommandQueue)
+	{
+		size_t localWorkSize = m_LocalWorkSize;
+		size_t globalWorkSize = GetGroupCount() * localWorkSize;
+		cl_uint n = cl_uint(m_N);
+
+		cl_int clErr;
+		clErr = clSetKernelArg(m_Kernel, 0, sizeof(cl_mem), (void*)&m_dInput);
+		clErr |= clSetKernelArg(m_Kernel, 1, sizeof(cl_mem), (void*)&m_dPartials);
+		clErr |= clSetKernelArg(m_Kernel, 2, sizeof(cl_mem), (void*)&m_dCounter);
+		clErr |= clSetKernelArg(m_Kernel, 3, sizeof(cl_uint), (void*)&n);
+		clErr |= clSetKernelArg(m_Kernel, 4, localWorkSize * sizeof(Acc), NULL);
+		V_RETURN_CL(clErr, "Failed to set kernel args: TypedReduction");
+
+		clErr = clEnqueueNDRangeKernel(CommandQueue, m_Kernel, 1, NULL, &globalWorkSize, &localWorkSize, 0, NULL, NULL);
+		V_RETURN_CL(clErr, "Error executing TypedReduction!");
+	}
+
+	size_t				m_N;
+	size_t				m_LocalWorkSize;
+	cl_uint				m_ComputeUnits;
+	bool				m_Supported;
+
+	std::vector<T>		m_hInput;
+	// sum of |x|, the scale of the rounding errors of float sums
+	double				m_AbsSum;
+
+	Acc					m_ResultCPU;
+	Acc					m_ResultGPU;
+
+	cl_mem				m_dInput;
+	// one partial result per work-group, the final result in element 0
+	cl_mem				m_dPartials;
+	cl_mem				m_dCounter;
+
+	cl_program			m_Program;
+	cl_kernel			m_Kernel;
+};
+
+#endif // _CTYPED_REDUCTION_TASK_H
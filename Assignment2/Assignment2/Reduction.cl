@@ -60,7 +60,158 @@ __kernel void Reduction_Decomp(const __global uint* inArray, __global uint* outA
 
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-__kernel void Reduction_DecompUnroll(const __global uint* inArray, __global uint* outArray, uint N, __local uint* localBlock)
+// BLOCK_SIZE (the work-group size) and ELEMENTS_PER_THREAD are set by the host,
+// WARP_SIZE only on devices that execute a whole wavefront in lockstep
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE 128
+#endif
+
+#ifndef ELEMENTS_PER_THREAD
+#define ELEMENTS_PER_THREAD 8
+#endif
+
+// one tree stage with a barrier, removed by the compiler if the block is too small
+#define REDUCE_STAGE(S) \
+	if(BLOCK_SIZE >= 2 * (S)) \
+	{ \
+		if(LID < (S)) \
+			localBlock[LID] = sum = sum + localBlock[LID + (S)]; \
+		barrier(CLK_LOCAL_MEM_FENCE); \
+	}
+
+// the same within a single wavefront: no barrier, but volatile accesses
+#define REDUCE_WARP_STAGE(S) \
+	if(BLOCK_SIZE >= 2 * (S)) \
+		warpBlock[LID] = sum = sum + warpBlock[LID + (S)];
+
+__kernel __attribute__((reqd_work_group_size(BLOCK_SIZE, 1, 1)))
+void Reduction_DecompUnroll(const __global uint* inArray, __global uint* outArray, uint N, __local uint* localBlock)
 {
-	// TO DO: Kernel implementation
+	uint LID = get_local_id(0);
+
+	// every work-item first adds ELEMENTS_PER_THREAD elements, strided by the block size
+	// so the loads of a work-group stay coalesced; works for arbitrary N
+	uint i = get_group_id(0) * (BLOCK_SIZE * ELEMENTS_PER_THREAD) + LID;
+	uint sum = 0;
+	#pragma unroll
+	for(uint k = 0; k < ELEMENTS_PER_THREAD; k++, i += BLOCK_SIZE)
+	{
+		if(i < N)
+			sum += inArray[i];
+	}
+	localBlock[LID] = sum;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// fully unrolled tree, the stage sizes are compile time constants
+	REDUCE_STAGE(512)
+	REDUCE_STAGE(256)
+	REDUCE_STAGE(128)
+
+#if defined(WARP_SIZE) && BLOCK_SIZE >= 2 * WARP_SIZE
+	#if WARP_SIZE < 64
+	REDUCE_STAGE(64)
+	#endif
+	#if WARP_SIZE < 32
+	REDUCE_STAGE(32)
+	#endif
+
+	if(LID < WARP_SIZE)
+	{
+		volatile __local uint* warpBlock = localBlock;
+		#if WARP_SIZE >= 64
+		REDUCE_WARP_STAGE(64)
+		#endif
+		#if WARP_SIZE >= 32
+		REDUCE_WARP_STAGE(32)
+		#endif
+		REDUCE_WARP_STAGE(16)
+		REDUCE_WARP_STAGE(8)
+		REDUCE_WARP_STAGE(4)
+		REDUCE_WARP_STAGE(2)
+		REDUCE_WARP_STAGE(1)
+	}
+#else
+	REDUCE_STAGE(64)
+	REDUCE_STAGE(32)
+	REDUCE_STAGE(16)
+	REDUCE_STAGE(8)
+	REDUCE_STAGE(4)
+	REDUCE_STAGE(2)
+	REDUCE_STAGE(1)
+#endif
+
+	if(LID == 0)
+		outArray[get_group_id(0)] = sum;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tree reduction of one value per work-item, the result is valid in work-item 0
+uint ReduceBlock(uint sum, __local uint* localBlock)
+{
+	uint LID = get_local_id(0);
+
+	localBlock[LID] = sum;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	REDUCE_STAGE(512)
+	REDUCE_STAGE(256)
+	REDUCE_STAGE(128)
+	REDUCE_STAGE(64)
+	REDUCE_STAGE(32)
+	REDUCE_STAGE(16)
+	REDUCE_STAGE(8)
+	REDUCE_STAGE(4)
+	REDUCE_STAGE(2)
+	REDUCE_STAGE(1)
+
+	return sum;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Complete reduction in a single launch: every group writes its partial sum, the group
+// that finishes last (determined with an atomic counter) combines them into partials[0].
+// The counter has to be 0 before the launch and is reset to 0 by the last group.
+__kernel __attribute__((reqd_work_group_size(BLOCK_SIZE, 1, 1)))
+void Reduction_SinglePass(const __global uint* inArray, __global uint* partials, __global uint* counter, uint N, __local uint* localBlock)
+{
+	__local uint isLastGroup;
+
+	uint LID = get_local_id(0);
+	uint nGroups = get_num_groups(0);
+
+	// grid-stride accumulation, handles arbitrary N with a fixed number of groups
+	uint sum = 0;
+	for(uint i = get_global_id(0); i < N; i += get_global_size(0))
+		sum += inArray[i];
+
+	sum = ReduceBlock(sum, localBlock);
+
+	if(LID == 0)
+	{
+		partials[get_group_id(0)] = sum;
+
+		// make the partial sum visible before taking a ticket
+		mem_fence(CLK_GLOBAL_MEM_FENCE);
+		isLastGroup = (atomic_inc(counter) == nGroups - 1);
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if(!isLastGroup)
+		return;
+
+	// volatile: the partial sums of the other groups must not come from a stale cache line
+	volatile const __global uint* volatilePartials = partials;
+	sum = 0;
+	for(uint i = LID; i < nGroups; i += BLOCK_SIZE)
+		sum += volatilePartials[i];
+
+	// all reads of the partials happen before work-item 0 overwrites partials[0]
+	sum = ReduceBlock(sum, localBlock);
+
+	if(LID == 0)
+	{
+		partials[0] = sum;
+		*counter = 0;
+	}
 }
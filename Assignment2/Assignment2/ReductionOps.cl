@@ -0,0 +1,117 @@
+
+// Element type and associative operator of the reductions, configured by the host through -D macros:
+//   VALUE_T                       element type (int, uint, float, double)
+//   VALUE_LOWEST, VALUE_HIGHEST   range of VALUE_T, used as identities of max / min
+//   OP_SUM, OP_KAHAN_SUM, OP_MIN, OP_MAX, OP_ARGMIN, OP_ARGMAX, OP_STATS
+//   USE_FP64                      set for double (the statistics of double are accumulated in double, all others in float)
+// The host prepends this file to TypedReduction.cl and SegmentedReduction.cl.
+
+#ifdef USE_FP64
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accumulator type ACC and the operator: Identity(), Load() turns element i into an accumulator,
+// Combine() must be associative. The layouts match the host structs in CReductionOps.h.
+
+#if defined(OP_SUM)
+
+typedef VALUE_T ACC;
+ACC Identity() { return (VALUE_T)0; }
+ACC Load(VALUE_T x, uint i) { return x; }
+ACC Combine(ACC a, ACC b) { return a + b; }
+
+#elif defined(OP_KAHAN_SUM)
+
+// sum with the accumulated rounding error, combined with an error-free two-sum
+typedef struct { VALUE_T sum; VALUE_T compensation; } ACC;
+ACC Identity() { ACC r = { (VALUE_T)0, (VALUE_T)0 }; return r; }
+ACC Load(VALUE_T x, uint i) { ACC r = { x, (VALUE_T)0 }; return r; }
+ACC Combine(ACC a, ACC b)
+{
+	VALUE_T s = a.sum + b.sum;
+	VALUE_T bv = s - a.sum;
+	VALUE_T err = (a.sum - (s - bv)) + (b.sum - bv);
+	ACC r = { s, a.compensation + b.compensation + err };
+	return r;
+}
+
+#elif defined(OP_MIN)
+
+typedef VALUE_T ACC;
+ACC Identity() { return VALUE_HIGHEST; }
+ACC Load(VALUE_T x, uint i) { return x; }
+ACC Combine(ACC a, ACC b) { return b < a ? b : a; }
+
+#elif defined(OP_MAX)
+
+typedef VALUE_T ACC;
+ACC Identity() { return VALUE_LOWEST; }
+ACC Load(VALUE_T x, uint i) { return x; }
+ACC Combine(ACC a, ACC b) { return b > a ? b : a; }
+
+#elif defined(OP_ARGMIN) || defined(OP_ARGMAX)
+
+// ties are resolved to the smaller index, so the result does not depend on the reduction order
+typedef struct { VALUE_T value; uint index; } ACC;
+#if defined(OP_ARGMIN)
+ACC Identity() { ACC r = { VALUE_HIGHEST, 0xFFFFFFFF }; return r; }
+#define ARG_BETTER(x, y) ((x) < (y))
+#else
+ACC Identity() { ACC r = { VALUE_LOWEST, 0xFFFFFFFF }; return r; }
+#define ARG_BETTER(x, y) ((x) > (y))
+#endif
+ACC Load(VALUE_T x, uint i) { ACC r = { x, i }; return r; }
+ACC Combine(ACC a, ACC b)
+{
+	if(ARG_BETTER(b.value, a.value) || (b.value == a.value && b.index < a.index))
+		return b;
+	return a;
+}
+
+#elif defined(OP_STATS)
+
+// count, sum, min, max, mean and the sum of squared deviations from the mean (M2) in a single pass.
+// Load() followed by Combine() is Welford's update, Combine() merges two partial results like Chan et al.,
+// so the variance M2 / count does not suffer from the cancellation of sum(x^2) - sum(x)^2 / count.
+#ifdef USE_FP64
+typedef double REAL_T;
+#else
+typedef float REAL_T;
+#endif
+typedef struct { VALUE_T sum; VALUE_T min; VALUE_T max; REAL_T mean; REAL_T m2; uint count; } ACC;
+ACC Identity() { ACC r = { (VALUE_T)0, VALUE_HIGHEST, VALUE_LOWEST, (REAL_T)0, (REAL_T)0, 0 }; return r; }
+ACC Load(VALUE_T x, uint i) { ACC r = { x, x, x, (REAL_T)x, (REAL_T)0, 1 }; return r; }
+ACC Combine(ACC a, ACC b)
+{
+	uint n = a.count + b.count;
+	if(n == 0)
+		return a;
+
+	// the mean moves towards b by its weight, M2 gains the spread between the two means
+	REAL_T delta = b.mean - a.mean;
+	REAL_T weightB = (REAL_T)b.count / (REAL_T)n;
+	ACC r;
+	r.sum = a.sum + b.sum;
+	r.min = b.min < a.min ? b.min : a.min;
+	r.max = b.max > a.max ? b.max : a.max;
+	r.mean = a.mean + delta * weightB;
+	r.m2 = a.m2 + b.m2 + delta * delta * (REAL_T)a.count * weightB;
+	r.count = n;
+	return r;
+}
+
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reads a partial result written by another work-group, word by word through a volatile pointer
+typedef union { ACC acc; uint words[sizeof(ACC) / sizeof(uint)]; } ACC_WORDS;
+
+ACC LoadPartial(const __global ACC* partials, uint i)
+{
+	volatile const __global uint* words = (volatile const __global uint*)(partials + i);
+	ACC_WORDS w;
+	for(uint k = 0; k < sizeof(ACC) / sizeof(uint); k++)
+		w.words[k] = words[k];
+	return w.acc;
+}
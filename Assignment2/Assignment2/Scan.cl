@@ -28,118 +28,211 @@ __kernel void Scan_Naive(const __global uint* inArray, __global uint* outArray,
 #define NUM_BANKS_LOG		5
 #define SIMD_GROUP_SIZE		32
 
-// Bank conflicts
-#define AVOID_BANK_CONFLICTS
+// Bank conflicts, AVOID_BANK_CONFLICTS is set by the host (which also sizes localBlock accordingly).
+// One padding element after every NUM_BANKS elements spreads the power-of-two strides over all banks.
 #ifdef AVOID_BANK_CONFLICTS
-	// TO DO: define your conflict-free macro here
+	#define OFFSET(A) ((A) + ((A) >> NUM_BANKS_LOG))
 #else
 	#define OFFSET(A) (A)
 #endif
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-__kernel void Scan_WorkEfficient(__global uint* array, __global uint* higherLevelArray, __local uint* localBlock) 
+// Inclusive scan of one block of 2 * local_size elements (Blelloch up- and down-sweep in local memory).
+// Elements beyond N are padded with 0, so N does not have to be a multiple of the block size.
+// The block total is written to higherLevelArray[GPID].
+__kernel void Scan_WorkEfficient(__global uint* array, __global uint* higherLevelArray, __local uint* localBlock, uint N) 
 {
-	// TO DO: Kernel implementation
-	
-	int GID = get_global_id(0);
 	int LID = get_local_id(0);
 	int GPID = get_group_id(0);
-	
-	int ldx = GPID * get_local_size(0) * 2 +  LID ;
-	int rdx = GPID * get_local_size(0) * 2 + LID + get_local_size(0) ;
-//	higherLevelArray[ 0 ] = 0;
-	localBlock[ LID ] = array[ ldx ] ;
-	localBlock[ LID + get_local_size(0) ] = array[ rdx ] ;
+	int L = get_local_size(0);
+
+	uint base = GPID * L * 2;
+	uint a = (base + LID < N) ? array[base + LID] : 0;
+	uint b = (base + LID + L < N) ? array[base + LID + L] : 0;
+
+	localBlock[ OFFSET(LID) ] = a;
+	localBlock[ OFFSET(LID + L) ] = b;
 	barrier(CLK_LOCAL_MEM_FENCE);
 
-	for(unsigned int stride = 1 ; stride <= get_local_size(0) ; stride=stride*2 ) 
+	// up-sweep
+	for(int stride = 1; stride <= L; stride *= 2) 
 	{
-		rdx = get_local_size(0) * 2 - 1 - LID * 2 * stride  ;
-		ldx = get_local_size(0) * 2 - 1 - ( 2 * LID + 1 ) * stride   ;
-		
-		if( ldx >= 0 )
-		{
-			if(stride == get_local_size(0))
-				{
-					array[GPID * get_local_size(0) * 2 +rdx] = localBlock[ ldx ] + localBlock[ rdx ];
-					higherLevelArray[ GPID ] = localBlock[ ldx ] + localBlock[ rdx ];
-					localBlock[rdx] = 0 ;
-				}
-			else
-				{
-				localBlock[rdx] = localBlock[ ldx ] + localBlock[ rdx ] ;
-				}
-		}
+		int rdx = L * 2 - 1 - LID * 2 * stride;
+		int ldx = rdx - stride;
+		if(ldx >= 0)
+			localBlock[ OFFSET(rdx) ] += localBlock[ OFFSET(ldx) ];
 		barrier(CLK_LOCAL_MEM_FENCE);
 	}
-	
 
+	if(LID == 0)
+	{
+		higherLevelArray[ GPID ] = localBlock[ OFFSET(L * 2 - 1) ];
+		localBlock[ OFFSET(L * 2 - 1) ] = 0;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
 
-	for(unsigned int stride = get_local_size(0) ; stride >= 1 ; stride=stride/2 ) 
+	// down-sweep, leaves the exclusive scan in local memory
+	for(int stride = L; stride >= 1; stride /= 2) 
 	{
-		rdx = get_local_size(0) * 2 - 1 - LID * 2 * stride  ;
-		ldx = get_local_size(0) * 2 - 1 - ( 2 * LID + 1 ) * stride  ;
-		
-		if( ldx >= 0 )
+		int rdx = L * 2 - 1 - LID * 2 * stride;
+		int ldx = rdx - stride;
+		if(ldx >= 0)
 		{
-			if ( stride == 1 )
-			{
-				array[ GPID * get_local_size(0) * 2 + rdx - 1 ] = localBlock[ ldx ] + localBlock[ rdx ] ;
-				if( ( ldx - 1 ) >= 0 )
-					array[ GPID * get_local_size(0) * 2 + ldx - 1 ] = localBlock[ rdx ] ;
-			}
-			else
-			{
-				int inter = localBlock[ ldx ] + localBlock[ rdx ] ;
-				localBlock[ ldx ] = localBlock[ rdx ] ;
-				localBlock[ rdx ] = inter ;
-			}
+			uint left = localBlock[ OFFSET(ldx) ];
+			localBlock[ OFFSET(ldx) ] = localBlock[ OFFSET(rdx) ];
+			localBlock[ OFFSET(rdx) ] += left;
 		}
 		barrier(CLK_LOCAL_MEM_FENCE);
 	}
-	
+
+	if(base + LID < N)
+		array[ base + LID ] = localBlock[ OFFSET(LID) ] + a;
+	if(base + LID + L < N)
+		array[ base + LID + L ] = localBlock[ OFFSET(LID + L) ] + b;
 }
 
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-__kernel void Scan_WorkEfficientAdd(__global uint* higherLevelArray, __global uint* array, __local uint* localBlock) 
+// Adds the scanned block totals of the higher level to the blocks of this level (Figure 14).
+// Group g handles block g + 1 (block 0 needs no correction), every work-item two elements.
+__kernel void Scan_WorkEfficientAdd(__global uint* higherLevelArray, __global uint* array, uint N) 
 {
-	// TO DO: Kernel implementation (large arrays)
-	// Kernel that should add the group PPS to the local PPS (Figure 14)
-	
-	int GID = get_global_id(0) ;
-	int LID = get_local_id(0) ;
-	int GPID = get_group_id(0) ;
-	
-	int idx = ( GPID + 1 ) * get_local_size(0) + LID;
-	
-	if( idx < get_global_size(0) )
+	int LID = get_local_id(0);
+	int GPID = get_group_id(0);
+	int L = get_local_size(0);
+
+	uint idx = (GPID + 1) * L * 2 + LID;
+	uint sum = higherLevelArray[ GPID ];
+
+	if(idx < N)
+		array[ idx ] += sum;
+	if(idx + L < N)
+		array[ idx + L ] += sum;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Single-pass scan with decoupled look-back. Every work-group scans a tile of local_size * ITEMS_PER_THREAD
+// elements, publishes the tile total (aggregate) and, once the prefix of all preceding tiles is known, its
+// inclusive prefix. The exclusive prefix of a tile is found by walking back over the preceding tiles, adding
+// aggregates until a tile with an inclusive prefix is reached.
+//
+// Tickets and epochs, SegmentedReduction.cl and CompactPrimitive.cl chain their tiles the same way:
+//	- Tiles are numbered in the order the work-groups start: work-item 0 draws the tile index from an atomic
+//	  ticket counter. A tile only waits for tiles with lower tickets, which belong to groups that are already
+//	  running. This relies on the device keeping those groups running, so the host only uses the look-back on
+//	  GPUs and falls back to the hierarchical scan otherwise.
+//	- Once the last tile has its ticket, all tickets of the launch are drawn and it resets the counter for the
+//	  next launch.
+//	- The host increments the epoch before every launch and a tile flag holds the epoch of the launch that
+//	  wrote it. Flags left over from earlier launches never match, so the flags only have to start below the
+//	  first epoch and are never cleared.
+//
+// localBlock holds (ITEMS_PER_THREAD + 1) * local_size elements.
+
+#ifndef ITEMS_PER_THREAD
+#define ITEMS_PER_THREAD 8
+#endif
+
+#define STATUS_AGGREGATE(epoch)	(2 * (epoch))
+#define STATUS_PREFIX(epoch)	(2 * (epoch) + 1)
+
+__kernel void Scan_DecoupledLookBack(__global uint* array, uint N, __global uint* tileCounter, volatile __global uint* tileFlags,
+	volatile __global uint* tileAggregate, volatile __global uint* tilePrefix, uint epoch, __local uint* localBlock)
+{
+	__local uint tileIndex;
+	__local uint exclusivePrefix;
+
+	uint LID = get_local_id(0);
+	uint L = get_local_size(0);
+	uint nTiles = (N + L * ITEMS_PER_THREAD - 1) / (L * ITEMS_PER_THREAD);
+
+	if(LID == 0)
+		tileIndex = atomic_inc(tileCounter);
+	barrier(CLK_LOCAL_MEM_FENCE);
+	uint tile = tileIndex;
+
+	// coalesced load of the tile, padded with 0
+	uint base = tile * L * ITEMS_PER_THREAD;
+	for(uint k = 0; k < ITEMS_PER_THREAD; k++)
 	{
-		localBlock[ LID ] = array[ idx ] ;
-	
-		array[ idx ] = localBlock[ LID ] + higherLevelArray[ GPID ] ;
-	//	array[ idx ] = 0 ;
+		uint i = base + k * L + LID;
+		localBlock[ k * L + LID ] = (i < N) ? array[ i ] : 0;
 	}
-	
-	
-	
-	
-	
-	
-	
-	
-	
-	
-	
-	
-	
-	
-	
-	
-	
-	
-	
-	
-	
-	
-}
\ No newline at end of file
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// every work-item scans ITEMS_PER_THREAD consecutive elements serially
+	__local uint* threadSums = localBlock + L * ITEMS_PER_THREAD;
+	uint sum = 0;
+	for(uint k = 0; k < ITEMS_PER_THREAD; k++)
+	{
+		sum += localBlock[ LID * ITEMS_PER_THREAD + k ];
+		localBlock[ LID * ITEMS_PER_THREAD + k ] = sum;
+	}
+	threadSums[ LID ] = sum;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// inclusive scan of the per work-item sums
+	for(uint offset = 1; offset < L; offset *= 2)
+	{
+		uint left = (LID >= offset) ? threadSums[ LID - offset ] : 0;
+		barrier(CLK_LOCAL_MEM_FENCE);
+		threadSums[ LID ] += left;
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	if(LID == 0)
+	{
+		uint tileSum = threadSums[ L - 1 ];
+		uint prefix = 0;
+
+		if(tile > 0)
+		{
+			tileAggregate[ tile ] = tileSum;
+			mem_fence(CLK_GLOBAL_MEM_FENCE);
+			tileFlags[ tile ] = STATUS_AGGREGATE(epoch);
+
+			// look-back, tile 0 always publishes its prefix so the walk ends there at the latest
+			int pred = tile - 1;
+			for(;;)
+			{
+				uint flag = tileFlags[ pred ];
+				if(flag == STATUS_PREFIX(epoch))
+				{
+					mem_fence(CLK_GLOBAL_MEM_FENCE);
+					prefix += tilePrefix[ pred ];
+					break;
+				}
+				if(flag == STATUS_AGGREGATE(epoch))
+				{
+					mem_fence(CLK_GLOBAL_MEM_FENCE);
+					prefix += tileAggregate[ pred ];
+					pred--;
+				}
+			}
+		}
+
+		tilePrefix[ tile ] = prefix + tileSum;
+		mem_fence(CLK_GLOBAL_MEM_FENCE);
+		tileFlags[ tile ] = STATUS_PREFIX(epoch);
+
+		exclusivePrefix = prefix;
+
+		// reset the ticket counter for the next launch
+		if(tile == nTiles - 1)
+			*tileCounter = 0;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	uint offset = exclusivePrefix + ((LID > 0) ? threadSums[ LID - 1 ] : 0);
+	for(uint k = 0; k < ITEMS_PER_THREAD; k++)
+		localBlock[ LID * ITEMS_PER_THREAD + k ] += offset;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for(uint k = 0; k < ITEMS_PER_THREAD; k++)
+	{
+		uint i = base + k * L + LID;
+		if(i < N)
+			array[ i ] = localBlock[ k * L + LID ];
+	}
+}
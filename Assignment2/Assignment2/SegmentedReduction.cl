@@ -0,0 +1,286 @@
+
+// Segmented reduction in a single pass. ReductionOps.cl (prepended by the host) defines the
+// element type and the operator. BLOCK_SIZE is the work-group size, ITEMS_PER_THREAD the
+// number of work units every work-item processes.
+//
+// Load balancing: every work-group processes a tile of exactly BLOCK_SIZE * ITEMS_PER_THREAD
+// work units, independent of the segment lengths. With CSR offsets a unit is either an element
+// or the end of a segment (merge path over the segment ends and the element indices), so
+// many empty segments are balanced as well as very long ones.
+//
+// Segments that cross tile boundaries need the state of the preceding tiles: the value of the
+// segment that is still open and the number of segment ends so far. With LOOK_BACK (set by the
+// host on GPUs) this is a chained scan in a single pass: each tile waits for the state of its
+// predecessor, combines it and publishes its own state. Tiles are numbered with tickets and
+// their flags hold epochs, see Scan_DecoupledLookBack in Scan.cl. Without LOOK_BACK no tile
+// waits for another one: the kernels run twice, the first pass (statesOnly) only stores the
+// local state of every tile, CombineTiles turns these into the states before every tile and
+// the second pass reads them and writes the results.
+
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE 128
+#endif
+
+#ifndef ITEMS_PER_THREAD
+#define ITEMS_PER_THREAD 8
+#endif
+
+#define TILE_ITEMS (BLOCK_SIZE * ITEMS_PER_THREAD)
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Per tile data in local memory
+typedef struct
+{
+	ACC		carry[BLOCK_SIZE];		// value of the segment open at the end of a work-item's range
+	uint	nEnds[BLOCK_SIZE];		// number of segment ends in a work-item's range
+	uint	endsBefore[BLOCK_SIZE];	// exclusive scan of nEnds
+	ACC		predCarry;				// state of the preceding tile
+	uint	predPrefix;
+	uint	tile;
+} TileData;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Work-item 0 draws the tile ticket (see Scan.cl), without LOOK_BACK the tiles are the work-groups
+uint AcquireTile(__global uint* tileCounter, __local TileData* tileData)
+{
+#ifdef LOOK_BACK
+	if(get_local_id(0) == 0)
+		tileData->tile = atomic_inc(tileCounter);
+	barrier(CLK_LOCAL_MEM_FENCE);
+	return tileData->tile;
+#else
+	return get_group_id(0);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Combines the per work-item results of a tile with the state of the preceding tile and
+// publishes the state of this tile. Called by all work-items after carry / nEnds are set.
+// Without LOOK_BACK the first pass (statesOnly) stores the local state of the tile, the
+// second one reads the state before the tile computed by CombineTiles.
+void ChainTile(uint tile, uint nTiles, uint epoch, uint statesOnly, __global uint* tileCounter, volatile __global uint* tileFlags,
+	__global uint* tilePrefix, __global ACC* tileCarry, __local TileData* tileData)
+{
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if(get_local_id(0) == 0)
+	{
+		// the local part is short compared to the tile, it is done serially
+		uint tileEnds = 0;
+		for(uint t = 0; t < BLOCK_SIZE; t++)
+		{
+			tileData->endsBefore[t] = tileEnds;
+			tileEnds += tileData->nEnds[t];
+		}
+
+		// value of the segment open at the end of this tile, without the preceding tiles
+		ACC carry = Identity();
+		int t = BLOCK_SIZE - 1;
+		for(; t >= 0; t--)
+		{
+			carry = Combine(tileData->carry[t], carry);
+			if(tileData->nEnds[t] > 0)
+				break;
+		}
+
+		ACC predCarry = Identity();
+		uint predPrefix = 0;
+#ifdef LOOK_BACK
+		if(tile > 0)
+		{
+			while(tileFlags[tile - 1] != epoch)
+				;
+			predCarry = LoadPartial(tileCarry, tile - 1);
+			predPrefix = ((volatile __global uint*)tilePrefix)[tile - 1];
+		}
+
+		// the open segment started before this tile if no segment ends in it
+		if(t < 0)
+			carry = Combine(predCarry, carry);
+
+		tilePrefix[tile] = predPrefix + tileEnds;
+		tileCarry[tile] = carry;
+		mem_fence(CLK_GLOBAL_MEM_FENCE);
+		tileFlags[tile] = epoch;
+
+		// ticket counter reset, see Scan.cl
+		if(tile == nTiles - 1)
+			*tileCounter = 0;
+#else
+		if(statesOnly)
+		{
+			tilePrefix[tile] = tileEnds;
+			tileCarry[tile] = carry;
+		}
+		else
+		{
+			predPrefix = tilePrefix[tile];
+			predCarry = tileCarry[tile];
+		}
+#endif
+
+		tileData->predCarry = predCarry;
+		tileData->predPrefix = predPrefix;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Without LOOK_BACK, between the two passes: replaces the local state of every tile (number of segment ends,
+// value of the segment open at its end) by the state before the tile. One work-item, there are few tiles.
+__kernel void CombineTiles(__global uint* tilePrefix, __global ACC* tileCarry, uint nTiles)
+{
+	uint prefix = 0;
+	ACC carry = Identity();
+	for(uint tile = 0; tile < nTiles; tile++)
+	{
+		uint tileEnds = tilePrefix[tile];
+		ACC tileValue = tileCarry[tile];
+		tilePrefix[tile] = prefix;
+		tileCarry[tile] = carry;
+
+		prefix += tileEnds;
+		carry = (tileEnds > 0) ? tileValue : Combine(carry, tileValue);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Value of the first segment that ends in the range of this work-item: the carries of the preceding
+// work-items (and tiles) that belong to the same segment, combined with FirstValue
+ACC CompleteFirstSegment(ACC FirstValue, __local TileData* tileData)
+{
+	ACC value = FirstValue;
+	int t = (int)get_local_id(0) - 1;
+	for(; t >= 0; t--)
+	{
+		value = Combine(tileData->carry[t], value);
+		if(tileData->nEnds[t] > 0)
+			return value;
+	}
+	return Combine(tileData->predCarry, value);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Number of segment ends that precede merge path diagonal Diagonal. Ends are at segmentEnd[x] = offsets[x + 1],
+// an element y comes before the end of segment x if y < offsets[x + 1].
+uint MergePathSearch(uint Diagonal, const __global uint* offsets, uint S, uint N)
+{
+	uint lo = Diagonal > N ? Diagonal - N : 0;
+	uint hi = min(Diagonal, S);
+	while(lo < hi)
+	{
+		uint mid = (lo + hi) / 2;
+		if(offsets[mid + 1] <= Diagonal - mid - 1)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// One result per segment, segment s covers values[offsets[s] .. offsets[s + 1]), offsets has S + 1 entries.
+// Empty segments produce Identity().
+__kernel __attribute__((reqd_work_group_size(BLOCK_SIZE, 1, 1)))
+void SegmentedReduceCSR(const __global VALUE_T* values, const __global uint* offsets, uint N, uint S,
+	__global ACC* results, __global uint* tileCounter, volatile __global uint* tileFlags, __global uint* tilePrefix,
+	__global ACC* tileCarry, uint epoch, uint statesOnly)
+{
+	__local TileData tileData;
+
+	uint LID = get_local_id(0);
+	uint total = N + S;
+	uint nTiles = (total + TILE_ITEMS - 1) / TILE_ITEMS;
+	uint tile = AcquireTile(tileCounter, &tileData);
+
+	// the range of this work-item on the merge path
+	uint d0 = min(tile * TILE_ITEMS + LID * ITEMS_PER_THREAD, total);
+	uint d1 = min(d0 + ITEMS_PER_THREAD, total);
+	uint x = MergePathSearch(d0, offsets, S, N);
+	uint y = d0 - x;
+	uint firstSegment = x;
+
+	uint nEnds = 0;
+	ACC acc = Identity();
+	ACC firstValue = Identity();
+	for(uint d = d0; d < d1; d++)
+	{
+		if(y < offsets[x + 1])
+		{
+			acc = Combine(acc, Load(values[y], y));
+			y++;
+		}
+		else
+		{
+			// segments that start and end within this range are complete
+			if(nEnds == 0)
+				firstValue = acc;
+			else if(!statesOnly)
+				results[x] = acc;
+			nEnds++;
+			acc = Identity();
+			x++;
+		}
+	}
+
+	tileData.carry[LID] = acc;
+	tileData.nEnds[LID] = nEnds;
+	ChainTile(tile, nTiles, epoch, statesOnly, tileCounter, tileFlags, tilePrefix, tileCarry, &tileData);
+	if(statesOnly)
+		return;
+
+	if(nEnds > 0)
+		results[firstSegment] = CompleteFirstSegment(firstValue, &tileData);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reduce-by-key: runs of equal consecutive keys form the segments. Writes the key and the value of
+// every run in order and the number of runs to *segmentCount.
+__kernel __attribute__((reqd_work_group_size(BLOCK_SIZE, 1, 1)))
+void ReduceByKey(const __global VALUE_T* values, const __global uint* keys, uint N,
+	__global uint* resultKeys, __global ACC* results, __global uint* segmentCount,
+	__global uint* tileCounter, volatile __global uint* tileFlags, __global uint* tilePrefix,
+	__global ACC* tileCarry, uint epoch, uint statesOnly)
+{
+	__local TileData tileData;
+
+	uint LID = get_local_id(0);
+	uint nTiles = (N + TILE_ITEMS - 1) / TILE_ITEMS;
+	uint tile = AcquireTile(tileCounter, &tileData);
+
+	uint y0 = min(tile * TILE_ITEMS + LID * ITEMS_PER_THREAD, N);
+	uint y1 = min(y0 + ITEMS_PER_THREAD, N);
+
+	// the ends are kept in registers until their output positions are known
+	ACC endValues[ITEMS_PER_THREAD];
+	uint endIndices[ITEMS_PER_THREAD];
+	uint nEnds = 0;
+	ACC acc = Identity();
+	for(uint y = y0; y < y1; y++)
+	{
+		acc = Combine(acc, Load(values[y], y));
+		if(y == N - 1 || keys[y] != keys[y + 1])
+		{
+			endValues[nEnds] = acc;
+			endIndices[nEnds] = y;
+			nEnds++;
+			acc = Identity();
+		}
+	}
+
+	tileData.carry[LID] = acc;
+	tileData.nEnds[LID] = nEnds;
+	ChainTile(tile, nTiles, epoch, statesOnly, tileCounter, tileFlags, tilePrefix, tileCarry, &tileData);
+	if(statesOnly)
+		return;
+
+	uint outIndex = tileData.predPrefix + tileData.endsBefore[LID];
+	for(uint k = 0; k < nEnds; k++)
+	{
+		resultKeys[outIndex + k] = keys[endIndices[k]];
+		results[outIndex + k] = (k == 0) ? CompleteFirstSegment(endValues[0], &tileData) : endValues[k];
+	}
+
+	if(tile == nTiles - 1 && LID == BLOCK_SIZE - 1)
+		*segmentCount = tileData.predPrefix + tileData.endsBefore[LID] + nEnds;
+}
@@ -0,0 +1,68 @@
+
+// Generic single-pass reduction. ReductionOps.cl (prepended by the host) defines the
+// element type and the operator, BLOCK_SIZE is the work-group size (power of two).
+
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE 128
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tree reduction of one accumulator per work-item, the result is valid in work-item 0
+ACC ReduceBlock(ACC acc, __local ACC* localBlock)
+{
+	uint LID = get_local_id(0);
+
+	localBlock[LID] = acc;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	#pragma unroll
+	for(uint stride = BLOCK_SIZE / 2; stride > 0; stride >>= 1)
+	{
+		if(LID < stride)
+			localBlock[LID] = acc = Combine(acc, localBlock[LID + stride]);
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	return acc;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Same scheme as Reduction_SinglePass: grid-stride accumulation, one partial per group,
+// the last group combines the partials into partials[0] and resets the counter.
+__kernel __attribute__((reqd_work_group_size(BLOCK_SIZE, 1, 1)))
+void TypedReduction(const __global VALUE_T* inArray, __global ACC* partials, __global uint* counter, uint N, __local ACC* localBlock)
+{
+	__local uint isLastGroup;
+
+	uint LID = get_local_id(0);
+	uint nGroups = get_num_groups(0);
+
+	ACC acc = Identity();
+	for(uint i = get_global_id(0); i < N; i += get_global_size(0))
+		acc = Combine(acc, Load(inArray[i], i));
+
+	acc = ReduceBlock(acc, localBlock);
+
+	if(LID == 0)
+	{
+		partials[get_group_id(0)] = acc;
+		mem_fence(CLK_GLOBAL_MEM_FENCE);
+		isLastGroup = (atomic_inc(counter) == nGroups - 1);
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if(!isLastGroup)
+		return;
+
+	acc = Identity();
+	for(uint i = LID; i < nGroups; i += BLOCK_SIZE)
+		acc = Combine(acc, LoadPartial(partials, i));
+
+	acc = ReduceBlock(acc, localBlock);
+
+	if(LID == 0)
+	{
+		partials[0] = acc;
+		*counter = 0;
+	}
+}
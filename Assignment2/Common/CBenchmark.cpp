@@ -0,0 +1,66 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CBenchmark.h"
+#include "CLUtil.h"
+#include "CTimer.h"
+
+#include <iostream>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CBenchmark
+
+bool CBenchmark::TimeGPU(cl_command_queue CommandQueue, const function<void()>& Run, double& Milliseconds,
+	unsigned int nIterations)
+{
+	// earlier commands are not part of the measurement
+	V_RETURN_FALSE_CL(clFinish(CommandQueue), "Error finishing the queue!");
+
+	CTimer timer;
+	timer.Start();
+
+	for(unsigned int i = 0; i < nIterations; i++)
+		Run();
+
+	V_RETURN_FALSE_CL(clFinish(CommandQueue), "Error finishing the queue!");
+	timer.Stop();
+
+	Milliseconds = timer.GetElapsedMilliseconds() / double(nIterations);
+	return true;
+}
+
+double CBenchmark::TimeCPU(const function<void()>& Run)
+{
+	CTimer timer;
+	timer.Start();
+	Run();
+	timer.Stop();
+	return timer.GetElapsedMilliseconds();
+}
+
+void CBenchmark::PrintGPU(const string& Label, double Milliseconds, double Elements, double Bytes)
+{
+	cout<<Label<<": "<<Milliseconds<<" ms";
+	if(Elements > 0.0)
+		cout<<", "<<1.0e-6 * Elements / Milliseconds<<" Gelem/s";
+	if(Bytes > 0.0)
+		cout<<", "<<1.0e-6 * Bytes / Milliseconds<<" GB/s";
+	cout<<endl;
+}
+
+void CBenchmark::PrintCPU(const string& Label, double Milliseconds, double Elements)
+{
+	cout<<"  "<<Label<<": "<<Milliseconds<<" ms";
+	if(Elements > 0.0)
+		cout<<", "<<1.0e-6 * Elements / Milliseconds<<" Gelem/s";
+	cout<<endl;
+}
+
+void CBenchmark::PrintKeys(const string& Label, double Milliseconds, double Keys, bool Host)
+{
+	cout<<(Host ? "  " : "")<<Label<<": "<<Milliseconds<<" ms, "<<1.0e-3 * Keys / Milliseconds<<" Mkeys/s"<<endl;
+}
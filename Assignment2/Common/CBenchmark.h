@@ -0,0 +1,112 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CBENCHMARK_H
+#define _CBENCHMARK_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif 
+
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+//! Timing, throughput output and random input of the primitive benchmarks
+/*!
+	The tasks of the primitives (typed and segmented reductions, scans, radix
+	sort, compaction, top-k) only differ in what they enqueue and how they
+	validate the result, the measurement is the same for all of them: the
+	enqueued work is repeated between two clFinish() calls and the average
+	time is printed with the element and byte rates (keys for the sorts). The
+	CPU references are timed once.
+*/
+class CBenchmark
+{
+public:
+	//! Average time of Run() in ms over nIterations calls enqueued back to back
+	static bool TimeGPU(cl_command_queue CommandQueue, const std::function<void()>& Run, double& Milliseconds,
+		unsigned int nIterations = 100);
+
+	//! Time of a single call of Run() in ms
+	static double TimeCPU(const std::function<void()>& Run);
+
+	//! Prints "Label: t ms, x Gelem/s, y GB/s", a rate is left out when Elements or Bytes is 0
+	static void PrintGPU(const std::string& Label, double Milliseconds, double Elements, double Bytes = 0.0);
+
+	//! Prints "  Label: t ms, x Gelem/s" for a HOST implementation, without the rate when Elements is 0
+	static void PrintCPU(const std::string& Label, double Milliseconds, double Elements = 0.0);
+
+	//! Prints "Label: t ms, x Mkeys/s", the rate the sorts and selections are compared by, indented if Host
+	static void PrintKeys(const std::string& Label, double Milliseconds, double Keys, bool Host = false);
+
+	//! Uniform over all bits of the integer type T
+	template <typename T>
+	static T RandomBits()
+	{
+		T value = 0;
+		for(size_t b = 0; b < sizeof(T); b++)
+			value = T(value << 8) | T(rand() & 0xFF);
+		return value;
+	}
+
+	//! Integers in [-1000, 1000] ([0, 1000) if unsigned), floating point values in [-1, 1]
+	template <typename T>
+	static T RandomValue()
+	{
+		if(!std::numeric_limits<T>::is_integer)
+			return T(2.0 * rand() / double(RAND_MAX) - 1.0);
+		return std::numeric_limits<T>::is_signed ? T(rand() % 2001 - 1000) : T(rand() % 1000);
+	}
+
+	//! Integers in [-8, 8) ([0, 16) if unsigned), floating point multiples of 1/4 in [0, 4), sums of these stay exact
+	template <typename T>
+	static T RandomSmall()
+	{
+		if(!std::numeric_limits<T>::is_integer)
+			return T(rand() & 15) * T(0.25);
+		return std::numeric_limits<T>::is_signed ? T((rand() & 15) - 8) : T(rand() & 15);
+	}
+
+	//! 1 with a probability of 1 / OneIn, 0 otherwise
+	static cl_uint RandomFlag(unsigned int OneIn)
+	{
+		return rand() % OneIn == 0 ? 1 : 0;
+	}
+
+	//! Resizes Data to N elements generated by Generate()
+	template <typename T, typename Generator>
+	static void Fill(std::vector<T>& Data, size_t N, Generator Generate)
+	{
+		Data.resize(N);
+		for(size_t i = 0; i < N; i++)
+			Data[i] = Generate();
+	}
+};
+
+#endif // _CBENCHMARK_H
@@ -0,0 +1,152 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CDEVICE_PRIMITIVES_H
+#define _CDEVICE_PRIMITIVES_H
+
+#include "CScanPrimitive.h"
+#include "CRadixSort.h"
+#include "CCompactPrimitive.h"
+#include "CTopKPrimitive.h"
+
+#include <map>
+
+//! Version of the primitives API, bumped whenever the functions below change
+#define DEVICE_PRIMITIVES_VERSION	5
+
+//! Data-parallel building blocks on device buffers, shared by the assignments
+/*!
+	One object per device and context. The kernels for a combination of element
+	type, operator and mode (key type for Sort() and TopK(), type and predicate
+	for the compactions) are built on first use and kept, together with their
+	temporary buffers, until Release(). Init() selects the work-group size from
+	the device limits. The number of elements per work-item is chosen for every
+	primitive so that its tiles, including those of its internal scans, fit into
+	half of the local memory. Sort() only uses 8-bit digits if the local buffers
+	of the scatter fit as well.
+
+	All functions only enqueue commands, they return false if that fails.
+*/
+class CDevicePrimitives
+{
+public:
+	enum EType
+	{
+		UINT,
+		INT,
+		FLOAT,
+		ULONG
+	};
+
+	enum EOperator
+	{
+		SUM,
+		MIN,
+		MAX
+	};
+
+	CDevicePrimitives();
+
+	virtual ~CDevicePrimitives();
+
+	bool Init(cl_device_id Device, cl_context Context);
+
+	void Release();
+
+	static int GetVersion() { return DEVICE_PRIMITIVES_VERSION; }
+
+	//! Combines the N > 0 elements of In, the result is written to the first element of Result
+	bool Reduce(cl_command_queue CommandQueue, cl_mem In, size_t N, EType Type, EOperator Operator, cl_mem Result);
+
+	//! Inclusive or exclusive scan of N elements from In to Out (In == Out is allowed)
+	/*!
+		With HeadFlags (one cl_uint per element) the scan restarts at every element with a non-zero flag.
+	*/
+	bool Scan(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, size_t N, EType Type, EOperator Operator,
+		bool Exclusive = false, cl_mem HeadFlags = NULL);
+
+	//! Stable sort of N cl_uint (or with Keys64 cl_ulong) keys in place, Values (cl_uint, may be NULL) are moved with them
+	/*!
+		Only the lowest KeyBits bits are sorted (0 = all bits), all keys must be smaller than 2^KeyBits then.
+	*/
+	bool Sort(cl_command_queue CommandQueue, cl_mem Keys, cl_mem Values, size_t N, bool Keys64 = false, unsigned int KeyBits = 0);
+
+	//! Stream compaction (or with Partition a stable partition) of N elements of ElementSize bytes
+	/*!
+		Elements with a non-zero flag (one cl_uint per element) are kept. ElementSize is 1, 2, 4, 8, 16, 32 or 64,
+		In and Out must not overlap. The number of kept elements is written to Count (may be NULL).
+	*/
+	bool Compact(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, size_t N, size_t ElementSize, cl_mem Flags,
+		cl_mem Count = NULL, bool Partition = false);
+
+	//! Compacts In to Out and In2 to Out2 (N elements of ElementSize bytes each) by the same flags in one pass
+	/*!
+		The flags are evaluated and scanned once for both arrays, e.g. for the arrays of a structure of arrays.
+	*/
+	bool CompactPair(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, cl_mem In2, cl_mem Out2, size_t N, size_t ElementSize,
+		cl_mem Flags, cl_mem Count = NULL);
+
+	//! Like Compact(), but the elements are kept if Predicate, an OpenCL expression of the element x (of type Type) and its index i, holds
+	bool CompactIf(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, size_t N, const std::string& Type, const std::string& Predicate,
+		cl_mem Count = NULL, bool Partition = false);
+
+	//! The K largest of N cl_uint (or with Keys64 cl_ulong) keys and their Values (may be NULL) in descending order
+	/*!
+		OutKeys and OutValues hold at least K elements. Which of several keys equal to the K-th largest are taken is not specified.
+	*/
+	bool TopK(cl_command_queue CommandQueue, cl_mem Keys, cl_mem Values, size_t N, size_t K, cl_mem OutKeys, cl_mem OutValues,
+		bool Keys64 = false);
+
+	//! The descriptor used for a combination (for CScanPrimitive / ScanReference users)
+	static SScanDesc GetDesc(EType Type, EOperator Operator, bool Exclusive, bool Segmented);
+
+	size_t GetLocalWorkSize() const { return m_LocalWorkSize; }
+
+protected:
+	//! Largest number of elements per work-item (up to the maximum) whose tiles fit into half of the local memory
+	/*!
+		A tile needs BytesPerItem for each of its elements and for one more element per work-item.
+	*/
+	size_t GetItemsPerThread(size_t BytesPerItem) const;
+
+	//! Returns the (possibly new) primitive for a combination, NULL if it could not be built
+	CScanPrimitive* GetPrimitive(EType Type, EOperator Operator, bool Exclusive, bool Segmented);
+
+	//! Returns the (possibly new) radix sort for a combination, NULL if it could not be built
+	CRadixSort* GetRadixSort(bool Keys64, bool HasValues, unsigned int DigitBits);
+
+	//! Returns the (possibly new) compaction for a type and predicate, NULL if it could not be built
+	CCompactPrimitive* GetCompaction(const std::string& Type, const std::string& Predicate);
+
+	//! Returns the (possibly new) top-k selection for a combination, NULL if it could not be built
+	CTopKPrimitive* GetTopK(bool Keys64, bool HasValues);
+
+	cl_device_id					m_Device;
+	cl_context						m_Context;
+	size_t							m_LocalWorkSize;
+	cl_ulong						m_LocalMemSize;
+
+	std::map<int, CScanPrimitive*>	m_Primitives;
+	std::map<int, CRadixSort*>		m_RadixSorts;
+	std::map<std::string, CCompactPrimitive*>	m_Compactions;
+	std::map<int, CTopKPrimitive*>	m_TopKs;
+};
+
+#endif // _CDEVICE_PRIMITIVES_H
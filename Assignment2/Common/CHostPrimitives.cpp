@@ -0,0 +1,328 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CHostPrimitives.h"
+
+#include "CParallel.h"
+
+#include <vector>
+#include <algorithm>
+
+// the AVX2 kernels are compiled for their own target, the CPU is checked before they are called
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#include <immintrin.h>
+	#define HOST_HAS_AVX2		1
+	#define HOST_TARGET_AVX2	__attribute__((target("avx2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#include <immintrin.h>
+	#include <intrin.h>
+	#define HOST_HAS_AVX2		1
+	#define HOST_TARGET_AVX2
+#else
+	#define HOST_HAS_AVX2		0
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define HOST_HAS_SSE2		1
+#else
+	#define HOST_HAS_SSE2		0
+#endif
+
+// smaller arrays are not worth starting a thread
+#define HOST_PRIMITIVES_MIN_CHUNK	(1 << 16)
+// chunks start at multiples of a cache line
+#define HOST_PRIMITIVES_ALIGN		16
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// Kernels
+
+static unsigned int ReduceScalar(const unsigned int* In, size_t N)
+{
+	unsigned int s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	size_t i = 0;
+	for(; i + 4 <= N; i += 4)
+	{
+		s0 += In[i];
+		s1 += In[i + 1];
+		s2 += In[i + 2];
+		s3 += In[i + 3];
+	}
+	for(; i < N; i++)
+		s0 += In[i];
+	return s0 + s1 + s2 + s3;
+}
+
+static unsigned int ScanScalar(const unsigned int* In, unsigned int* Out, size_t N, unsigned int Carry, bool Exclusive)
+{
+	for(size_t i = 0; i < N; i++)
+	{
+		unsigned int x = In[i];
+		Carry += x;
+		Out[i] = Exclusive ? Carry - x : Carry;
+	}
+	return Carry;
+}
+
+#if HOST_HAS_SSE2
+
+static unsigned int ReduceSSE2(const unsigned int* In, size_t N)
+{
+	// independent accumulators hide the latency of the adds
+	__m128i s0 = _mm_setzero_si128(), s1 = s0, s2 = s0, s3 = s0;
+	size_t i = 0;
+	for(; i + 16 <= N; i += 16)
+	{
+		s0 = _mm_add_epi32(s0, _mm_loadu_si128((const __m128i*)(In + i)));
+		s1 = _mm_add_epi32(s1, _mm_loadu_si128((const __m128i*)(In + i + 4)));
+		s2 = _mm_add_epi32(s2, _mm_loadu_si128((const __m128i*)(In + i + 8)));
+		s3 = _mm_add_epi32(s3, _mm_loadu_si128((const __m128i*)(In + i + 12)));
+	}
+	for(; i + 4 <= N; i += 4)
+		s0 = _mm_add_epi32(s0, _mm_loadu_si128((const __m128i*)(In + i)));
+
+	__m128i s = _mm_add_epi32(_mm_add_epi32(s0, s1), _mm_add_epi32(s2, s3));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	return (unsigned int)_mm_cvtsi128_si32(s) + ReduceScalar(In + i, N - i);
+}
+
+static unsigned int ScanSSE2(const unsigned int* In, unsigned int* Out, size_t N, unsigned int Carry, bool Exclusive)
+{
+	__m128i carry = _mm_set1_epi32((int)Carry);
+	size_t i = 0;
+	for(; i + 4 <= N; i += 4)
+	{
+		// log2(4) shifted adds give the prefix sums of the register
+		__m128i x = _mm_loadu_si128((const __m128i*)(In + i));
+		__m128i s = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+		s = _mm_add_epi32(s, _mm_slli_si128(s, 8));
+		s = _mm_add_epi32(s, carry);
+		_mm_storeu_si128((__m128i*)(Out + i), Exclusive ? _mm_sub_epi32(s, x) : s);
+		carry = _mm_shuffle_epi32(s, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+
+	return ScanScalar(In + i, Out + i, N - i, (unsigned int)_mm_cvtsi128_si32(carry), Exclusive);
+}
+
+#endif // HOST_HAS_SSE2
+
+#if HOST_HAS_AVX2
+
+HOST_TARGET_AVX2 static unsigned int ReduceAVX2(const unsigned int* In, size_t N)
+{
+	__m256i s0 = _mm256_setzero_si256(), s1 = s0, s2 = s0, s3 = s0;
+	size_t i = 0;
+	for(; i + 32 <= N; i += 32)
+	{
+		s0 = _mm256_add_epi32(s0, _mm256_loadu_si256((const __m256i*)(In + i)));
+		s1 = _mm256_add_epi32(s1, _mm256_loadu_si256((const __m256i*)(In + i + 8)));
+		s2 = _mm256_add_epi32(s2, _mm256_loadu_si256((const __m256i*)(In + i + 16)));
+		s3 = _mm256_add_epi32(s3, _mm256_loadu_si256((const __m256i*)(In + i + 24)));
+	}
+	for(; i + 8 <= N; i += 8)
+		s0 = _mm256_add_epi32(s0, _mm256_loadu_si256((const __m256i*)(In + i)));
+
+	s0 = _mm256_add_epi32(_mm256_add_epi32(s0, s1), _mm256_add_epi32(s2, s3));
+	__m128i s = _mm_add_epi32(_mm256_castsi256_si128(s0), _mm256_extracti128_si256(s0, 1));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	return (unsigned int)_mm_cvtsi128_si32(s) + ReduceScalar(In + i, N - i);
+}
+
+HOST_TARGET_AVX2 static unsigned int ScanAVX2(const unsigned int* In, unsigned int* Out, size_t N, unsigned int Carry, bool Exclusive)
+{
+	__m256i carry = _mm256_set1_epi32((int)Carry);
+	const __m256i last = _mm256_set1_epi32(7);
+	size_t i = 0;
+	for(; i + 8 <= N; i += 8)
+	{
+		// the byte shifts only work within the 128 bit lanes, the total of the lower lane is added to the upper one afterwards
+		__m256i x = _mm256_loadu_si256((const __m256i*)(In + i));
+		__m256i s = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+		s = _mm256_add_epi32(s, _mm256_slli_si256(s, 8));
+		__m256i lower = _mm256_permute2x128_si256(s, s, 0x08);
+		s = _mm256_add_epi32(s, _mm256_shuffle_epi32(lower, _MM_SHUFFLE(3, 3, 3, 3)));
+		s = _mm256_add_epi32(s, carry);
+		_mm256_storeu_si256((__m256i*)(Out + i), Exclusive ? _mm256_sub_epi32(s, x) : s);
+		carry = _mm256_permutevar8x32_epi32(s, last);
+	}
+
+	return ScanScalar(In + i, Out + i, N - i, (unsigned int)_mm_cvtsi128_si32(_mm256_castsi256_si128(carry)), Exclusive);
+}
+
+#endif // HOST_HAS_AVX2
+
+///////////////////////////////////////////////////////////////////////////////
+// CHostPrimitives
+
+CHostPrimitives::EISA CHostPrimitives::GetBestISA()
+{
+	if(IsSupported(AVX2))
+		return AVX2;
+	if(IsSupported(SSE2))
+		return SSE2;
+	return SCALAR;
+}
+
+bool CHostPrimitives::IsSupported(EISA ISA)
+{
+	switch(ISA)
+	{
+	case SSE2:
+		return HOST_HAS_SSE2 != 0;
+	case AVX2:
+#if HOST_HAS_AVX2 && defined(_MSC_VER)
+		{
+			// AVX2 in the CPU, AVX (and XSAVE) enabled by the OS
+			static const bool supported = []()
+			{
+				int info[4];
+				__cpuid(info, 0);
+				if(info[0] < 7)
+					return false;
+				__cpuid(info, 1);
+				if((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+					return false;
+				__cpuidex(info, 7, 0);
+				return (info[1] & (1 << 5)) != 0;
+			}();
+			return supported;
+		}
+#elif HOST_HAS_AVX2
+		return __builtin_cpu_supports("avx2") != 0;
+#else
+		return false;
+#endif
+	default:
+		return true;
+	}
+}
+
+const char* CHostPrimitives::GetName(EISA ISA)
+{
+	switch(ISA)
+	{
+	case SSE2:
+		return "SSE2";
+	case AVX2:
+		return "AVX2";
+	default:
+		return "scalar";
+	}
+}
+
+unsigned int CHostPrimitives::Reduce(const unsigned int* In, size_t N, EISA ISA, unsigned int ThreadCount)
+{
+	if(!IsSupported(ISA))
+		ISA = GetBestISA();
+
+	size_t nThreads = ThreadCount > 0 ? ThreadCount : CParallel::GetThreadCount();
+	size_t nChunks = max<size_t>(1, min<size_t>(nThreads, N / HOST_PRIMITIVES_MIN_CHUNK));
+	size_t chunk = (N + nChunks - 1) / nChunks;
+	chunk = (chunk + HOST_PRIMITIVES_ALIGN - 1) / HOST_PRIMITIVES_ALIGN * HOST_PRIMITIVES_ALIGN;
+
+	vector<unsigned int> sums(nChunks, 0);
+	CParallel::For(0, nChunks, [&](size_t First, size_t Last)
+	{
+		for(size_t c = First; c < Last; c++)
+		{
+			size_t begin = min(N, c * chunk);
+			sums[c] = ReduceChunk(In + begin, min(N, begin + chunk) - begin, ISA);
+		}
+	}, (unsigned int)nChunks);
+
+	unsigned int sum = 0;
+	for(size_t c = 0; c < nChunks; c++)
+		sum += sums[c];
+	return sum;
+}
+
+void CHostPrimitives::Scan(const unsigned int* In, unsigned int* Out, size_t N, bool Exclusive, EISA ISA, unsigned int ThreadCount)
+{
+	if(!IsSupported(ISA))
+		ISA = GetBestISA();
+
+	size_t nThreads = ThreadCount > 0 ? ThreadCount : CParallel::GetThreadCount();
+	size_t nChunks = max<size_t>(1, min<size_t>(nThreads, N / HOST_PRIMITIVES_MIN_CHUNK));
+	if(nChunks == 1)
+	{
+		ScanChunk(In, Out, N, 0, Exclusive, ISA);
+		return;
+	}
+
+	size_t chunk = (N + nChunks - 1) / nChunks;
+	chunk = (chunk + HOST_PRIMITIVES_ALIGN - 1) / HOST_PRIMITIVES_ALIGN * HOST_PRIMITIVES_ALIGN;
+
+	// 1. chunk sums (the last chunk is not needed)
+	vector<unsigned int> offsets(nChunks, 0);
+	CParallel::For(0, nChunks - 1, [&](size_t First, size_t Last)
+	{
+		for(size_t c = First; c < Last; c++)
+		{
+			size_t begin = min(N, c * chunk);
+			offsets[c] = ReduceChunk(In + begin, min(N, begin + chunk) - begin, ISA);
+		}
+	}, (unsigned int)(nChunks - 1));
+
+	// 2. exclusive scan of the chunk sums
+	unsigned int sum = 0;
+	for(size_t c = 0; c < nChunks; c++)
+	{
+		unsigned int s = offsets[c];
+		offsets[c] = sum;
+		sum += s;
+	}
+
+	// 3. every chunk is scanned starting at its offset
+	CParallel::For(0, nChunks, [&](size_t First, size_t Last)
+	{
+		for(size_t c = First; c < Last; c++)
+		{
+			size_t begin = min(N, c * chunk);
+			ScanChunk(In + begin, Out + begin, min(N, begin + chunk) - begin, offsets[c], Exclusive, ISA);
+		}
+	}, (unsigned int)nChunks);
+}
+
+unsigned int CHostPrimitives::ReduceChunk(const unsigned int* In, size_t N, EISA ISA)
+{
+	switch(ISA)
+	{
+#if HOST_HAS_AVX2
+	case AVX2:
+		return ReduceAVX2(In, N);
+#endif
+#if HOST_HAS_SSE2
+	case SSE2:
+		return ReduceSSE2(In, N);
+#endif
+	default:
+		return ReduceScalar(In, N);
+	}
+}
+
+unsigned int CHostPrimitives::ScanChunk(const unsigned int* In, unsigned int* Out, size_t N, unsigned int Carry, bool Exclusive, EISA ISA)
+{
+	switch(ISA)
+	{
+#if HOST_HAS_AVX2
+	case AVX2:
+		return ScanAVX2(In, Out, N, Carry, Exclusive);
+#endif
+#if HOST_HAS_SSE2
+	case SSE2:
+		return ScanSSE2(In, Out, N, Carry, Exclusive);
+#endif
+	default:
+		return ScanScalar(In, Out, N, Carry, Exclusive);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,71 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CHOST_PRIMITIVES_H
+#define _CHOST_PRIMITIVES_H
+
+#include <cstddef>
+
+//! Multithreaded SIMD reduction and scan of unsigned int arrays on the HOST
+/*!
+	The CPU counterpart of CDevicePrimitives for the SUM of cl_uint, used as the
+	fallback without an OpenCL device and as the CPU side of the benchmarks.
+
+	Both functions split the array into one chunk per thread (CParallel). The
+	scan runs in three phases: every thread reduces its chunk, the chunk sums
+	are scanned serially, then every thread scans its chunk starting at its
+	offset. Within a chunk the prefix sums are computed in registers with
+	shifted adds. The instruction set is chosen at run time, AVX2 needs no
+	special compiler flags.
+*/
+class CHostPrimitives
+{
+public:
+	enum EISA
+	{
+		SCALAR,
+		SSE2,
+		AVX2
+	};
+
+	//! The widest instruction set supported by the compiler and the CPU
+	static EISA GetBestISA();
+
+	static bool IsSupported(EISA ISA);
+
+	static const char* GetName(EISA ISA);
+
+	//! Sum of the N elements of In (modulo 2^32)
+	/*!
+		ThreadCount == 0 uses CParallel::GetThreadCount().
+	*/
+	static unsigned int Reduce(const unsigned int* In, size_t N, EISA ISA = GetBestISA(), unsigned int ThreadCount = 0);
+
+	//! Inclusive or exclusive prefix sum of N elements from In to Out (In == Out is allowed)
+	static void Scan(const unsigned int* In, unsigned int* Out, size_t N, bool Exclusive = false,
+		EISA ISA = GetBestISA(), unsigned int ThreadCount = 0);
+
+protected:
+	//! Single-threaded kernels for one chunk, ScanChunk() starts at Carry and returns the sum including Carry
+	static unsigned int ReduceChunk(const unsigned int* In, size_t N, EISA ISA);
+	static unsigned int ScanChunk(const unsigned int* In, unsigned int* Out, size_t N, unsigned int Carry, bool Exclusive, EISA ISA);
+};
+
+#endif // _CHOST_PRIMITIVES_H
@@ -0,0 +1,49 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CPARALLEL_H
+#define _CPARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+//! Minimal helper for data-parallel loops on the HOST
+/*!
+	The iteration range is split into one contiguous chunk per thread, the
+	calling thread processes the first chunk itself. This is meant for the
+	CPU reference implementations, which otherwise dominate the run time of
+	the bigger examples.
+*/
+class CParallel
+{
+public:
+	//! Number of hardware threads (at least 1)
+	static unsigned int GetThreadCount();
+
+	//! Calls Body(ChunkBegin, ChunkEnd) for disjoint chunks covering [Begin, End)
+	/*!
+		ThreadCount == 0 uses GetThreadCount(). Ranges smaller than MinChunkSize
+		per thread are processed with fewer threads.
+	*/
+	static void For(size_t Begin, size_t End, const std::function<void(size_t, size_t)>& Body,
+		unsigned int ThreadCount = 0, size_t MinChunkSize = 1);
+};
+
+#endif // _CPARALLEL_H
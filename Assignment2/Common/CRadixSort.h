@@ -0,0 +1,91 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CRADIX_SORT_H
+#define _CRADIX_SORT_H
+
+#include "CScanPrimitive.h"
+
+//! LSD radix sort of cl_uint or cl_ulong keys on device buffers, optionally with cl_uint values
+/*!
+	Every pass sorts by DigitBits (4 .. 8) bits: per-tile digit histograms are
+	counted in local memory, their exclusive scan (with CScanPrimitive) gives the
+	output position of every digit of every tile, and a stable scatter moves the
+	keys and values. The passes ping-pong between the user's buffers and internal
+	temporary buffers, which are allocated by the first Sort() call and reused as
+	long as N does not grow.
+
+	More digit bits mean fewer passes over the data, but larger histograms and
+	less coherent scatters.
+
+	The kernels are loaded from ../Common/RadixSort.cl (relative to the working
+	directory of the assignments).
+*/
+class CRadixSort
+{
+public:
+	//! LocalWorkSize must be a power of two
+	CRadixSort(bool Keys64 = false, bool HasValues = false, unsigned int DigitBits = 4,
+		size_t LocalWorkSize = 128, size_t ItemsPerThread = 8);
+
+	virtual ~CRadixSort();
+
+	bool Init(cl_device_id Device, cl_context Context);
+
+	void Release();
+
+	//! Sorts N keys (and the values with them) in place, the sort is stable
+	/*!
+		Only the lowest KeyBits bits are sorted (0 = all bits), all keys must be
+		smaller than 2^KeyBits then. Values is ignored without HasValues.
+		The commands are enqueued, not finished.
+	*/
+	bool Sort(cl_command_queue CommandQueue, cl_mem Keys, cl_mem Values, size_t N, unsigned int KeyBits = 0);
+
+	bool HasValues() const { return m_HasValues; }
+	size_t GetKeySize() const { return m_Keys64 ? sizeof(cl_ulong) : sizeof(cl_uint); }
+	unsigned int GetDigitBits() const { return m_DigitBits; }
+
+protected:
+	bool ReserveTemp(size_t N);
+	void ReleaseTemp();
+
+	bool				m_Keys64;
+	bool				m_HasValues;
+	unsigned int		m_DigitBits;
+	size_t				m_LocalWorkSize;
+	size_t				m_ItemsPerThread;
+	size_t				m_TileSize;
+
+	cl_context			m_Context;
+	cl_program			m_Program;
+	cl_kernel			m_HistogramKernel;
+	cl_kernel			m_ScatterKernel;
+
+	//! Exclusive sum over the digit histograms
+	CScanPrimitive		m_Scan;
+
+	size_t				m_TempCapacity;
+	cl_mem				m_dTempKeys;
+	cl_mem				m_dTempValues;
+	cl_mem				m_dHistograms;
+};
+
+#endif // _CRADIX_SORT_H
@@ -0,0 +1,209 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CSCAN_PRIMITIVE_H
+#define _CSCAN_PRIMITIVE_H
+
+// All OpenCL headers
+#if defined(WIN32)
+    #include <CL/opencl.h>
+#elif defined (__APPLE__) || defined(MACOSX)
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif 
+
+#include "CommonDefs.h"
+
+#include <string>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+//! Describes a scan: element type, operator and mode
+/*!
+	Combine is an OpenCL expression of the two operands a and b, it has to be
+	associative (not necessarily commutative). Identity is an OpenCL expression
+	with Combine(Identity, x) == x. Use MakeScanDesc() for the predefined operators.
+*/
+struct SScanDesc
+{
+	std::string	Name;			//!< only used for output
+	std::string	Type;			//!< OpenCL element type, e.g. "uint" or "ulong"
+	size_t		ElementSize;
+	std::string	Combine;
+	std::string	Identity;
+	bool		Exclusive;		//!< exclusive: element i gets the combination of the elements before i
+	bool		Segmented;		//!< restart at every element with a non-zero head flag
+};
+
+//! Scan (prefix sum with any associative operator) and reduction on device buffers
+/*!
+	Reduce-then-scan over tiles of LocalWorkSize * ItemsPerThread elements,
+	the tile totals are scanned recursively with the same kernels, so any N
+	is supported. Temporary buffers are allocated by the first Scan() call
+	and reused as long as N does not grow.
+
+	The kernels are loaded from ../Common/ScanPrimitive.cl (relative to the
+	working directory of the assignments).
+*/
+class CScanPrimitive
+{
+public:
+	//! LocalWorkSize must be a power of two
+	CScanPrimitive(const SScanDesc& Desc, size_t LocalWorkSize = 128, size_t ItemsPerThread = 8);
+
+	virtual ~CScanPrimitive();
+
+	//! Builds the program for the descriptor
+	bool Init(cl_device_id Device, cl_context Context);
+
+	void Release();
+
+	//! Scans N elements of In into Out (In == Out is allowed)
+	/*!
+		HeadFlags (one cl_uint per element, non-zero starts a segment) is only
+		used by segmented descriptors. The commands are enqueued, not finished.
+	*/
+	bool Scan(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, size_t N, cl_mem HeadFlags = NULL);
+
+	//! Combines all N > 0 elements of In into the first element of Result (not for segmented descriptors)
+	bool Reduce(cl_command_queue CommandQueue, cl_mem In, size_t N, cl_mem Result);
+
+	const SScanDesc& GetDesc() const { return m_Desc; }
+
+	//! The generated definitions that are prepended to ScanPrimitive.cl
+	std::string GetProgramHeader() const;
+
+protected:
+	bool ReduceTiles(cl_command_queue CommandQueue, cl_mem In, cl_mem HeadFlags, size_t N, cl_mem TileValues, cl_mem TileHeads);
+	bool ScanLevel(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, cl_mem HeadFlags, size_t N, unsigned int Level, cl_uint Mode);
+
+	//! Makes sure the tile buffers for N elements exist
+	bool ReserveTemp(size_t N);
+	void ReleaseTemp();
+
+	SScanDesc				m_Desc;
+	size_t					m_LocalWorkSize;
+	size_t					m_ItemsPerThread;
+	size_t					m_TileSize;
+
+	cl_context				m_Context;
+	cl_program				m_Program;
+	cl_kernel				m_ReduceKernel;
+	cl_kernel				m_ScanKernel;
+
+	// tile totals (and head flags of segmented scans) per recursion level
+	size_t					m_TempCapacity;
+	std::vector<cl_mem>		m_dTileValues;
+	std::vector<cl_mem>		m_dTileHeads;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Element types and operators
+
+template <typename T> struct CLScanType;
+
+template <> struct CLScanType<cl_uint>
+{
+	static const char* Name() { return "uint"; }
+	static const char* Lowest() { return "0"; }
+	static const char* Highest() { return "UINT_MAX"; }
+};
+
+template <> struct CLScanType<cl_int>
+{
+	static const char* Name() { return "int"; }
+	static const char* Lowest() { return "INT_MIN"; }
+	static const char* Highest() { return "INT_MAX"; }
+};
+
+template <> struct CLScanType<cl_float>
+{
+	static const char* Name() { return "float"; }
+	static const char* Lowest() { return "-FLT_MAX"; }
+	static const char* Highest() { return "FLT_MAX"; }
+};
+
+template <> struct CLScanType<cl_ulong>
+{
+	static const char* Name() { return "ulong"; }
+	static const char* Lowest() { return "0"; }
+	static const char* Highest() { return "ULONG_MAX"; }
+};
+
+//! Operators: the OpenCL expression for the kernels and the same operation on the host for the references
+template <typename T> struct SScanSumOp
+{
+	static const char* Name() { return "sum"; }
+	static std::string Combine() { return "a + b"; }
+	static std::string Identity() { return "0"; }
+	static T HostIdentity() { return T(0); }
+	T operator()(T A, T B) const { return A + B; }
+};
+
+template <typename T> struct SScanMaxOp
+{
+	static const char* Name() { return "max"; }
+	static std::string Combine() { return "max(a, b)"; }
+	static std::string Identity() { return CLScanType<T>::Lowest(); }
+	static T HostIdentity() { return std::numeric_limits<T>::lowest(); }
+	T operator()(T A, T B) const { return std::max(A, B); }
+};
+
+template <typename T> struct SScanMinOp
+{
+	static const char* Name() { return "min"; }
+	static std::string Combine() { return "min(a, b)"; }
+	static std::string Identity() { return CLScanType<T>::Highest(); }
+	static T HostIdentity() { return std::numeric_limits<T>::max(); }
+	T operator()(T A, T B) const { return std::min(A, B); }
+};
+
+template <typename T, template <typename> class Op>
+SScanDesc MakeScanDesc(bool Exclusive = false, bool Segmented = false)
+{
+	SScanDesc desc;
+	desc.Type = CLScanType<T>::Name();
+	desc.ElementSize = sizeof(T);
+	desc.Combine = Op<T>::Combine();
+	desc.Identity = Op<T>::Identity();
+	desc.Exclusive = Exclusive;
+	desc.Segmented = Segmented;
+	desc.Name = std::string(Segmented ? "segmented " : "") + (Exclusive ? "exclusive " : "inclusive ") + desc.Type + " " + Op<T>::Name();
+	return desc;
+}
+
+//! CPU reference for the same descriptor
+template <typename T, template <typename> class Op>
+void ScanReference(const T* In, T* Out, size_t N, bool Exclusive, const cl_uint* HeadFlags = NULL)
+{
+	Op<T> combine;
+	T acc = Op<T>::HostIdentity();
+	for(size_t i = 0; i < N; i++)
+	{
+		bool head = HeadFlags && HeadFlags[i];
+		T inclusive = head ? In[i] : combine(acc, In[i]);
+		Out[i] = Exclusive ? (head ? Op<T>::HostIdentity() : acc) : inclusive;
+		acc = inclusive;
+	}
+}
+
+#endif // _CSCAN_PRIMITIVE_H
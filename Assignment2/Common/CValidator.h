@@ -0,0 +1,111 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CVALIDATOR_H
+#define _CVALIDATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <string>
+
+//! Compares computed results with a reference on the HOST
+/*!
+	Replaces the byte-wise memcmp() checks. Floating point data can be
+	compared with a tolerance, so kernels that reorder operations or are
+	built with -cl-fast-relaxed-math can still be validated.
+
+	The arrays are split into chunks that are compared in parallel (CParallel).
+	Each chunk is first tested with SSE, only blocks that fail the vector test
+	are checked element by element, so a passing validation runs at memory
+	bandwidth. The first GetMaxReported() mismatches (lowest indices) are kept
+	and can be printed.
+*/
+class CValidator
+{
+public:
+	enum EMode
+	{
+		EXACT,		//!< bitwise identical
+		ABSOLUTE,	//!< |a - b| <= Tolerance
+		RELATIVE,	//!< |a - b| <= Tolerance * max(|a|, |b|)
+		ULP			//!< a and b are at most Tolerance representable floats apart
+	};
+
+	struct SMismatch
+	{
+		size_t	Index;
+		double	Expected;
+		double	Actual;
+	};
+
+	CValidator(EMode Mode = EXACT, double Tolerance = 0.0, size_t MaxReported = 8);
+
+	virtual ~CValidator() {};
+
+	//! Returns true if all Count elements of Actual match Expected
+	bool Compare(const float* Expected, const float* Actual, size_t Count);
+
+	//! Integer data: RELATIVE and ULP are treated as ABSOLUTE
+	bool Compare(const int* Expected, const int* Actual, size_t Count);
+	bool Compare(const unsigned int* Expected, const unsigned int* Actual, size_t Count);
+	bool Compare(const uint64_t* Expected, const uint64_t* Actual, size_t Count);
+
+	//! Number of mismatches found by the last Compare()
+	size_t GetMismatchCount() const { return m_MismatchCount; }
+
+	//! The first mismatches of the last Compare(), sorted by index
+	const std::vector<SMismatch>& GetMismatches() const { return m_Mismatches; }
+
+	size_t GetMaxReported() const { return m_MaxReported; }
+
+	//! Prints the mismatch count and the reported mismatches (nothing if the last Compare() passed)
+	void PrintMismatches(const std::string& Name) const;
+
+	//! Distance of two floats in units in the last place, counted across zero for different signs (saturates for NaNs)
+	static unsigned int UlpDistance(float A, float B);
+
+protected:
+	template<class T>
+	bool CompareImpl(const T* Expected, const T* Actual, size_t Count);
+
+	template<class T>
+	size_t CompareChunk(const T* Expected, const T* Actual, size_t Begin, size_t End, std::vector<SMismatch>& Mismatches) const;
+
+	bool Matches(float Expected, float Actual) const;
+	bool Matches(int Expected, int Actual) const;
+	bool Matches(unsigned int Expected, unsigned int Actual) const;
+	bool Matches(uint64_t Expected, uint64_t Actual) const;
+
+	//! Tests Count (multiple of 4) elements at once, false means "check element-wise"
+	bool BlockMatches(const float* Expected, const float* Actual, size_t Count) const;
+	bool BlockMatches(const int* Expected, const int* Actual, size_t Count) const;
+	bool BlockMatches(const unsigned int* Expected, const unsigned int* Actual, size_t Count) const;
+	bool BlockMatches(const uint64_t* Expected, const uint64_t* Actual, size_t Count) const;
+
+	EMode					m_Mode;
+	double					m_Tolerance;
+	size_t					m_MaxReported;
+
+	size_t					m_MismatchCount = 0;
+	std::vector<SMismatch>	m_Mismatches;
+};
+
+#endif // _CVALIDATOR_H
@@ -0,0 +1,163 @@
+
+// Generic scan used by CScanPrimitive. The host prepends the element type VALUE_T, the operator
+// Combine(), IDENTITY, BLOCK_SIZE, ITEMS_PER_THREAD and, for segmented scans, SEGMENTED.
+//
+// Reduce-then-scan: ScanReduceTiles produces one total per tile, the host scans the totals
+// (recursively, with the same kernels) and ScanTiles scans every tile starting with the carry
+// of its predecessors. Combine() only has to be associative, all combinations keep the order.
+//
+// Segmented scans work on pairs (head, value): head tells if a segment starts within the range,
+// value is the combination of the range since its last segment start.
+//		(ha, a) + (hb, b) = (ha | hb, hb ? b : Combine(a, b))
+
+#define TILE_ITEMS (BLOCK_SIZE * ITEMS_PER_THREAD)
+
+// output modes of ScanTiles
+#define SCAN_INCLUSIVE	0
+#define SCAN_EXCLUSIVE	1	// identity at segment starts
+#define SCAN_CARRY		2	// inclusive result of the preceding element, heads do not reset their own position
+
+#ifdef SEGMENTED
+	#define TILE_HEAD(i) heads[i]
+#else
+	#define TILE_HEAD(i) 0
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Coalesced load of a tile, elements beyond N are the identity
+void LoadTile(const __global VALUE_T* in, const __global uint* headFlags, uint base, uint N,
+	__local VALUE_T* values, __local uint* heads)
+{
+	uint LID = get_local_id(0);
+	for(uint k = 0; k < ITEMS_PER_THREAD; k++)
+	{
+		uint i = base + k * BLOCK_SIZE + LID;
+		values[k * BLOCK_SIZE + LID] = (i < N) ? in[i] : IDENTITY;
+#ifdef SEGMENTED
+		heads[k * BLOCK_SIZE + LID] = (i < N) ? (headFlags[i] != 0) : 0;
+#endif
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Serial reduction of the ITEMS_PER_THREAD consecutive elements of a work-item
+void ReduceThread(__local VALUE_T* values, __local uint* heads, VALUE_T* value, uint* head)
+{
+	uint first = get_local_id(0) * ITEMS_PER_THREAD;
+	VALUE_T v = IDENTITY;
+	uint h = 0;
+	for(uint k = 0; k < ITEMS_PER_THREAD; k++)
+	{
+		uint xh = TILE_HEAD(first + k);
+		v = xh ? values[first + k] : Combine(v, values[first + k]);
+		h |= xh;
+	}
+	*value = v;
+	*head = h;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Inclusive scan of one pair per work-item over the block (Hillis-Steele), the results stay in threadValues / threadHeads
+void ScanBlock(VALUE_T value, uint head, __local VALUE_T* threadValues, __local uint* threadHeads)
+{
+	uint LID = get_local_id(0);
+
+	threadValues[LID] = value;
+	threadHeads[LID] = head;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for(uint offset = 1; offset < BLOCK_SIZE; offset *= 2)
+	{
+		if(LID >= offset)
+		{
+			VALUE_T left = threadValues[LID - offset];
+			uint leftHead = threadHeads[LID - offset];
+			value = head ? value : Combine(left, value);
+			head |= leftHead;
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+		threadValues[LID] = value;
+		threadHeads[LID] = head;
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// One (head, value) pair per tile
+__kernel __attribute__((reqd_work_group_size(BLOCK_SIZE, 1, 1)))
+void ScanReduceTiles(const __global VALUE_T* in, const __global uint* headFlags, uint N,
+	__global VALUE_T* tileValues, __global uint* tileHeads)
+{
+	__local VALUE_T values[TILE_ITEMS];
+	__local uint heads[TILE_ITEMS];
+	__local VALUE_T threadValues[BLOCK_SIZE];
+	__local uint threadHeads[BLOCK_SIZE];
+
+	LoadTile(in, headFlags, get_group_id(0) * TILE_ITEMS, N, values, heads);
+
+	VALUE_T value;
+	uint head;
+	ReduceThread(values, heads, &value, &head);
+	ScanBlock(value, head, threadValues, threadHeads);
+
+	if(get_local_id(0) == BLOCK_SIZE - 1)
+	{
+		tileValues[get_group_id(0)] = threadValues[BLOCK_SIZE - 1];
+#ifdef SEGMENTED
+		tileHeads[get_group_id(0)] = threadHeads[BLOCK_SIZE - 1];
+#endif
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scans every tile, starting with tileCarries[tile] (the value open at the start of the tile) if useCarry is set.
+// in and out may be the same buffer.
+__kernel __attribute__((reqd_work_group_size(BLOCK_SIZE, 1, 1)))
+void ScanTiles(const __global VALUE_T* in, __global VALUE_T* out, const __global uint* headFlags, uint N,
+	const __global VALUE_T* tileCarries, uint useCarry, uint mode)
+{
+	__local VALUE_T values[TILE_ITEMS];
+	__local uint heads[TILE_ITEMS];
+	__local VALUE_T threadValues[BLOCK_SIZE];
+	__local uint threadHeads[BLOCK_SIZE];
+
+	uint LID = get_local_id(0);
+	uint base = get_group_id(0) * TILE_ITEMS;
+
+	LoadTile(in, headFlags, base, N, values, heads);
+
+	VALUE_T value;
+	uint head;
+	ReduceThread(values, heads, &value, &head);
+	ScanBlock(value, head, threadValues, threadHeads);
+
+	// value open at the start of the range of this work-item
+	VALUE_T acc = useCarry ? tileCarries[get_group_id(0)] : IDENTITY;
+	if(LID > 0)
+		acc = threadHeads[LID - 1] ? threadValues[LID - 1] : Combine(acc, threadValues[LID - 1]);
+
+	uint first = LID * ITEMS_PER_THREAD;
+	for(uint k = 0; k < ITEMS_PER_THREAD; k++)
+	{
+		uint xh = TILE_HEAD(first + k);
+		VALUE_T inclusive = xh ? values[first + k] : Combine(acc, values[first + k]);
+
+		if(mode == SCAN_INCLUSIVE)
+			values[first + k] = inclusive;
+		else if(mode == SCAN_EXCLUSIVE)
+			values[first + k] = xh ? IDENTITY : acc;
+		else
+			values[first + k] = acc;
+
+		acc = inclusive;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for(uint k = 0; k < ITEMS_PER_THREAD; k++)
+	{
+		uint i = base + k * BLOCK_SIZE + LID;
+		if(i < N)
+			out[i] = values[k * BLOCK_SIZE + LID];
+	}
+}
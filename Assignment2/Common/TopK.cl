@@ -0,0 +1,165 @@
+
+// Top-k selection used by CTopKPrimitive. The host sets KEY_T (uint or ulong), BLOCK_SIZE and ITEMS_PER_THREAD.
+//
+// The k-th largest key (the threshold) is found by a radix select, starting with the most significant
+// digit: SelectHistogram counts the digits of all keys that match the digits selected so far, SelectDigit
+// picks the digit that holds the k-th largest of them. The state stays on the device, so all passes are
+// enqueued without reading anything back. TopKFlags then marks the keys above the threshold and as many
+// keys equal to it as are still missing, the host compacts the marked keys (and values) with CCompactPrimitive.
+
+#define RADIX_BITS	8
+#define RADIX		(1 << RADIX_BITS)
+#define TILE_ITEMS	(BLOCK_SIZE * ITEMS_PER_THREAD)
+
+typedef struct
+{
+	KEY_T	prefix;		// digits selected so far
+	KEY_T	mask;		// bits of these digits
+	uint	remaining;	// rank (from the top, 1-based) of the k-th largest key among the keys matching prefix
+	uint	ties;		// keys equal to the threshold marked by TopKFlags
+} SELECT_STATE;
+
+uint Digit(KEY_T Key, uint Shift)
+{
+	return (uint)(Key >> Shift) & (RADIX - 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Clears the histogram and starts the selection of the k-th largest key, RADIX work-items
+__kernel void SelectInit(__global uint* histogram, __global SELECT_STATE* state, uint k)
+{
+	uint GID = get_global_id(0);
+	histogram[GID] = 0;
+
+	if(GID == 0)
+	{
+		state->prefix = 0;
+		state->mask = 0;
+		state->remaining = k;
+		state->ties = 0;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Digit counts of the keys matching the selected digits, one tile per work-group. The counts are
+// gathered in local memory, every work-group adds them to the global histogram with one atomic per digit.
+__kernel __attribute__((reqd_work_group_size(BLOCK_SIZE, 1, 1)))
+void SelectHistogram(const __global KEY_T* keys, uint N, uint shift, const __global SELECT_STATE* state, __global uint* histogram)
+{
+	__local uint hist[RADIX];
+
+	uint LID = get_local_id(0);
+	KEY_T prefix = state->prefix;
+	KEY_T mask = state->mask;
+
+	for(uint d = LID; d < RADIX; d += BLOCK_SIZE)
+		hist[d] = 0;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	uint base = get_group_id(0) * TILE_ITEMS;
+	for(uint k = 0; k < ITEMS_PER_THREAD; k++)
+	{
+		uint i = base + k * BLOCK_SIZE + LID;
+		if(i < N)
+		{
+			KEY_T key = keys[i];
+			if((key & mask) == prefix)
+				atomic_inc(&hist[Digit(key, shift)]);
+		}
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for(uint d = LID; d < RADIX; d += BLOCK_SIZE)
+		if(hist[d] > 0)
+			atomic_add(&histogram[d], hist[d]);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Selects the digit of the k-th largest matching key and clears the histogram for the next pass, one work-group.
+// Walking down from the largest digit, the keys with larger digits are subtracted from the rank.
+__kernel __attribute__((reqd_work_group_size(BLOCK_SIZE, 1, 1)))
+void SelectDigit(__global uint* histogram, __global SELECT_STATE* state, uint shift)
+{
+	__local uint hist[RADIX];
+
+	uint LID = get_local_id(0);
+	for(uint d = LID; d < RADIX; d += BLOCK_SIZE)
+	{
+		hist[d] = histogram[d];
+		histogram[d] = 0;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if(LID == 0)
+	{
+		uint remaining = state->remaining;
+		uint greater = 0;
+		for(int d = RADIX - 1; d >= 0; d--)
+		{
+			if(greater + hist[d] >= remaining)
+			{
+				state->prefix |= (KEY_T)d << shift;
+				state->mask |= (KEY_T)(RADIX - 1) << shift;
+				state->remaining = remaining - greater;
+				break;
+			}
+			greater += hist[d];
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// flags[i] = 1 for the keys above the threshold and the first state->remaining keys equal to it (in the order in
+// which the work-groups reserve them), 0 otherwise. Every work-group reserves the ranks of its ties with one atomic.
+__kernel __attribute__((reqd_work_group_size(BLOCK_SIZE, 1, 1)))
+void TopKFlags(const __global KEY_T* keys, uint N, __global SELECT_STATE* state, __global uint* flags)
+{
+	__local uint groupTies;
+	__local uint groupBase;
+
+	uint LID = get_local_id(0);
+	uint base = get_group_id(0) * TILE_ITEMS;
+	KEY_T threshold = state->prefix;
+	uint remaining = state->remaining;
+
+	if(LID == 0)
+		groupTies = 0;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	uint ties = 0;
+	for(uint k = 0; k < ITEMS_PER_THREAD; k++)
+	{
+		uint i = base + k * BLOCK_SIZE + LID;
+		if(i < N && keys[i] == threshold)
+			ties++;
+	}
+	uint tie = (ties > 0) ? atomic_add(&groupTies, ties) : 0;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if(LID == 0)
+		groupBase = (groupTies > 0) ? atomic_add(&state->ties, groupTies) : 0;
+	barrier(CLK_LOCAL_MEM_FENCE);
+	tie += groupBase;
+
+	for(uint k = 0; k < ITEMS_PER_THREAD; k++)
+	{
+		uint i = base + k * BLOCK_SIZE + LID;
+		if(i < N)
+		{
+			KEY_T key = keys[i];
+			uint keep = key > threshold;
+			if(key == threshold)
+				keep = tie++ < remaining;
+			flags[i] = keep;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The ascending radix sort of the inverted keys gives the descending order
+__kernel void InvertKeys(__global KEY_T* keys, uint N)
+{
+	uint GID = get_global_id(0);
+	if(GID < N)
+		keys[GID] = ~keys[GID];
+}
@@ -81,6 +81,30 @@ bool CAssignment3::DoCompute()
 				4, 4, 3, ConvKernel, ConvKernel);
 			RunComputeTask(convTask, HGroupSize);
 		}
+
+		{
+			// the same blur on interleaved RGBA pixels: one launch per pass convolves all channels
+			float ConvKernel[7] = {
+				0.000817774f, 0.0286433f, 0.235018f, 0.471041f, 0.235018f, 0.0286433f, 0.000817774f
+			};
+			CConvolutionSeparableTask convTask("gauss_3x3_rgba", "Images/input.pfm", HGroupSize, VGroupSize,
+				4, 4, 3, ConvKernel, ConvKernel, true);
+			RunComputeTask(convTask, HGroupSize);
+		}
+
+		{
+			// half and 8 bit pixels in the device buffers: half or a quarter of the memory traffic
+			float ConvKernel[7] = {
+				0.000817774f, 0.0286433f, 0.235018f, 0.471041f, 0.235018f, 0.0286433f, 0.000817774f
+			};
+			CConvolutionSeparableTask halfTask("gauss_3x3_half", "Images/input.pfm", HGroupSize, VGroupSize,
+				4, 4, 3, ConvKernel, ConvKernel, false, STORAGE_HALF);
+			RunComputeTask(halfTask, HGroupSize);
+
+			CConvolutionSeparableTask ucharTask("gauss_3x3_rgba_uchar", "Images/input.pfm", HGroupSize, VGroupSize,
+				4, 4, 3, ConvKernel, ConvKernel, true, STORAGE_UCHAR);
+			RunComputeTask(ucharTask, HGroupSize);
+		}
 		
 	}
 
@@ -114,6 +138,11 @@ bool CAssignment3::DoCompute()
 			RunComputeTask(histogram, group_size);
 		}
 
+		{
+			CHistogramTask histogram(0.25f, 0.26f, true, "Images/input.pfm", STORAGE_UCHAR);
+			RunComputeTask(histogram, group_size);
+		}
+
 	}
 
 	return true;
@@ -19,9 +19,11 @@ CConvolution3x3Task(
 		size_t TileSize[2],
 		float ConvKernel[3][3],
 		bool Monochrome,
-		float Offset
+		float Offset,
+		bool Interleaved,
+		EImageStorage Storage
 )
-	: CConvolutionTaskBase(FileName, Monochrome)
+	: CConvolutionTaskBase(FileName, Monochrome, Interleaved, Storage)
 	, m_Offset(Offset)
 {
 	m_TileSize[0] = TileSize[0];
@@ -42,7 +44,9 @@ CConvolution3x3Task(
 	else
 		m_KernelWeight = 1.0f;
 
-	m_FileNamePostfix = "3x3";
+	m_FileNamePostfix = Interleaved ? "3x3_rgba" : "3x3";
+	if(Storage != STORAGE_FLOAT)
+		m_FileNamePostfix += string("_") + CImageStorage::GetName(Storage);
 }
 
 CConvolution3x3Task::~CConvolution3x3Task()
@@ -70,8 +74,8 @@ bool CConvolution3x3Task::InitResources(cl_device_id Device, cl_context Context)
 
 	string programCode;
 
-	CLUtil::LoadProgramSourceToMemory("Convolution3x3.cl", programCode);
-	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode);
+	CImageStorage::LoadProgram("Convolution3x3.cl", programCode);
+	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode, GetStorageOptions());
 	if(m_Program == nullptr) return false;
 
 	//create kernel(s)
@@ -105,27 +109,23 @@ void CConvolution3x3Task::ComputeGPU(cl_context Context, cl_command_queue Comman
 	const int nIterations = 1000;
 
 	//do 1 or 3 convolution steps, based on the number of color channels to process
+	//(the interleaved layout convolves all of them in one step)
 	unsigned int numChannels = m_Monochrome ? 1 : 3;
 
-	size_t dataSize = m_Pitch * m_Height * sizeof(cl_float);
-
 	//perform the convolution and measure the performance
 	double runTime = 0.0f;
-	for(unsigned int iChannel = 0; iChannel < numChannels; iChannel++)	
+	for(unsigned int iChannel = 0; iChannel < GetNumGPUChannels(numChannels); iChannel++)	
 		runTime += ConvolutionChannelGPU(iChannel, Context, CommandQueue, nIterations);
 
 
 	cout<<"  Average GPU time: "<<runTime<<" ms, throughput: "<< 1.0e-6 * m_Width * m_Height / runTime << " Gpixels/s" <<endl;
 
-	for(unsigned int iChannel = 0; iChannel < numChannels; iChannel++)
-	{
-		//copy the results back to the CPU
-		V_RETURN_CL( clEnqueueReadBuffer(CommandQueue, m_dResultChannels[iChannel], CL_TRUE, 0, dataSize,
-									m_hGPUResultChannels[iChannel], 0, NULL, NULL), "Error reading back results from the device!" );
-	}
+	//copy the results back to the CPU
+	if(!ReadGPUResults(CommandQueue, numChannels))
+		return;
 
 
-	SaveImage("Images/GPUResult3x3.pfm", m_hGPUResultChannels);
+	SaveImage("Images/GPUResult" + m_FileNamePostfix + ".pfm", m_hGPUResultChannels);
 }
 
 void CConvolution3x3Task::ComputeCPU()
@@ -142,7 +142,7 @@ void CConvolution3x3Task::ComputeCPU()
 
 	cout<<"  CPU time: "<<runTime<<" ms, throughput: "<< 1.0e-6 * m_Width * m_Height / runTime << " Gpixels/s" <<endl;
 
-	SaveImage("Images/CPUResult3x3.pfm", m_hCPUResultChannels);
+	SaveImage("Images/CPUResult" + m_FileNamePostfix + ".pfm", m_hCPUResultChannels);
 }
 
 double CConvolution3x3Task::ConvolutionChannelCPU(unsigned int Channel)
@@ -33,7 +33,9 @@ public:
 			size_t TileSize[2],
 			float ConvKernel[3][3],
 			bool Monochrome,
-			float Offset);
+			float Offset,
+			bool Interleaved = false,
+			EImageStorage Storage = STORAGE_FLOAT);
 
 	virtual ~CConvolution3x3Task();
 
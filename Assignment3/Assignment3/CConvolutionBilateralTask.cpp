@@ -26,11 +26,12 @@ CConvolutionBilateralTask::CConvolutionBilateralTask(
 		int StepsVertical,
 		int KernelRadius,
 		float* pKernelHorizontal,
-		float* pKernelVertical)
+		float* pKernelVertical,
+		bool Interleaved)
 	: CConvolutionSeparableTask(
 			"bilateral", FileName, LocalSizeHorizontal,
 			LocalSizeVertical, StepsHorizontal, StepsVertical,
-			KernelRadius, pKernelHorizontal, pKernelVertical)
+			KernelRadius, pKernelHorizontal, pKernelVertical, Interleaved)
 	, m_NormalFileName(NormalFileName)
 	, m_DepthFileName(DepthFileName)
 {
@@ -164,7 +165,6 @@ void CConvolutionBilateralTask::ReleaseResources()
 
 void CConvolutionBilateralTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
 {
-	size_t dataSize = m_Pitch * m_Height * sizeof(cl_float);
 	int nIterations = 100;
 
 	unsigned int numChannels = 3;
@@ -179,21 +179,16 @@ void CConvolutionBilateralTask::ComputeGPU(cl_context Context, cl_command_queue
 	runTime += CLUtil::ProfileKernel(CommandQueue, m_VerticalDiscKernel, 2, globalWorkSizeV, LocalWorkSize, nIterations);
 
 
-	for(unsigned int iChannel = 0; iChannel < numChannels; iChannel++)
+	for(unsigned int iChannel = 0; iChannel < GetNumGPUChannels(numChannels); iChannel++)
 	{
 		runTime += ConvolutionChannelGPU(iChannel, Context, CommandQueue, nIterations);
 	}
 
 	cout<<"  Average GPU time: "<<runTime<<" ms, throughput: "<< 1.0e-6 * m_Width * m_Height / runTime << " Gpixels/s" <<endl;
 
-	for(unsigned int iChannel = 0; iChannel < numChannels; iChannel++)
-	{
-		//copy the results back to the CPU
-		//(this time the data is in the same buffer as the input was, because of the 2 convolution passes)
-		V_RETURN_CL( clEnqueueReadBuffer(CommandQueue, m_dResultChannels[iChannel], CL_TRUE, 0, dataSize,
-									m_hGPUResultChannels[iChannel], 0, NULL, NULL), "Error reading back results from the device!" );
-
-	}
+	//copy the results back to the CPU
+	if(!ReadGPUResults(CommandQueue, numChannels))
+		return;
 	V_RETURN_CL( clEnqueueReadBuffer(CommandQueue, m_dDiscBuffer, CL_TRUE, 0, m_Width * m_Height * sizeof(int), 
 		m_hGPUDiscBuffer, 0, NULL, NULL), "Error reading back results from the device!" );
 	
@@ -40,7 +40,8 @@ public:
 	// Yes, we have more and more attributes :) But we did not want to complicate it with more "setter" methods...
 	CConvolutionBilateralTask(const std::string& FileName, const std::string& NormalFileName,
 		const std::string& DepthFileName, size_t LocalSizeHorizontal[2], size_t LocalSizeVertical[2],
-		int StepsHorizontal, int StepsVertical, int KernelRadius, float* pKernelHorizontal, float* pKernelVertical);
+		int StepsHorizontal, int StepsVertical, int KernelRadius, float* pKernelHorizontal, float* pKernelVertical,
+		bool Interleaved = false);
 
 	virtual ~CConvolutionBilateralTask();
 
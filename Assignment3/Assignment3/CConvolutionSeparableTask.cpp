@@ -25,9 +25,11 @@ CConvolutionSeparableTask::CConvolutionSeparableTask(
 		int StepsVertical,
 		int KernelRadius,
 		float* pKernelHorizontal,
-		float* pKernelVertical
+		float* pKernelVertical,
+		bool Interleaved,
+		EImageStorage Storage
 )
-	: CConvolutionTaskBase(FileName, false)
+	: CConvolutionTaskBase(FileName, false, Interleaved, Storage)
 	, m_OutFileName(OutFileName)
 	, m_StepsHorizontal(StepsHorizontal)
 	, m_StepsVertical(StepsVertical)
@@ -79,14 +81,16 @@ bool CConvolutionSeparableTask::InitResources(cl_device_id Device, cl_context Co
 	clError |= clErr;
 	V_RETURN_FALSE_CL(clError, "Error allocating device kernel constants.");
 
-	m_dGPUWorkingBuffer = clCreateBuffer(Context, CL_MEM_READ_WRITE, m_Pitch * m_Height * sizeof(cl_float), NULL, &clError);
+	//the working buffer holds one channel, or all of them if interleaved, in the storage format
+	size_t pixelSize = (m_Interleaved ? 4 : 1) * CImageStorage::GetSize(m_Storage);
+	m_dGPUWorkingBuffer = clCreateBuffer(Context, CL_MEM_READ_WRITE, m_Pitch * m_Height * pixelSize, NULL, &clError);
 	V_RETURN_FALSE_CL(clError, "Error allocating device working array");
 
 	m_hCPUWorkingBuffer = new float[m_Height * m_Pitch];
 
 	string programCode;
 
-	CLUtil::LoadProgramSourceToMemory(m_ProgramName, programCode);
+	CImageStorage::LoadProgram(m_ProgramName, programCode);
 
 	//This time we define several kernel-specific constants that we did not know during
 	//implementing the kernel, but we need to include during compile time.
@@ -96,7 +100,8 @@ bool CConvolutionSeparableTask::InitResources(cl_device_id Device, cl_context Co
 	<<" -D H_GROUPSIZE_X="<<m_LocalSizeHorizontal[0]<<" -D H_GROUPSIZE_Y="<<m_LocalSizeHorizontal[1]
 	<<" -D H_RESULT_STEPS="<<m_StepsHorizontal
 	<<" -D V_GROUPSIZE_X="<<m_LocalSizeVertical[0]<<" -D V_GROUPSIZE_Y="<<m_LocalSizeVertical[1]
-	<<" -D V_RESULT_STEPS="<<m_StepsVertical;
+	<<" -D V_RESULT_STEPS="<<m_StepsVertical
+	<<GetStorageOptions();
 
 	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode, compileOptions.str());
 	if(m_Program == nullptr) return false;
@@ -147,30 +152,22 @@ void CConvolutionSeparableTask::ReleaseResources()
 
 void CConvolutionSeparableTask::ComputeGPU(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3])
 {
-	size_t dataSize = m_Pitch * m_Height * sizeof(cl_float);
 	int nIterations = 100;
 
 	unsigned int numChannels = 3;
 
+	//with the interleaved layout all channels are convolved at once
 	double runTime = 0.0f;
-	for(unsigned int iChannel = 0; iChannel < numChannels; iChannel++)
+	for(unsigned int iChannel = 0; iChannel < GetNumGPUChannels(numChannels); iChannel++)
 	{
 		runTime += ConvolutionChannelGPU(iChannel, Context, CommandQueue, nIterations);
 	}
 
 	cout<<"  Average GPU time: "<<runTime<<" ms, throughput: "<< 1.0e-6 * m_Width * m_Height / runTime << " Gpixels/s" <<endl;
 
-	for(unsigned int iChannel = 0; iChannel < numChannels; iChannel++)
-	{
-		//copy the results back to the CPU
-		//(this time the data is in the same buffer as the input was, because of the 2 convolution passes)
-		V_RETURN_CL( clEnqueueReadBuffer(CommandQueue, m_dResultChannels[iChannel], CL_TRUE, 0, dataSize,
-								m_hGPUResultChannels[iChannel], 0, NULL, NULL), "Error reading back results from the device!" );
-									
-	//	V_RETURN_CL( clEnqueueReadBuffer(CommandQueue, m_dGPUWorkingBuffer, CL_TRUE, 0, dataSize,
-	//								m_hGPUResultChannels[iChannel], 0, NULL, NULL), "Error reading back results from the device!" );							
-
-	}
+	//copy the results back to the CPU
+	if(!ReadGPUResults(CommandQueue, numChannels))
+		return;
 	
 	SaveImage("Images/GPUResultSeparable_" + m_OutFileName + ".pfm", m_hGPUResultChannels);
 }
@@ -208,6 +205,8 @@ double CConvolutionSeparableTask::ConvolutionChannelCPU(unsigned int Channel)
 			m_hCPUWorkingBuffer[y * m_Pitch + x] = value;
 		
 		}
+	//the device stores the intermediate result in the storage format as well
+	CImageStorage::Quantize(m_Storage, m_hCPUWorkingBuffer, m_Height * m_Pitch);
 
 	//vertical pass
 	for(int x = 0; x < (int)m_Width; x++)
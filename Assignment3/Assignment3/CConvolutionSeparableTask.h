@@ -37,7 +37,9 @@ public:
 			int StepsVertical,
 			int KernelRadius,
 			float* pKernelHorizontal,
-			float* pKernelVertical);
+			float* pKernelVertical,
+			bool Interleaved = false,
+			EImageStorage Storage = STORAGE_FLOAT);
 
 	virtual ~CConvolutionSeparableTask();
 
@@ -14,16 +14,28 @@ GPU Computing / GPGPU Praktikum source code.
 #include <stdio.h>
 #include <assert.h>
 #include <cstdint>
+#include <cstdlib>
+#include <cmath>
 #include <vector>
 
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
 using namespace std;
 
 ///////////////////////////////////////////////////////////////////////////////
 // CConvolutionTaskBase
 
-CConvolutionTaskBase::CConvolutionTaskBase(const std::string& FileName, bool Monochrome)
-	: m_FileName(FileName), m_Monochrome(Monochrome)
+CConvolutionTaskBase::CConvolutionTaskBase(const std::string& FileName, bool Monochrome, bool Interleaved, EImageStorage Storage)
+	: m_FileName(FileName), m_Monochrome(Monochrome), m_Interleaved(Interleaved), m_Storage(Storage)
 {
+	for(int i = 0; i < 3; i++)
+	{
+		m_hSourceChannels[i] = m_hCPUResultChannels[i] = m_hGPUResultChannels[i] = NULL;
+		m_hSourceStaging[i] = NULL;
+		m_dSourceChannels[i] = m_dResultChannels[i] = NULL;
+	}
 }
 
 CConvolutionTaskBase::~CConvolutionTaskBase()
@@ -31,10 +43,35 @@ CConvolutionTaskBase::~CConvolutionTaskBase()
 	ReleaseResources();
 }
 
+// Page aligned host memory, which an OpenCL implementation can use for a buffer directly
+// (CL_MEM_USE_HOST_PTR) instead of copying it into its own staging area first.
+static void* AllocStaging(size_t Size)
+{
+	size_t size = (Size + 63) & ~(size_t)63;
+#ifdef _WIN32
+	return _aligned_malloc(size, 4096);
+#else
+	void* p = NULL;
+	return posix_memalign(&p, 4096, size) == 0 ? p : NULL;
+#endif
+}
+
+template <typename T>
+static void FreeStaging(T*& Ptr)
+{
+#ifdef _WIN32
+	_aligned_free(Ptr);
+#else
+	free(Ptr);
+#endif
+	Ptr = NULL;
+}
+
 bool CConvolutionTaskBase::InitResources(cl_device_id , cl_context Context)
 {
-	PFM inputPfm;
-	if (!inputPfm.LoadRGB(m_FileName.c_str())) {
+	// the pixels are read straight from the mapped file, without an intermediate copy
+	PFMMapping inputPfm;
+	if (!inputPfm.Open(m_FileName.c_str()) || inputPfm.channels != 3) {
 		cerr<<"Error loading file: " << m_FileName.c_str() << "." << endl;
 		return false;
 	}
@@ -48,25 +85,32 @@ bool CConvolutionTaskBase::InitResources(cl_device_id , cl_context Context)
 		m_Pitch = m_Width + 32 - (m_Width % 32); //This will make sure that the data accesses are ALWAYS coalesced
 
 	cout<<"Size of image: "<<m_Width<<" x "<<m_Height<<endl;
+	if(m_Interleaved || m_Storage != STORAGE_FLOAT)
+		cout<<"Device storage: "<<CImageStorage::GetName(m_Storage)<<(m_Interleaved ? " RGBA" : "")<<endl;
 
-	//allocate data for the float channels
+	//allocate data for the float channels, the sources are backing the device buffers
 	for(int i = 0; i < 3; i++)
 	{
-		m_hSourceChannels[i] = new float[m_Height * m_Pitch];
+		m_hSourceChannels[i] = (float*)AllocStaging(m_Height * m_Pitch * sizeof(float));
 		m_hCPUResultChannels[i] = new float[m_Height * m_Pitch];
 		m_hGPUResultChannels[i] = new float[m_Height * m_Pitch];
+		if(!m_hSourceChannels[i])
+		{
+			cerr<<"Error allocating host memory for the source channels."<<endl;
+			return false;
+		}
 	}
 
 	//extract R, G, B channels
 	unsigned int pixelOffset = 0;
-	unsigned int trippleOffset = 0;
+	size_t trippleOffset = 0;
 	for(unsigned int y = 0; y < m_Height; y++)
 	{
 		for(unsigned int x = 0; x < m_Width; x++)
 		{
-			m_hSourceChannels[0][pixelOffset] = inputPfm.pImg[trippleOffset    ];
-			m_hSourceChannels[1][pixelOffset] = inputPfm.pImg[trippleOffset + 1];
-			m_hSourceChannels[2][pixelOffset] = inputPfm.pImg[trippleOffset + 2];
+			m_hSourceChannels[0][pixelOffset] = inputPfm.Get(trippleOffset    );
+			m_hSourceChannels[1][pixelOffset] = inputPfm.Get(trippleOffset + 1);
+			m_hSourceChannels[2][pixelOffset] = inputPfm.Get(trippleOffset + 2);
 
 			//monochrome: the data is converted to grayscale
 			if(m_Monochrome)
@@ -86,13 +130,54 @@ bool CConvolutionTaskBase::InitResources(cl_device_id , cl_context Context)
 		}
 		pixelOffset += m_Pitch - m_Width;
 	}
+	inputPfm.Close();
 
-	unsigned int dataSize = m_Pitch * m_Height * sizeof(cl_float);
+	//the CPU reference works on the values the device sees
+	size_t numValues = m_Pitch * m_Height;
+	for(int i = 0; i < 3; i++)
+		CImageStorage::Quantize(m_Storage, m_hSourceChannels[i], numValues);
+
+	//planar floats are used as they are, otherwise the pixels are converted into staging memory
+	size_t valueSize = CImageStorage::GetSize(m_Storage);
+	if(m_Interleaved)
+	{
+		//the same pixels as RGBA, including the padding
+		vector<float> rgba(4 * numValues);
+		for(size_t i = 0; i < numValues; i++)
+		{
+			rgba[4 * i    ] = m_hSourceChannels[0][i];
+			rgba[4 * i + 1] = m_hSourceChannels[1][i];
+			rgba[4 * i + 2] = m_hSourceChannels[2][i];
+			rgba[4 * i + 3] = 0.0f;
+		}
+		m_hSourceStaging[0] = AllocStaging(4 * numValues * valueSize);
+		if(m_hSourceStaging[0])
+			CImageStorage::Encode(m_Storage, &rgba[0], m_hSourceStaging[0], 4 * numValues);
+	}
+	else if(m_Storage != STORAGE_FLOAT)
+	{
+		for(int i = 0; i < 3; i++)
+		{
+			m_hSourceStaging[i] = AllocStaging(numValues * valueSize);
+			if(m_hSourceStaging[i])
+				CImageStorage::Encode(m_Storage, m_hSourceChannels[i], m_hSourceStaging[i], numValues);
+		}
+	}
+
+	size_t dataSize = (m_Interleaved ? 4 : 1) * numValues * valueSize;
 	
+	// the source memory is only read on the host (CPU reference) while the buffers use it
 	cl_int clError;
-	for(int i = 0; i < 3; i++)
+	for(unsigned int i = 0; i < GetNumGPUChannels(3); i++)
 	{
-		m_dSourceChannels[i] = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, dataSize, m_hSourceChannels[i], &clError);
+		void* hostPtr = (m_Interleaved || m_Storage != STORAGE_FLOAT) ? m_hSourceStaging[i] : m_hSourceChannels[i];
+		if(!hostPtr)
+		{
+			cerr<<"Error allocating host memory for the device input."<<endl;
+			return false;
+		}
+
+		m_dSourceChannels[i] = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, dataSize, hostPtr, &clError);
 		V_RETURN_FALSE_CL(clError, "Error allocating device input array");
 
 		m_dResultChannels[i] = clCreateBuffer(Context, CL_MEM_WRITE_ONLY, dataSize, NULL, &clError);
@@ -106,13 +191,52 @@ void CConvolutionTaskBase::ReleaseResources()
 {
 	for(int i = 0; i < 3; i++)
 	{
-		SAFE_DELETE_ARRAY( m_hSourceChannels[i] );
+		// the source buffers have to go before their host memory
+		SAFE_RELEASE_MEMOBJECT( m_dSourceChannels[i] );
+		SAFE_RELEASE_MEMOBJECT( m_dResultChannels[i] );
+
+		FreeStaging( m_hSourceChannels[i] );
+		FreeStaging( m_hSourceStaging[i] );
 		SAFE_DELETE_ARRAY( m_hCPUResultChannels[i] );
 		SAFE_DELETE_ARRAY( m_hGPUResultChannels[i] );
+	}
+}
 
-		SAFE_RELEASE_MEMOBJECT( m_dSourceChannels[i] );
-		SAFE_RELEASE_MEMOBJECT( m_dResultChannels[i] );
+string CConvolutionTaskBase::GetStorageOptions() const
+{
+	return CImageStorage::GetBuildOptions(m_Storage, m_Interleaved);
+}
+
+bool CConvolutionTaskBase::ReadGPUResults(cl_command_queue CommandQueue, unsigned int NumChannels)
+{
+	size_t numValues = m_Pitch * m_Height;
+	size_t dataSize = numValues * CImageStorage::GetSize(m_Storage);
+
+	if(!m_Interleaved)
+	{
+		vector<char> result(m_Storage != STORAGE_FLOAT ? dataSize : 0);
+		for(unsigned int iChannel = 0; iChannel < NumChannels; iChannel++)
+		{
+			void* hostPtr = result.empty() ? (void*)m_hGPUResultChannels[iChannel] : (void*)&result[0];
+			V_RETURN_FALSE_CL( clEnqueueReadBuffer(CommandQueue, m_dResultChannels[iChannel], CL_TRUE, 0, dataSize,
+										hostPtr, 0, NULL, NULL), "Error reading back results from the device!" );
+			if(!result.empty())
+				CImageStorage::Decode(m_Storage, &result[0], m_hGPUResultChannels[iChannel], numValues);
+		}
+		return true;
 	}
+
+	vector<char> result(4 * dataSize);
+	V_RETURN_FALSE_CL( clEnqueueReadBuffer(CommandQueue, m_dResultChannels[0], CL_TRUE, 0, 4 * dataSize,
+								&result[0], 0, NULL, NULL), "Error reading back results from the device!" );
+
+	vector<float> rgba(4 * numValues);
+	CImageStorage::Decode(m_Storage, &result[0], &rgba[0], rgba.size());
+	for(unsigned int iChannel = 0; iChannel < NumChannels; iChannel++)
+		for(size_t i = 0; i < numValues; i++)
+			m_hGPUResultChannels[iChannel][i] = rgba[4 * i + iChannel];
+
+	return true;
 }
 
 bool CConvolutionTaskBase::ValidateResults()
@@ -130,7 +254,11 @@ bool CConvolutionTaskBase::ValidateResults()
 		for(unsigned int x = 0; x < m_Width; x++)
 			for(unsigned int i = 0; i < numChannels; i++)
 			{
-				float L2Error = m_hCPUResultChannels[i][y * m_Pitch + x] - m_hGPUResultChannels[i][y * m_Pitch + x];
+				// with 8 / 16 bit storage the CPU result is rounded like the device result, and a difference
+				// of one step for the result plus one for the rounding of the separable intermediate is accepted
+				float cpuValue = CImageStorage::Quantize(m_Storage, m_hCPUResultChannels[i][y * m_Pitch + x]);
+				float L2Error = fabs(cpuValue - m_hGPUResultChannels[i][y * m_Pitch + x]);
+				L2Error = max(0.0f, L2Error - 2.0f * CImageStorage::GetStep(m_Storage, cpuValue));
 				L2Error = L2Error * L2Error;
 
 				// Ignore the last line for the difference computations because we seem to have issues with NANs and other incorrect values in the last line with
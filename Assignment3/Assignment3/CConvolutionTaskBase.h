@@ -21,6 +21,7 @@
 #define _CCONVOLUTION_TASK_BASE_H
 
 #include "../Common/IComputeTask.h"
+#include "ImageStorage.h"
 
 #include <string>
 
@@ -28,11 +29,19 @@
 /*!
 	This class does not handle any actual computation, but implements methods used by all
 	tasks such as loading and saving images and comparing GPU-CPU results.
+
+	With Interleaved the device holds the image as one RGBA buffer (m_dSourceChannels[0]
+	and m_dResultChannels[0]) instead of three planar channels, so one launch convolves all
+	channels with vector loads. Storage selects float, half or uchar values in the device
+	buffers, the kernels still compute in float (see ImageStorage.cl). The kernels are built
+	with GetStorageOptions(). The host channels stay planar float for the CPU reference and
+	are rounded to the storage format.
 */
 class CConvolutionTaskBase : public IComputeTask
 {
 public:
-	CConvolutionTaskBase(const std::string& FileName, bool Monochrome = false);
+	CConvolutionTaskBase(const std::string& FileName, bool Monochrome = false, bool Interleaved = false,
+		EImageStorage Storage = STORAGE_FLOAT);
 
 	virtual ~CConvolutionTaskBase();
 
@@ -49,6 +58,13 @@ protected:
 	void SaveImage(const std::string& FileName, float* Channels[3]);
 	void SaveIntImage(const std::string& FileName, int* Channel);
 
+	// number of channel buffers processed on the device, 1 for the interleaved layout
+	unsigned int GetNumGPUChannels(unsigned int NumChannels) const { return m_Interleaved ? 1 : NumChannels; }
+	// defines of the pixel type and storage format for the convolution kernels
+	std::string GetStorageOptions() const;
+	// reads the device results into m_hGPUResultChannels
+	bool ReadGPUResults(cl_command_queue CommandQueue, unsigned int NumChannels);
+
 	// helper functions:
 	
 	// one grayscale floating point value out of RGB
@@ -59,6 +75,10 @@ protected:
 	std::string		m_FileName;
 	//if true, only one channel is used
 	bool			m_Monochrome;
+	//if true, the device buffers store RGBA pixels
+	bool			m_Interleaved;
+	//format of the values in the device buffers
+	EImageStorage	m_Storage;
 
 	// internally used, so different tasks can name their differece images
 	// uniquely
@@ -72,7 +92,10 @@ protected:
 	float*			m_hCPUResultChannels[3] /*= { nullptr, nullptr, nullptr }*/; //the convolved image
 	float*			m_hGPUResultChannels[3] /*= { nullptr, nullptr, nullptr }*/; //the convolved image
 
-	//we process exactly one channel on the GPU in the same time
+	//backing store of the source buffers, if they are interleaved or not float
+	void*			m_hSourceStaging[3];
+
+	//we process exactly one channel on the GPU in the same time (or all of them, if interleaved)
 	cl_mem			m_dSourceChannels[3] /*= { nullptr, nullptr, nullptr}*/;
 	cl_mem			m_dResultChannels[3] /*= { nullptr, nullptr, nullptr}*/;
 
@@ -6,11 +6,13 @@
 #include <cassert>
 
 CHistogramTask::
-CHistogramTask(float min_val, float max_val, bool use_local_memory, const std::string &img_path)
+CHistogramTask(float min_val, float max_val, bool use_local_memory, const std::string &img_path,
+		EImageStorage storage)
 	: m_min_val(min_val)
 	, m_max_val(max_val)
 	, m_img_path(img_path)
 	, m_use_local_memory(use_local_memory)
+	, m_storage(storage)
 {
 }
 
@@ -44,10 +46,17 @@ InitResources(cl_device_id dev, cl_context ctx)
 		}
 	}
 	
+	// the CPU histogram is computed from the values the device sees
+	CImageStorage::Quantize(m_storage, m_pixels.data(), m_pixels.size());
+	std::vector<char> storage(CImageStorage::GetSize(m_storage) * m_pixels.size());
+	CImageStorage::Encode(m_storage, m_pixels.data(), storage.data(), m_pixels.size());
+	if(m_storage != STORAGE_FLOAT)
+		std::cout << "  Pixel storage: " << CImageStorage::GetName(m_storage) << std::endl;
+
 	m_d_pixels = clCreateBuffer(ctx,
 			CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
-			sizeof(float) * m_pixels.size(),
-			m_pixels.data(),
+			storage.size(),
+			storage.data(),
 			&err);
 	V_RETURN_FALSE_CL(err, "Failed to allocate device memory");
 
@@ -58,10 +67,10 @@ InitResources(cl_device_id dev, cl_context ctx)
 
 
 	std::string src;
-	if(!CLUtil::LoadProgramSourceToMemory("histogram.cl", src))
+	if(!CImageStorage::LoadProgram("histogram.cl", src))
 		return false;
 
-	m_program = CLUtil::BuildCLProgramFromMemory(dev, ctx, src);
+	m_program = CLUtil::BuildCLProgramFromMemory(dev, ctx, src, CImageStorage::GetBuildOptions(m_storage, false));
 	if(!m_program)
 		return false;
 
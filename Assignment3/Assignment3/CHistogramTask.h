@@ -4,12 +4,14 @@
 #include <string>
 #include <vector>
 #include "../Common/IComputeTask.h"
+#include "ImageStorage.h"
 
 class CHistogramTask : public IComputeTask
 {
 public:
 	enum { NUM_HIST_BINS = 64 };
-	CHistogramTask(float min_val, float max_val, bool use_local_memory, const std::string &img_path);
+	CHistogramTask(float min_val, float max_val, bool use_local_memory, const std::string &img_path,
+			EImageStorage storage = STORAGE_FLOAT);
 	virtual ~CHistogramTask();
 
 	virtual bool InitResources(cl_device_id Device, cl_context Context) override;
@@ -22,6 +24,7 @@ protected:
 	float m_min_val = 0.0f, m_max_val = 1.0f;
 	const std::string m_img_path;
 	const bool m_use_local_memory;
+	const EImageStorage m_storage;  // format of the pixels on the device
 	int m_img_width = 0, m_img_height = 0, m_img_stride = 0;
 
 	cl_program m_program = nullptr;
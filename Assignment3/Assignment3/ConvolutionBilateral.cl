@@ -4,6 +4,9 @@
 #define DEPTH_THRESHOLD	0.025f
 #define NORM_THRESHOLD	0.9f
 
+// PIXEL_T is float4 if the image is stored as interleaved RGBA, the buffers hold STORAGE_T
+// (see ImageStorage.cl). Read them with LoadPixel() and write them with StorePixel().
+
 // These functions define discontinuities
 bool IsNormalDiscontinuity(float4 n1, float4 n2){
 	return fabs(dot(n1, n2)) < NORM_THRESHOLD;
@@ -157,8 +160,8 @@ void DiscontinuityVertical(
 //require matching work-group size
 __kernel __attribute__((reqd_work_group_size(H_GROUPSIZE_X, H_GROUPSIZE_Y, 1)))
 void ConvHorizontal(
-			__global float* d_Dst,
-			__global const float* d_Src,
+			__global STORAGE_T* d_Dst,
+			__global const STORAGE_T* d_Src,
 			__global const int* d_Disc,
 			__constant float* c_Kernel,
 			int Width,
@@ -171,7 +174,7 @@ void ConvHorizontal(
 	// This will be very similar to the separable convolution, except that you have
 	// also load the discontinuity buffer into the local memory
 	// Each work-item loads H_RESULT_STEPS values + 2 halo values
-	//__local float tile[H_GROUPSIZE_Y][(H_RESULT_STEPS + 2) * H_GROUPSIZE_X];
+	//__local PIXEL_T tile[H_GROUPSIZE_Y][(H_RESULT_STEPS + 2) * H_GROUPSIZE_X];
 	//__local int   disc[H_GROUPSIZE_Y][(H_RESULT_STEPS + 2) * H_GROUPSIZE_X];
 
 	// Load data to the tile and disc local arrays
@@ -198,8 +201,8 @@ void ConvHorizontal(
 //require matching work-group size
 __kernel __attribute__((reqd_work_group_size(V_GROUPSIZE_X, V_GROUPSIZE_Y, 1)))
 void ConvVertical(
-			__global float* d_Dst,
-			__global const float* d_Src,
+			__global STORAGE_T* d_Dst,
+			__global const STORAGE_T* d_Src,
 			__global const int* d_Disc,
 			__constant float* c_Kernel,
 			int Width,
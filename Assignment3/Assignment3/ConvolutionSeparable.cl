@@ -23,6 +23,12 @@
 #define V_GROUPSIZE_Y		32
 #define V_RESULT_STEPS		3
 
+//pixel type, float4 if the image is stored as interleaved RGBA
+#define PIXEL_T				float
+
+//optional: STORAGE_HALF or STORAGE_UCHAR for half or 8 bit buffers, float if neither is
+//defined (see ImageStorage.cl)
+
 */
 
 
@@ -39,8 +45,8 @@ c_Kernel stores 2 * KERNEL_RADIUS + 1 weights, use these during the convolution
 //require matching work-group size
 __kernel __attribute__((reqd_work_group_size(H_GROUPSIZE_X, H_GROUPSIZE_Y, 1)))
 void ConvHorizontal(
-			__global float* d_Dst,
-			__global const float* d_Src,
+			__global STORAGE_T* d_Dst,
+			__global const STORAGE_T* d_Src,
 			__constant float* c_Kernel,
 			int Width,
 			int Pitch
@@ -51,7 +57,7 @@ void ConvHorizontal(
 	//Since these loads are coalesced, they introduce no overhead, except for slightly redundant local memory allocation.
 	//Each work-item loads H_RESULT_STEPS values + 2 halo values
 	
-	__local float tile[H_GROUPSIZE_Y][(H_RESULT_STEPS + 2) * H_GROUPSIZE_X];
+	__local PIXEL_T tile[H_GROUPSIZE_Y][(H_RESULT_STEPS + 2) * H_GROUPSIZE_X];
 
 	// TODO:
 	
@@ -74,7 +80,7 @@ void ConvHorizontal(
 	// Load left halo (check for left bound)
 	if(( baseX + LID.x - H_GROUPSIZE_X ) >= 0 )
 	{
-		tile[ LID.y ][ LID.x ] = d_Src[ offset + LID.x - H_GROUPSIZE_X ] ;
+		tile[ LID.y ][ LID.x ] = LoadPixel( d_Src, offset + LID.x - H_GROUPSIZE_X ) ;
 	}
 	else
 	{
@@ -84,12 +90,12 @@ void ConvHorizontal(
 	// Load main data + right halo (check for right bound)
 	for (int tileID = 1; tileID <= H_RESULT_STEPS ; tileID++ )
 	{
-		tile[ LID.y ][ tileID * H_GROUPSIZE_X + LID.x ] = d_Src[ offset + LID.x + ( tileID - 1 ) * H_GROUPSIZE_X ] ;
+		tile[ LID.y ][ tileID * H_GROUPSIZE_X + LID.x ] = LoadPixel( d_Src, offset + LID.x + ( tileID - 1 ) * H_GROUPSIZE_X ) ;
 	}
 
 	if(( baseX + LID.x + H_GROUPSIZE_X * H_RESULT_STEPS ) < Width )
 	{
-		tile[ LID.y ][ LID.x + H_GROUPSIZE_X * ( H_RESULT_STEPS + 1 ) ] = d_Src[ offset + LID.x + H_RESULT_STEPS * H_GROUPSIZE_X ] ;
+		tile[ LID.y ][ LID.x + H_GROUPSIZE_X * ( H_RESULT_STEPS + 1 ) ] = LoadPixel( d_Src, offset + LID.x + H_RESULT_STEPS * H_GROUPSIZE_X ) ;
 	}
 	else
 	{
@@ -105,7 +111,7 @@ void ConvHorizontal(
 	
 	for (int tileID = 1; tileID <=H_RESULT_STEPS ; tileID++ )
 		{
-			float value = 0;
+			PIXEL_T value = 0;
 			//apply horizontal kernel
 			for(int k = -KERNEL_RADIUS; k <= KERNEL_RADIUS; k++)
 			{
@@ -113,7 +119,7 @@ void ConvHorizontal(
 				if(sx >= 0 && sx < (H_RESULT_STEPS + 2) * H_GROUPSIZE_X)
 					value += tile[LID.y][sx] * c_Kernel[KERNEL_RADIUS - k];
 			}
-			d_Dst[offset + LID.x + ( tileID - 1 ) * H_GROUPSIZE_X] = value ;
+			StorePixel( d_Dst, offset + LID.x + ( tileID - 1 ) * H_GROUPSIZE_X, value ) ;
 		
 		
 		}
@@ -126,14 +132,14 @@ void ConvHorizontal(
 //require matching work-group size
 __kernel __attribute__((reqd_work_group_size(V_GROUPSIZE_X, V_GROUPSIZE_Y, 1)))
 void ConvVertical(
-			__global float* d_Dst,
-			__global const float* d_Src,
+			__global STORAGE_T* d_Dst,
+			__global const STORAGE_T* d_Src,
 			__constant float* c_Kernel,
 			int Height,
 			int Pitch
 			)
 {
-	__local float tile[(V_RESULT_STEPS + 2) * V_GROUPSIZE_Y][V_GROUPSIZE_X];
+	__local PIXEL_T tile[(V_RESULT_STEPS + 2) * V_GROUPSIZE_Y][V_GROUPSIZE_X];
 
 	//TO DO:
 	
@@ -157,7 +163,7 @@ void ConvVertical(
 	
 	if(( baseY + LID.y - V_GROUPSIZE_Y ) >= 0 )
 	{
-		tile[ LID.y ][ LID.x ] = d_Src[ ( baseY + LID.y - V_GROUPSIZE_Y ) * Pitch + GID.x ] ;
+		tile[ LID.y ][ LID.x ] = LoadPixel( d_Src, ( baseY + LID.y - V_GROUPSIZE_Y ) * Pitch + GID.x ) ;
 	}
 	else
 	{
@@ -168,12 +174,12 @@ void ConvVertical(
 	
 	for (int tileID = 1; tileID <= H_RESULT_STEPS ; tileID++ )
 	{
-		tile[ tileID * V_GROUPSIZE_Y + LID.y ][ LID.x ] = d_Src[ ( baseY + ( tileID - 1 ) * V_GROUPSIZE_Y + LID.y ) * Pitch + GID.x ] ;
+		tile[ tileID * V_GROUPSIZE_Y + LID.y ][ LID.x ] = LoadPixel( d_Src, ( baseY + ( tileID - 1 ) * V_GROUPSIZE_Y + LID.y ) * Pitch + GID.x ) ;
 	}
 
 	if(( baseY + LID.y + V_GROUPSIZE_Y * H_RESULT_STEPS ) < Height )
 	{
-		tile[ LID.y + V_GROUPSIZE_Y * ( H_RESULT_STEPS + 1 ) ][ LID.x ] = d_Src[ ( baseY + H_RESULT_STEPS * V_GROUPSIZE_Y + LID.y ) * Pitch + GID.x ] ;
+		tile[ LID.y + V_GROUPSIZE_Y * ( H_RESULT_STEPS + 1 ) ][ LID.x ] = LoadPixel( d_Src, ( baseY + H_RESULT_STEPS * V_GROUPSIZE_Y + LID.y ) * Pitch + GID.x ) ;
 	}
 	else
 	{
@@ -187,7 +193,7 @@ void ConvVertical(
 
 	for (int tileID = 1; tileID <=H_RESULT_STEPS ; tileID++ )
 		{
-			float value = 0;
+			PIXEL_T value = 0;
 			//apply horizontal kernel
 			for(int k = -KERNEL_RADIUS; k <= KERNEL_RADIUS; k++)
 			{
@@ -195,7 +201,7 @@ void ConvVertical(
 				if(sy >= 0 && sy < (H_RESULT_STEPS + 2) * V_GROUPSIZE_Y )
 					value += tile[sy][LID.x] * c_Kernel[KERNEL_RADIUS - k];
 			}
-			d_Dst[ ( baseY + ( tileID - 1 ) * V_GROUPSIZE_Y + LID.y ) * Pitch + GID.x] = value ; 
+			StorePixel( d_Dst, ( baseY + ( tileID - 1 ) * V_GROUPSIZE_Y + LID.y ) * Pitch + GID.x, value ) ;
 		
 		}
 }
@@ -0,0 +1,43 @@
+
+// Storage formats of the image buffers, put in front of the convolution and histogram programs
+// by CImageStorage::LoadProgram(). The host defines PIXEL_T (float, or float4 for interleaved RGBA
+// pixels), PIXEL_CHANNELS and STORAGE_HALF or STORAGE_UCHAR. Without them the pixels are stored as float.
+//
+// The kernels compute in PIXEL_T only: LoadPixel(p, i) returns pixel i of the buffer p dequantized,
+// StorePixel(p, i, v) quantizes v (round to nearest even, uchar saturates [0, 1] to 0..255).
+
+#ifndef PIXEL_T
+#define PIXEL_T float
+#endif
+
+#if defined(STORAGE_HALF)
+
+// half is only used through pointers, cl_khr_fp16 is not needed
+#define STORAGE_T half
+#if PIXEL_CHANNELS == 4
+#define LoadPixel(p, i)			vload_half4((i), (p))
+#define StorePixel(p, i, v)		vstore_half4((v), (i), (p))
+#else
+#define LoadPixel(p, i)			vload_half((i), (p))
+#define StorePixel(p, i, v)		vstore_half((v), (i), (p))
+#endif
+
+#elif defined(STORAGE_UCHAR)
+
+#if PIXEL_CHANNELS == 4
+#define STORAGE_T uchar4
+#define LoadPixel(p, i)			(convert_float4((p)[i]) * (1.0f / 255.0f))
+#define StorePixel(p, i, v)		((p)[i] = convert_uchar4_sat_rte((v) * 255.0f))
+#else
+#define STORAGE_T uchar
+#define LoadPixel(p, i)			(convert_float((p)[i]) * (1.0f / 255.0f))
+#define StorePixel(p, i, v)		((p)[i] = convert_uchar_sat_rte((v) * 255.0f))
+#endif
+
+#else
+
+#define STORAGE_T PIXEL_T
+#define LoadPixel(p, i)			((p)[i])
+#define StorePixel(p, i, v)		((p)[i] = (v))
+
+#endif
@@ -0,0 +1,200 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "ImageStorage.h"
+
+#include "../Common/CLUtil.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CImageStorage
+
+const char* CImageStorage::GetName(EImageStorage Storage)
+{
+	switch(Storage)
+	{
+	case STORAGE_HALF: return "half";
+	case STORAGE_UCHAR: return "uchar";
+	default: return "float";
+	}
+}
+
+size_t CImageStorage::GetSize(EImageStorage Storage)
+{
+	switch(Storage)
+	{
+	case STORAGE_HALF: return sizeof(cl_half);
+	case STORAGE_UCHAR: return sizeof(cl_uchar);
+	default: return sizeof(cl_float);
+	}
+}
+
+string CImageStorage::GetBuildOptions(EImageStorage Storage, bool Interleaved)
+{
+	string options = Interleaved ? " -D PIXEL_T=float4 -D PIXEL_CHANNELS=4" : " -D PIXEL_T=float -D PIXEL_CHANNELS=1";
+	if(Storage == STORAGE_HALF)
+		options += " -D STORAGE_HALF";
+	else if(Storage == STORAGE_UCHAR)
+		options += " -D STORAGE_UCHAR";
+	return options;
+}
+
+bool CImageStorage::LoadProgram(const string& FileName, string& ProgramCode)
+{
+	string storageCode, programCode;
+	if(!CLUtil::LoadProgramSourceToMemory("ImageStorage.cl", storageCode) ||
+		!CLUtil::LoadProgramSourceToMemory(FileName, programCode))
+		return false;
+
+	ProgramCode = storageCode + "\n" + programCode;
+	return true;
+}
+
+void CImageStorage::Encode(EImageStorage Storage, const float* In, void* Out, size_t Count)
+{
+	if(Storage == STORAGE_HALF)
+	{
+		cl_half* out = (cl_half*)Out;
+		for(size_t i = 0; i < Count; i++)
+			out[i] = FloatToHalf(In[i]);
+	}
+	else if(Storage == STORAGE_UCHAR)
+	{
+		cl_uchar* out = (cl_uchar*)Out;
+		for(size_t i = 0; i < Count; i++)
+			out[i] = FloatToUChar(In[i]);
+	}
+	else
+		memcpy(Out, In, Count * sizeof(float));
+}
+
+void CImageStorage::Decode(EImageStorage Storage, const void* In, float* Out, size_t Count)
+{
+	if(Storage == STORAGE_HALF)
+	{
+		const cl_half* in = (const cl_half*)In;
+		for(size_t i = 0; i < Count; i++)
+			Out[i] = HalfToFloat(in[i]);
+	}
+	else if(Storage == STORAGE_UCHAR)
+	{
+		// the same expression as LoadPixel() in ImageStorage.cl
+		const cl_uchar* in = (const cl_uchar*)In;
+		for(size_t i = 0; i < Count; i++)
+			Out[i] = (float)in[i] * (1.0f / 255.0f);
+	}
+	else
+		memcpy(Out, In, Count * sizeof(float));
+}
+
+float CImageStorage::Quantize(EImageStorage Storage, float Value)
+{
+	if(Storage == STORAGE_HALF)
+		return HalfToFloat(FloatToHalf(Value));
+	if(Storage == STORAGE_UCHAR)
+		return (float)FloatToUChar(Value) * (1.0f / 255.0f);
+	return Value;
+}
+
+void CImageStorage::Quantize(EImageStorage Storage, float* Values, size_t Count)
+{
+	if(Storage == STORAGE_FLOAT)
+		return;
+	for(size_t i = 0; i < Count; i++)
+		Values[i] = Quantize(Storage, Values[i]);
+}
+
+float CImageStorage::GetStep(EImageStorage Storage, float Value)
+{
+	if(Storage == STORAGE_UCHAR)
+		return 1.0f / 255.0f;
+	if(Storage != STORAGE_HALF)
+		return 0.0f;
+
+	// 10 mantissa bits, the subnormals are 2^-24 apart
+	int exponent;
+	frexp(Value, &exponent);
+	return max(ldexp(1.0f, exponent - 11), ldexp(1.0f, -24));
+}
+
+cl_half CImageStorage::FloatToHalf(float Value)
+{
+	cl_uint bits;
+	memcpy(&bits, &Value, sizeof(bits));
+	cl_uint sign = (bits >> 16) & 0x8000;
+	cl_uint abs = bits & 0x7FFFFFFF;
+
+	// infinity and NaN (keeping it quiet)
+	if(abs >= 0x7F800000)
+		return (cl_half)(sign | 0x7C00 | (abs > 0x7F800000 ? 0x200 : 0));
+	// rounds to infinity from 65520 on
+	if(abs >= 0x477FF000)
+		return (cl_half)(sign | 0x7C00);
+
+	cl_uint half, rest, tie;
+	if(abs < 0x38800000)
+	{
+		// below 2^-14 the result is subnormal, below 2^-25 it rounds to zero
+		if(abs < 0x33000000)
+			return (cl_half)sign;
+		cl_uint mantissa = (abs & 0x7FFFFF) | 0x800000;
+		cl_uint shift = 126 - (abs >> 23);
+		half = mantissa >> shift;
+		rest = mantissa & ((1u << shift) - 1);
+		tie = 1u << (shift - 1);
+	}
+	else
+	{
+		// rebias the exponent from 127 to 15, a carry out of the mantissa increments the exponent
+		half = (abs - 0x38000000) >> 13;
+		rest = abs & 0x1FFF;
+		tie = 0x1000;
+	}
+	if(rest > tie || (rest == tie && (half & 1)))
+		half++;
+
+	return (cl_half)(sign | half);
+}
+
+float CImageStorage::HalfToFloat(cl_half Value)
+{
+	cl_uint sign = (cl_uint)(Value & 0x8000) << 16;
+	cl_uint exponent = (Value >> 10) & 0x1F;
+	cl_uint mantissa = Value & 0x3FF;
+
+	if(exponent == 0)
+	{
+		float value = ldexp((float)mantissa, -24);
+		return sign ? -value : value;
+	}
+
+	cl_uint bits = sign | (mantissa << 13);
+	if(exponent == 31)
+		bits |= 0x7F800000;
+	else
+		bits |= (exponent + 112) << 23;
+
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+unsigned char CImageStorage::FloatToUChar(float Value)
+{
+	// convert_uchar_sat_rte(Value * 255.0f), NaN becomes 0
+	float scaled = Value * 255.0f;
+	if(!(scaled > 0.0f))
+		return 0;
+	if(scaled >= 255.0f)
+		return 255;
+	return (unsigned char)nearbyint(scaled);
+}
+
+///////////////////////////////////////////////////////////////////////////////
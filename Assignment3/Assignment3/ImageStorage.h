@@ -0,0 +1,76 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _IMAGE_STORAGE_H
+#define _IMAGE_STORAGE_H
+
+#include "../Common/IComputeTask.h"
+
+#include <string>
+
+//! Storage formats of the image buffers on the device
+enum EImageStorage
+{
+	STORAGE_FLOAT,
+	STORAGE_HALF,	// 16 bit float, vload_half / vstore_half
+	STORAGE_UCHAR	// 8 bit, [0, 1] mapped to 0..255 with saturation
+};
+
+//! Helpers for the image storage formats
+/*!
+	The kernels always compute in float. ImageStorage.cl is put in front of the
+	program code and provides STORAGE_T, LoadPixel() (dequantizes) and StorePixel()
+	(quantizes). The host functions round exactly like the kernels, so the CPU
+	references can work on the values that the device sees.
+*/
+class CImageStorage
+{
+public:
+	static const char* GetName(EImageStorage Storage);
+
+	// bytes per channel value
+	static size_t GetSize(EImageStorage Storage);
+
+	// defines for ImageStorage.cl, PIXEL_T is float4 for interleaved RGBA pixels
+	static std::string GetBuildOptions(EImageStorage Storage, bool Interleaved);
+
+	// ImageStorage.cl followed by the code of the given program
+	static bool LoadProgram(const std::string& FileName, std::string& ProgramCode);
+
+	// float <-> storage format
+	static void Encode(EImageStorage Storage, const float* In, void* Out, size_t Count);
+	static void Decode(EImageStorage Storage, const void* In, float* Out, size_t Count);
+
+	// the value after a round trip through the storage format
+	static float Quantize(EImageStorage Storage, float Value);
+	static void Quantize(EImageStorage Storage, float* Values, size_t Count);
+
+	// distance between Value and the next value of the storage format, 0 for float
+	static float GetStep(EImageStorage Storage, float Value);
+
+	// IEEE 754 binary16, round to nearest even
+	static cl_half FloatToHalf(float Value);
+	static float HalfToFloat(cl_half Value);
+
+protected:
+	static unsigned char FloatToUChar(float Value);
+};
+
+#endif // _IMAGE_STORAGE_H
@@ -3,6 +3,16 @@
 #include <string.h>
 
 #include <cstring>
+#include <cctype>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #ifdef _MSC_VER
 #pragma warning(disable: 4996) //fopen
@@ -23,32 +33,7 @@ PFM::~PFM(){
 //load a bitmap from a file and represent it correctly
 //in memory
 bool PFM::LoadRGB(const char *file) {
-
-	Release();
-
-	FILE *f = fopen( file, "rb" );
-
-	if ( !f )  {
-		fprintf( stderr, "PFM::Load: Error opening file '%s'\n", file );
-		return false;
-	}
-
-	char tmp[ 1024 ];
-	fscanf( f, "%s\n", tmp );
-	if ( strcmp( tmp, "PF" ) != 0 )
-		return false;
-
-	fscanf( f, "%d%d", &width, &height );
-	float sc;
-	fscanf( f, "%f", &sc );
-
-	pImg = new float[ width * height * 3];
-
-	fread( pImg, 1, 1, f);
-	fread( pImg, sizeof(float) * 3, width * height, f);
-
-	fclose( f );
-	return true;
+	return Load(file, 3);
 }
 
 bool PFM::SaveRGB(const char* file) {
@@ -76,32 +61,7 @@ bool PFM::SaveRGB(const char* file) {
 //load a bitmap from a file and represent it correctly
 //in memory
 bool PFM::LoadGrayscale(const char *file) {
-
-	Release();
-
-	FILE *f = fopen( file, "rb" );
-
-	if ( !f )  {
-		fprintf( stderr, "PFM::Load: Error opening file '%s'\n", file );
-		return false;
-	}
-
-	char tmp[ 1024 ];
-	fscanf( f, "%s\n", tmp );
-	if ( strcmp( tmp, "Pf" ) != 0 )
-		return false;
-
-	fscanf( f, "%d%d", &width, &height );
-	float sc;
-	fscanf( f, "%f", &sc );
-
-	pImg = new float[ width * height];
-
-	fread( pImg, 1, 1, f);
-	fread( pImg, sizeof(float), width * height, f );
-
-	fclose( f );
-	return true;
+	return Load(file, 1);
 }
 
 bool PFM::SaveGrayscale(const char* file) {
@@ -135,4 +95,156 @@ void PFM::Reset(void) {
 void PFM::Release(void){
 	if (pImg)
 		delete [] pImg;
+	Reset();
+}
+
+//copies the payload of a mapped file with the given number of channels
+bool PFM::Load(const char *file, int channels) {
+
+	Release();
+
+	PFMMapping map;
+	if ( !map.Open( file ) )
+		return false;
+
+	if ( map.channels != channels ) {
+		fprintf( stderr, "PFM::Load: '%s' has %d channel(s), expected %d\n", file, map.channels, channels );
+		return false;
+	}
+
+	width = map.width;
+	height = map.height;
+
+	size_t count = (size_t)width * height * channels;
+	pImg = new float[ count ];
+
+	if ( !map.swap )
+		memcpy( pImg, map.pData, count * sizeof(float) );
+	else
+		for ( size_t i = 0; i < count; i++ )
+			pImg[ i ] = map.Get( i );
+
+	return true;
+}
+
+
+
+//basic constructor
+PFMMapping::PFMMapping() {
+	width = 0;
+	height = 0;
+	channels = 0;
+	scale = 0.0f;
+	swap = false;
+	pData = NULL;
+	pMapping = NULL;
+	size = 0;
+}
+
+//destructor
+PFMMapping::~PFMMapping() {
+	Close();
+}
+
+//map a file and check its header
+bool PFMMapping::Open(const char *file) {
+
+	Close();
+
+#ifdef _WIN32
+	HANDLE hFile = CreateFileA( file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+	if ( hFile == INVALID_HANDLE_VALUE ) {
+		fprintf( stderr, "PFM::Load: Error opening file '%s'\n", file );
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	HANDLE hMapping = NULL;
+	if ( GetFileSizeEx( hFile, &fileSize ) && fileSize.QuadPart > 0 )
+		hMapping = CreateFileMappingA( hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+	if ( hMapping ) {
+		pMapping = MapViewOfFile( hMapping, FILE_MAP_READ, 0, 0, 0 );
+		size = (size_t)fileSize.QuadPart;
+		//the view keeps the mapping alive
+		CloseHandle( hMapping );
+	}
+	CloseHandle( hFile );
+#else
+	int fd = open( file, O_RDONLY );
+	if ( fd < 0 ) {
+		fprintf( stderr, "PFM::Load: Error opening file '%s'\n", file );
+		return false;
+	}
+	struct stat st;
+	if ( fstat( fd, &st ) == 0 && st.st_size > 0 ) {
+		void *p = mmap( NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if ( p != MAP_FAILED ) {
+			pMapping = p;
+			size = (size_t)st.st_size;
+			//the payload is read front to back
+			madvise( pMapping, size, MADV_SEQUENTIAL );
+		}
+	}
+	//the mapping keeps the file alive
+	close( fd );
+#endif
+
+	if ( !pMapping ) {
+		fprintf( stderr, "PFM::Load: Error mapping file '%s'\n", file );
+		return false;
+	}
+
+	//the header is text, a zero terminated copy of its beginning is enough to parse it
+	char header[ 256 ];
+	size_t headerSize = size < sizeof(header) - 1 ? size : sizeof(header) - 1;
+	memcpy( header, pMapping, headerSize );
+	header[ headerSize ] = 0;
+
+	char magic[ 4 ];
+	int offset = 0;
+	if ( sscanf( header, "%3s %d %d %f%n", magic, &width, &height, &scale, &offset ) != 4 ||
+		(size_t)offset >= headerSize || !isspace( (unsigned char)header[ offset ] ) ) {
+		fprintf( stderr, "PFM::Load: '%s' has no valid PFM header\n", file );
+		Close();
+		return false;
+	}
+	//exactly one whitespace character separates the header from the pixels
+	offset++;
+
+	if ( strcmp( magic, "PF" ) == 0 )
+		channels = 3;
+	else if ( strcmp( magic, "Pf" ) == 0 )
+		channels = 1;
+
+	size_t payload = (size_t)width * height * channels * sizeof(float);
+	if ( channels == 0 || width <= 0 || height <= 0 || !(scale != 0.0f) ||
+		payload / ((size_t)width * channels * sizeof(float)) != (size_t)height || size - offset < payload ) {
+		fprintf( stderr, "PFM::Load: '%s' is not a valid %dx%d PFM file\n", file, width, height );
+		Close();
+		return false;
+	}
+
+	const uint16_t one = 1;
+	bool hostLittleEndian = *(const unsigned char *)&one == 1;
+	swap = (scale < 0.0f) != hostLittleEndian;
+	pData = (const unsigned char *)pMapping + offset;
+
+	return true;
+}
+
+void PFMMapping::Close(void) {
+	if ( pMapping ) {
+#ifdef _WIN32
+		UnmapViewOfFile( pMapping );
+#else
+		munmap( pMapping, size );
+#endif
+	}
+	width = 0;
+	height = 0;
+	channels = 0;
+	scale = 0.0f;
+	swap = false;
+	pData = NULL;
+	pMapping = NULL;
+	size = 0;
 }
@@ -4,9 +4,54 @@
 #include <iostream>
 #include <cstdio>
 #include <string>
+#include <cstring>
+#include <stdint.h>
 using namespace std;
 
 
+//! Read-only memory mapping of a PFM file
+/*!
+	Open() maps the whole file and validates the header ("PF" for RGB, "Pf" for grayscale,
+	width, height and scale). pData then points directly to the pixels inside the mapping,
+	nothing is copied. The sign of the scale gives the byte order of the file (negative:
+	little endian), swap is set if it differs from this machine. The payload starts right
+	after the header and is not necessarily aligned, so the pixels are read with Get().
+*/
+class PFMMapping {
+public:
+
+	//variables
+	int width;
+	int height;
+	int channels;
+	float scale;
+	bool swap;
+	const unsigned char *pData;
+
+	//methods
+	PFMMapping(void);
+	~PFMMapping();
+	bool Open(const char *);
+	void Close(void);
+
+	//value i of the interleaved payload, in host byte order
+	float Get(size_t i) const {
+		uint32_t bits;
+		memcpy(&bits, pData + i * sizeof(float), sizeof(bits));
+		if (swap)
+			bits = (bits << 24) | ((bits << 8) & 0x00FF0000) | ((bits >> 8) & 0x0000FF00) | (bits >> 24);
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+private:
+
+	void *pMapping;
+	size_t size;
+};
+
+
 class PFM {
 public:
 
@@ -29,6 +74,7 @@ private:
     //methods
     void Reset(void);
 	void Release(void);
+	bool Load(const char *, int);
 };
 
 #endif //_BITMAP_H
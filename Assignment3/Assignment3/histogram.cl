@@ -14,7 +14,7 @@ set_array_to_constant(
 __kernel void
 compute_histogram(
 	__global int *histogram,   // accumulate histogram here
-	__global const float *img, // input image
+	__global const STORAGE_T *img, // input image (see ImageStorage.cl)
 	int width,                 // image width
 	int height,                // image height
 	int pitch,                 // image pitch
@@ -28,7 +28,7 @@ compute_histogram(
 	GID.y = get_global_id(1);	
 	if( ( GID.y < height ) && ( GID.x < width ) )
 	{
-		float p = img[GID.y * pitch + GID.x] * (float)(num_hist_bins);
+		float p = LoadPixel(img, GID.y * pitch + GID.x) * (float)(num_hist_bins);
 		int h_idx = (int)min(num_hist_bins - 1, (int)max(0, (int)(p)));
 		atomic_add( &histogram[h_idx] , 1 ) ;
 	}
@@ -38,7 +38,7 @@ compute_histogram(
 __kernel void
 compute_histogram_local_memory(
 	__global int *histogram,   // accumulate histogram here
-	__global const float *img, // input image
+	__global const STORAGE_T *img, // input image (see ImageStorage.cl)
 	int width,                 // image width
 	int height,                // image height
 	int pitch,                 // image pitch
@@ -68,7 +68,7 @@ compute_histogram_local_memory(
 	
 	if( ( GID.y < height ) && ( GID.x < width ) )
 	{
-		float p = img[GID.y * pitch + GID.x] * (float)(num_hist_bins);
+		float p = LoadPixel(img, GID.y * pitch + GID.x) * (float)(num_hist_bins);
 		int h_idx = (int)min(num_hist_bins - 1, (int)max(0, (int)(p)));
 		atomic_add( &local_hist[h_idx] , 1 ) ;
 	}
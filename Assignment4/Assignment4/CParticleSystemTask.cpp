@@ -23,7 +23,6 @@ GPU Computing / GPGPU Praktikum source code.
 #include "CL/cl_gl.h"
 
 #define NUM_FORCE_LINES		4096
-#define NUM_BANKS	32
 
 using namespace std;
 using namespace hlsl;
@@ -52,18 +51,6 @@ CParticleSystemTask::CParticleSystemTask(
 
 	for(unsigned int i = 0; i < 3; i++)
 		m_LocalWorkSize[i] = LocalWorkSize[i];
-	
-	// compute the number of levels that we need for the work-efficient algorithm
-	m_nLevels = 1;
-	unsigned int N = NParticles;
-	while (N > 0){
-		N /= 2 * LocalWorkSize[0];
-		m_nLevels++;
-	}
-	m_clLevelArrays = new cl_mem[m_nLevels];
-
-	for (unsigned int i = 0; i < m_nLevels; i++)
-		m_clLevelArrays[i] = NULL;
 
 	for(int i = 0; i < 255; i++)
 	{
@@ -192,26 +179,15 @@ bool CParticleSystemTask::InitResources(cl_device_id Device, cl_context Context)
 	m_clTriangleSoup = clCreateBuffer(Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, m_nTriangles * 3 * sizeof(cl_float4), pTriangles, &clError2);
 	clError |= clError2;
 	delete pTriangles;
-
-	m_clPingArray = clCreateBuffer(Context, CL_MEM_READ_WRITE, m_nParticles * sizeof(cl_uint) * 2, NULL, &clError2);
-	clError |= clError2;
-	m_clPongArray = clCreateBuffer(Context, CL_MEM_READ_WRITE, m_nParticles * sizeof(cl_uint) * 2, NULL, &clError2);
-	clError |= clError2;
 	V_RETURN_FALSE_CL(clError, "Error allocating device arrays");
 
 
 	SAFE_DELETE_ARRAY(pPosLife);
 	SAFE_DELETE_ARRAY(pVelMass);
 
-	// Scan arrays
-	unsigned int N = m_nParticles * 2;
-	for (unsigned int i = 0; i < m_nLevels; i++) {
-		m_clLevelArrays[i] = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * N, NULL, &clError2);
-		clError |= clError2;
-		N = std::max(N / (2 * m_LocalWorkSize[0]), m_LocalWorkSize[0]);
-	}
-	V_RETURN_FALSE_CL(clError, "Error allocating device arrays");
-
+	// the compaction kernels are built on first use
+	if(!m_Primitives.Init(Device, Context))
+		return false;
 
 
 	//shader programs
@@ -282,21 +258,6 @@ bool CParticleSystemTask::InitResources(cl_device_id Device, cl_context Context)
 	V_RETURN_FALSE_CL(clError, "Failed to create Integrate kernel.");
 	m_ClearKernel = clCreateKernel(m_PSystemProgram, "Clear", &clError);
 	V_RETURN_FALSE_CL(clError, "Failed to create Clear kernel.");
-	m_ReorganizeKernel = clCreateKernel(m_PSystemProgram, "Reorganize", &clError);
-	V_RETURN_FALSE_CL(clError, "Failed to create Reorganize kernel.");
-
-	// Scan kernels
-	CLUtil::LoadProgramSourceToMemory("Scan.cl", programCode);
-	m_ScanProgram = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode);
-	if(!m_ScanProgram)
-		return false;
-
-	m_ScanKernel = clCreateKernel(m_ScanProgram, "Scan", &clError);
-	V_RETURN_FALSE_CL(clError, "Failed to create Scan kernel.");
-	m_ScanAddKernel = clCreateKernel(m_ScanProgram, "ScanAdd", &clError);
-	V_RETURN_FALSE_CL(clError, "Failed to create ScanAdd kernel.");
-	m_ScanNaiveKernel = clCreateKernel(m_ScanProgram, "ScanNaive", &clError);
-	V_RETURN_FALSE_CL(clError, "Failed to create Scan kernel.");
 
 	// Load volume data
 	m_volumeRes[0] = m_volumeRes[1] = m_volumeRes[2] = 128;
@@ -377,9 +338,6 @@ bool CParticleSystemTask::InitResources(cl_device_id Device, cl_context Context)
 	clError |= clSetKernelArg(m_IntegrateKernel, 4, sizeof(cl_uint), (void*)&m_nTriangles);
 	V_RETURN_FALSE_CL(clError, "Failed to set args for m_IntegrateKernel");
 
-	clError  = clSetKernelArg(m_ReorganizeKernel, 0, sizeof(cl_mem), (void*)&m_clAlive);
-	V_RETURN_FALSE_CL(clError, "Failed to set args for m_ReorganizeKernel");
-
 	//set the modelview matrix
 	glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
@@ -408,25 +366,14 @@ void CParticleSystemTask::ReleaseResources()
 	SAFE_RELEASE_MEMOBJECT(m_clVelMass[1]);
 	SAFE_RELEASE_MEMOBJECT(m_clAlive);
 	SAFE_RELEASE_MEMOBJECT(m_clTriangleSoup);
-	SAFE_RELEASE_MEMOBJECT(m_clPingArray);
-	SAFE_RELEASE_MEMOBJECT(m_clPongArray);
 	SAFE_RELEASE_MEMOBJECT(m_clVolTex3D);
-	if (m_clLevelArrays)
-		for (unsigned int i = 0; i < m_nLevels; i++)
-			SAFE_RELEASE_MEMOBJECT(m_clLevelArrays[i]);
-	
-	SAFE_DELETE_ARRAY(m_clLevelArrays);
 
-	SAFE_RELEASE_SAMPLER(m_LinearSampler);
+	m_Primitives.Release();
 
-	SAFE_RELEASE_KERNEL(m_ScanKernel);
-	SAFE_RELEASE_KERNEL(m_ScanAddKernel);
-	SAFE_RELEASE_KERNEL(m_ScanNaiveKernel);
-	SAFE_RELEASE_PROGRAM(m_ScanProgram);
+	SAFE_RELEASE_SAMPLER(m_LinearSampler);
 
 	SAFE_RELEASE_KERNEL(m_IntegrateKernel);
 	SAFE_RELEASE_KERNEL(m_ClearKernel);
-	SAFE_RELEASE_KERNEL(m_ReorganizeKernel);
 	SAFE_RELEASE_PROGRAM(m_PSystemProgram);	
 
 	SAFE_RELEASE_GL_BUFFER(m_glForceLines);
@@ -467,11 +414,8 @@ void CParticleSystemTask::ComputeGPU(cl_context Context, cl_command_queue Comman
 	// (If you are doing the smaller course, ignore these lines)
 	//********************************************************
 
-	// TO DO: 
-	// Enable these once you implement them
 	// Stream compaction
-	//Scan(Context, CommandQueue, LocalWorkSize);
-	//Reorganize(Context, CommandQueue, LocalWorkSize);
+	Reorganize(Context, CommandQueue, LocalWorkSize);
 
 
 	V_RETURN_CL(clEnqueueReleaseGLObjects(CommandQueue, 1, &m_clPosLife[0], 0, NULL, NULL),  "Error releasing OpenGL buffer.");
@@ -655,21 +599,6 @@ void CParticleSystemTask::OnWindowResized(int Width, int Height)
     gluPerspective(60.0, (GLfloat)Width / (GLfloat) Height, 0.1, 10.0);
 }
 
-void CParticleSystemTask::Scan(cl_context , cl_command_queue CommandQueue, size_t LocalWorkSize[3])
-{
-
-
-	//********************************************************
-	// GPU Computing only!
-	// (If you are doing the smaller course, ignore this function)
-	//********************************************************
-
-	// Add your favorite prefix sum code here from Assignment 2 :)
-
-
-}
-
-
 void CParticleSystemTask::Integrate(cl_context , cl_command_queue CommandQueue, size_t LocalWorkSize[3], float dT)
 {
 	cl_int clErr;
@@ -702,12 +631,27 @@ void CParticleSystemTask::Reorganize(cl_context , cl_command_queue CommandQueue,
 	// (If you are doing the smaller course, ignore this function)
 	//********************************************************
 
-	// Clear
-	// ADD YOUR CODE HERE
-
-	// Reorganize (perform the actual compaction)
-	// ADD YOUR CODE HERE
-
+	cl_int clErr;
+	size_t globalWorkSize[1];
+	cl_uint nSlots = m_nParticles * 2;
+
+	// Clear: the alive particles only fill the front of the target arrays
+	globalWorkSize[0] = CLUtil::GetGlobalWorkSize(nSlots, LocalWorkSize[0]);
+	clErr  = clSetKernelArg(m_ClearKernel, 0, sizeof(cl_mem), (void*)&m_clPosLife[1]);
+	clErr |= clSetKernelArg(m_ClearKernel, 1, sizeof(cl_mem), (void*)&m_clVelMass[1]);
+	clErr |= clSetKernelArg(m_ClearKernel, 2, sizeof(cl_uint), (void*)&nSlots);
+	V_RETURN_CL(clErr, "Failed to set args for m_ClearKernel");
+	clErr = clEnqueueNDRangeKernel(CommandQueue, m_ClearKernel, 1, NULL, globalWorkSize, LocalWorkSize, 0, NULL, NULL);
+	V_RETURN_CL(clErr, "Error executing m_ClearKernel!");
+
+	// Reorganize: flags, scan and scatter in one pass for both arrays, the alive flags cover
+	// the particles and the emitted ones in the second half
+	if(!m_Primitives.CompactPair(CommandQueue, m_clPosLife[0], m_clPosLife[1], m_clVelMass[0], m_clVelMass[1], nSlots,
+		sizeof(cl_float4), m_clAlive))
+	{
+		cerr<<"Error compacting the particles."<<endl;
+		return;
+	}
 
 	std::swap(m_clPosLife[0],	 m_clPosLife[1]);
 	std::swap(m_clVelMass[0],	 m_clVelMass[1]);
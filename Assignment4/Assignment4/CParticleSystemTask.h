@@ -21,6 +21,7 @@
 #define _CPARTICLE_SYSTEM_TASK_H
 
 #include "../Common/IGUIEnabledComputeTask.h"
+#include "../Common/CDevicePrimitives.h"
 
 #include "CTriMesh.h"
 #include "CGLTexture.h"
@@ -69,7 +70,6 @@ public:
 
 protected:
 
-	void Scan(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
 	void Integrate(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3], float dT);
 	void Reorganize(cl_context Context, cl_command_queue CommandQueue, size_t LocalWorkSize[3]);
 
@@ -91,27 +91,16 @@ protected:
 	cl_mem				m_clVelMass[2] /*= { nullptr, nullptr }*/;
 	cl_mem				m_clAlive = nullptr;
 	cl_mem				m_clTriangleSoup = nullptr;
-	cl_mem				m_clRank = nullptr;
 	cl_mem				m_clVolTex3D = nullptr;
-	cl_mem				m_clPingArray = nullptr;
-	cl_mem				m_clPongArray = nullptr;
-
-	// arrays for each level of the work-efficient scan
-	unsigned int		m_nLevels = 0;
-	cl_mem				*m_clLevelArrays = nullptr;
 
+	// stream compaction of the particles (and its temporary buffers)
+	CDevicePrimitives	m_Primitives;
 
 	// OpenCL program and kernels
 	cl_sampler			m_LinearSampler = nullptr;
 	cl_program			m_PSystemProgram = nullptr;
 	cl_kernel			m_IntegrateKernel = nullptr;
 	cl_kernel			m_ClearKernel = nullptr;
-	cl_kernel			m_ReorganizeKernel = nullptr;
-
-	cl_program			m_ScanProgram = nullptr;
-	cl_kernel			m_ScanKernel = nullptr;
-	cl_kernel			m_ScanAddKernel = nullptr;
-	cl_kernel			m_ScanNaiveKernel = nullptr;
 
 	// OpenGL variables
 	//these will be used as VBOs
@@ -269,37 +269,12 @@ __kernel void Integrate(__global uint *gAlive,
 
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-__kernel void Clear(__global float4* gPosLife, __global float4* gVelMass) {
+// The stream compaction itself runs in CDevicePrimitives::Compact() (Common/CompactPrimitive.cl),
+// Clear zeroes the target arrays beforehand
+__kernel void Clear(__global float4* gPosLife, __global float4* gVelMass, uint nElements) {
 	uint GID = get_global_id(0);
+	if (GID >= nElements)
+		return;
 	gPosLife[GID] = 0.f;
 	gVelMass[GID] = 0.f;
-}
-
-
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-__kernel void Reorganize(	__global uint* gAlive, __global uint* gRank,	
-							__global float4* gPosLifeIn,  __global float4* gVelMassIn,
-							__global float4* gPosLifeOut, __global float4* gVelMassOut) {
-
-
-	// Re-order the particles according to the gRank obtained from the parallel prefix sum
-	// ADD YOUR CODE HERE
-	int GID = get_global_id(0) ;
-	
-	if( gAlive[GID] )
-	{
-		int idx = gRank[GID] - 1 ;
-		gPosLifeOut[idx] = gPosLifeIn[GID] ;
-		gVelMassOut[idx] = gVelMassIn[GID] ;
-	
-	}
-	
-	
-	
-	
-	
-	
-	
-	
-
 }
@@ -0,0 +1,246 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CCompactPrimitive.h"
+
+#include "CLUtil.h"
+
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CCompactPrimitive
+
+CCompactPrimitive::CCompactPrimitive(const string& Type, const string& Predicate, size_t LocalWorkSize, size_t ItemsPerThread)
+	: m_Type(Type), m_Predicate(Predicate), m_LocalWorkSize(LocalWorkSize),
+	m_ItemsPerThread(ItemsPerThread), m_TileSize(LocalWorkSize * ItemsPerThread), m_UseLookBack(false), m_UseSubGroups(false),
+	m_Context(NULL), m_Program(NULL), m_CountKernel(NULL), m_CompactKernel(NULL), m_ReverseKernel(NULL),
+	m_Scan(MakeScanDesc<cl_uint, SScanSumOp>(true), LocalWorkSize, ItemsPerThread),
+	m_Epoch(0), m_TempCapacity(0), m_dTileCounter(NULL), m_dTileFlags(NULL), m_dTileAggregate(NULL), m_dTilePrefix(NULL), m_dCount(NULL)
+{
+}
+
+CCompactPrimitive::~CCompactPrimitive()
+{
+	Release();
+}
+
+string CCompactPrimitive::GetProgramHeader() const
+{
+	stringstream header;
+	header<<"#define VALUE_T "<<m_Type<<endl;
+	header<<"#define BLOCK_SIZE "<<m_LocalWorkSize<<endl;
+	header<<"#define ITEMS_PER_THREAD "<<m_ItemsPerThread<<endl;
+	if(m_UseLookBack)
+		header<<"#define LOOK_BACK"<<endl;
+	if(m_UseSubGroups)
+		header<<"#define USE_SUBGROUPS"<<endl;
+	if(HasPredicate())
+	{
+		header<<"#define PREDICATE"<<endl;
+		header<<"inline bool Predicate(VALUE_T x, uint i) { return "<<m_Predicate<<"; }"<<endl;
+	}
+	return header.str();
+}
+
+bool CCompactPrimitive::Init(cl_device_id Device, cl_context Context)
+{
+	m_Context = Context;
+
+	// forward progress between work-groups, see the look-back in Assignment2/CScanTask
+	cl_device_type deviceType;
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_TYPE, sizeof(deviceType), &deviceType, NULL), "Error querying the device type");
+	m_UseLookBack = (deviceType & CL_DEVICE_TYPE_GPU) != 0;
+
+	// the sub-group builtins need the extension and OpenCL C 2.0 or later
+	size_t extSize = 0, versionSize = 0;
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_EXTENSIONS, 0, NULL, &extSize), "Error querying the device extensions");
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_OPENCL_C_VERSION, 0, NULL, &versionSize), "Error querying the OpenCL C version");
+	vector<char> extensions(extSize + 1, 0), version(versionSize + 1, 0);
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_EXTENSIONS, extSize, &extensions[0], NULL),
+		"Error querying the device extensions");
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_OPENCL_C_VERSION, versionSize, &version[0], NULL),
+		"Error querying the OpenCL C version");
+	// "OpenCL C <major>.<minor> <vendor info>"
+	int major = strncmp(&version[0], "OpenCL C ", 9) == 0 ? atoi(&version[9]) : 0;
+	m_UseSubGroups = strstr(&extensions[0], "cl_khr_subgroups") != NULL && major >= 2;
+
+	string programCode;
+	if(!CLUtil::LoadProgramSourceToMemory("../Common/CompactPrimitive.cl", programCode))
+		return false;
+
+	stringstream options;
+	if(m_UseSubGroups)
+		options<<"-cl-std=CL"<<major<<".0";
+	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, GetProgramHeader() + programCode, options.str());
+	if(m_Program == nullptr) return false;
+
+	cl_int clError;
+	m_CountKernel = clCreateKernel(m_Program, "CountTiles", &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create kernel: CountTiles");
+	m_CompactKernel = clCreateKernel(m_Program, "CompactTiles", &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create kernel: CompactTiles");
+	m_ReverseKernel = clCreateKernel(m_Program, "ReverseTail", &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create kernel: ReverseTail");
+
+	return m_UseLookBack || m_Scan.Init(Device, Context);
+}
+
+void CCompactPrimitive::Release()
+{
+	ReleaseTemp();
+	m_Scan.Release();
+
+	SAFE_RELEASE_KERNEL(m_CountKernel);
+	SAFE_RELEASE_KERNEL(m_CompactKernel);
+	SAFE_RELEASE_KERNEL(m_ReverseKernel);
+	SAFE_RELEASE_PROGRAM(m_Program);
+}
+
+bool CCompactPrimitive::Compact(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, size_t N, cl_mem Flags, cl_mem Count)
+{
+	return Run(CommandQueue, In, Out, NULL, NULL, N, Flags, Count, false);
+}
+
+bool CCompactPrimitive::Partition(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, size_t N, cl_mem Flags, cl_mem Count)
+{
+	return Run(CommandQueue, In, Out, NULL, NULL, N, Flags, Count, true);
+}
+
+bool CCompactPrimitive::CompactPair(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, cl_mem In2, cl_mem Out2, size_t N, cl_mem Flags,
+	cl_mem Count)
+{
+	return Run(CommandQueue, In, Out, In2, Out2, N, Flags, Count, false);
+}
+
+bool CCompactPrimitive::Run(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, cl_mem In2, cl_mem Out2, size_t N, cl_mem Flags, cl_mem Count,
+	bool Partition)
+{
+	if(!HasPredicate() && Flags == NULL)
+	{
+		cerr<<"Compaction of "<<m_Type<<" without flags or predicate."<<endl;
+		return false;
+	}
+
+	if(!ReserveTemp(N))
+		return false;
+
+	// unused buffer arguments still need a valid object
+	cl_mem flags = Flags ? Flags : In;
+	cl_mem count = Count ? Count : m_dCount;
+	cl_mem in2 = In2 ? In2 : In;
+	cl_mem out2 = Out2 ? Out2 : Out;
+
+	cl_int clErr;
+	if(N == 0)
+	{
+		cl_uint zero = 0;
+		V_RETURN_FALSE_CL(clEnqueueWriteBuffer(CommandQueue, count, CL_FALSE, 0, sizeof(cl_uint), &zero, 0, NULL, NULL),
+			"Error writing the count");
+		return true;
+	}
+
+	size_t nTiles = (N + m_TileSize - 1) / m_TileSize;
+	size_t globalWorkSize = nTiles * m_LocalWorkSize;
+	cl_uint n = (cl_uint)N;
+	cl_uint partition = Partition ? 1 : 0;
+	cl_uint pair = (In2 && Out2) ? 1 : 0;
+
+	if(!m_UseLookBack)
+	{
+		clErr = clSetKernelArg(m_CountKernel, 0, sizeof(cl_mem), (void*)&In);
+		clErr |= clSetKernelArg(m_CountKernel, 1, sizeof(cl_mem), (void*)&flags);
+		clErr |= clSetKernelArg(m_CountKernel, 2, sizeof(cl_uint), (void*)&n);
+		clErr |= clSetKernelArg(m_CountKernel, 3, sizeof(cl_mem), (void*)&m_dTilePrefix);
+		V_RETURN_FALSE_CL(clErr, "Failed to set kernel args: CountTiles");
+
+		clErr = clEnqueueNDRangeKernel(CommandQueue, m_CountKernel, 1, NULL, &globalWorkSize, &m_LocalWorkSize, 0, NULL, NULL);
+		V_RETURN_FALSE_CL(clErr, "Error executing CountTiles!");
+
+		if(!m_Scan.Scan(CommandQueue, m_dTilePrefix, m_dTilePrefix, nTiles))
+			return false;
+	}
+
+	m_Epoch++;
+
+	clErr = clSetKernelArg(m_CompactKernel, 0, sizeof(cl_mem), (void*)&In);
+	clErr |= clSetKernelArg(m_CompactKernel, 1, sizeof(cl_mem), (void*)&Out);
+	clErr |= clSetKernelArg(m_CompactKernel, 2, sizeof(cl_mem), (void*)&flags);
+	clErr |= clSetKernelArg(m_CompactKernel, 3, sizeof(cl_uint), (void*)&n);
+	clErr |= clSetKernelArg(m_CompactKernel, 4, sizeof(cl_uint), (void*)&partition);
+	clErr |= clSetKernelArg(m_CompactKernel, 5, sizeof(cl_mem), (void*)&count);
+	clErr |= clSetKernelArg(m_CompactKernel, 6, sizeof(cl_mem), (void*)&m_dTileCounter);
+	clErr |= clSetKernelArg(m_CompactKernel, 7, sizeof(cl_mem), (void*)&m_dTileFlags);
+	clErr |= clSetKernelArg(m_CompactKernel, 8, sizeof(cl_mem), (void*)&m_dTileAggregate);
+	clErr |= clSetKernelArg(m_CompactKernel, 9, sizeof(cl_mem), (void*)&m_dTilePrefix);
+	clErr |= clSetKernelArg(m_CompactKernel, 10, sizeof(cl_uint), (void*)&m_Epoch);
+	clErr |= clSetKernelArg(m_CompactKernel, 11, sizeof(cl_mem), (void*)&in2);
+	clErr |= clSetKernelArg(m_CompactKernel, 12, sizeof(cl_mem), (void*)&out2);
+	clErr |= clSetKernelArg(m_CompactKernel, 13, sizeof(cl_uint), (void*)&pair);
+	V_RETURN_FALSE_CL(clErr, "Failed to set kernel args: CompactTiles");
+
+	clErr = clEnqueueNDRangeKernel(CommandQueue, m_CompactKernel, 1, NULL, &globalWorkSize, &m_LocalWorkSize, 0, NULL, NULL);
+	V_RETURN_FALSE_CL(clErr, "Error executing CompactTiles!");
+
+	if(Partition)
+	{
+		// the rejected elements were written backwards, at most N / 2 pairs have to be swapped
+		size_t reverseWorkSize = CLUtil::GetGlobalWorkSize(max<size_t>(N / 2, 1), m_LocalWorkSize);
+
+		clErr = clSetKernelArg(m_ReverseKernel, 0, sizeof(cl_mem), (void*)&Out);
+		clErr |= clSetKernelArg(m_ReverseKernel, 1, sizeof(cl_uint), (void*)&n);
+		clErr |= clSetKernelArg(m_ReverseKernel, 2, sizeof(cl_mem), (void*)&count);
+		V_RETURN_FALSE_CL(clErr, "Failed to set kernel args: ReverseTail");
+
+		clErr = clEnqueueNDRangeKernel(CommandQueue, m_ReverseKernel, 1, NULL, &reverseWorkSize, &m_LocalWorkSize, 0, NULL, NULL);
+		V_RETURN_FALSE_CL(clErr, "Error executing ReverseTail!");
+	}
+
+	return true;
+}
+
+bool CCompactPrimitive::ReserveTemp(size_t N)
+{
+	if(m_dCount != NULL && N <= m_TempCapacity)
+		return true;
+
+	ReleaseTemp();
+
+	// the flags have to start below any epoch
+	size_t nTiles = max<size_t>((N + m_TileSize - 1) / m_TileSize, 1);
+	vector<cl_uint> zeros(nTiles, 0);
+
+	cl_int clError, clError2;
+	m_dTileCounter = clCreateBuffer(m_Context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint), &zeros[0], &clError2);
+	clError = clError2;
+	m_dTileFlags = clCreateBuffer(m_Context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint) * nTiles, &zeros[0], &clError2);
+	clError |= clError2;
+	m_dTileAggregate = clCreateBuffer(m_Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * nTiles, NULL, &clError2);
+	clError |= clError2;
+	m_dTilePrefix = clCreateBuffer(m_Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * nTiles, NULL, &clError2);
+	clError |= clError2;
+	m_dCount = clCreateBuffer(m_Context, CL_MEM_READ_WRITE, sizeof(cl_uint), NULL, &clError2);
+	clError |= clError2;
+	V_RETURN_FALSE_CL(clError, "Error allocating compaction buffers");
+
+	m_TempCapacity = N;
+	return true;
+}
+
+void CCompactPrimitive::ReleaseTemp()
+{
+	SAFE_RELEASE_MEMOBJECT(m_dTileCounter);
+	SAFE_RELEASE_MEMOBJECT(m_dTileFlags);
+	SAFE_RELEASE_MEMOBJECT(m_dTileAggregate);
+	SAFE_RELEASE_MEMOBJECT(m_dTilePrefix);
+	SAFE_RELEASE_MEMOBJECT(m_dCount);
+	m_TempCapacity = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
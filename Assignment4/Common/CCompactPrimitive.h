@@ -0,0 +1,120 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CCOMPACT_PRIMITIVE_H
+#define _CCOMPACT_PRIMITIVE_H
+
+#include "CScanPrimitive.h"
+
+//! Stream compaction and stable partition on device buffers
+/*!
+	Elements are kept if their flag (one cl_uint per element, non-zero keeps)
+	is set or, if a predicate was given, if the predicate holds. The predicate
+	is an OpenCL expression of the element x (of type Type) and its index i,
+	e.g. "x.w > 0.0f"; it is compiled into the kernel, so no flag array is
+	needed. Flag compaction only moves the elements, Type can be any OpenCL
+	type of the right size then.
+
+	Flag evaluation, scan and scatter are fused into one kernel per tile of
+	LocalWorkSize * ItemsPerThread elements. On GPUs the tile offsets are found
+	with decoupled look-back in the same pass; other devices count the tiles
+	and scan the counts (CScanPrimitive) first. Devices with cl_khr_subgroups
+	(and OpenCL C 2.0 or later) scan within the sub-groups with the builtins.
+
+	The number of kept elements is written to a device buffer, nothing is read
+	back. The kernels are loaded from ../Common/CompactPrimitive.cl (relative to
+	the working directory of the assignments).
+*/
+class CCompactPrimitive
+{
+public:
+	//! LocalWorkSize must be a power of two
+	CCompactPrimitive(const std::string& Type, const std::string& Predicate = "",
+		size_t LocalWorkSize = 128, size_t ItemsPerThread = 8);
+
+	virtual ~CCompactPrimitive();
+
+	bool Init(cl_device_id Device, cl_context Context);
+
+	void Release();
+
+	//! Copies the kept elements of In to the front of Out, in order
+	/*!
+		In and Out must not overlap. Flags is ignored with a predicate. The number
+		of kept elements is written to the first cl_uint of Count (may be NULL).
+		The commands are enqueued, not finished.
+	*/
+	bool Compact(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, size_t N, cl_mem Flags, cl_mem Count = NULL);
+
+	//! Like Compact(), but the rejected elements follow the kept ones in Out, also in order
+	bool Partition(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, size_t N, cl_mem Flags, cl_mem Count = NULL);
+
+	//! Like Compact(), and In2 is compacted to Out2 with the same flags in the same pass
+	/*!
+		In2 holds N elements of the same type as In. A predicate is evaluated on In.
+	*/
+	bool CompactPair(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, cl_mem In2, cl_mem Out2, size_t N, cl_mem Flags,
+		cl_mem Count = NULL);
+
+	bool HasPredicate() const { return !m_Predicate.empty(); }
+	bool UsesLookBack() const { return m_UseLookBack; }
+	bool UsesSubGroups() const { return m_UseSubGroups; }
+
+	//! The generated definitions that are prepended to CompactPrimitive.cl
+	std::string GetProgramHeader() const;
+
+protected:
+	//! In2 / Out2 may be NULL, they are not supported by partitions
+	bool Run(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, cl_mem In2, cl_mem Out2, size_t N, cl_mem Flags, cl_mem Count,
+		bool Partition);
+
+	//! Makes sure the tile states for N elements exist
+	bool ReserveTemp(size_t N);
+	void ReleaseTemp();
+
+	std::string			m_Type;
+	std::string			m_Predicate;
+	size_t				m_LocalWorkSize;
+	size_t				m_ItemsPerThread;
+	size_t				m_TileSize;
+
+	bool				m_UseLookBack;
+	bool				m_UseSubGroups;
+
+	cl_context			m_Context;
+	cl_program			m_Program;
+	cl_kernel			m_CountKernel;
+	cl_kernel			m_CompactKernel;
+	cl_kernel			m_ReverseKernel;
+
+	//! Exclusive sum over the tile counts without look-back
+	CScanPrimitive		m_Scan;
+
+	//! Tile states of the look-back (or the tile counts), valid for m_Epoch
+	cl_uint				m_Epoch;
+	size_t				m_TempCapacity;
+	cl_mem				m_dTileCounter;
+	cl_mem				m_dTileFlags;
+	cl_mem				m_dTileAggregate;
+	cl_mem				m_dTilePrefix;
+	cl_mem				m_dCount;
+};
+
+#endif // _CCOMPACT_PRIMITIVE_H
@@ -0,0 +1,284 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CDevicePrimitives.h"
+
+#include "CLUtil.h"
+
+using namespace std;
+
+// upper limits for the automatic selection in Init()
+#define DEVICE_PRIMITIVES_MAX_LOCAL_WORK_SIZE	256
+#define DEVICE_PRIMITIVES_MAX_ITEMS_PER_THREAD	8
+
+// radix sort: fewer passes pay off for large arrays, small ones are dominated by the histogram scans
+#define DEVICE_PRIMITIVES_SORT_LARGE			(1 << 20)
+
+///////////////////////////////////////////////////////////////////////////////
+// CDevicePrimitives
+
+CDevicePrimitives::CDevicePrimitives()
+	: m_Device(NULL), m_Context(NULL), m_LocalWorkSize(DEVICE_PRIMITIVES_MAX_LOCAL_WORK_SIZE), m_LocalMemSize(16 * 1024)
+{
+}
+
+CDevicePrimitives::~CDevicePrimitives()
+{
+	Release();
+}
+
+bool CDevicePrimitives::Init(cl_device_id Device, cl_context Context)
+{
+	m_Device = Device;
+	m_Context = Context;
+
+	size_t maxWorkGroupSize;
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &maxWorkGroupSize, NULL),
+		"Error querying the maximum work-group size");
+	V_RETURN_FALSE_CL(clGetDeviceInfo(Device, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &m_LocalMemSize, NULL),
+		"Error querying the local memory size");
+
+	// largest power of two the device supports
+	m_LocalWorkSize = DEVICE_PRIMITIVES_MAX_LOCAL_WORK_SIZE;
+	while(m_LocalWorkSize > maxWorkGroupSize && m_LocalWorkSize > 1)
+		m_LocalWorkSize /= 2;
+
+	return true;
+}
+
+void CDevicePrimitives::Release()
+{
+	for(map<int, CScanPrimitive*>::iterator it = m_Primitives.begin(); it != m_Primitives.end(); ++it)
+		delete it->second;
+	m_Primitives.clear();
+
+	for(map<int, CRadixSort*>::iterator it = m_RadixSorts.begin(); it != m_RadixSorts.end(); ++it)
+		delete it->second;
+	m_RadixSorts.clear();
+
+	for(map<string, CCompactPrimitive*>::iterator it = m_Compactions.begin(); it != m_Compactions.end(); ++it)
+		delete it->second;
+	m_Compactions.clear();
+
+	for(map<int, CTopKPrimitive*>::iterator it = m_TopKs.begin(); it != m_TopKs.end(); ++it)
+		delete it->second;
+	m_TopKs.clear();
+}
+
+bool CDevicePrimitives::Reduce(cl_command_queue CommandQueue, cl_mem In, size_t N, EType Type, EOperator Operator, cl_mem Result)
+{
+	CScanPrimitive* primitive = GetPrimitive(Type, Operator, false, false);
+	return primitive && primitive->Reduce(CommandQueue, In, N, Result);
+}
+
+bool CDevicePrimitives::Scan(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, size_t N, EType Type, EOperator Operator,
+	bool Exclusive, cl_mem HeadFlags)
+{
+	CScanPrimitive* primitive = GetPrimitive(Type, Operator, Exclusive, HeadFlags != NULL);
+	return primitive && primitive->Scan(CommandQueue, In, Out, N, HeadFlags);
+}
+
+bool CDevicePrimitives::Sort(cl_command_queue CommandQueue, cl_mem Keys, cl_mem Values, size_t N, bool Keys64, unsigned int KeyBits)
+{
+	// the scatter keeps two counters per digit and the keys, values, digits and scan of a chunk in local memory
+	size_t scatterBytes = 2 * (1 << 8) * sizeof(cl_uint) +
+		m_LocalWorkSize * ((Keys64 ? sizeof(cl_ulong) : sizeof(cl_uint)) + 3 * sizeof(cl_uint));
+	bool largeDigits = N >= DEVICE_PRIMITIVES_SORT_LARGE && scatterBytes <= m_LocalMemSize / 2;
+
+	CRadixSort* sort = GetRadixSort(Keys64, Values != NULL, largeDigits ? 8 : 4);
+	return sort && sort->Sort(CommandQueue, Keys, Values, N, KeyBits);
+}
+
+// the compacted elements are only moved, any type of the same size will do
+static const char* GetMoveType(size_t ElementSize)
+{
+	switch(ElementSize)
+	{
+	case 1: return "uchar";
+	case 2: return "ushort";
+	case 4: return "uint";
+	case 8: return "uint2";
+	case 16: return "uint4";
+	case 32: return "uint8";
+	case 64: return "uint16";
+	default:
+		cerr<<"Compaction of "<<ElementSize<<" byte elements is not supported."<<endl;
+		return NULL;
+	}
+}
+
+bool CDevicePrimitives::Compact(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, size_t N, size_t ElementSize, cl_mem Flags,
+	cl_mem Count, bool Partition)
+{
+	const char* type = GetMoveType(ElementSize);
+	CCompactPrimitive* compaction = type ? GetCompaction(type, "") : NULL;
+	if(!compaction)
+		return false;
+	return Partition ? compaction->Partition(CommandQueue, In, Out, N, Flags, Count) : compaction->Compact(CommandQueue, In, Out, N, Flags, Count);
+}
+
+bool CDevicePrimitives::CompactPair(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, cl_mem In2, cl_mem Out2, size_t N,
+	size_t ElementSize, cl_mem Flags, cl_mem Count)
+{
+	const char* type = GetMoveType(ElementSize);
+	CCompactPrimitive* compaction = type ? GetCompaction(type, "") : NULL;
+	return compaction && compaction->CompactPair(CommandQueue, In, Out, In2, Out2, N, Flags, Count);
+}
+
+bool CDevicePrimitives::CompactIf(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, size_t N, const string& Type, const string& Predicate,
+	cl_mem Count, bool Partition)
+{
+	CCompactPrimitive* compaction = GetCompaction(Type, Predicate);
+	if(!compaction)
+		return false;
+	return Partition ? compaction->Partition(CommandQueue, In, Out, N, NULL, Count) : compaction->Compact(CommandQueue, In, Out, N, NULL, Count);
+}
+
+bool CDevicePrimitives::TopK(cl_command_queue CommandQueue, cl_mem Keys, cl_mem Values, size_t N, size_t K, cl_mem OutKeys, cl_mem OutValues,
+	bool Keys64)
+{
+	CTopKPrimitive* topK = GetTopK(Keys64, Values != NULL);
+	return topK && topK->Select(CommandQueue, Keys, Values, N, K, OutKeys, OutValues);
+}
+
+template <typename T>
+static SScanDesc MakeDesc(CDevicePrimitives::EOperator Operator, bool Exclusive, bool Segmented)
+{
+	switch(Operator)
+	{
+	case CDevicePrimitives::MIN:
+		return MakeScanDesc<T, SScanMinOp>(Exclusive, Segmented);
+	case CDevicePrimitives::MAX:
+		return MakeScanDesc<T, SScanMaxOp>(Exclusive, Segmented);
+	default:
+		return MakeScanDesc<T, SScanSumOp>(Exclusive, Segmented);
+	}
+}
+
+SScanDesc CDevicePrimitives::GetDesc(EType Type, EOperator Operator, bool Exclusive, bool Segmented)
+{
+	switch(Type)
+	{
+	case INT:
+		return MakeDesc<cl_int>(Operator, Exclusive, Segmented);
+	case FLOAT:
+		return MakeDesc<cl_float>(Operator, Exclusive, Segmented);
+	case ULONG:
+		return MakeDesc<cl_ulong>(Operator, Exclusive, Segmented);
+	default:
+		return MakeDesc<cl_uint>(Operator, Exclusive, Segmented);
+	}
+}
+
+size_t CDevicePrimitives::GetItemsPerThread(size_t BytesPerItem) const
+{
+	size_t itemsPerThread = DEVICE_PRIMITIVES_MAX_ITEMS_PER_THREAD;
+	while(itemsPerThread > 1 && (itemsPerThread + 1) * m_LocalWorkSize * BytesPerItem > m_LocalMemSize / 2)
+		itemsPerThread /= 2;
+	return itemsPerThread;
+}
+
+CScanPrimitive* CDevicePrimitives::GetPrimitive(EType Type, EOperator Operator, bool Exclusive, bool Segmented)
+{
+	int key = ((int(Type) * 3 + int(Operator)) * 2 + (Exclusive ? 1 : 0)) * 2 + (Segmented ? 1 : 0);
+	map<int, CScanPrimitive*>::iterator it = m_Primitives.find(key);
+	if(it != m_Primitives.end())
+		return it->second;
+
+	if(m_Context == NULL)
+	{
+		cerr<<"CDevicePrimitives used before Init()."<<endl;
+		return NULL;
+	}
+
+	// a tile of values and head flags and one value / flag per work-item
+	SScanDesc desc = GetDesc(Type, Operator, Exclusive, Segmented);
+	CScanPrimitive* primitive = new CScanPrimitive(desc, m_LocalWorkSize, GetItemsPerThread(desc.ElementSize + sizeof(cl_uint)));
+	if(!primitive->Init(m_Device, m_Context))
+	{
+		delete primitive;
+		return NULL;
+	}
+
+	m_Primitives[key] = primitive;
+	return primitive;
+}
+
+CRadixSort* CDevicePrimitives::GetRadixSort(bool Keys64, bool HasValues, unsigned int DigitBits)
+{
+	int key = ((Keys64 ? 1 : 0) * 2 + (HasValues ? 1 : 0)) * 16 + DigitBits;
+	map<int, CRadixSort*>::iterator it = m_RadixSorts.find(key);
+	if(it != m_RadixSorts.end())
+		return it->second;
+
+	if(m_Context == NULL)
+	{
+		cerr<<"CDevicePrimitives used before Init()."<<endl;
+		return NULL;
+	}
+
+	// the histograms are scanned with the uint scan, the scatter does not depend on the tile size
+	CRadixSort* sort = new CRadixSort(Keys64, HasValues, DigitBits, m_LocalWorkSize, GetItemsPerThread(2 * sizeof(cl_uint)));
+	if(!sort->Init(m_Device, m_Context))
+	{
+		delete sort;
+		return NULL;
+	}
+
+	m_RadixSorts[key] = sort;
+	return sort;
+}
+
+CCompactPrimitive* CDevicePrimitives::GetCompaction(const string& Type, const string& Predicate)
+{
+	string key = Type + "|" + Predicate;
+	map<string, CCompactPrimitive*>::iterator it = m_Compactions.find(key);
+	if(it != m_Compactions.end())
+		return it->second;
+
+	if(m_Context == NULL)
+	{
+		cerr<<"CDevicePrimitives used before Init()."<<endl;
+		return NULL;
+	}
+
+	// the ranks of a tile, without look-back the tile counts are scanned with the uint scan
+	CCompactPrimitive* compaction = new CCompactPrimitive(Type, Predicate, m_LocalWorkSize, GetItemsPerThread(2 * sizeof(cl_uint)));
+	if(!compaction->Init(m_Device, m_Context))
+	{
+		delete compaction;
+		return NULL;
+	}
+
+	m_Compactions[key] = compaction;
+	return compaction;
+}
+
+CTopKPrimitive* CDevicePrimitives::GetTopK(bool Keys64, bool HasValues)
+{
+	int key = (Keys64 ? 1 : 0) * 2 + (HasValues ? 1 : 0);
+	map<int, CTopKPrimitive*>::iterator it = m_TopKs.find(key);
+	if(it != m_TopKs.end())
+		return it->second;
+
+	if(m_Context == NULL)
+	{
+		cerr<<"CDevicePrimitives used before Init()."<<endl;
+		return NULL;
+	}
+
+	// the candidates are compacted and sorted with the same tile size
+	CTopKPrimitive* topK = new CTopKPrimitive(Keys64, HasValues, m_LocalWorkSize, GetItemsPerThread(2 * sizeof(cl_uint)));
+	if(!topK->Init(m_Device, m_Context))
+	{
+		delete topK;
+		return NULL;
+	}
+
+	m_TopKs[key] = topK;
+	return topK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
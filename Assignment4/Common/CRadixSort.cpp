@@ -0,0 +1,173 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CRadixSort.h"
+
+#include "CLUtil.h"
+
+#include <sstream>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// CRadixSort
+
+CRadixSort::CRadixSort(bool Keys64, bool HasValues, unsigned int DigitBits, size_t LocalWorkSize, size_t ItemsPerThread)
+	: m_Keys64(Keys64), m_HasValues(HasValues), m_DigitBits(DigitBits), m_LocalWorkSize(LocalWorkSize),
+	m_ItemsPerThread(ItemsPerThread), m_TileSize(LocalWorkSize * ItemsPerThread),
+	m_Context(NULL), m_Program(NULL), m_HistogramKernel(NULL), m_ScatterKernel(NULL),
+	m_Scan(MakeScanDesc<cl_uint, SScanSumOp>(true), LocalWorkSize, ItemsPerThread),
+	m_TempCapacity(0), m_dTempKeys(NULL), m_dTempValues(NULL), m_dHistograms(NULL)
+{
+}
+
+CRadixSort::~CRadixSort()
+{
+	Release();
+}
+
+bool CRadixSort::Init(cl_device_id Device, cl_context Context)
+{
+	m_Context = Context;
+
+	if(m_DigitBits < 4 || m_DigitBits > 8)
+	{
+		cerr<<"Radix sort with "<<m_DigitBits<<" bit digits, only 4 to 8 bits are supported."<<endl;
+		return false;
+	}
+
+	string programCode;
+	if(!CLUtil::LoadProgramSourceToMemory("../Common/RadixSort.cl", programCode))
+		return false;
+
+	stringstream options;
+	options<<"-D KEY_T="<<(m_Keys64 ? "ulong" : "uint")<<" -D RADIX_BITS="<<m_DigitBits;
+	options<<" -D BLOCK_SIZE="<<m_LocalWorkSize<<" -D ITEMS_PER_THREAD="<<m_ItemsPerThread;
+	if(m_HasValues)
+		options<<" -D HAS_VALUES";
+	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode, options.str());
+	if(m_Program == nullptr) return false;
+
+	cl_int clError;
+	m_HistogramKernel = clCreateKernel(m_Program, "RadixHistogram", &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create kernel: RadixHistogram");
+	m_ScatterKernel = clCreateKernel(m_Program, "RadixScatter", &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create kernel: RadixScatter");
+
+	return m_Scan.Init(Device, Context);
+}
+
+void CRadixSort::Release()
+{
+	ReleaseTemp();
+	m_Scan.Release();
+
+	SAFE_RELEASE_KERNEL(m_HistogramKernel);
+	SAFE_RELEASE_KERNEL(m_ScatterKernel);
+	SAFE_RELEASE_PROGRAM(m_Program);
+}
+
+bool CRadixSort::Sort(cl_command_queue CommandQueue, cl_mem Keys, cl_mem Values, size_t N, unsigned int KeyBits)
+{
+	if(N <= 1)
+		return true;
+
+	if(!ReserveTemp(N))
+		return false;
+
+	unsigned int keyWidth = (unsigned int)(8 * GetKeySize());
+	if(KeyBits == 0 || KeyBits > keyWidth)
+		KeyBits = keyWidth;
+	unsigned int nPasses = (KeyBits + m_DigitBits - 1) / m_DigitBits;
+
+	cl_int clErr;
+	size_t nTiles = (N + m_TileSize - 1) / m_TileSize;
+	size_t globalWorkSize = nTiles * m_LocalWorkSize;
+	size_t nCounters = nTiles << m_DigitBits;
+	cl_uint n = (cl_uint)N;
+
+	// unused value arguments still need a valid object
+	cl_mem keysIn = Keys, keysOut = m_dTempKeys;
+	cl_mem valuesIn = m_HasValues ? Values : Keys;
+	cl_mem valuesOut = m_HasValues ? m_dTempValues : m_dTempKeys;
+
+	for(unsigned int pass = 0; pass < nPasses; pass++)
+	{
+		cl_uint shift = pass * m_DigitBits;
+
+		clErr = clSetKernelArg(m_HistogramKernel, 0, sizeof(cl_mem), (void*)&keysIn);
+		clErr |= clSetKernelArg(m_HistogramKernel, 1, sizeof(cl_uint), (void*)&n);
+		clErr |= clSetKernelArg(m_HistogramKernel, 2, sizeof(cl_uint), (void*)&shift);
+		clErr |= clSetKernelArg(m_HistogramKernel, 3, sizeof(cl_mem), (void*)&m_dHistograms);
+		V_RETURN_FALSE_CL(clErr, "Failed to set kernel args: RadixHistogram");
+
+		clErr = clEnqueueNDRangeKernel(CommandQueue, m_HistogramKernel, 1, NULL, &globalWorkSize, &m_LocalWorkSize, 0, NULL, NULL);
+		V_RETURN_FALSE_CL(clErr, "Error executing RadixHistogram!");
+
+		if(!m_Scan.Scan(CommandQueue, m_dHistograms, m_dHistograms, nCounters))
+			return false;
+
+		clErr = clSetKernelArg(m_ScatterKernel, 0, sizeof(cl_mem), (void*)&keysIn);
+		clErr |= clSetKernelArg(m_ScatterKernel, 1, sizeof(cl_mem), (void*)&keysOut);
+		clErr |= clSetKernelArg(m_ScatterKernel, 2, sizeof(cl_mem), (void*)&valuesIn);
+		clErr |= clSetKernelArg(m_ScatterKernel, 3, sizeof(cl_mem), (void*)&valuesOut);
+		clErr |= clSetKernelArg(m_ScatterKernel, 4, sizeof(cl_uint), (void*)&n);
+		clErr |= clSetKernelArg(m_ScatterKernel, 5, sizeof(cl_uint), (void*)&shift);
+		clErr |= clSetKernelArg(m_ScatterKernel, 6, sizeof(cl_mem), (void*)&m_dHistograms);
+		V_RETURN_FALSE_CL(clErr, "Failed to set kernel args: RadixScatter");
+
+		clErr = clEnqueueNDRangeKernel(CommandQueue, m_ScatterKernel, 1, NULL, &globalWorkSize, &m_LocalWorkSize, 0, NULL, NULL);
+		V_RETURN_FALSE_CL(clErr, "Error executing RadixScatter!");
+
+		swap(keysIn, keysOut);
+		swap(valuesIn, valuesOut);
+	}
+
+	// after an odd number of passes the result is in the temporary buffers
+	if(keysIn != Keys)
+	{
+		V_RETURN_FALSE_CL(clEnqueueCopyBuffer(CommandQueue, keysIn, Keys, 0, 0, GetKeySize() * N, 0, NULL, NULL),
+			"Error copying the sorted keys");
+		if(m_HasValues)
+			V_RETURN_FALSE_CL(clEnqueueCopyBuffer(CommandQueue, valuesIn, Values, 0, 0, sizeof(cl_uint) * N, 0, NULL, NULL),
+				"Error copying the sorted values");
+	}
+
+	return true;
+}
+
+bool CRadixSort::ReserveTemp(size_t N)
+{
+	if(N <= m_TempCapacity)
+		return true;
+
+	ReleaseTemp();
+
+	size_t nTiles = (N + m_TileSize - 1) / m_TileSize;
+	cl_int clError, clError2;
+	m_dTempKeys = clCreateBuffer(m_Context, CL_MEM_READ_WRITE, GetKeySize() * N, NULL, &clError2);
+	clError = clError2;
+	if(m_HasValues)
+	{
+		m_dTempValues = clCreateBuffer(m_Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * N, NULL, &clError2);
+		clError |= clError2;
+	}
+	m_dHistograms = clCreateBuffer(m_Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * (nTiles << m_DigitBits), NULL, &clError2);
+	clError |= clError2;
+	V_RETURN_FALSE_CL(clError, "Error allocating radix sort buffers");
+
+	m_TempCapacity = N;
+	return true;
+}
+
+void CRadixSort::ReleaseTemp()
+{
+	SAFE_RELEASE_MEMOBJECT(m_dTempKeys);
+	SAFE_RELEASE_MEMOBJECT(m_dTempValues);
+	SAFE_RELEASE_MEMOBJECT(m_dHistograms);
+	m_TempCapacity = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
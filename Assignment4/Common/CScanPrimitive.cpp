@@ -0,0 +1,215 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CScanPrimitive.h"
+
+#include "CLUtil.h"
+
+#include <sstream>
+
+using namespace std;
+
+// output modes, see ScanPrimitive.cl
+#define SCAN_INCLUSIVE	0
+#define SCAN_EXCLUSIVE	1
+#define SCAN_CARRY		2
+
+///////////////////////////////////////////////////////////////////////////////
+// CScanPrimitive
+
+CScanPrimitive::CScanPrimitive(const SScanDesc& Desc, size_t LocalWorkSize, size_t ItemsPerThread)
+	: m_Desc(Desc), m_LocalWorkSize(LocalWorkSize), m_ItemsPerThread(ItemsPerThread), m_TileSize(LocalWorkSize * ItemsPerThread),
+	m_Context(NULL), m_Program(NULL), m_ReduceKernel(NULL), m_ScanKernel(NULL), m_TempCapacity(0)
+{
+}
+
+CScanPrimitive::~CScanPrimitive()
+{
+	Release();
+}
+
+string CScanPrimitive::GetProgramHeader() const
+{
+	stringstream header;
+	header<<"#define VALUE_T "<<m_Desc.Type<<endl;
+	header<<"#define IDENTITY ("<<m_Desc.Identity<<")"<<endl;
+	header<<"#define BLOCK_SIZE "<<m_LocalWorkSize<<endl;
+	header<<"#define ITEMS_PER_THREAD "<<m_ItemsPerThread<<endl;
+	if(m_Desc.Segmented)
+		header<<"#define SEGMENTED"<<endl;
+	header<<"inline VALUE_T Combine(VALUE_T a, VALUE_T b) { return "<<m_Desc.Combine<<"; }"<<endl;
+	return header.str();
+}
+
+bool CScanPrimitive::Init(cl_device_id Device, cl_context Context)
+{
+	m_Context = Context;
+
+	string programCode;
+	if(!CLUtil::LoadProgramSourceToMemory("../Common/ScanPrimitive.cl", programCode))
+		return false;
+
+	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, GetProgramHeader() + programCode);
+	if(m_Program == nullptr) return false;
+
+	cl_int clError;
+	m_ReduceKernel = clCreateKernel(m_Program, "ScanReduceTiles", &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create kernel: ScanReduceTiles");
+	m_ScanKernel = clCreateKernel(m_Program, "ScanTiles", &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create kernel: ScanTiles");
+
+	return true;
+}
+
+void CScanPrimitive::Release()
+{
+	ReleaseTemp();
+
+	SAFE_RELEASE_KERNEL(m_ReduceKernel);
+	SAFE_RELEASE_KERNEL(m_ScanKernel);
+	SAFE_RELEASE_PROGRAM(m_Program);
+}
+
+bool CScanPrimitive::Scan(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, size_t N, cl_mem HeadFlags)
+{
+	if(N == 0)
+		return true;
+
+	if(m_Desc.Segmented && HeadFlags == NULL)
+	{
+		cerr<<"Segmented scan "<<m_Desc.Name<<" without head flags."<<endl;
+		return false;
+	}
+
+	if(!ReserveTemp(N))
+		return false;
+
+	return ScanLevel(CommandQueue, In, Out, HeadFlags, N, 0, m_Desc.Exclusive ? SCAN_EXCLUSIVE : SCAN_INCLUSIVE);
+}
+
+bool CScanPrimitive::Reduce(cl_command_queue CommandQueue, cl_mem In, size_t N, cl_mem Result)
+{
+	if(m_Desc.Segmented || N == 0)
+	{
+		cerr<<"Reduce() needs a non-segmented descriptor and at least one element ("<<m_Desc.Name<<")."<<endl;
+		return false;
+	}
+
+	if(!ReserveTemp(N))
+		return false;
+
+	// the tile totals of every level are reduced again, the last level has a single tile
+	for(unsigned int level = 0; ; level++)
+	{
+		size_t nTiles = (N + m_TileSize - 1) / m_TileSize;
+		cl_mem out = nTiles > 1 ? m_dTileValues[level] : Result;
+		if(!ReduceTiles(CommandQueue, In, In, N, out, out))
+			return false;
+		if(nTiles == 1)
+			return true;
+
+		In = out;
+		N = nTiles;
+	}
+}
+
+bool CScanPrimitive::ReduceTiles(cl_command_queue CommandQueue, cl_mem In, cl_mem HeadFlags, size_t N, cl_mem TileValues, cl_mem TileHeads)
+{
+	cl_int clErr;
+	size_t nTiles = (N + m_TileSize - 1) / m_TileSize;
+	size_t globalWorkSize = nTiles * m_LocalWorkSize;
+	cl_uint n = (cl_uint)N;
+
+	clErr = clSetKernelArg(m_ReduceKernel, 0, sizeof(cl_mem), (void*)&In);
+	clErr |= clSetKernelArg(m_ReduceKernel, 1, sizeof(cl_mem), (void*)&HeadFlags);
+	clErr |= clSetKernelArg(m_ReduceKernel, 2, sizeof(cl_uint), (void*)&n);
+	clErr |= clSetKernelArg(m_ReduceKernel, 3, sizeof(cl_mem), (void*)&TileValues);
+	clErr |= clSetKernelArg(m_ReduceKernel, 4, sizeof(cl_mem), (void*)&TileHeads);
+	V_RETURN_FALSE_CL(clErr, "Failed to set kernel args: ScanReduceTiles");
+
+	clErr = clEnqueueNDRangeKernel(CommandQueue, m_ReduceKernel, 1, NULL, &globalWorkSize, &m_LocalWorkSize, 0, NULL, NULL);
+	V_RETURN_FALSE_CL(clErr, "Error executing ScanReduceTiles!");
+
+	return true;
+}
+
+bool CScanPrimitive::ScanLevel(cl_command_queue CommandQueue, cl_mem In, cl_mem Out, cl_mem HeadFlags, size_t N, unsigned int Level, cl_uint Mode)
+{
+	cl_int clErr;
+	size_t nTiles = (N + m_TileSize - 1) / m_TileSize;
+	size_t globalWorkSize = nTiles * m_LocalWorkSize;
+	cl_uint n = (cl_uint)N;
+	cl_uint useCarry = nTiles > 1 ? 1 : 0;
+
+	// unused buffer arguments still need a valid object
+	cl_mem headFlags = HeadFlags ? HeadFlags : In;
+	cl_mem carries = In;
+
+	if(nTiles > 1)
+	{
+		cl_mem tileHeads = m_Desc.Segmented ? m_dTileHeads[Level] : m_dTileValues[Level];
+		if(!ReduceTiles(CommandQueue, In, headFlags, N, m_dTileValues[Level], tileHeads))
+			return false;
+
+		// the carry of a tile is the inclusive result of the preceding tiles
+		if(!ScanLevel(CommandQueue, m_dTileValues[Level], m_dTileValues[Level], m_Desc.Segmented ? m_dTileHeads[Level] : NULL,
+			nTiles, Level + 1, SCAN_CARRY))
+			return false;
+
+		carries = m_dTileValues[Level];
+	}
+
+	clErr = clSetKernelArg(m_ScanKernel, 0, sizeof(cl_mem), (void*)&In);
+	clErr |= clSetKernelArg(m_ScanKernel, 1, sizeof(cl_mem), (void*)&Out);
+	clErr |= clSetKernelArg(m_ScanKernel, 2, sizeof(cl_mem), (void*)&headFlags);
+	clErr |= clSetKernelArg(m_ScanKernel, 3, sizeof(cl_uint), (void*)&n);
+	clErr |= clSetKernelArg(m_ScanKernel, 4, sizeof(cl_mem), (void*)&carries);
+	clErr |= clSetKernelArg(m_ScanKernel, 5, sizeof(cl_uint), (void*)&useCarry);
+	clErr |= clSetKernelArg(m_ScanKernel, 6, sizeof(cl_uint), (void*)&Mode);
+	V_RETURN_FALSE_CL(clErr, "Failed to set kernel args: ScanTiles");
+
+	clErr = clEnqueueNDRangeKernel(CommandQueue, m_ScanKernel, 1, NULL, &globalWorkSize, &m_LocalWorkSize, 0, NULL, NULL);
+	V_RETURN_FALSE_CL(clErr, "Error executing ScanTiles!");
+
+	return true;
+}
+
+bool CScanPrimitive::ReserveTemp(size_t N)
+{
+	if(N <= m_TempCapacity)
+		return true;
+
+	ReleaseTemp();
+
+	// one buffer per level that has more than one tile
+	cl_int clError = CL_SUCCESS, clError2;
+	for(size_t n = (N + m_TileSize - 1) / m_TileSize; n > 1; n = (n + m_TileSize - 1) / m_TileSize)
+	{
+		m_dTileValues.push_back(clCreateBuffer(m_Context, CL_MEM_READ_WRITE, m_Desc.ElementSize * n, NULL, &clError2));
+		clError |= clError2;
+		if(m_Desc.Segmented)
+		{
+			m_dTileHeads.push_back(clCreateBuffer(m_Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * n, NULL, &clError2));
+			clError |= clError2;
+		}
+	}
+	V_RETURN_FALSE_CL(clError, "Error allocating scan buffers");
+
+	m_TempCapacity = N;
+	return true;
+}
+
+void CScanPrimitive::ReleaseTemp()
+{
+	for(size_t i = 0; i < m_dTileValues.size(); i++)
+		SAFE_RELEASE_MEMOBJECT(m_dTileValues[i]);
+	for(size_t i = 0; i < m_dTileHeads.size(); i++)
+		SAFE_RELEASE_MEMOBJECT(m_dTileHeads[i]);
+	m_dTileValues.clear();
+	m_dTileHeads.clear();
+	m_TempCapacity = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
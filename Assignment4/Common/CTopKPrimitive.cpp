@@ -0,0 +1,197 @@
+/******************************************************************************
+GPU Computing / GPGPU Praktikum source code.
+
+******************************************************************************/
+
+#include "CTopKPrimitive.h"
+
+#include "CLUtil.h"
+
+#include <sstream>
+
+using namespace std;
+
+// digit width of the radix select, see RADIX_BITS in TopK.cl
+#define TOPK_DIGIT_BITS		8
+#define TOPK_RADIX			(1 << TOPK_DIGIT_BITS)
+
+///////////////////////////////////////////////////////////////////////////////
+// CTopKPrimitive
+
+CTopKPrimitive::CTopKPrimitive(bool Keys64, bool HasValues, size_t LocalWorkSize, size_t ItemsPerThread)
+	: m_Keys64(Keys64), m_HasValues(HasValues), m_LocalWorkSize(LocalWorkSize),
+	m_ItemsPerThread(ItemsPerThread), m_TileSize(LocalWorkSize * ItemsPerThread),
+	m_Context(NULL), m_Program(NULL), m_InitKernel(NULL), m_HistogramKernel(NULL), m_DigitKernel(NULL), m_FlagsKernel(NULL),
+	m_InvertKernel(NULL),
+	m_CompactKeys(Keys64 ? "ulong" : "uint", "", LocalWorkSize, ItemsPerThread),
+	m_CompactValues("uint", "", LocalWorkSize, ItemsPerThread),
+	m_Sort(Keys64, HasValues, TOPK_DIGIT_BITS, LocalWorkSize, ItemsPerThread),
+	m_TempCapacity(0), m_dHistogram(NULL), m_dState(NULL), m_dFlags(NULL)
+{
+}
+
+CTopKPrimitive::~CTopKPrimitive()
+{
+	Release();
+}
+
+bool CTopKPrimitive::Init(cl_device_id Device, cl_context Context)
+{
+	m_Context = Context;
+
+	string programCode;
+	if(!CLUtil::LoadProgramSourceToMemory("../Common/TopK.cl", programCode))
+		return false;
+
+	stringstream options;
+	options<<"-D KEY_T="<<(m_Keys64 ? "ulong" : "uint");
+	options<<" -D BLOCK_SIZE="<<m_LocalWorkSize<<" -D ITEMS_PER_THREAD="<<m_ItemsPerThread;
+	m_Program = CLUtil::BuildCLProgramFromMemory(Device, Context, programCode, options.str());
+	if(m_Program == nullptr) return false;
+
+	cl_int clError;
+	m_InitKernel = clCreateKernel(m_Program, "SelectInit", &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create kernel: SelectInit");
+	m_HistogramKernel = clCreateKernel(m_Program, "SelectHistogram", &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create kernel: SelectHistogram");
+	m_DigitKernel = clCreateKernel(m_Program, "SelectDigit", &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create kernel: SelectDigit");
+	m_FlagsKernel = clCreateKernel(m_Program, "TopKFlags", &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create kernel: TopKFlags");
+	m_InvertKernel = clCreateKernel(m_Program, "InvertKeys", &clError);
+	V_RETURN_FALSE_CL(clError, "Failed to create kernel: InvertKeys");
+
+	if(!m_CompactKeys.Init(Device, Context) || !m_Sort.Init(Device, Context))
+		return false;
+	return !(m_HasValues && m_Keys64) || m_CompactValues.Init(Device, Context);
+}
+
+void CTopKPrimitive::Release()
+{
+	ReleaseTemp();
+	m_CompactKeys.Release();
+	m_CompactValues.Release();
+	m_Sort.Release();
+
+	SAFE_RELEASE_KERNEL(m_InitKernel);
+	SAFE_RELEASE_KERNEL(m_HistogramKernel);
+	SAFE_RELEASE_KERNEL(m_DigitKernel);
+	SAFE_RELEASE_KERNEL(m_FlagsKernel);
+	SAFE_RELEASE_KERNEL(m_InvertKernel);
+	SAFE_RELEASE_PROGRAM(m_Program);
+}
+
+bool CTopKPrimitive::Select(cl_command_queue CommandQueue, cl_mem Keys, cl_mem Values, size_t N, size_t K, cl_mem OutKeys, cl_mem OutValues,
+	bool Sorted)
+{
+	K = min(K, N);
+	if(K == 0)
+		return true;
+
+	if(!ReserveTemp(N))
+		return false;
+
+	cl_int clErr;
+	size_t nTiles = (N + m_TileSize - 1) / m_TileSize;
+	size_t globalWorkSize = nTiles * m_LocalWorkSize;
+	size_t radixWorkSize = TOPK_RADIX;
+	cl_uint n = (cl_uint)N;
+	cl_uint k = (cl_uint)K;
+
+	clErr = clSetKernelArg(m_InitKernel, 0, sizeof(cl_mem), (void*)&m_dHistogram);
+	clErr |= clSetKernelArg(m_InitKernel, 1, sizeof(cl_mem), (void*)&m_dState);
+	clErr |= clSetKernelArg(m_InitKernel, 2, sizeof(cl_uint), (void*)&k);
+	V_RETURN_FALSE_CL(clErr, "Failed to set kernel args: SelectInit");
+
+	clErr = clEnqueueNDRangeKernel(CommandQueue, m_InitKernel, 1, NULL, &radixWorkSize, NULL, 0, NULL, NULL);
+	V_RETURN_FALSE_CL(clErr, "Error executing SelectInit!");
+
+	// radix select from the most significant digit, afterwards the state holds the K-th largest key
+	unsigned int keyBits = (unsigned int)(8 * GetKeySize());
+	for(unsigned int p = 1; p <= keyBits / TOPK_DIGIT_BITS; p++)
+	{
+		cl_uint shift = keyBits - p * TOPK_DIGIT_BITS;
+
+		clErr = clSetKernelArg(m_HistogramKernel, 0, sizeof(cl_mem), (void*)&Keys);
+		clErr |= clSetKernelArg(m_HistogramKernel, 1, sizeof(cl_uint), (void*)&n);
+		clErr |= clSetKernelArg(m_HistogramKernel, 2, sizeof(cl_uint), (void*)&shift);
+		clErr |= clSetKernelArg(m_HistogramKernel, 3, sizeof(cl_mem), (void*)&m_dState);
+		clErr |= clSetKernelArg(m_HistogramKernel, 4, sizeof(cl_mem), (void*)&m_dHistogram);
+		V_RETURN_FALSE_CL(clErr, "Failed to set kernel args: SelectHistogram");
+
+		clErr = clEnqueueNDRangeKernel(CommandQueue, m_HistogramKernel, 1, NULL, &globalWorkSize, &m_LocalWorkSize, 0, NULL, NULL);
+		V_RETURN_FALSE_CL(clErr, "Error executing SelectHistogram!");
+
+		clErr = clSetKernelArg(m_DigitKernel, 0, sizeof(cl_mem), (void*)&m_dHistogram);
+		clErr |= clSetKernelArg(m_DigitKernel, 1, sizeof(cl_mem), (void*)&m_dState);
+		clErr |= clSetKernelArg(m_DigitKernel, 2, sizeof(cl_uint), (void*)&shift);
+		V_RETURN_FALSE_CL(clErr, "Failed to set kernel args: SelectDigit");
+
+		clErr = clEnqueueNDRangeKernel(CommandQueue, m_DigitKernel, 1, NULL, &m_LocalWorkSize, &m_LocalWorkSize, 0, NULL, NULL);
+		V_RETURN_FALSE_CL(clErr, "Error executing SelectDigit!");
+	}
+
+	clErr = clSetKernelArg(m_FlagsKernel, 0, sizeof(cl_mem), (void*)&Keys);
+	clErr |= clSetKernelArg(m_FlagsKernel, 1, sizeof(cl_uint), (void*)&n);
+	clErr |= clSetKernelArg(m_FlagsKernel, 2, sizeof(cl_mem), (void*)&m_dState);
+	clErr |= clSetKernelArg(m_FlagsKernel, 3, sizeof(cl_mem), (void*)&m_dFlags);
+	V_RETURN_FALSE_CL(clErr, "Failed to set kernel args: TopKFlags");
+
+	clErr = clEnqueueNDRangeKernel(CommandQueue, m_FlagsKernel, 1, NULL, &globalWorkSize, &m_LocalWorkSize, 0, NULL, NULL);
+	V_RETURN_FALSE_CL(clErr, "Error executing TopKFlags!");
+
+	// exactly K flags are set
+	if(!m_CompactKeys.Compact(CommandQueue, Keys, OutKeys, N, m_dFlags))
+		return false;
+	if(m_HasValues && !(m_Keys64 ? m_CompactValues : m_CompactKeys).Compact(CommandQueue, Values, OutValues, N, m_dFlags))
+		return false;
+
+	if(!Sorted || K == 1)
+		return true;
+
+	size_t invertWorkSize = CLUtil::GetGlobalWorkSize(K, m_LocalWorkSize);
+	clErr = clSetKernelArg(m_InvertKernel, 0, sizeof(cl_mem), (void*)&OutKeys);
+	clErr |= clSetKernelArg(m_InvertKernel, 1, sizeof(cl_uint), (void*)&k);
+	V_RETURN_FALSE_CL(clErr, "Failed to set kernel args: InvertKeys");
+
+	clErr = clEnqueueNDRangeKernel(CommandQueue, m_InvertKernel, 1, NULL, &invertWorkSize, &m_LocalWorkSize, 0, NULL, NULL);
+	V_RETURN_FALSE_CL(clErr, "Error executing InvertKeys!");
+
+	if(!m_Sort.Sort(CommandQueue, OutKeys, OutValues, K))
+		return false;
+
+	clErr = clEnqueueNDRangeKernel(CommandQueue, m_InvertKernel, 1, NULL, &invertWorkSize, &m_LocalWorkSize, 0, NULL, NULL);
+	V_RETURN_FALSE_CL(clErr, "Error executing InvertKeys!");
+
+	return true;
+}
+
+bool CTopKPrimitive::ReserveTemp(size_t N)
+{
+	if(N <= m_TempCapacity)
+		return true;
+
+	ReleaseTemp();
+
+	cl_int clError, clError2;
+	m_dHistogram = clCreateBuffer(m_Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * TOPK_RADIX, NULL, &clError2);
+	clError = clError2;
+	m_dState = clCreateBuffer(m_Context, CL_MEM_READ_WRITE, 4 * sizeof(cl_ulong), NULL, &clError2);
+	clError |= clError2;
+	m_dFlags = clCreateBuffer(m_Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * N, NULL, &clError2);
+	clError |= clError2;
+	V_RETURN_FALSE_CL(clError, "Error allocating top-k buffers");
+
+	m_TempCapacity = N;
+	return true;
+}
+
+void CTopKPrimitive::ReleaseTemp()
+{
+	SAFE_RELEASE_MEMOBJECT(m_dHistogram);
+	SAFE_RELEASE_MEMOBJECT(m_dState);
+	SAFE_RELEASE_MEMOBJECT(m_dFlags);
+	m_TempCapacity = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,98 @@
+/******************************************************************************
+                         .88888.   888888ba  dP     dP 
+                        d8'   `88  88    `8b 88     88 
+                        88        a88aaaa8P' 88     88 
+                        88   YP88  88        88     88 
+                        Y8.   .88  88        Y8.   .8P 
+                         `88888'   dP        `Y88888P' 
+                                                       
+                                                       
+   a88888b.                                         dP   oo                   
+  d8'   `88                                         88                        
+  88        .d8888b. 88d8b.d8b. 88d888b. dP    dP d8888P dP 88d888b. .d8888b. 
+  88        88'  `88 88'`88'`88 88'  `88 88    88   88   88 88'  `88 88'  `88 
+  Y8.   .88 88.  .88 88  88  88 88.  .88 88.  .88   88   88 88    88 88.  .88 
+   Y88888P' `88888P' dP  dP  dP 88Y888P' `88888P'   dP   dP dP    dP `8888P88 
+                                88                                        .88 
+                                dP                                    d8888P  
+******************************************************************************/
+
+
+#ifndef _CTOPK_PRIMITIVE_H
+#define _CTOPK_PRIMITIVE_H
+
+#include "CCompactPrimitive.h"
+#include "CRadixSort.h"
+
+//! Selection of the K largest cl_uint or cl_ulong keys on device buffers, optionally with cl_uint values
+/*!
+	A radix select finds the K-th largest key with one histogram pass per 8 bit
+	digit (4 passes for cl_uint, 8 for cl_ulong). Every pass only counts the keys
+	that match the digits selected so far, a single work-group then picks the next
+	digit on the device, so no pass waits for the host. The keys above this
+	threshold and the missing number of keys equal to it are flagged and compacted
+	(CCompactPrimitive), which keeps them in input order. Sorted results are
+	ordered with CRadixSort.
+
+	Unlike per-work-group heaps or sorting networks, the passes need no local
+	memory that grows with K, so K is only limited by N.
+
+	The kernels are loaded from ../Common/TopK.cl (relative to the working
+	directory of the assignments).
+*/
+class CTopKPrimitive
+{
+public:
+	//! LocalWorkSize must be a power of two
+	CTopKPrimitive(bool Keys64 = false, bool HasValues = false, size_t LocalWorkSize = 128, size_t ItemsPerThread = 8);
+
+	virtual ~CTopKPrimitive();
+
+	bool Init(cl_device_id Device, cl_context Context);
+
+	void Release();
+
+	//! Writes the K largest of the N Keys (and their Values) to OutKeys (and OutValues), which hold at least K elements
+	/*!
+		Sorted results are in descending order, otherwise in input order. Which of
+		several keys equal to the K-th largest key are taken is not specified.
+		K is clamped to N, Values and OutValues are ignored without HasValues.
+		The commands are enqueued, not finished.
+	*/
+	bool Select(cl_command_queue CommandQueue, cl_mem Keys, cl_mem Values, size_t N, size_t K, cl_mem OutKeys, cl_mem OutValues,
+		bool Sorted = true);
+
+	bool HasValues() const { return m_HasValues; }
+	size_t GetKeySize() const { return m_Keys64 ? sizeof(cl_ulong) : sizeof(cl_uint); }
+
+protected:
+	bool ReserveTemp(size_t N);
+	void ReleaseTemp();
+
+	bool				m_Keys64;
+	bool				m_HasValues;
+	size_t				m_LocalWorkSize;
+	size_t				m_ItemsPerThread;
+	size_t				m_TileSize;
+
+	cl_context			m_Context;
+	cl_program			m_Program;
+	cl_kernel			m_InitKernel;
+	cl_kernel			m_HistogramKernel;
+	cl_kernel			m_DigitKernel;
+	cl_kernel			m_FlagsKernel;
+	cl_kernel			m_InvertKernel;
+
+	//! The values only need their own compaction for cl_ulong keys
+	CCompactPrimitive	m_CompactKeys;
+	CCompactPrimitive	m_CompactValues;
+	CRadixSort			m_Sort;
+
+	size_t				m_TempCapacity;
+	cl_mem				m_dHistogram;
+	//! SELECT_STATE in TopK.cl
+	cl_mem				m_dState;
+	cl_mem				m_dFlags;
+};
+
+#endif // _CTOPK_PRIMITIVE_H
@@ -0,0 +1,248 @@
+
+// Stream compaction and stable partition used by CCompactPrimitive. The host prepends the element
+// type VALUE_T, BLOCK_SIZE, ITEMS_PER_THREAD and optionally
+//		PREDICATE		Predicate(x, i) decides for element x at index i, otherwise the flags are used
+//		LOOK_BACK		single pass with decoupled look-back (see below)
+//		USE_SUBGROUPS	the per-tile scan uses the cl_khr_subgroups builtins
+//
+// Flags, scan and scatter are fused: every work-group evaluates the predicate for a tile, ranks the
+// kept elements within the tile and scatters them to the exclusive prefix of the tile. With LOOK_BACK
+// the prefix is found like in Scan_DecoupledLookBack (Assignment2/Scan.cl, which also explains the tile
+// tickets and epochs): tiles publish their count (aggregate) and, once known, their inclusive prefix,
+// and walk back over the aggregates of their predecessors. Without LOOK_BACK the host runs CountTiles
+// and scans the counts first, tilePrefix then holds the exclusive prefix of every tile.
+//
+// With pair != 0 the elements of in2 are moved to out2 with the same ranks, so two arrays of a
+// structure of arrays are compacted by one evaluation and scan of the flags.
+//
+// The last tile writes the number of kept elements to *count, so the host does not have to read
+// anything back. Partitions write the rejected elements backwards from the end of the output,
+// ReverseTail restores their order afterwards.
+
+#define TILE_ITEMS (BLOCK_SIZE * ITEMS_PER_THREAD)
+
+#define STATUS_AGGREGATE(epoch)	(2 * (epoch))
+#define STATUS_PREFIX(epoch)	(2 * (epoch) + 1)
+
+// ranks in local memory carry the flag in the top bit
+#define KEPT_BIT	0x80000000u
+
+#ifdef USE_SUBGROUPS
+#pragma OPENCL EXTENSION cl_khr_subgroups : enable
+#endif
+
+bool Keep(const __global VALUE_T* in, const __global uint* flags, uint i)
+{
+#ifdef PREDICATE
+	return Predicate(in[i], i);
+#else
+	return flags[i] != 0;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Coalesced evaluation of the flags of a tile into ranks[], returns the number of kept elements
+// among the ITEMS_PER_THREAD consecutive elements of this work-item
+uint LoadTileFlags(const __global VALUE_T* in, const __global uint* flags, uint base, uint N, __local uint* ranks)
+{
+	uint LID = get_local_id(0);
+	for(uint k = 0; k < ITEMS_PER_THREAD; k++)
+	{
+		uint i = base + k * BLOCK_SIZE + LID;
+		ranks[k * BLOCK_SIZE + LID] = (i < N && Keep(in, flags, i)) ? 1 : 0;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	uint count = 0;
+	for(uint k = 0; k < ITEMS_PER_THREAD; k++)
+		count += ranks[LID * ITEMS_PER_THREAD + k];
+	return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Exclusive scan of one count per work-item, *total receives the sum over the tile.
+// scratch holds BLOCK_SIZE + 1 elements.
+uint ScanTileCounts(uint count, __local uint* scratch, uint* total)
+{
+	uint LID = get_local_id(0);
+
+#ifdef USE_SUBGROUPS
+	// within a sub-group in registers, only the sub-group totals go through local memory
+	uint subGroupPrefix = sub_group_scan_exclusive_add(count);
+	uint subGroupTotal = sub_group_reduce_add(count);
+	if(get_sub_group_local_id() == 0)
+		scratch[get_sub_group_id()] = subGroupTotal;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if(LID == 0)
+	{
+		uint sum = 0;
+		for(uint s = 0; s < get_num_sub_groups(); s++)
+		{
+			uint t = scratch[s];
+			scratch[s] = sum;
+			sum += t;
+		}
+		scratch[BLOCK_SIZE] = sum;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	*total = scratch[BLOCK_SIZE];
+	uint result = scratch[get_sub_group_id()] + subGroupPrefix;
+#else
+	scratch[LID] = count;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for(uint offset = 1; offset < BLOCK_SIZE; offset *= 2)
+	{
+		uint left = (LID >= offset) ? scratch[LID - offset] : 0;
+		barrier(CLK_LOCAL_MEM_FENCE);
+		scratch[LID] += left;
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	*total = scratch[BLOCK_SIZE - 1];
+	uint result = scratch[LID] - count;
+#endif
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Number of kept elements per tile (only without LOOK_BACK)
+__kernel __attribute__((reqd_work_group_size(BLOCK_SIZE, 1, 1)))
+void CountTiles(const __global VALUE_T* in, const __global uint* flags, uint N, __global uint* tileCounts)
+{
+	__local uint ranks[TILE_ITEMS];
+	__local uint scratch[BLOCK_SIZE + 1];
+
+	uint count = LoadTileFlags(in, flags, get_group_id(0) * TILE_ITEMS, N, ranks);
+
+	uint total;
+	ScanTileCounts(count, scratch, &total);
+
+	if(get_local_id(0) == 0)
+		tileCounts[get_group_id(0)] = total;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Compaction (partition == 0) or stable partition of in into out, in and out must not overlap
+__kernel __attribute__((reqd_work_group_size(BLOCK_SIZE, 1, 1)))
+void CompactTiles(const __global VALUE_T* in, __global VALUE_T* out, const __global uint* flags, uint N, uint partition,
+	__global uint* count, __global uint* tileCounter, volatile __global uint* tileFlags,
+	volatile __global uint* tileAggregate, volatile __global uint* tilePrefix, uint epoch,
+	const __global VALUE_T* in2, __global VALUE_T* out2, uint pair)
+{
+	__local uint ranks[TILE_ITEMS];
+	__local uint scratch[BLOCK_SIZE + 1];
+	__local uint tileIndex;
+	__local uint exclusivePrefix;
+
+	uint LID = get_local_id(0);
+	uint nTiles = (N + TILE_ITEMS - 1) / TILE_ITEMS;
+
+#ifdef LOOK_BACK
+	if(LID == 0)
+		tileIndex = atomic_inc(tileCounter);
+	barrier(CLK_LOCAL_MEM_FENCE);
+	uint tile = tileIndex;
+#else
+	uint tile = get_group_id(0);
+#endif
+
+	uint base = tile * TILE_ITEMS;
+	uint threadCount = LoadTileFlags(in, flags, base, N, ranks);
+
+	uint tileCount;
+	uint rank = ScanTileCounts(threadCount, scratch, &tileCount);
+
+	// the flags of the consecutive elements of this work-item become their ranks within the tile
+	for(uint k = 0; k < ITEMS_PER_THREAD; k++)
+	{
+		uint kept = ranks[LID * ITEMS_PER_THREAD + k];
+		ranks[LID * ITEMS_PER_THREAD + k] = rank | (kept ? KEPT_BIT : 0);
+		rank += kept;
+	}
+
+	if(LID == 0)
+	{
+		uint prefix = 0;
+
+#ifdef LOOK_BACK
+		if(tile > 0)
+		{
+			tileAggregate[tile] = tileCount;
+			mem_fence(CLK_GLOBAL_MEM_FENCE);
+			tileFlags[tile] = STATUS_AGGREGATE(epoch);
+
+			// look-back, tile 0 always publishes its prefix so the walk ends there at the latest
+			int pred = tile - 1;
+			for(;;)
+			{
+				uint flag = tileFlags[pred];
+				if(flag == STATUS_PREFIX(epoch))
+				{
+					mem_fence(CLK_GLOBAL_MEM_FENCE);
+					prefix += tilePrefix[pred];
+					break;
+				}
+				if(flag == STATUS_AGGREGATE(epoch))
+				{
+					mem_fence(CLK_GLOBAL_MEM_FENCE);
+					prefix += tileAggregate[pred];
+					pred--;
+				}
+			}
+		}
+
+		tilePrefix[tile] = prefix + tileCount;
+		mem_fence(CLK_GLOBAL_MEM_FENCE);
+		tileFlags[tile] = STATUS_PREFIX(epoch);
+
+		// ticket counter reset, see Scan_DecoupledLookBack
+		if(tile == nTiles - 1)
+			*tileCounter = 0;
+#else
+		prefix = tilePrefix[tile];
+#endif
+
+		exclusivePrefix = prefix;
+		if(tile == nTiles - 1)
+			*count = prefix + tileCount;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// coalesced scatter, the kept elements of a tile are consecutive in the output
+	for(uint k = 0; k < ITEMS_PER_THREAD; k++)
+	{
+		uint i = base + k * BLOCK_SIZE + LID;
+		if(i >= N)
+			break;
+
+		uint entry = ranks[k * BLOCK_SIZE + LID];
+		uint keptBefore = exclusivePrefix + (entry & ~KEPT_BIT);
+		if(!(entry & KEPT_BIT) && !partition)
+			continue;
+
+		uint target = (entry & KEPT_BIT) ? keptBefore : N - 1 - (i - keptBefore);
+		out[target] = in[i];
+		if(pair)
+			out2[target] = in2[i];
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reverses out[*count .. N), one pair of elements per work-item
+__kernel void ReverseTail(__global VALUE_T* out, uint N, const __global uint* count)
+{
+	uint GID = get_global_id(0);
+	uint first = *count;
+
+	if(GID < (N - first) / 2)
+	{
+		VALUE_T a = out[first + GID];
+		out[first + GID] = out[N - 1 - GID];
+		out[N - 1 - GID] = a;
+	}
+}
@@ -0,0 +1,143 @@
+
+// LSD radix sort used by CRadixSort. The host sets KEY_T (uint or ulong), RADIX_BITS (digit width),
+// BLOCK_SIZE, ITEMS_PER_THREAD and HAS_VALUES (sort key / value pairs, values are uint).
+//
+// Every pass sorts by one digit: RadixHistogram counts the digits of every tile in local memory,
+// the host scans the counts (digit-major, so the scan yields the output position of every digit
+// of every tile) and RadixScatter moves the keys. Both kernels work on the same tiles of
+// BLOCK_SIZE * ITEMS_PER_THREAD keys. The scatter is stable, as LSD radix sort requires.
+
+#define RADIX		(1 << RADIX_BITS)
+#define TILE_ITEMS	(BLOCK_SIZE * ITEMS_PER_THREAD)
+
+uint Digit(KEY_T Key, uint Shift)
+{
+	return (uint)(Key >> Shift) & (RADIX - 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Exclusive scan of one value per work-item, *total receives the sum over the block
+uint ExclusiveScanBlock(uint x, __local uint* scanBlock, uint* total)
+{
+	uint LID = get_local_id(0);
+
+	scanBlock[LID] = x;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for(uint offset = 1; offset < BLOCK_SIZE; offset *= 2)
+	{
+		uint left = (LID >= offset) ? scanBlock[LID - offset] : 0;
+		barrier(CLK_LOCAL_MEM_FENCE);
+		scanBlock[LID] += left;
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	*total = scanBlock[BLOCK_SIZE - 1];
+	uint result = scanBlock[LID] - x;
+	barrier(CLK_LOCAL_MEM_FENCE);
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Digit counts of every tile, stored as histograms[digit * nTiles + tile]
+__kernel __attribute__((reqd_work_group_size(BLOCK_SIZE, 1, 1)))
+void RadixHistogram(const __global KEY_T* keys, uint N, uint shift, __global uint* histograms)
+{
+	__local uint hist[RADIX];
+
+	uint LID = get_local_id(0);
+	uint tile = get_group_id(0);
+
+	for(uint d = LID; d < RADIX; d += BLOCK_SIZE)
+		hist[d] = 0;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	uint base = tile * TILE_ITEMS;
+	for(uint k = 0; k < ITEMS_PER_THREAD; k++)
+	{
+		uint i = base + k * BLOCK_SIZE + LID;
+		if(i < N)
+			atomic_inc(&hist[Digit(keys[i], shift)]);
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for(uint d = LID; d < RADIX; d += BLOCK_SIZE)
+		histograms[d * get_num_groups(0) + tile] = hist[d];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Moves the keys of a tile to their positions for this digit. offsets is the exclusive scan of the histograms.
+// The tile is processed in chunks of BLOCK_SIZE keys: every chunk is sorted by the digit in local memory with
+// RADIX_BITS stable 1-bit splits, so the keys of one digit end up consecutive (and in input order). Their
+// position is then the offset of the digit plus the rank within the run.
+__kernel __attribute__((reqd_work_group_size(BLOCK_SIZE, 1, 1)))
+void RadixScatter(const __global KEY_T* keysIn, __global KEY_T* keysOut, const __global uint* valuesIn, __global uint* valuesOut,
+	uint N, uint shift, const __global uint* offsets)
+{
+	__local uint digitOffset[RADIX];	// output position of the next key with this digit
+	__local uint digitStart[RADIX];		// start of the digit's run in the sorted chunk
+	__local KEY_T localKeys[BLOCK_SIZE];
+	__local uint localValues[BLOCK_SIZE];
+	__local uint localDigits[BLOCK_SIZE];
+	__local uint scanBlock[BLOCK_SIZE];
+
+	uint LID = get_local_id(0);
+	uint tile = get_group_id(0);
+
+	for(uint d = LID; d < RADIX; d += BLOCK_SIZE)
+		digitOffset[d] = offsets[d * get_num_groups(0) + tile];
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for(uint c = 0; c < ITEMS_PER_THREAD; c++)
+	{
+		uint chunk = tile * TILE_ITEMS + c * BLOCK_SIZE;
+		if(chunk >= N)
+			break;
+
+		// keys beyond N get the highest digit: the stable sort keeps them behind all valid keys
+		uint i = chunk + LID;
+		KEY_T key = (i < N) ? keysIn[i] : 0;
+		uint value = 0;
+#ifdef HAS_VALUES
+		value = (i < N) ? valuesIn[i] : 0;
+#endif
+		uint digit = (i < N) ? Digit(key, shift) : RADIX - 1;
+
+		for(uint b = 0; b < RADIX_BITS; b++)
+		{
+			uint isZero = ((digit >> b) & 1) == 0;
+			uint nZeros;
+			uint zerosBefore = ExclusiveScanBlock(isZero, scanBlock, &nZeros);
+			uint dst = isZero ? zerosBefore : nZeros + LID - zerosBefore;
+
+			localKeys[dst] = key;
+			localValues[dst] = value;
+			localDigits[dst] = digit;
+			barrier(CLK_LOCAL_MEM_FENCE);
+
+			key = localKeys[LID];
+			value = localValues[LID];
+			digit = localDigits[LID];
+			barrier(CLK_LOCAL_MEM_FENCE);
+		}
+
+		if(LID == 0 || localDigits[LID - 1] != digit)
+			digitStart[digit] = LID;
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		if(LID < N - chunk)
+		{
+			uint dst = digitOffset[digit] + LID - digitStart[digit];
+			keysOut[dst] = key;
+#ifdef HAS_VALUES
+			valuesOut[dst] = value;
+#endif
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// the last key of every run advances the offset of its digit
+		if(LID == BLOCK_SIZE - 1 || localDigits[LID + 1] != digit)
+			digitOffset[digit] += LID - digitStart[digit] + 1;
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+}